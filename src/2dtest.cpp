@@ -196,6 +196,9 @@ int mymain(list<string> &args) {
     mycfg.register_option("water_detail", 128);
     mycfg.register_option("wave_fft_res", 128);
     mycfg.register_option("wave_phases", 256);
+    mycfg.register_option("wave_streaming", false); // compute wave phases on the fly
+    mycfg.register_option("wave_seed", 1); // 0 = different waves on every run
+    mycfg.register_option("wave_cache_dir", std::string("")); // directory for precomputed waves, empty = no cache
     mycfg.register_option("wavetile_length", 256.0f);
     mycfg.register_option("wave_tidecycle_time", 10.24f);
     mycfg.register_option("usex86sse", true);
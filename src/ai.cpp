@@ -193,7 +193,7 @@ void ai::act_escort(game &gm, double delta_time) {
     // any subs in visual range to attack?
     vector<submarine *> subs = gm.visible_submarines(parent);
     for (vector<submarine *>::iterator it = subs.begin(); it != subs.end(); ++it) {
-        double d = (*it)->get_pos().xy().distance(parent->get_pos().xy());
+        double d = (*it)->get_step_pos().xy().distance(parent->get_pos().xy());
         if (d < dist) {
             dist = d;
             nearest_contact = *it;
@@ -204,7 +204,7 @@ void ai::act_escort(game &gm, double delta_time) {
         // any subs in radar range to attack?
         subs = gm.radar_submarines(parent);
         for (vector<submarine *>::iterator it = subs.begin(); it != subs.end(); ++it) {
-            double d = (*it)->get_pos().xy().distance(parent->get_pos().xy());
+            double d = (*it)->get_step_pos().xy().distance(parent->get_pos().xy());
             if (d < dist) {
                 dist = d;
                 nearest_contact = *it;
@@ -214,12 +214,12 @@ void ai::act_escort(game &gm, double delta_time) {
 
     if (nearest_contact) { // is there a contact?
         if (dist <= parent->max_gun_range()) {
-            if (ship::GUN_NOT_MANNED == parent->fire_shell_at(*nearest_contact))
+            if (ship::GUN_NOT_MANNED == parent->fire_shell_at(nearest_contact->get_step_pos().xy()))
                 parent->man_guns();
         }
-        attack_contact(nearest_contact->get_pos());
+        attack_contact(nearest_contact->get_step_pos());
         if (myconvoy)
-            myconvoy->add_contact(nearest_contact->get_pos());
+            myconvoy->add_contact(nearest_contact->get_step_pos());
         parent->set_throttle(ship::aheadflank);
         attackrun = true;
     }
@@ -292,7 +292,7 @@ void ai::act_escort(game &gm, double delta_time) {
 
 void ai::act_dumb(game &gm, double delta_time) {
     if (state == followobject && followme) {
-        set_course_to_pos(gm, followme->get_pos().xy());
+        set_course_to_pos(gm, followme->get_step_pos().xy());
     } else if (state == followpath) {
         if (waypoints.size() > 0) {
             set_course_to_pos(gm, waypoints.front());
@@ -0,0 +1,197 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Loads specs, models and textures of all objects of a game in advance
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "asset_preloader.h"
+#include "datadirs.h"
+#include "error.h"
+#include "global_data.h"
+#include "log.h"
+#include "sea_object.h"
+#include "texture.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+using std::string;
+using std::vector;
+
+namespace {
+typedef std::chrono::steady_clock clk;
+
+double seconds_since(clk::time_point t0) {
+    return std::chrono::duration<double>(clk::now() - t0).count();
+}
+} // namespace
+
+asset_preloader::asset_preloader(thread_pool *pool_) : pool(pool_) {
+}
+
+asset_preloader::~asset_preloader() {
+    sdl_image::clear_preloaded();
+}
+
+void asset_preloader::add_object_type(const std::string &type, const std::string &layout) {
+    if (std::find(types.begin(), types.end(), type) == types.end())
+        types.push_back(type);
+    layouts[type].insert(layout);
+}
+
+void asset_preloader::add_objects(const xml_elem &parent, const std::string &group, const std::string &childname) {
+    if (!parent.has_child(group))
+        return;
+    // the layout depends on the skin data of the object and the skins of the spec
+    for (xml_elem::iterator it = parent.child(group).iterate(childname); !it.end(); it.next()) {
+        string type = it.elem().attr("type");
+        if (std::find(types.begin(), types.end(), type) == types.end())
+            types.push_back(type);
+        saved_objects.emplace_back(type, it.elem());
+    }
+}
+
+void asset_preloader::add_random_skins(const std::string &type, const date &d) {
+    if (std::find(types.begin(), types.end(), type) == types.end())
+        types.push_back(type);
+    random_skins.emplace_back(type, d);
+}
+
+void asset_preloader::load() {
+    load_specs();
+    resolve_layouts();
+    load_models();
+    prepare_models();
+}
+
+xml_elem asset_preloader::get_spec(const std::string &type) {
+    auto it = specs.find(type);
+    if (it == specs.end())
+        throw error(string("asset_preloader: spec of type ") + type + " was not loaded");
+    return it->second->first_child();
+}
+
+void asset_preloader::run(unsigned nr_of_tasks, const std::function<void(unsigned)> &func) {
+    if (pool) {
+        pool->run(nr_of_tasks, [&](unsigned task, unsigned) { func(task); });
+    } else {
+        for (unsigned i = 0; i < nr_of_tasks; ++i)
+            func(i);
+    }
+}
+
+void asset_preloader::load_specs() {
+    auto t0 = clk::now();
+    // resolving filenames uses the data file handler, so do it here and not in the workers
+    vector<std::unique_ptr<xml_doc>> docs;
+    docs.reserve(types.size());
+    for (const auto &type : types)
+        docs.push_back(std::make_unique<xml_doc>(data_file().get_filename(type)));
+    vector<timing> times(types.size());
+    run(unsigned(types.size()), [&](unsigned i) {
+        auto t = clk::now();
+        docs[i]->load();
+        times[i] = timing("spec", types[i], seconds_since(t));
+    });
+    for (unsigned i = 0; i < types.size(); ++i)
+        specs[types[i]] = std::move(docs[i]);
+    timings.insert(timings.end(), times.begin(), times.end());
+    stage_timings.push_back(timing("specs", "", seconds_since(t0)));
+}
+
+void asset_preloader::resolve_layouts() {
+    // same choice as sea_object::load and sea_object::set_random_skin_name
+    for (const auto &so : saved_objects)
+        layouts[so.first].insert(sea_object::get_skin_layout(get_spec(so.first), so.second));
+    for (const auto &rs : random_skins) {
+        vector<string> names = sea_object::get_random_skin_layouts(get_spec(rs.first), rs.second);
+        layouts[rs.first].insert(names.begin(), names.end());
+    }
+    saved_objects.clear();
+    random_skins.clear();
+}
+
+void asset_preloader::load_models() {
+    auto t0 = clk::now();
+    // the same model names as sea_object uses, so the objects find them in the cache
+    std::map<string, std::set<string>> modelnames;
+    for (const auto &type : types) {
+        xml_elem cl = get_spec(type).child("classification");
+        const std::set<string> &l = layouts[type];
+        modelnames[data_file().get_rel_path(cl.attr("identifier")) + cl.attr("modelname")].insert(l.begin(), l.end());
+    }
+    // models create vertex buffers, so they must be created by the thread owning the GL context
+    for (const auto &mn : modelnames) {
+        auto t = clk::now();
+        models.emplace_back(modelcache(), mn.first);
+        model_layouts.push_back(mn.second);
+        timings.push_back(timing("model", mn.first, seconds_since(t)));
+    }
+    stage_timings.push_back(timing("models", "", seconds_since(t0)));
+}
+
+void asset_preloader::prepare_models() {
+    auto t0 = clk::now();
+    // a task computes the bv_tree of a model or decodes a texture, tasks are independent
+    vector<model::mesh *> meshes;
+    vector<string> meshnames;
+    for (auto &m : models) {
+        if (!m->get_base_mesh().has_bv_tree()) {
+            meshes.push_back(&m->get_base_mesh());
+            meshnames.push_back(m->get_filename());
+        }
+    }
+    std::set<string> unique_files;
+    for (unsigned i = 0; i < models.size(); ++i) {
+        for (const auto &layout : model_layouts[i]) {
+            vector<string> files;
+            models[i]->get_texture_filenames(layout, files);
+            unique_files.insert(files.begin(), files.end());
+        }
+    }
+    vector<string> files(unique_files.begin(), unique_files.end());
+    const unsigned nr_meshes = unsigned(meshes.size());
+    vector<timing> times(nr_meshes + files.size());
+    run(unsigned(times.size()), [&](unsigned i) {
+        auto t = clk::now();
+        if (i < nr_meshes) {
+            meshes[i]->compute_bv_tree();
+            times[i] = timing("bv_tree", meshnames[i], seconds_since(t));
+        } else {
+            const string &fn = files[i - nr_meshes];
+            bool ok = sdl_image::preload(fn);
+            times[i] = timing(ok ? "texture" : "texture (failed)", fn, seconds_since(t));
+        }
+    });
+    timings.insert(timings.end(), times.begin(), times.end());
+    stage_timings.push_back(timing("bv_trees and textures", "", seconds_since(t0)));
+}
+
+void asset_preloader::log_report() const {
+    std::ostringstream oss;
+    oss << "preloaded " << specs.size() << " specs and " << models.size() << " models using "
+        << (pool ? pool->get_nr_of_threads() : 1U) << " threads\n";
+    for (const auto &t : stage_timings)
+        oss << "stage " << t.kind << ": " << unsigned(t.seconds * 1000000.0) << " us\n";
+    for (const auto &t : timings)
+        oss << t.kind << " " << t.name << ": " << unsigned(t.seconds * 1000000.0) << " us\n";
+    log_info(oss.str());
+}
@@ -0,0 +1,120 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Loads specs, models and textures of all objects of a game in advance
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef ASSET_PRELOADER_H
+#define ASSET_PRELOADER_H
+
+#include "date.h"
+#include "model.h"
+#include "objcache.h"
+#include "xml.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+class thread_pool;
+
+///\brief Loads all assets the objects of a mission or savegame need before they are created.
+///@note Assets depend on each other: the specs name the models and the models name
+///	their textures. So loading is done in stages. Spec files are parsed in parallel,
+///	then models are created on the calling thread, as that needs OpenGL. At last the
+///	bounding volume trees of the models are computed and the textures of the
+///	skin layouts the objects will use are decoded in parallel. Creating the textures
+///	later only uploads the decoded images. Each spec is parsed once per object type,
+///	not per object. Without a thread pool all stages run on the calling thread.
+class asset_preloader {
+  public:
+    /// time needed to load an asset
+    struct timing {
+        std::string kind;
+        std::string name;
+        double seconds;
+        timing(const std::string &k = std::string(), const std::string &n = std::string(), double s = 0.0)
+            : kind(k), name(n), seconds(s) {}
+    };
+
+    /// create preloader
+    ///@param pool - thread pool for parallel stages, can be null to load everything serially
+    asset_preloader(thread_pool *pool);
+
+    /// destroy preloader, decoded images that were not used are dropped
+    ~asset_preloader();
+
+    /// request spec of an object type and the textures of a skin layout of its model
+    void add_object_type(const std::string &type, const std::string &layout = model::default_layout);
+
+    /// request specs of all objects in a group of a mission or savegame, like "ships",
+    /// and the textures of the skin layouts sea_object::load will choose for them.
+    ///@note parent must stay valid until load() was called.
+    void add_objects(const xml_elem &parent, const std::string &group, const std::string &childname);
+
+    /// request spec of an object type and the textures of all skin layouts
+    /// sea_object::set_random_skin_name can choose at the date
+    void add_random_skins(const std::string &type, const date &d);
+
+    /// load all requested assets
+    void load();
+
+    /// get parsed spec of an object type, type must have been requested and loaded
+    xml_elem get_spec(const std::string &type);
+
+    /// get time needed per asset
+    const std::vector<timing> &get_timings() const { return timings; }
+
+    /// write time needed per asset and per stage to the log
+    void log_report() const;
+
+  protected:
+    thread_pool *pool;
+    std::vector<std::string> types;
+    std::map<std::string, std::unique_ptr<xml_doc>> specs;
+    // skin layouts per type, completed from the requests below when the specs are loaded
+    std::map<std::string, std::set<std::string>> layouts;
+    std::vector<std::pair<std::string, xml_elem>> saved_objects;
+    std::vector<std::pair<std::string, date>> random_skins;
+    // references keep the models in the cache until the objects use them
+    std::vector<objcachet<model>::reference> models;
+    // skin layouts per model, same order as models
+    std::vector<std::set<std::string>> model_layouts;
+    std::vector<timing> timings;
+    // wall clock time per stage
+    std::vector<timing> stage_timings;
+
+    /// run tasks on pool or on calling thread
+    void run(unsigned nr_of_tasks, const std::function<void(unsigned)> &func);
+
+    void load_specs();
+    void resolve_layouts();
+    void load_models();
+    void prepare_models();
+
+  private:
+    asset_preloader(const asset_preloader &) = delete;
+    asset_preloader &operator=(const asset_preloader &) = delete;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Precomputed elevation per distance for deck guns
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "ballistic_table.h"
+#include "global_constants.h"
+#include "mutex.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+
+// see ship::fire_shell_at and gun_shell::gun_shell
+const double ballistic_table::launch_height = 4.0;
+const double ballistic_table::launch_straight_time = 0.5;
+
+namespace {
+::mutex tables_mutex;
+std::map<double, std::unique_ptr<ballistic_table>> tables;
+} // namespace
+
+ballistic_table::ballistic_table(double initial_velocity_, double min_elevation, double max_elevation, double step)
+    : initial_velocity(initial_velocity_) {
+    const unsigned nr_steps = unsigned(std::floor((max_elevation - min_elevation) / step + 0.5));
+    for (unsigned i = 0; i <= nr_steps; ++i) {
+        double a = min_elevation + i * step;
+        double d = compute_distance(initial_velocity, a);
+        // maximum range is reached a bit below 45 degrees, higher angles don't reach further
+        if (!distances.empty() && d <= distances.back())
+            break;
+        distances.push_back(d);
+        elevations.push_back(a);
+    }
+}
+
+const ballistic_table &ballistic_table::get(double initial_velocity) {
+    mutex_locker ml(tables_mutex);
+    std::unique_ptr<ballistic_table> &t = tables[initial_velocity];
+    if (!t)
+        t = std::make_unique<ballistic_table>(initial_velocity);
+    return *t;
+}
+
+double ballistic_table::compute_distance(double initial_velocity, double elevation) {
+    angle a(elevation);
+    const double vz = initial_velocity * a.sin();
+    const double vd = initial_velocity * a.cos();
+    const double z0 = launch_height + vz * launch_straight_time;
+    if (z0 <= 0) {
+        // steep downwards, hits water before falling
+        return vd * launch_height / -vz;
+    }
+    // z0 + vz * t - g/2 * t^2 = 0
+    const double t = (vz + std::sqrt(vz * vz + 2.0 * GRAVITY * z0)) / GRAVITY;
+    return vd * (launch_straight_time + t);
+}
+
+bool ballistic_table::get_elevation(double distance, angle &elevation) const {
+    if (distance > distances.back())
+        return false;
+    std::vector<double>::const_iterator it = std::lower_bound(distances.begin(), distances.end(), distance);
+    const unsigned i = unsigned(it - distances.begin());
+    if (i == 0) {
+        elevation = angle(elevations.front());
+        return true;
+    }
+    const double f = (distance - distances[i - 1]) / (distances[i] - distances[i - 1]);
+    elevation = angle(elevations[i - 1] + f * (elevations[i] - elevations[i - 1]));
+    return true;
+}
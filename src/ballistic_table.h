@@ -0,0 +1,75 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Precomputed elevation per distance for deck guns
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef BALLISTIC_TABLE_H
+#define BALLISTIC_TABLE_H
+
+#include "angle.h"
+#include <vector>
+
+///\brief Relation of shooting distance and gun elevation for one muzzle velocity.
+///@note Shells only feel gravity in the simulation, so the distance is computed in
+///	closed form for the trajectory gun_shell really flies: it starts at launch_height,
+///	moves straight for launch_straight_time and then follows a parabola down to the
+///	water. Distances are stored sorted in a flat array, elevations in between are
+///	interpolated. Tables are immutable and shared per muzzle velocity, so any number
+///	of threads can use them.
+class ballistic_table {
+  public:
+    /// height above the ship's position where shells start
+    static const double launch_height;
+    /// time the shell flies straight before it is simulated (avoids collision with the ship)
+    static const double launch_straight_time;
+
+    /// build table for elevations min_elevation...max_elevation in steps (degrees)
+    ballistic_table(double initial_velocity, double min_elevation = -20.0, double max_elevation = 45.0,
+                    double step = 0.1);
+
+    /// get shared table for a muzzle velocity, built on first request, thread safe
+    static const ballistic_table &get(double initial_velocity);
+
+    /// horizontal distance where a shell hits the water
+    static double compute_distance(double initial_velocity, double elevation);
+
+    /// get elevation needed to hit at a distance
+    ///@returns false if distance is out of range. Distances closer than the range of
+    ///	min_elevation give min_elevation.
+    bool get_elevation(double distance, angle &elevation) const;
+
+    /// get maximum distance that can be reached
+    double get_max_range() const { return distances.back(); }
+
+    /// get muzzle velocity
+    double get_initial_velocity() const { return initial_velocity; }
+
+    /// get number of entries
+    unsigned size() const { return unsigned(distances.size()); }
+
+  protected:
+    double initial_velocity;
+    // strictly increasing distances and their elevations
+    std::vector<double> distances;
+    std::vector<double> elevations;
+};
+
+#endif
@@ -0,0 +1,195 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// File of raw arrays (sections) with header, checksum and section table
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "binary_container.h"
+#include "error.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+uint64_t binary_container::hash(const void *data, size_t size, uint64_t h) {
+    // FNV-1a, on 64bit words where possible, because the data is large
+    const uint64_t prime = 1099511628211ULL;
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    for (; size >= 8; size -= 8, p += 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * prime;
+    }
+    for (; size > 0; --size, ++p)
+        h = (h ^ *p) * prime;
+    return h;
+}
+
+binary_container::writer::writer(const std::string &filename_, const format &fmt_, uint64_t key_)
+    : filename(filename_), tmpfilename(filename_ + ".tmp"), fmt(fmt_), key(key_), checksum(hash(nullptr, 0)),
+      next_in_order(0), in_order(true), finished(false) {
+    out.open(tmpfilename.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.good())
+        throw error(std::string("can't write ") + fmt.description + " " + tmpfilename);
+    // header is written when finished
+    header h;
+    memset(&h, 0, sizeof(h));
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+}
+
+binary_container::writer::~writer() {
+    if (!finished) {
+        out.close();
+        std::remove(tmpfilename.c_str());
+    }
+}
+
+void binary_container::writer::set_nr_of_sections(unsigned n) {
+    if (2 * size_t(n) < table.size())
+        throw error(std::string("too many sections written to ") + fmt.description + " " + filename);
+    table.resize(2 * size_t(n), 0);
+}
+
+void binary_container::writer::write(unsigned section, const void *data, size_t size) {
+    if (2 * size_t(section) >= table.size())
+        table.resize(2 * size_t(section) + 2, 0);
+    uint64_t *entry = &table[2 * size_t(section)];
+    if (entry[0] != 0)
+        throw error(std::string("section written twice to ") + fmt.description + " " + filename);
+    uint64_t offset = uint64_t(out.tellp());
+    uint64_t aligned = (offset + alignment - 1) & ~uint64_t(alignment - 1);
+    static const char padding[alignment] = {};
+    out.write(padding, std::streamsize(aligned - offset));
+    out.write(static_cast<const char *>(data), std::streamsize(size));
+    if (!out.good())
+        throw error(std::string("writing ") + fmt.description + " failed " + tmpfilename);
+    checksum = hash(data, size, checksum);
+    entry[0] = aligned;
+    entry[1] = size;
+    // the reader checks in table order, so the running checksum is only valid in that order
+    if (section < next_in_order)
+        in_order = false;
+    else
+        next_in_order = section + 1;
+}
+
+uint64_t binary_container::writer::compute_checksum_in_table_order() {
+    out.flush();
+    std::ifstream in(tmpfilename.c_str(), std::ios::binary);
+    // chunks are a multiple of 8 bytes, so hashing them in sequence gives the hash of the section
+    std::vector<char> buffer(1024 * 1024);
+    uint64_t h = hash(nullptr, 0);
+    for (size_t i = 0; i < table.size(); i += 2) {
+        in.seekg(std::streamoff(table[i]));
+        for (uint64_t left = table[i + 1]; left > 0;) {
+            size_t n = size_t(std::min(left, uint64_t(buffer.size())));
+            in.read(buffer.data(), std::streamsize(n));
+            if (!in.good())
+                throw error(std::string("reading back ") + fmt.description + " failed " + tmpfilename);
+            h = hash(buffer.data(), n, h);
+            left -= n;
+        }
+    }
+    return h;
+}
+
+void binary_container::writer::finish() {
+    // table is read in place from the mapped file, so align it
+    uint64_t offset = uint64_t(out.tellp());
+    uint64_t aligned = (offset + alignment - 1) & ~uint64_t(alignment - 1);
+    static const char padding[alignment] = {};
+    out.write(padding, std::streamsize(aligned - offset));
+    header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, fmt.magic, sizeof(h.magic));
+    h.version = fmt.version;
+    h.byte_order = byte_order_mark;
+    h.key = key;
+    h.nr_of_sections = table.size() / 2;
+    h.checksum = in_order ? checksum : compute_checksum_in_table_order();
+    h.table_offset = aligned;
+    out.write(reinterpret_cast<const char *>(table.data()), std::streamsize(table.size() * sizeof(uint64_t)));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    out.close();
+    if (out.fail())
+        throw error(std::string("writing ") + fmt.description + " failed " + tmpfilename);
+    // rename fails on some systems when the target exists
+    std::remove(filename.c_str());
+    if (std::rename(tmpfilename.c_str(), filename.c_str()) != 0)
+        throw error(std::string("can't rename ") + fmt.description + " to " + filename);
+    finished = true;
+}
+
+binary_container::reader::reader(const std::string &filename, const format &fmt_, uint64_t key, bool verify)
+    : fmt(fmt_), file(std::make_unique<mapped_file>(filename)), table(nullptr), next(0) {
+    const uint64_t file_size = file->size();
+    if (file_size < sizeof(hdr))
+        throw_corrupt();
+    memcpy(&hdr, file->data(), sizeof(hdr));
+    if (memcmp(hdr.magic, fmt.magic, sizeof(hdr.magic)) != 0)
+        throw_corrupt();
+    if (hdr.version != fmt.version || hdr.byte_order != byte_order_mark || hdr.key != key)
+        throw error(std::string(fmt.description) + " is stale: " + filename);
+    // check table against file size, so reading sections can't go outside the mapping
+    if (hdr.table_offset < sizeof(hdr) || hdr.table_offset % sizeof(uint64_t) != 0 || hdr.table_offset > file_size ||
+        hdr.nr_of_sections > (file_size - hdr.table_offset) / (2 * sizeof(uint64_t)))
+        throw_corrupt();
+    table = reinterpret_cast<const uint64_t *>(file->data() + hdr.table_offset);
+    for (uint64_t i = 0; i < 2 * hdr.nr_of_sections; i += 2) {
+        if (table[i + 1] == 0)
+            continue;
+        if (table[i] < sizeof(hdr) || table[i + 1] > hdr.table_offset || table[i] > hdr.table_offset - table[i + 1])
+            throw_corrupt();
+    }
+    if (verify) {
+        uint64_t checksum = hash(nullptr, 0);
+        for (uint64_t i = 0; i < 2 * hdr.nr_of_sections; i += 2)
+            if (table[i + 1] != 0)
+                checksum = hash(file->data() + table[i], size_t(table[i + 1]), checksum);
+        if (checksum != hdr.checksum)
+            throw_corrupt();
+    }
+}
+
+const unsigned char *binary_container::reader::get_section(unsigned section, size_t &size) const {
+    if (section >= get_nr_of_sections())
+        throw_unexpected();
+    const uint64_t *entry = table + 2 * size_t(section);
+    size = size_t(entry[1]);
+    return file->data() + entry[0];
+}
+
+const unsigned char *binary_container::reader::next_section(size_t &size) {
+    const unsigned char *p = get_section(next, size);
+    ++next;
+    return p;
+}
+
+void binary_container::reader::finish() const {
+    if (next != get_nr_of_sections())
+        throw_unexpected();
+}
+
+void binary_container::reader::throw_corrupt() const {
+    throw error(std::string(fmt.description) + " is corrupt: " + file->get_filename());
+}
+
+void binary_container::reader::throw_unexpected() const {
+    throw error(std::string(fmt.description) + " has unexpected contents: " + file->get_filename());
+}
@@ -0,0 +1,144 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// File of raw arrays (sections) with header, checksum and section table
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef BINARY_CONTAINER_H
+#define BINARY_CONTAINER_H
+
+#include "mapped_file.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// A file of raw arrays (sections), the common format of compiled and cached data.
+///@note The file starts with a header of magic, version, byte order, key, number of
+///	sections and checksum, followed by the sections aligned to 16 bytes and a table
+///	of section offsets and sizes at the end. The data is stored in native layout and
+///	the file is mapped into memory for reading. Files of other versions, byte order or
+///	keys are reported as stale, damaged files as corrupt, both by throwing error.
+///	The writer writes to a temporary file and renames it when finished, so an aborted
+///	write never leaves a file behind that looks valid.
+class binary_container {
+  protected:
+    /// header of file
+    struct header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t key;
+        uint64_t nr_of_sections;
+        uint64_t checksum;
+        uint64_t table_offset;
+    };
+    static const uint32_t byte_order_mark = 0x01020304;
+    static const unsigned alignment = 16;
+
+  public:
+    /// compute hash (FNV-1a on 64bit words), use to build keys and checksums
+    static uint64_t hash(const void *data, size_t size, uint64_t h = 14695981039346656037ULL);
+    template <class T>
+    static uint64_t hash_value(const T &v, uint64_t h) { return hash(&v, sizeof(T), h); }
+
+    /// kind of file
+    struct format {
+        const char *magic;       ///< 8 characters
+        uint32_t version;        ///< increase on every change of format or contents
+        const char *description; ///< name of file kind for error messages
+    };
+
+    /// writes a file section by section
+    class writer {
+      public:
+        /// open temporary file for writing, throws error on failure
+        writer(const std::string &filename, const format &fmt, uint64_t key);
+        /// removes temporary file when not finished
+        ~writer();
+        /// write next section
+        template <class T>
+        void write(const std::vector<T> &data) { write(data.data(), data.size() * sizeof(T)); }
+        void write(const void *data, size_t size) { write(unsigned(table.size() / 2), data, size); }
+        /// write section with that number, so sections can be written in any order.
+        ///@note Sections not written are empty. Throws error if a section is written twice.
+        void write(unsigned section, const void *data, size_t size);
+        /// set number of sections, sections not written are empty
+        void set_nr_of_sections(unsigned n);
+        /// write section table and header, then replace the file
+        void finish();
+        /// get name of file to write
+        const std::string &get_filename() const { return filename; }
+
+      protected:
+        std::string filename;
+        std::string tmpfilename;
+        format fmt;
+        std::ofstream out;
+        uint64_t key;
+        uint64_t checksum; ///< over sections in order of writing
+        std::vector<uint64_t> table; ///< offset and size per section, offset 0 if not written
+        unsigned next_in_order; ///< sections were written in table order while lower than this
+        bool in_order;
+        bool finished;
+
+        /// compute checksum over sections in table order by reading them back
+        uint64_t compute_checksum_in_table_order();
+    };
+
+    /// maps a file and gives access to its sections
+    class reader {
+      public:
+        /// map file and check header and section table.
+        ///@param verify - check the checksum over all sections now, else the caller can
+        ///	check it while reading with get_checksum()
+        ///@note throws file_read_error if file is missing and error if it is stale or corrupt
+        reader(const std::string &filename, const format &fmt, uint64_t key, bool verify);
+        /// get number of sections
+        unsigned get_nr_of_sections() const { return unsigned(hdr.nr_of_sections); }
+        /// get data and size in bytes of a section, throws error if number is invalid
+        const unsigned char *get_section(unsigned section, size_t &size) const;
+        /// get data and size of the next section, throws error if all were read
+        const unsigned char *next_section(size_t &size);
+        /// check that all sections have been read with next_section, throws error otherwise
+        void finish() const;
+        /// get checksum stored in the file
+        uint64_t get_checksum() const { return hdr.checksum; }
+        /// get name of file
+        const std::string &get_filename() const { return file->get_filename(); }
+        /// throw error that file is corrupt
+        void throw_corrupt() const;
+        /// throw error that file has unexpected contents
+        void throw_unexpected() const;
+
+      protected:
+        format fmt;
+        std::unique_ptr<mapped_file> file;
+        header hdr;
+        const uint64_t *table;
+        unsigned next;
+
+      private:
+        reader(const reader &) = delete;
+        reader &operator=(const reader &) = delete;
+    };
+};
+
+#endif
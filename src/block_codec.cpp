@@ -0,0 +1,177 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Fast block compression in the style of LZ4
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "block_codec.h"
+#include "error.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+const size_t min_match = 4;
+// the last bytes are always literals and matches end before them, so decompression
+// never has to check for the end inside a match (same limits as LZ4)
+const size_t last_literals = 5;
+const size_t match_limit = 12;
+const size_t max_offset = 65535;
+const unsigned hash_bits = 12;
+
+inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+inline unsigned hash4(uint32_t v) {
+    return (v * 2654435761U) >> (32 - hash_bits);
+}
+
+// write length part that doesn't fit into the token
+inline uint8_t *write_length(uint8_t *op, size_t len) {
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = uint8_t(len);
+    return op;
+}
+
+uint8_t *write_sequence(uint8_t *op, const uint8_t *literals, size_t nr_literals, size_t offset, size_t match_len) {
+    uint8_t *token = op++;
+    *token = uint8_t(((nr_literals < 15) ? nr_literals : 15) << 4);
+    if (nr_literals >= 15)
+        op = write_length(op, nr_literals - 15);
+    memcpy(op, literals, nr_literals);
+    op += nr_literals;
+    if (match_len == 0)
+        return op;
+    *op++ = uint8_t(offset & 0xff);
+    *op++ = uint8_t(offset >> 8);
+    match_len -= min_match;
+    *token |= uint8_t((match_len < 15) ? match_len : 15);
+    if (match_len >= 15)
+        op = write_length(op, match_len - 15);
+    return op;
+}
+
+void corrupt() {
+    throw error("block_codec: compressed data is corrupt");
+}
+
+// read length part that doesn't fit into the token
+inline size_t read_length(const uint8_t *&ip, const uint8_t *iend) {
+    size_t len = 0;
+    uint8_t b;
+    do {
+        if (ip >= iend)
+            corrupt();
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+} // namespace
+
+namespace block_codec {
+size_t max_compressed_size(size_t n) {
+    return n + n / 255 + 16;
+}
+
+size_t compress(const void *src, size_t n, void *dst) {
+    const uint8_t *const base = static_cast<const uint8_t *>(src);
+    const uint8_t *const iend = base + n;
+    uint8_t *op = static_cast<uint8_t *>(dst);
+    const uint8_t *anchor = base;
+    if (n > match_limit) {
+        // positions + 1, so zero means empty
+        std::vector<uint32_t> table(size_t(1) << hash_bits, 0);
+        const uint8_t *const search_end = iend - match_limit;
+        const uint8_t *const match_end = iend - last_literals;
+        const uint8_t *ip = base;
+        while (ip <= search_end) {
+            uint32_t v = read32(ip);
+            uint32_t &entry = table[hash4(v)];
+            const uint8_t *ref = base + entry - 1;
+            bool found = entry != 0 && size_t(ip - ref) <= max_offset && read32(ref) == v;
+            entry = uint32_t(ip - base) + 1;
+            if (!found) {
+                ++ip;
+                continue;
+            }
+            const uint8_t *mp = ip + min_match;
+            const uint8_t *mr = ref + min_match;
+            while (mp < match_end && *mp == *mr) {
+                ++mp;
+                ++mr;
+            }
+            op = write_sequence(op, anchor, size_t(ip - anchor), size_t(ip - ref), size_t(mp - ip));
+            ip = anchor = mp;
+        }
+    }
+    op = write_sequence(op, anchor, size_t(iend - anchor), 0, 0);
+    return size_t(op - static_cast<uint8_t *>(dst));
+}
+
+void decompress(const void *src, size_t n, void *dst, size_t out_size) {
+    const uint8_t *ip = static_cast<const uint8_t *>(src);
+    const uint8_t *const iend = ip + n;
+    uint8_t *const obase = static_cast<uint8_t *>(dst);
+    uint8_t *op = obase;
+    uint8_t *const oend = op + out_size;
+    while (true) {
+        if (ip >= iend)
+            corrupt();
+        const unsigned token = *ip++;
+        size_t nr_literals = token >> 4;
+        if (nr_literals == 15)
+            nr_literals += read_length(ip, iend);
+        if (nr_literals > size_t(iend - ip) || nr_literals > size_t(oend - op))
+            corrupt();
+        memcpy(op, ip, nr_literals);
+        ip += nr_literals;
+        op += nr_literals;
+        // the last sequence has no match
+        if (ip == iend)
+            break;
+        if (iend - ip < 2)
+            corrupt();
+        const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+        ip += 2;
+        size_t match_len = token & 15;
+        if (match_len == 15)
+            match_len += read_length(ip, iend);
+        match_len += min_match;
+        if (offset == 0 || offset > size_t(op - obase) || match_len > size_t(oend - op))
+            corrupt();
+        const uint8_t *ref = op - offset;
+        if (offset >= match_len) {
+            memcpy(op, ref, match_len);
+            op += match_len;
+        } else {
+            // overlapping match repeats the last offset bytes
+            for (size_t i = 0; i < match_len; ++i)
+                *op++ = *ref++;
+        }
+    }
+    if (op != oend)
+        corrupt();
+}
+} // namespace block_codec
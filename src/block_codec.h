@@ -0,0 +1,48 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Fast block compression in the style of LZ4
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef BLOCK_CODEC_H
+#define BLOCK_CODEC_H
+
+#include <cstddef>
+
+/// Fast compression of memory blocks, used where bzip2 is too slow to decompress.
+///@note The data is a sequence of LZ4 style sequences: a token with the lengths
+///	of literals and match, the literals, a 16bit offset of the match and the
+///	remaining match length. Only a greedy search with a small hash table is done,
+///	so compression is weaker than bzip2, but decompression is only a sequence of
+///	copies. The uncompressed size is not stored and must be known by the caller.
+namespace block_codec {
+/// get maximum size of compressed data for input of size n
+size_t max_compressed_size(size_t n);
+
+/// compress n bytes from src to dst, dst must have max_compressed_size(n) bytes.
+///@returns size of compressed data
+size_t compress(const void *src, size_t n, void *dst);
+
+/// decompress n bytes from src to exactly out_size bytes in dst.
+///@note throws error if data is corrupt or doesn't decompress to out_size bytes
+void decompress(const void *src, size_t n, void *dst, size_t out_size);
+} // namespace block_codec
+
+#endif
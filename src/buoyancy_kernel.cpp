@@ -0,0 +1,190 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Vectorized voxel buoyancy kernels for ship physics
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "buoyancy_kernel.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BUOYANCY_KERNEL_SSE
+#endif
+
+namespace buoyancy_kernel {
+
+// voxels summed in float lanes before adding to the double sums
+static const unsigned block_size = 256;
+
+const char *get_name(path p) {
+    switch (p) {
+    case scalar:
+        return "scalar";
+    case sse2:
+        return "sse2";
+    default:
+        return "unknown";
+    }
+}
+
+bool is_supported(path p) {
+    switch (p) {
+    case scalar:
+        return true;
+#ifdef BUOYANCY_KERNEL_SSE
+    case sse2:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+path get_best_path() {
+    return is_supported(sse2) ? sse2 : scalar;
+}
+
+// ------------------------------- scalar ---------------------------------
+
+static void transform_scalar(unsigned i, unsigned n, const float *x, const float *y, const float *z, const matrix4f &m,
+                             float *out_x, float *out_y, float *out_z) {
+    for (; i < n; ++i) {
+        vector3f p = m.mul4vec3xlat(vector3f(x[i], y[i], z[i]));
+        out_x[i] = p.x;
+        out_y[i] = p.y;
+        out_z[i] = p.z;
+    }
+}
+
+static void accumulate_scalar(unsigned i, unsigned n, const float *x, const float *y, const float *z,
+                              const float *water_height, const float *part_of_volume, const float *relative_mass,
+                              const float *flooded_mass, const parameters &par, sums &s) {
+    for (; i < n; ++i) {
+        float below = std::max(std::min((z[i] + par.position_z - water_height[i]) / par.voxel_radius, 1.0f), -1.0f);
+        // voxels partly below water must be computed or torque is severely wrong
+        float submerged_part = 1.0f - (below + 1.0f) * 0.5f;
+        float lift_force = part_of_volume[i] * par.voxel_volume_force * submerged_part;
+        float gravity_force = par.gravity_force * relative_mass[i] + flooded_mass[i] * par.flooded_gravity;
+        float f = lift_force + gravity_force;
+        s.force_z += f;
+        s.torque_x += y[i] * f;
+        s.torque_y -= x[i] * f;
+        s.volume_below_water += part_of_volume[i] * submerged_part;
+    }
+}
+
+// -------------------------------- sse2 ----------------------------------
+
+#ifdef BUOYANCY_KERNEL_SSE
+static unsigned transform_sse2(unsigned n, const float *x, const float *y, const float *z, const matrix4f &m,
+                               float *out_x, float *out_y, float *out_z) {
+    // same order of operations as matrix4::mul4vec3xlat, so results are identical
+    __m128 mc[3][4];
+    for (unsigned j = 0; j < 3; ++j)
+        for (unsigned k = 0; k < 4; ++k)
+            mc[j][k] = _mm_set1_ps(m.elem(k, j));
+    float *out[3] = {out_x, out_y, out_z};
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 vz = _mm_loadu_ps(z + i);
+        for (unsigned j = 0; j < 3; ++j) {
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(mc[j][0], vx), _mm_mul_ps(mc[j][1], vy)),
+                                             _mm_mul_ps(mc[j][2], vz)),
+                                  mc[j][3]);
+            _mm_storeu_ps(out[j] + i, r);
+        }
+    }
+    return i;
+}
+
+static double horizontal_sum(__m128 v) {
+    float f[4];
+    _mm_storeu_ps(f, v);
+    return (double(f[0]) + double(f[1])) + (double(f[2]) + double(f[3]));
+}
+
+static unsigned accumulate_sse2(unsigned n, const float *x, const float *y, const float *z,
+                                const float *water_height, const float *part_of_volume, const float *relative_mass,
+                                const float *flooded_mass, const parameters &par, sums &s) {
+    const __m128 pos_z = _mm_set1_ps(par.position_z);
+    const __m128 radius = _mm_set1_ps(par.voxel_radius);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minus_one = _mm_set1_ps(-1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 volume_force = _mm_set1_ps(par.voxel_volume_force);
+    const __m128 gravity = _mm_set1_ps(par.gravity_force);
+    const __m128 flooded_gravity = _mm_set1_ps(par.flooded_gravity);
+    unsigned i = 0;
+    while (i + 4 <= n) {
+        const unsigned block_end = std::min(i + block_size, n & ~3U);
+        __m128 force = _mm_setzero_ps(), torque_x = _mm_setzero_ps(), torque_y = _mm_setzero_ps();
+        __m128 volume = _mm_setzero_ps();
+        for (; i < block_end; i += 4) {
+            __m128 d = _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(z + i), pos_z), _mm_loadu_ps(water_height + i));
+            __m128 below = _mm_max_ps(_mm_min_ps(_mm_div_ps(d, radius), one), minus_one);
+            __m128 submerged_part = _mm_sub_ps(one, _mm_mul_ps(_mm_add_ps(below, one), half));
+            __m128 pv = _mm_loadu_ps(part_of_volume + i);
+            __m128 lift_force = _mm_mul_ps(_mm_mul_ps(pv, volume_force), submerged_part);
+            __m128 gravity_force = _mm_add_ps(_mm_mul_ps(gravity, _mm_loadu_ps(relative_mass + i)),
+                                              _mm_mul_ps(_mm_loadu_ps(flooded_mass + i), flooded_gravity));
+            __m128 f = _mm_add_ps(lift_force, gravity_force);
+            force = _mm_add_ps(force, f);
+            torque_x = _mm_add_ps(torque_x, _mm_mul_ps(_mm_loadu_ps(y + i), f));
+            torque_y = _mm_sub_ps(torque_y, _mm_mul_ps(_mm_loadu_ps(x + i), f));
+            volume = _mm_add_ps(volume, _mm_mul_ps(pv, submerged_part));
+        }
+        s.force_z += horizontal_sum(force);
+        s.torque_x += horizontal_sum(torque_x);
+        s.torque_y += horizontal_sum(torque_y);
+        s.volume_below_water += horizontal_sum(volume);
+    }
+    return i;
+}
+#endif
+
+// ------------------------------ dispatch --------------------------------
+
+void transform(path p, unsigned n, const float *x, const float *y, const float *z, const matrix4f &m,
+               float *out_x, float *out_y, float *out_z) {
+    unsigned i = 0;
+#ifdef BUOYANCY_KERNEL_SSE
+    if (p == sse2)
+        i = transform_sse2(n, x, y, z, m, out_x, out_y, out_z);
+#endif
+    transform_scalar(i, n, x, y, z, m, out_x, out_y, out_z);
+}
+
+sums accumulate(path p, unsigned n, const float *x, const float *y, const float *z, const float *water_height,
+                const float *part_of_volume, const float *relative_mass, const float *flooded_mass,
+                const parameters &par) {
+    sums s;
+    unsigned i = 0;
+#ifdef BUOYANCY_KERNEL_SSE
+    if (p == sse2)
+        i = accumulate_sse2(n, x, y, z, water_height, part_of_volume, relative_mass, flooded_mass, par, s);
+#endif
+    accumulate_scalar(i, n, x, y, z, water_height, part_of_volume, relative_mass, flooded_mass, par, s);
+    return s;
+}
+
+} // namespace buoyancy_kernel
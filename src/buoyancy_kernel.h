@@ -0,0 +1,81 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Vectorized voxel buoyancy kernels for ship physics
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef BUOYANCY_KERNEL_H
+#define BUOYANCY_KERNEL_H
+
+#include "matrix4.h"
+
+/// Kernels for the per voxel work of ship::compute_force_and_torque on float arrays.
+///@note All arrays are structures of arrays. The scalar path is the reference. The
+///	SIMD path handles four voxels at once and sums in float lanes for blocks of
+///	voxels before adding to double precision sums, so its sums differ from the
+///	scalar path by some float epsilons.
+namespace buoyancy_kernel {
+/// implementations of the kernels
+enum path {
+    scalar,
+    sse2,
+    nr_of_paths
+};
+
+/// get name of path
+const char *get_name(path p);
+
+/// is path supported by this build?
+bool is_supported(path p);
+
+/// get fastest supported path
+path get_best_path();
+
+/// transform voxel positions, out = m * (x, y, z, 1), m must not be projective
+void transform(path p, unsigned n, const float *x, const float *y, const float *z, const matrix4f &m,
+               float *out_x, float *out_y, float *out_z);
+
+/// constant values for accumulation
+struct parameters {
+    float position_z;         ///< z position of the ship, added to voxel z
+    float voxel_radius;       ///< "radius" of a voxel
+    float voxel_volume_force; ///< lift force of a voxel fully filled with model volume and fully below water
+    float gravity_force;      ///< gravity force of the whole ship (negative)
+    float flooded_gravity;    ///< gravity per flooded mass unit (negative)
+};
+
+/// sums of forces acting on the voxels
+struct sums {
+    double force_z;         ///< sum of lift and gravity forces, all in z direction
+    double torque_x;        ///< torque by forces, relative to center, z is always zero
+    double torque_y;
+    double volume_below_water; ///< sum of part_of_volume of all voxels below water
+    sums() : force_z(0), torque_x(0), torque_y(0), volume_below_water(0) {}
+};
+
+/// compute lift and gravity force and their torque for transformed voxels
+///@param x,y,z - voxel positions relative to the ship's position
+///@param water_height - water height at voxel, a very high value counts voxel as fully submerged
+sums accumulate(path p, unsigned n, const float *x, const float *y, const float *z, const float *water_height,
+                const float *part_of_volume, const float *relative_mass, const float *flooded_mass,
+                const parameters &par);
+} // namespace buoyancy_kernel
+
+#endif
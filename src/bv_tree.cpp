@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 //
 
 #include "bv_tree.h"
+#include "error.h"
 #include "triangle_intersection.h"
 
 // #define PRINT(x) std::cout << x
@@ -109,6 +110,46 @@ bv_tree::bv_tree(const spheref &sph, std::unique_ptr<bv_tree> left_tree, std::un
     children[1] = std::move(right_tree);
 }
 
+void bv_tree::store(std::vector<stored_node> &nodes) const {
+    stored_node n;
+    n.center[0] = volume.center.x;
+    n.center[1] = volume.center.y;
+    n.center[2] = volume.center.z;
+    n.radius = volume.radius;
+    n.leaf = is_leaf() ? leafdata : leaf_data();
+    nodes.push_back(n);
+    if (!is_leaf()) {
+        children[0]->store(nodes);
+        children[1]->store(nodes);
+    }
+}
+
+std::unique_ptr<bv_tree> bv_tree::restore(const std::vector<stored_node> &nodes, unsigned nr_of_vertices) {
+    if (nodes.empty())
+        return std::unique_ptr<bv_tree>();
+    unsigned next = 0;
+    std::unique_ptr<bv_tree> result = restore(nodes, nr_of_vertices, next);
+    if (next != nodes.size())
+        throw error("stored bv_tree has unused nodes");
+    return result;
+}
+
+std::unique_ptr<bv_tree> bv_tree::restore(const std::vector<stored_node> &nodes, unsigned nr_of_vertices, unsigned &next) {
+    if (next >= nodes.size())
+        throw error("stored bv_tree is incomplete");
+    const stored_node &n = nodes[next++];
+    spheref sph(vector3f(n.center[0], n.center[1], n.center[2]), n.radius);
+    if (n.leaf.tri_idx[0] == uint32_t(-1)) {
+        std::unique_ptr<bv_tree> left = restore(nodes, nr_of_vertices, next);
+        std::unique_ptr<bv_tree> right = restore(nodes, nr_of_vertices, next);
+        return std::make_unique<bv_tree>(sph, std::move(left), std::move(right));
+    }
+    for (unsigned i = 0; i < 3; ++i)
+        if (n.leaf.tri_idx[i] >= nr_of_vertices)
+            throw error("stored bv_tree has invalid vertex index");
+    return std::make_unique<bv_tree>(sph, n.leaf);
+}
+
 bool bv_tree::is_inside(const vector3f &v) const {
     if (!volume.is_inside(v))
         return false;
@@ -72,11 +72,22 @@ class bv_tree {
         }
     };
 
+    /// node of a tree stored in an array in depth first order, used for files
+    struct stored_node {
+        float center[3];
+        float radius;
+        leaf_data leaf; // all indices are -1 for inner nodes
+    };
+
     bv_tree(const spheref &sph, const leaf_data &ld)
         : volume(sph), leafdata(ld) {}
     bv_tree(const spheref &sph, std::unique_ptr<bv_tree> left_tree, std::unique_ptr<bv_tree> right_tree);
     static std::unique_ptr<bv_tree> create(const std::vector<vector3f> &vertices, std::list<leaf_data> &nodes);
     bool is_inside(const vector3f &v) const;
+    /// append nodes of tree in depth first order
+    void store(std::vector<stored_node> &nodes) const;
+    /// build tree from nodes written by store(), throws error if nodes don't form a valid tree
+    static std::unique_ptr<bv_tree> restore(const std::vector<stored_node> &nodes, unsigned nr_of_vertices);
 
     /** determine if two bv_trees intersect each other (are colliding). A list of contact points is computed. */
     static bool collides(const param &p0, const param &p1, std::list<vector3f> &contact_points);
@@ -90,12 +101,16 @@ class bv_tree {
     const spheref &get_sphere() const { return volume; }
     void collect_volumes_of_tree_depth(std::list<spheref> &volumes, unsigned depth) const;
     bool is_leaf() const { return children[0].get() == 0; }
+    const bv_tree &get_child(unsigned i) const { return *children[i]; }
+    const leaf_data &get_leaf_data() const { return leafdata; }
 
   protected:
     spheref volume;
     leaf_data leafdata;
     std::unique_ptr<bv_tree> children[2];
 
+    static std::unique_ptr<bv_tree> restore(const std::vector<stored_node> &nodes, unsigned nr_of_vertices, unsigned &next);
+
   private:
     bv_tree();
     bv_tree(const bv_tree &);
@@ -27,6 +27,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "cfg.h"
 #include "datadirs.h"
+#include "flat_bv_tree.h"
 #include "log.h"
 #include "make_mesh.h"
 #include "model.h"
@@ -38,11 +39,70 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "system.h"
 #include "triangle_intersection.h"
 #include <SDL.h>
+#include <chrono>
 
 using std::vector;
 
+/// compare pointer based bv_tree with flat_bv_tree for random placements of B around A
+static void run_benchmark(model &modelA, model &modelB) {
+    const unsigned nr_of_placements = 20000;
+    const model::mesh &mA = modelA.get_base_mesh();
+    const model::mesh &mB = modelB.get_base_mesh();
+    const matrix4f transA = modelA.get_base_mesh_transformation();
+    const float dist = float(modelA.get_bounding_sphere_radius() + modelB.get_bounding_sphere_radius());
+    vector<matrix4f> transforms(nr_of_placements);
+    for (unsigned i = 0; i < nr_of_placements; ++i) {
+        vector3f t(float(rnd() - 0.5) * dist, float(rnd() - 0.5) * dist, float(rnd() - 0.5) * dist * 0.2f);
+        transforms[i] = matrix4f::trans(t) * matrix4f::rot_z(float(rnd() * 360.0)) * modelB.get_base_mesh_transformation();
+    }
+    typedef std::chrono::steady_clock clock;
+    auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    unsigned hits_tree = 0, hits_flat = 0, contacts_tree = 0, contacts_flat = 0;
+    auto t0 = clock::now();
+    for (unsigned i = 0; i < nr_of_placements; ++i) {
+        vector3f cp;
+        if (bv_tree::closest_collision(bv_tree::param(mA.get_bv_tree(), mA.vertices, transA),
+                                       bv_tree::param(mB.get_bv_tree(), mB.vertices, transforms[i]), cp))
+            ++hits_tree;
+    }
+    auto t1 = clock::now();
+    for (unsigned i = 0; i < nr_of_placements; ++i) {
+        vector3f cp;
+        if (flat_bv_tree::closest_collision(flat_bv_tree::param(mA.get_flat_bv_tree(), mA.vertices, transA),
+                                            flat_bv_tree::param(mB.get_flat_bv_tree(), mB.vertices, transforms[i]), cp))
+            ++hits_flat;
+    }
+    auto t2 = clock::now();
+    for (unsigned i = 0; i < nr_of_placements; ++i) {
+        std::list<vector3f> cps;
+        bv_tree::collides(bv_tree::param(mA.get_bv_tree(), mA.vertices, transA),
+                          bv_tree::param(mB.get_bv_tree(), mB.vertices, transforms[i]), cps);
+        contacts_tree += unsigned(cps.size());
+    }
+    auto t3 = clock::now();
+    for (unsigned i = 0; i < nr_of_placements; ++i) {
+        std::list<vector3f> cps;
+        flat_bv_tree::collides(flat_bv_tree::param(mA.get_flat_bv_tree(), mA.vertices, transA),
+                               flat_bv_tree::param(mB.get_flat_bv_tree(), mB.vertices, transforms[i]), cps);
+        contacts_flat += unsigned(cps.size());
+    }
+    auto t4 = clock::now();
+
+    std::cout << "bv_tree benchmark, " << nr_of_placements << " placements, nodes A="
+              << mA.get_flat_bv_tree().get_nr_of_nodes() << " B=" << mB.get_flat_bv_tree().get_nr_of_nodes() << "\n";
+    std::cout << "closest_collision: tree " << ms(t1 - t0) << "ms flat " << ms(t2 - t1) << "ms speedup "
+              << ms(t1 - t0) / ms(t2 - t1) << " hits " << hits_tree << "/" << hits_flat << "\n";
+    std::cout << "collides:          tree " << ms(t3 - t2) << "ms flat " << ms(t4 - t3) << "ms speedup "
+              << ms(t3 - t2) / ms(t4 - t3) << " contacts " << contacts_tree << "/" << contacts_flat << "\n";
+    if (hits_tree != hits_flat || contacts_tree != contacts_flat)
+        std::cout << "WARNING: results of bv_tree and flat_bv_tree differ!\n";
+}
+
 int mymain(list<string> &args) {
-    if (args.size() != 2)
+    // optional third argument "--benchmark" runs the speed comparison and quits
+    bool benchmark = (args.size() == 3 && args.back() == "--benchmark");
+    if (args.size() != 2 && !benchmark)
         return -1;
 
     cfg &mycfg = cfg::instance();
@@ -67,6 +127,9 @@ int mymain(list<string> &args) {
     mycfg.register_option("water_detail", 128);
     mycfg.register_option("wave_fft_res", 128);
     mycfg.register_option("wave_phases", 256);
+    mycfg.register_option("wave_streaming", false); // compute wave phases on the fly
+    mycfg.register_option("wave_seed", 1); // 0 = different waves on every run
+    mycfg.register_option("wave_cache_dir", std::string("")); // directory for precomputed waves, empty = no cache
     mycfg.register_option("wavetile_length", 256.0f);
     mycfg.register_option("wave_tidecycle_time", 10.24f);
     mycfg.register_option("usex86sse", true);
@@ -88,6 +151,11 @@ int mymain(list<string> &args) {
     modelB->set_layout(model::default_layout);
     modelA->get_base_mesh().compute_bv_tree();
     modelB->get_base_mesh().compute_bv_tree();
+    if (benchmark) {
+        run_benchmark(*modelA, *modelB);
+        system::destroy_instance();
+        return 0;
+    }
     // modelA->get_base_mesh().bounding_volume_tree->debug_dump();
     // modelB->get_base_mesh().bounding_volume_tree->debug_dump();
 
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "convoy.h"
 #include "ai.h"
+#include "asset_preloader.h"
 #include "datadirs.h"
 #include "game.h"
 #include "global_data.h"
@@ -98,7 +99,7 @@ string get_random_ship(ship_probability *p) {
     return string(p[0].name);
 }
 
-convoy::convoy(game &gm_, convoy::types type_, convoy::esctypes esct_)
+convoy::convoy(game &gm_, convoy::types type_, convoy::esctypes esct_, asset_preloader &assets)
     : gm(gm_), remaining_time(0) {
     // myai = new ai(this, ai::convoy);
 
@@ -125,6 +126,24 @@ convoy::convoy(game &gm_, convoy::types type_, convoy::esctypes esct_)
         // compute size and structure of convoy
         unsigned nrships = (2 << cvsize) * 10 + rnd(10) - 5;
         unsigned sqrtnrships = unsigned(floor(sqrt(float(nrships))));
+        unsigned nrescs = esct_ * 5;
+
+        // choose all ship types first, so their assets are loaded at once
+        // fixme!!! replace by parsing ship dir for available types or hardcode them!!!
+        // each ship in data/ships stores its type.
+        // but probability can not be stored...
+        vector<string> merchanttypes(nrships), escorttypes(nrescs);
+        for (unsigned i = 0; i < nrships; ++i) {
+            merchanttypes[i] = get_random_ship(civilships);
+            assets.add_random_skins(merchanttypes[i], gm.get_date());
+        }
+        for (unsigned i = 0; i < nrescs; ++i) {
+            escorttypes[i] = get_random_ship(escortships);
+            assets.add_random_skins(escorttypes[i], gm.get_date());
+        }
+        assets.load();
+        assets.log_report();
+
         unsigned shps = 0;
         for (unsigned j = 0; j <= sqrtnrships; ++j) {
             if (shps >= nrships)
@@ -134,13 +153,7 @@ convoy::convoy(game &gm_, convoy::types type_, convoy::esctypes esct_)
                 if (shps >= nrships)
                     break;
                 int dx = int(i) - sqrtnrships / 2;
-                // fixme!!! replace by parsing ship dir for available types or hardcode them!!!
-                // each ship in data/ships stores its type.
-                // but probability can not be stored...
-                string shiptype = get_random_ship(civilships);
-                xml_doc doc(data_file().get_filename(shiptype));
-                doc.load();
-                ship *s = new ship(gm, doc.first_child());
+                ship *s = new ship(gm, assets.get_spec(merchanttypes[shps]));
                 s->set_random_skin_name(gm.get_date());
                 vector2 pos = vector2(
                     dx * intershipdist + rnd() * 60.0 - 30.0,
@@ -155,8 +168,7 @@ convoy::convoy(game &gm_, convoy::types type_, convoy::esctypes esct_)
             }
         }
 
-        // compute nr of escorts
-        unsigned nrescs = esct_ * 5;
+        // place escorts
         for (unsigned i = 0; i < nrescs; ++i) {
             // fixme: give commands/tasks to escorts: "patrol left side of convoy" etc.
             int side = i % 4;
@@ -185,10 +197,7 @@ convoy::convoy(game &gm_, convoy::types type_, convoy::esctypes esct_)
             dy *= sqrtnrships / 2 * intershipdist + convoyescortdist;
             nx *= (int(nrescs / 4) - 1) * interescortdist - int(i / 4) * interescortdist;
             ny *= (int(nrescs / 4) - 1) * interescortdist - int(i / 4) * interescortdist;
-            string shiptype = get_random_ship(escortships);
-            xml_doc doc(data_file().get_filename(shiptype));
-            doc.load();
-            ship *s = new ship(gm, doc.first_child());
+            ship *s = new ship(gm, assets.get_spec(escorttypes[i]));
             s->set_random_skin_name(gm.get_date());
             vector2 pos = vector2(
                 dx + nx + rnd() * 100.0 - 50.0,
@@ -217,6 +226,8 @@ convoy::convoy(game &gm_, convoy::types type_, convoy::esctypes esct_)
 
     // fixme
     name = "SC-122";
+    // no ships to create yet, but the caller needs its requested assets
+    assets.load();
 
     // fixme
     switch (type_) {
@@ -382,7 +393,10 @@ void convoy::simulate(double delta_time) {
 
 void convoy::add_contact(const vector3 &pos) // fixme: simple, crude, ugly
 {
-    for (list<pair<ship *, vector2>>::iterator it = escorts.begin(); it != escorts.end(); ++it) {
-        it->first->get_ai()->attack_contact(pos);
-    }
+    // the escorts are simulated by other tasks, so tell them afterwards
+    game::execute_or_defer([this, pos]() {
+        for (list<pair<ship *, vector2>>::iterator it = escorts.begin(); it != escorts.end(); ++it) {
+            it->first->get_ai()->attack_contact(pos);
+        }
+    });
 }
@@ -72,7 +72,9 @@ class convoy {
     convoy(class game &gm_);
 
     /// create custom convoy
-    convoy(class game &gm, types type_, esctypes esct_);
+    ///@note requests the assets of its ships from assets and loads all requested assets
+    ///	before creating the ships, so callers can request their own objects before.
+    convoy(class game &gm, types type_, esctypes esct_, class asset_preloader &assets);
 
     /// create empty convoy (only used in the editor!)
     convoy(class game &gm, const vector2 &pos, const std::string &name);
@@ -28,6 +28,19 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "model.h"
 #include "system.h"
 
+memory_pool &depth_charge::get_pool() {
+    static memory_pool pool("depth_charge");
+    return pool;
+}
+
+void *depth_charge::operator new(std::size_t size) {
+    return get_pool().allocate(size);
+}
+
+void depth_charge::operator delete(void *p, std::size_t size) {
+    get_pool().deallocate(p, size);
+}
+
 depth_charge::depth_charge(game &gm_)
     : sea_object(gm_, "depth_charge.ddxml"), explosion_depth(0) {
     // for loading
@@ -50,13 +63,15 @@ void depth_charge::save(xml_elem &parent) const {
     parent.add_child("explosion_depth").set_attr(explosion_depth);
 }
 
-void depth_charge::simulate(double delta_time) {
-    sea_object::simulate(delta_time);
+bool depth_charge::simulate(double delta_time) {
+    if (!sea_object::simulate(delta_time))
+        return false;
 
     if (position.z < -explosion_depth) {
         gm.dc_explosion(*this);
         kill(); // dc is "dead"
     }
+    return true;
 }
 
 void depth_charge::compute_force_and_torque(vector3 &F, vector3 &T) const {
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #ifndef DEPTH_CHARGE_H
 #define DEPTH_CHARGE_H
 
+#include "memory_pool.h"
 #include "sea_object.h"
 
 // fixme: these values depend on depth charge type.
@@ -50,8 +51,12 @@ class depth_charge : public sea_object {
     virtual void load(const xml_elem &parent);
     virtual void save(xml_elem &parent) const;
 
-    virtual void simulate(double delta_time);
+    virtual bool simulate(double delta_time);
     void compute_force_and_torque(vector3 &F, vector3 &T) const;
+    /// objects are allocated from a memory_pool, they are created and deleted often
+    static void *operator new(std::size_t size);
+    static void operator delete(void *p, std::size_t size);
+    static memory_pool &get_pool();
 };
 
 #endif
@@ -0,0 +1,199 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// A bounding volume tree (spheres) stored in one contiguous array
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "flat_bv_tree.h"
+#include "triangle_intersection.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FLAT_BV_TREE_SSE
+#endif
+
+flat_bv_tree::flat_bv_tree(const bv_tree &tree) {
+    // breadth first, so node n is the n-th entry of the queue
+    std::vector<const bv_tree *> queue(1, &tree);
+    for (unsigned n = 0; n < queue.size(); ++n) {
+        const bv_tree &t = *queue[n];
+        const spheref &s = t.get_sphere();
+        cx.push_back(s.center.x);
+        cy.push_back(s.center.y);
+        cz.push_back(s.center.z);
+        radius.push_back(s.radius);
+        if (t.is_leaf()) {
+            link.push_back(leaf_flag | uint32_t(leaves.size()));
+            leaves.push_back(t.get_leaf_data());
+        } else {
+            link.push_back(uint32_t(queue.size()));
+            queue.push_back(&t.get_child(0));
+            queue.push_back(&t.get_child(1));
+        }
+    }
+}
+
+unsigned flat_bv_tree::test_children(const param &p, unsigned node, const spheref &s, spheref children[2], float sqdist[2]) {
+    const flat_bv_tree &t = p.tree;
+    const unsigned first = t.link[node];
+    const matrix4f &m = p.transform;
+#ifdef FLAT_BV_TREE_SSE
+    // lanes 0 and 1 hold the two children. The operations are done in the same
+    // order as matrix4::mul4vec3xlat and sphere::intersects, so results are the same.
+    __m128 x = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(&t.cx[first])));
+    __m128 y = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(&t.cy[first])));
+    __m128 z = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(&t.cz[first])));
+    __m128 r = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(&t.radius[first])));
+    __m128 tc[3];
+    for (unsigned j = 0; j < 3; ++j) {
+        tc[j] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.elem(0, j)), x),
+                                                 _mm_mul_ps(_mm_set1_ps(m.elem(1, j)), y)),
+                                      _mm_mul_ps(_mm_set1_ps(m.elem(2, j)), z)),
+                           _mm_set1_ps(m.elem(3, j)));
+    }
+    __m128 dx = _mm_sub_ps(tc[0], _mm_set1_ps(s.center.x));
+    __m128 dy = _mm_sub_ps(tc[1], _mm_set1_ps(s.center.y));
+    __m128 dz = _mm_sub_ps(tc[2], _mm_set1_ps(s.center.z));
+    __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    __m128 rr = _mm_add_ps(r, _mm_set1_ps(s.radius));
+    unsigned mask = unsigned(_mm_movemask_ps(_mm_cmplt_ps(d2, _mm_mul_ps(rr, rr)))) & 3;
+    float tx[4], ty[4], tz[4], td[4];
+    _mm_storeu_ps(tx, tc[0]);
+    _mm_storeu_ps(ty, tc[1]);
+    _mm_storeu_ps(tz, tc[2]);
+    _mm_storeu_ps(td, d2);
+    for (unsigned k = 0; k < 2; ++k) {
+        children[k] = spheref(vector3f(tx[k], ty[k], tz[k]), t.radius[first + k]);
+        sqdist[k] = td[k];
+    }
+    return mask;
+#else
+    unsigned mask = 0;
+    for (unsigned k = 0; k < 2; ++k) {
+        children[k] = spheref(m.mul4vec3xlat(t.get_center(first + k)), t.radius[first + k]);
+        sqdist[k] = children[k].center.square_distance(s.center);
+        if (children[k].intersects(s))
+            mask |= 1U << k;
+    }
+    return mask;
+#endif
+}
+
+bool flat_bv_tree::leaf_collision(const visit &v0, const visit &v1, vector3f &contact_point) {
+    const bv_tree::leaf_data &l0 = v0.p.tree.get_leaf_data(v0.node);
+    const bv_tree::leaf_data &l1 = v1.p.tree.get_leaf_data(v1.node);
+    vector3f v0t = v0.p.transform.mul4vec3xlat(v0.p.vertices[l0.tri_idx[0]]);
+    vector3f v1t = v0.p.transform.mul4vec3xlat(v0.p.vertices[l0.tri_idx[1]]);
+    vector3f v2t = v0.p.transform.mul4vec3xlat(v0.p.vertices[l0.tri_idx[2]]);
+    vector3f v3t = v1.p.transform.mul4vec3xlat(v1.p.vertices[l1.tri_idx[0]]);
+    vector3f v4t = v1.p.transform.mul4vec3xlat(v1.p.vertices[l1.tri_idx[1]]);
+    vector3f v5t = v1.p.transform.mul4vec3xlat(v1.p.vertices[l1.tri_idx[2]]);
+    // degenerated triangles have a bounding sphere of radius zero, so we never get here with them.
+    bool c = triangle_intersection_t<float>::compute(v0t, v1t, v2t, v3t, v4t, v5t);
+    if (c)
+        contact_point = (v0t + v1t + v2t + v3t + v4t + v5t) * (1.f / 6);
+    return c;
+}
+
+bool flat_bv_tree::collides(const param &p0, const param &p1, std::list<vector3f> &contact_points) {
+    visit v0(p0, 0, p0.get_transformed_sphere());
+    visit v1(p1, 0, p1.get_transformed_sphere());
+    if (!v0.sphere.intersects(v1.sphere))
+        return false;
+    return collides(v0, v1, contact_points);
+}
+
+bool flat_bv_tree::collides(const visit &v0, const visit &v1, std::list<vector3f> &contact_points) {
+    // spheres of v0 and v1 are known to intersect here
+    if (v0.p.tree.is_leaf(v0.node)) {
+        if (v1.p.tree.is_leaf(v1.node)) {
+            vector3f contact_point;
+            bool c = leaf_collision(v0, v1, contact_point);
+            if (c)
+                contact_points.push_back(contact_point);
+            return c;
+        }
+        // other node is no leaf, recurse there, swap roles of this and other
+        return collides_children(v1, v0, contact_points);
+    }
+    // split larger volume of this and other
+    if (v0.sphere.radius > v1.sphere.radius || v1.p.tree.is_leaf(v1.node))
+        return collides_children(v0, v1, contact_points);
+    return collides_children(v1, v0, contact_points);
+}
+
+bool flat_bv_tree::collides_children(const visit &split, const visit &other, std::list<vector3f> &contact_points) {
+    spheref children[2];
+    float sqdist[2];
+    unsigned mask = test_children(split.p, split.node, other.sphere, children, sqdist);
+    const unsigned first = split.p.tree.link[split.node];
+    bool col1 = (mask & 1) && collides(visit(split.p, first, children[0]), other, contact_points);
+    bool col2 = (mask & 2) && collides(visit(split.p, first + 1, children[1]), other, contact_points);
+    return col1 || col2;
+}
+
+bool flat_bv_tree::closest_collision(const param &p0, const param &p1, vector3f &contact_point) {
+    visit v0(p0, 0, p0.get_transformed_sphere());
+    visit v1(p1, 0, p1.get_transformed_sphere());
+    if (!v0.sphere.intersects(v1.sphere))
+        return false;
+    return closest_collision(v0, v1, contact_point);
+}
+
+bool flat_bv_tree::closest_collision(const visit &v0, const visit &v1, vector3f &contact_point) {
+    if (v0.p.tree.is_leaf(v0.node)) {
+        if (v1.p.tree.is_leaf(v1.node))
+            return leaf_collision(v0, v1, contact_point);
+        return closest_collision_children(v1, v0, contact_point);
+    }
+    if (v0.sphere.radius > v1.sphere.radius || v1.p.tree.is_leaf(v1.node))
+        return closest_collision_children(v0, v1, contact_point);
+    return closest_collision_children(v1, v0, contact_point);
+}
+
+bool flat_bv_tree::closest_collision_children(const visit &split, const visit &other, vector3f &contact_point) {
+    spheref children[2];
+    float sqdist[2];
+    unsigned mask = test_children(split.p, split.node, other.sphere, children, sqdist);
+    const unsigned first = split.p.tree.link[split.node];
+    // try closer child first, use logical or to return on first true result
+    unsigned i = (sqdist[0] < sqdist[1]) ? 0 : 1;
+    return ((mask & (1U << i)) && closest_collision(visit(split.p, first + i, children[i]), other, contact_point)) ||
+           ((mask & (2U >> i)) && closest_collision(visit(split.p, first + 1 - i, children[1 - i]), other, contact_point));
+}
+
+bool flat_bv_tree::collides(const param &p, const spheref &sp) {
+    visit v(p, 0, p.get_transformed_sphere());
+    if (!v.sphere.intersects(sp))
+        return false;
+    return collides(v, sp);
+}
+
+bool flat_bv_tree::collides(const visit &v, const spheref &sp) {
+    // leaf's bounding sphere and sp intersect, so we have a collision
+    if (v.p.tree.is_leaf(v.node))
+        return true;
+    spheref children[2];
+    float sqdist[2];
+    unsigned mask = test_children(v.p, v.node, sp, children, sqdist);
+    const unsigned first = v.p.tree.link[v.node];
+    unsigned i = (sqdist[0] < sqdist[1]) ? 0 : 1;
+    return ((mask & (1U << i)) && collides(visit(v.p, first + i, children[i]), sp)) ||
+           ((mask & (2U >> i)) && collides(visit(v.p, first + 1 - i, children[1 - i]), sp));
+}
@@ -0,0 +1,105 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// A bounding volume tree (spheres) stored in one contiguous array
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef FLAT_BV_TREE_H
+#define FLAT_BV_TREE_H
+
+#include "bv_tree.h"
+#include <list>
+#include <vector>
+
+/// An immutable copy of a bv_tree with all nodes in one array.
+///@note Nodes are stored in breadth first order as structure of arrays, the two
+///	children of a node are adjacent. So both child spheres are loaded and
+///	transformed together and tested against the other tree's sphere with one
+///	SIMD operation. Transformed spheres are passed down the recursion instead
+///	of being recomputed for every visit. The traversal order is the same as
+///	for bv_tree, so the results are identical.
+class flat_bv_tree {
+  public:
+    /// parameters for collision
+    struct param {
+        const flat_bv_tree &tree;
+        const std::vector<vector3f> &vertices;
+        matrix4f transform;
+        param(const flat_bv_tree &t, const std::vector<vector3f> &v, const matrix4f &m)
+            : tree(t), vertices(v), transform(m) {}
+        spheref get_transformed_sphere() const {
+            return spheref(transform.mul4vec3xlat(tree.get_sphere().center), tree.get_sphere().radius);
+        }
+    };
+
+    /// build from pointer based tree
+    flat_bv_tree(const bv_tree &tree);
+
+    /** determine if two trees intersect each other (are colliding). A list of contact points is computed. */
+    static bool collides(const param &p0, const param &p1, std::list<vector3f> &contact_points);
+    /** determine if two trees intersect each other (are colliding). The closest contact point is computed. */
+    static bool closest_collision(const param &p0, const param &p1, vector3f &contact_point);
+    /** determine if tree and sphere intersect each other (are colliding). */
+    static bool collides(const param &p, const spheref &sp);
+
+    /// get bounding sphere of root node
+    spheref get_sphere() const { return spheref(vector3f(cx[0], cy[0], cz[0]), radius[0]); }
+    /// get number of nodes
+    unsigned get_nr_of_nodes() const { return unsigned(radius.size()); }
+
+  protected:
+    // node spheres, structure of arrays in breadth first order
+    std::vector<float> cx, cy, cz, radius;
+    // index of first child for inner nodes or index in leaves with leaf_flag set
+    std::vector<uint32_t> link;
+    std::vector<bv_tree::leaf_data> leaves;
+
+    static const uint32_t leaf_flag = 0x80000000U;
+
+    bool is_leaf(unsigned node) const { return (link[node] & leaf_flag) != 0; }
+    const bv_tree::leaf_data &get_leaf_data(unsigned node) const { return leaves[link[node] & ~leaf_flag]; }
+    vector3f get_center(unsigned node) const { return vector3f(cx[node], cy[node], cz[node]); }
+
+    /// node of one tree during traversal with its transformed sphere
+    struct visit {
+        const param &p;
+        unsigned node;
+        spheref sphere;
+        visit(const param &p_, unsigned n, const spheref &s) : p(p_), node(n), sphere(s) {}
+    };
+
+    /// transform both children of an inner node and test them against a sphere.
+    ///@param children - transformed spheres of the two children
+    ///@param sqdist - square distances of transformed child centers to center of s
+    ///@returns bit mask of children that intersect s
+    static unsigned test_children(const param &p, unsigned node, const spheref &s, spheref children[2], float sqdist[2]);
+
+    static bool leaf_collision(const visit &v0, const visit &v1, vector3f &contact_point);
+    static bool collides(const visit &v0, const visit &v1, std::list<vector3f> &contact_points);
+    static bool collides_children(const visit &split, const visit &other, std::list<vector3f> &contact_points);
+    static bool closest_collision(const visit &v0, const visit &v1, vector3f &contact_point);
+    static bool closest_collision_children(const visit &split, const visit &other, vector3f &contact_point);
+    static bool collides(const visit &v, const spheref &sp);
+
+  private:
+    flat_bv_tree(const flat_bv_tree &) = delete;
+    flat_bv_tree &operator=(const flat_bv_tree &) = delete;
+};
+
+#endif
@@ -33,6 +33,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "model.h"
 #include "particle.h"
 #include "postprocessor.h"
+#include "profiler.h"
 #include "primitives.h"
 #include "ship.h"
 #include "sky.h"
@@ -91,7 +92,7 @@ void freeview_display::set_modelview_matrix(game &gm, const vector3 & /*viewpos*
         // This should be a negative angle, but nautical view dir is clockwise,
         // OpenGL uses ccw values, so this is a double negation
         glRotated(ui.get_relative_bearing().value(), 0, 0, 1);
-        gm.get_player()->get_orientation().conj().rotmat4().multiply_gl();
+        gm.get_player()->get_render_orientation(gm.get_interpolation_factor()).conj().rotmat4().multiply_gl();
     } else {
         // This should be a negative angle, but nautical view dir is clockwise,
         // OpenGL uses ccw values, so this is a double negation
@@ -132,7 +133,7 @@ freeview_display::~freeview_display() {
 }
 
 vector3 freeview_display::get_viewpos(class game &gm) const {
-    return gm.get_player()->get_pos() + add_pos;
+    return gm.get_player()->get_render_pos(gm.get_interpolation_factor()) + add_pos;
 }
 
 void freeview_display::display(class game &gm) const {
@@ -228,6 +229,8 @@ void freeview_display::draw_objects(game &gm, const vector3 &viewpos,
     // d = PI/2*r - r*arcsin(z/r+1), fixme implement
 
     sea_object *player = gm.get_player();
+    // objects are drawn between their last two simulated states
+    const double alpha = gm.get_interpolation_factor();
 
     for (vector<sea_object *>::const_iterator it = objects.begin(); it != objects.end(); ++it) {
         bool istorp = (dynamic_cast<const torpedo *>(*it) != 0);
@@ -240,7 +243,7 @@ void freeview_display::draw_objects(game &gm, const vector3 &viewpos,
 
         if (mirrorclip && !istorp) {
             // viewpos.z is already mirrored...
-            vector3 pos = (*it)->get_pos();
+            vector3 pos = (*it)->get_render_pos(alpha);
             glTranslated(pos.x - viewpos.x, pos.y - viewpos.y, -viewpos.z);
             // orientation affects tex#1 matrix, for the code below
             glActiveTexture(GL_TEXTURE1);
@@ -257,13 +260,13 @@ void freeview_display::draw_objects(game &gm, const vector3 &viewpos,
             // hmm it inflicts geoclipmap rendering as well...
             glTranslated(0, 0, pos.z);
         } else {
-            vector3 pos = (*it)->get_pos() - viewpos;
+            vector3 pos = (*it)->get_render_pos(alpha) - viewpos;
             // pos.z += EARTH_RADIUS * (sin(M_PI/2 - pos.xy().length()/EARTH_RADIUS) - 1.0);
             glTranslated(pos.x, pos.y, pos.z);
         }
         const ship *shp = dynamic_cast<const ship *>(*it);
         if (shp) {
-            shp->get_orientation().rotmat4().multiply_gl();
+            shp->get_render_orientation(alpha).rotmat4().multiply_gl();
         }
         if (mirrorclip) {
             // torpedoes are normally fully underwater and thus need not to get
@@ -300,7 +303,7 @@ void freeview_display::draw_objects(game &gm, const vector3 &viewpos,
         vector<depth_charge *> depth_charges = gm.visible_depth_charges(player);
         for (vector<depth_charge *>::const_iterator it = depth_charges.begin(); it != depth_charges.end(); ++it) {
             glPushMatrix();
-            vector3 pos = (*it)->get_pos() - viewpos;
+            vector3 pos = (*it)->get_render_pos(alpha) - viewpos;
             glTranslated(pos.x, pos.y, pos.z);
             glRotatef(-(*it)->get_heading().value(), 0, 0, 1);
             (*it)->display(under_water ? ui.get_caustics().get_map() : NULL);
@@ -311,7 +314,7 @@ void freeview_display::draw_objects(game &gm, const vector3 &viewpos,
     vector<gun_shell *> gun_shells = gm.visible_gun_shells(player);
     for (vector<gun_shell *>::const_iterator it = gun_shells.begin(); it != gun_shells.end(); ++it) {
         glPushMatrix();
-        vector3 pos = (*it)->get_pos() - viewpos;
+        vector3 pos = (*it)->get_render_pos(alpha) - viewpos;
         glTranslated(pos.x, pos.y, pos.z);
         glRotatef(-(*it)->get_heading().value(), 0, 0, 1);
         (*it)->display();
@@ -433,6 +436,7 @@ void freeview_display::draw_view(game &gm, const vector3 &viewpos) const {
     // or transform object space to world space, then clip at z=0 and then transform to eye space.
 
     {
+        profile_scope("render reflection");
         glPushMatrix();
         // flip geometry at z=0 plane
         glScalef(1.0f, 1.0f, -1.0f);
@@ -600,6 +604,7 @@ void freeview_display::draw_view(game &gm, const vector3 &viewpos) const {
 
     // ************ sky ***************************************************************
     if (above_water >= 0) {
+        profile_scope("render sky");
         ui.get_sky().display(gm.compute_light_color(viewpos), viewpos, max_view_dist, false);
     }
 
@@ -639,6 +644,7 @@ void freeview_display::draw_view(game &gm, const vector3 &viewpos) const {
      */
     // under water...
     if (above_water <= 0) {
+        profile_scope("render water");
         // render water background plane
         // clip far plane frustum polygon with z=0 plane (water surface)
         //		polygon uwp = viewwindow_far.clip(plane(vector3(0, 0, -1), 0));
@@ -657,31 +663,38 @@ void freeview_display::draw_view(game &gm, const vector3 &viewpos) const {
         ui.get_water().display(viewpos, max_view_dist, true /* under water*/);
         glCullFace(GL_BACK);
     } else {
+        profile_scope("render water");
         ui.get_water().display(viewpos, max_view_dist);
     }
 
     // ******** terrain/land ********************************************************
     //	glDisable(GL_FOG);	//testing with new 2d bspline terrain.
-    ui.draw_terrain(viewpos, ui.get_absolute_bearing(), max_view_dist, false /*not mirrored*/, above_water);
+    {
+        profile_scope("render terrain");
+        ui.draw_terrain(viewpos, ui.get_absolute_bearing(), max_view_dist, false /*not mirrored*/, above_water);
+    }
     //	glEnable(GL_FOG);
 
     // ******************** ships & subs *************************************************
     //	cout << "mv trans pos " << matrix4::get_gl(GL_MODELVIEW_MATRIX).column(3) << "\n";
 
     // substract player pos.
-    draw_objects(gm, viewpos, objects, lightcol, (above_water < 0) ? true : false /* under water */, false /* mirrorclip */);
+    {
+        profile_scope("render models");
+        draw_objects(gm, viewpos, objects, lightcol, (above_water < 0) ? true : false /* under water */, false /* mirrorclip */);
+    }
 
     // ******************** draw the bridge in higher detail
     if (aboard && drawbridge) {
         // after everything was drawn, draw conning tower
-        vector3 conntowerpos = player->get_pos() - viewpos;
+        vector3 conntowerpos = player->get_render_pos(gm.get_interpolation_factor()) - viewpos;
         glPushMatrix();
         // we would have to translate the conning tower, but the current model is centered arount the player's view
         // already, fixme.
         // glTranslated(conntowerpos.x, conntowerpos.y, conntowerpos.z);
         // glRotatef(-player->get_heading().value(),0,0,1);
         // fixme: rotate by player's orientation, but this looks strange, see above why.
-        player->get_orientation().rotmat4().multiply_gl();
+        player->get_render_orientation(gm.get_interpolation_factor()).rotmat4().multiply_gl();
         glTranslated(conntowerpos.x, conntowerpos.y, conntowerpos.z);
         conning_tower->display();
         glPopMatrix();
@@ -691,5 +704,6 @@ void freeview_display::draw_view(game &gm, const vector3 &viewpos) const {
 
     ui.draw_weather_effects();
 
+    profile_scope("render postprocessor");
     postprocessor::instance().process();
 }
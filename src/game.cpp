@@ -38,6 +38,7 @@ double log2(double n) {
 
 #include "airplane.h"
 #include "airplane_interface.h"
+#include "asset_preloader.h"
 #include "cfg.h"
 #include "convoy.h"
 #include "depth_charge.h"
@@ -52,9 +53,11 @@ double log2(double n) {
 #include "model.h"
 #include "network.h"
 #include "network_manager.h"
+#include "noise_field.h"
 #include "particle.h"
 #include "physics_system.h"
 #include "ping_manager.h"
+#include "profiler.h"
 #include "quaternion.h"
 #include "game_loader.h"
 #include "save_manager.h"
@@ -121,13 +124,8 @@ game::game()
 
     myheightgen = std::make_unique<terrain<Sint16>>(get_map_dir() + "terrain/terrain.xml", get_map_dir() + "terrain/", TERRAIN_NR_LEVELS + 1);
 
-#if 0
-	if (config.geti("cpucores") > 1) {
-		log_info("game: Using extra worker for multicore acceleration.");
-		myworker = std::make_unique<simulate_worker>(*this);
-		myworker->start();
-	}
-#endif
+    init_thread_pool();
+    init_step_rates();
 }
 
 game::game(class cfg &cfg_ref, class log &log_ref, const string &subtype, unsigned cvsize, unsigned cvesc, unsigned timeofday,
@@ -183,12 +181,8 @@ game::game(class cfg &cfg_ref, class log &log_ref, const string &subtype, unsign
             (below surface, passive sonar) or even detected by their smell (smoke)!
     ***********************************************************************/
 
-#if 0
-	if (config.geti("cpucores") > 1) {
-		myworker = std::make_unique<simulate_worker>(*this);
-		myworker->start();
-	}
-#endif
+    init_thread_pool();
+    init_step_rates();
 
     // fixme: show some info like in Silent Service II? sun/moon pos,time,visibility?
 
@@ -221,18 +215,19 @@ game::game(class cfg &cfg_ref, class log &log_ref, const string &subtype, unsign
     myheightgen = std::make_unique<terrain<Sint16>>(get_map_dir() + "terrain/terrain.xml", get_map_dir() + "terrain/", TERRAIN_NR_LEVELS + 1);
 
     // Convoy-constructor creates all the objects and spawns them in this game object.
+    // It loads the assets of its ships together with those requested here.
     // fixme: creation of convoys should be rather moved to this class, so object creation
     // and logic is centralized.
-    auto cv = std::make_unique<convoy>(*this, (convoy::types)(cvsize), (convoy::esctypes)(cvesc));
+    asset_preloader assets(mypool.get());
+    assets.add_object_type(subtype, model::default_layout);
+    auto cv = std::make_unique<convoy>(*this, (convoy::types)(cvsize), (convoy::esctypes)(cvesc), assets);
     spawn_convoy(std::move(cv));
 
     lookout_sensor tmpsensor;
     vector<angle> subangles;
     submarine *psub = 0;
     for (unsigned i = 0; i < nr_of_players; ++i) {
-        xml_doc doc(data_file().get_filename(subtype));
-        doc.load();
-        auto sub = std::make_unique<submarine>(*this, doc.first_child());
+        auto sub = std::make_unique<submarine>(*this, assets.get_spec(subtype));
         sub->set_skin_layout(model::default_layout);
         sub->init_fill_torpedo_tubes(currentdate);
         if (i == 0) {
@@ -315,11 +310,15 @@ game::game(class cfg &cfg_ref, class log &log_ref, const string &filename)
       my_run_state(running), myevents(std::make_unique<event_manager>()), myjobs(std::make_unique<job_scheduler>()), mynetwork(std::make_unique<network_manager>()), player(0),
       time(0),
       myphysics(std::make_unique<physics_system>()), mylighting(std::make_unique<lighting_system>()), mypings(std::make_unique<ping_manager>()), myfreezer(std::make_unique<time_freezer>()), myscoring(std::make_unique<scoring_manager>()), mytrails(std::make_unique<trail_manager>()), myvisibility(std::make_unique<visibility_manager>()), mysave(std::make_unique<save_manager>()) {
+    // the loader uses the pool to preload assets
+    init_thread_pool();
     game_loader::load(*this, filename);
+    init_step_rates();
 }
 
 game::~game() {
     // Job scheduler destructor handles cleanup
+    myworld->log_memory_pools();
 }
 
 // --------------------------------------------------------------------------------
@@ -350,33 +349,72 @@ double game::get_last_trail_record_time() const {
     return mytrails->get_last_trail_time();
 }
 
+// advance accumulator of a simulation stage, returns true if the stage is due
+static bool stage_due(double &accumulator, double delta_t, double rate) {
+    accumulator += delta_t;
+    const double period = 1.0 / rate;
+    if (accumulator < period)
+        return false;
+    accumulator = fmod(accumulator, period);
+    return true;
+}
+
+void game::init_step_rates() {
+    // all rates are given per second of game time
+    rates.step_rate = std::max(config.geti("sim_step_rate"), 1);
+    rates.collision_rate = std::min(double(std::max(config.geti("sim_collision_rate"), 1)), rates.step_rate);
+    rates.visibility_rate = std::min(double(std::max(config.geti("sim_visibility_rate"), 1)), rates.step_rate);
+    const int max_steps = config.geti("sim_max_steps");
+    if (max_steps > 0) {
+        rates.max_steps = unsigned(max_steps);
+    } else {
+        // Enough steps for max. time compression down to 10 frames per second, so game time
+        // is only dropped when the machine really can't keep up. With 20 steps per second
+        // and 4096x time compression a frame at 30fps needs about 2731 steps.
+        const double min_frame_rate = 10.0;
+        rates.max_steps = unsigned(ceil(rates.step_rate * user_interface::max_time_scale / min_frame_rate));
+    }
+    step_accumulator = 0;
+    collision_accumulator = 0;
+    // compute view distance in first step
+    visibility_accumulator = 1.0 / rates.visibility_rate;
+}
+
 void game::simulate(double delta_t) {
     if (!is_editor()) {
         if (my_run_state != running)
             return;
     }
 
-    // protect physics simulation from bad values, simulation step must not
-    // be less than 20fps.
-    const double max_dt_rate = 1.0 / 20.0;
-    if (delta_t > max_dt_rate) {
-        // do some intermediate steps. All larger than max_dt_rate, so add a small amount.
-        unsigned steps = unsigned(ceil(delta_t / max_dt_rate + 0.001));
-        double ddt = delta_t / steps;
-        log_debug("Large delta_t (" << delta_t << "), using " << steps << " steps in between.");
-        for (unsigned s = 1; s < steps; ++s) {
-            simulate(ddt);
-            delta_t -= ddt;
+    // kill events left over from last run. Events of all steps are kept until the next call.
+    myevents->clear_events();
+
+    // Simulate in fixed steps, so results don't depend on the frame rate and the physics
+    // simulation is protected from large time steps. The remaining time is accumulated.
+    const double step = 1.0 / rates.step_rate;
+    step_accumulator += delta_t;
+    unsigned steps = 0;
+    while (step_accumulator >= step) {
+        if (steps == rates.max_steps) {
+            // we can't keep up, so drop the time instead of stalling the game
+            log_warning("Simulation overloaded after " << steps << " steps, dropping " << step_accumulator << "s of game time.");
+            step_accumulator = fmod(step_accumulator, step);
+            break;
         }
-        simulate(delta_t);
-        return;
+        simulate_step(step);
+        step_accumulator -= step;
+        ++steps;
+        if (!is_editor() && my_run_state != running)
+            break;
     }
+}
 
-    // kill events left over from last run
-    myevents->clear_events();
-
+void game::simulate_step(double delta_t) {
     // check if jobs are to be run
-    myjobs->update(delta_t);
+    {
+        profile_scope("sim jobs");
+        myjobs->update(delta_t);
+    }
 
     if (!is_editor()) {
         // this could be done in jobs, fixme
@@ -398,7 +436,11 @@ void game::simulate(double delta_t) {
         }
     }
 
-    compute_max_view_dist();
+    // view distance depends on daylight, which changes slowly
+    if (stage_due(visibility_accumulator, delta_t, rates.visibility_rate)) {
+        profile_scope("sim visibility");
+        compute_max_view_dist();
+    }
 
     bool record = false;
     if (mytrails->should_record(get_time())) {
@@ -432,32 +474,17 @@ void game::simulate(double delta_t) {
     // step 1: check for invalidity of every object and remove
     // defunct objects. do NOT mix simulate() calls with real
     // calls to delete an object.
-    myworld->cleanup_defunct_entities();
+    {
+        profile_scope("sim cleanup");
+        myworld->cleanup_defunct_entities();
+    }
+    // the noise field referred to removed objects. Parallel tasks listen to it, so the
+    // sources are collected now, before the tasks change the objects.
+    update_noise_field();
 
     // step 2: simulate all objects, possibly setting state to dead/defunct.
-    if (myworker.get()) {
-        // Multi-Threading code path (2 cores)
-        myworker->work(delta_t, 1, 2, record);
-        simulate_objects_mt(delta_t, 0, 2, record, nearest_contact);
-        double nc = myworker->sync();
-        nearest_contact = std::min(nc, nearest_contact);
-        /* fixme: the following methods of class game need to be made
-           thread-safe for this to work:
-           --------------------
-           dc_explosion
-           spawn_*
-           add_event
-           check_torpedo_hit
-           ping_ASDIC
-           --------------------
-           making this easier: give sea_object only a const-ref to game,
-           and a non-const-ref to an interface class, where we add
-           only the allowed functions (the ones to be made threadsafe).
-           then game heirs from that interface and all is solved.
-        */
-    } else {
-        simulate_objects_mt(delta_t, 0, 1, record, nearest_contact);
-    }
+    simulate_objects(delta_t, record, nearest_contact);
+
     // must not be done multithreaded.
     // Note: No need to compact convoys/particles anymore as std::vector
     // doesn't have nullptr gaps like ptrvector did.
@@ -479,13 +506,22 @@ void game::simulate(double delta_t) {
     // can be solved by storing a list of collision partners per object,
     // that is cleared every round and generated by this check_collision()
     // function. In that case we should call it _before_ simulate()...
-    myphysics->check_collisions(get_all_ships());
+    // Ships are slow, so collisions need not be checked every step.
+    if (stage_due(collision_accumulator, delta_t, rates.collision_rate)) {
+        profile_scope("sim collisions");
+        myphysics->check_collisions(get_all_ships());
+    }
 
     time += delta_t;
     mylighting->set_time(time);
+    // objects have moved, noise sources must be collected again
+    invalidate_noise_field();
 
     // remove old pings
-    mypings->update(time);
+    {
+        profile_scope("sim pings");
+        mypings->update(time);
+    }
 
     if (!is_editor()) {
         if (nearest_contact > ENEMYCONTACTLOST) {
@@ -495,107 +531,175 @@ void game::simulate(double delta_t) {
     }
 }
 
-void game::simulate_objects_mt(double delta_t, unsigned idxoff, unsigned idxmod, bool record,
-                               double &nearest_contact) {
-    // ------------------------------ ships ------------------------------
-    for (unsigned i = idxoff; i < ships.size(); i += idxmod) {
-        if (ships[i].get() != player) {
-            double dist = ships[i]->get_pos().distance(player->get_pos());
-            if (dist < nearest_contact)
-                nearest_contact = dist;
+void game::init_thread_pool() {
+    unsigned cores = unsigned(std::max(config.geti("cpucores"), 0));
+    if (cores == 0)
+        cores = thread_pool::hardware_threads();
+    if (cores > 1) {
+        log_info("game: Using " << cores << " threads for multicore acceleration.");
+        mypool = std::make_unique<thread_pool>(cores, "simuwork");
+    }
+    myjobs->set_thread_pool(mypool.get());
+}
+
+// commands recorded by the simulation task that the current thread executes.
+static thread_local std::vector<std::unique_ptr<game::deferred_command>> *current_command_buffer = nullptr;
+
+bool game::deferring_commands() {
+    return current_command_buffer != nullptr;
+}
+
+void game::defer_command(std::unique_ptr<deferred_command> dc) {
+    current_command_buffer->push_back(std::move(dc));
+}
+
+void game::compute_simulate_tasks(std::vector<simulate_task> &tasks) const {
+    // cost of ships, submarines etc. differs much (AI, sensors, damage), so every
+    // object is a task of its own. Shells, splashes etc. are cheap, group them.
+    const unsigned group_size = 64;
+    tasks.clear();
+    for (unsigned i = 0; i < ships.size(); ++i)
+        tasks.push_back(simulate_task(simulate_task::ship_objects, i, i + 1));
+    for (unsigned i = 0; i < submarines.size(); ++i)
+        tasks.push_back(simulate_task(simulate_task::submarine_objects, i, i + 1));
+    for (unsigned i = 0; i < airplanes.size(); ++i)
+        tasks.push_back(simulate_task(simulate_task::airplane_objects, i, i + 1));
+    for (unsigned i = 0; i < torpedoes.size(); ++i)
+        tasks.push_back(simulate_task(simulate_task::torpedo_objects, i, i + 1));
+    for (unsigned i = 0; i < depth_charges.size(); i += group_size)
+        tasks.push_back(simulate_task(simulate_task::depth_charge_objects, i, std::min(unsigned(depth_charges.size()), i + group_size)));
+    for (unsigned i = 0; i < gun_shells.size(); i += group_size)
+        tasks.push_back(simulate_task(simulate_task::gun_shell_objects, i, std::min(unsigned(gun_shells.size()), i + group_size)));
+    for (unsigned i = 0; i < water_splashes.size(); i += group_size)
+        tasks.push_back(simulate_task(simulate_task::water_splash_objects, i, std::min(unsigned(water_splashes.size()), i + group_size)));
+    for (unsigned i = 0; i < particles.size(); i += group_size)
+        tasks.push_back(simulate_task(simulate_task::particle_objects, i, std::min(unsigned(particles.size()), i + group_size)));
+}
+
+void game::simulate_objects(double delta_t, bool record, double &nearest_contact) {
+    profile_scope("sim objects");
+    std::vector<simulate_task> tasks;
+    compute_simulate_tasks(tasks);
+    // distance of nearest contact to player before anything is moved, swept over the
+    // packed positions, which are up to date after cleanup.
+    const world::kinematic_type contact_types[] = {world::kinematic_ships, world::kinematic_submarines, world::kinematic_airplanes};
+    for (auto t : contact_types) {
+        const kinematic_store &ks = myworld->get_kinematics(t);
+        const unsigned skip = (player->get_kinematic_store() == &ks) ? player->get_kinematic_index() : kinematic_store::no_entry;
+        double dist = ks.min_distance(player->get_pos(), skip);
+        if (dist >= 0.0 && dist < nearest_contact)
+            nearest_contact = dist;
+    }
+
+    // every task has its own random numbers, so results are the same for any number of cores
+    const unsigned long long step = simulation_step++;
+    if (!mypool.get()) {
+        for (unsigned t = 0; t < tasks.size(); ++t) {
+            rnd_stream rs(step, t);
+            simulate_objects_mt(delta_t, tasks[t], record);
         }
-        try {
-            ships[i]->simulate(delta_t);
-            if (record)
+    } else {
+        // Multi-Threading code path. Every task records the commands its objects
+        // issue (spawn_*, add_event etc.) in its own buffer.
+        std::vector<std::vector<std::unique_ptr<deferred_command>>> commands(tasks.size());
+        mypool->run(unsigned(tasks.size()), [&](unsigned t, unsigned) {
+            current_command_buffer = &commands[t];
+            rnd_stream rs(step, t);
+            try {
+                simulate_objects_mt(delta_t, tasks[t], record);
+            } catch (...) {
+                current_command_buffer = nullptr;
+                throw;
+            }
+            current_command_buffer = nullptr;
+        });
+        // execute commands in task order, so the outcome is the same as for the
+        // single threaded code path, no matter which thread ran which task.
+        for (unsigned t = 0; t < commands.size(); ++t)
+            for (unsigned i = 0; i < commands[t].size(); ++i)
+                commands[t][i]->exec();
+    }
+
+    // convoys are few and steer their ships, so simulate them after all ships.
+    for (unsigned i = 0; i < convoys.size(); ++i) {
+        if (!convoys[i])
+            continue;
+        convoys[i]->simulate(delta_t); // fixme: handle erasing of empty convoys!
+    }
+    // all tasks are done, so others may see the new state now, e.g. collision checks
+    myworld->publish_kinematics();
+}
+
+void game::simulate_objects_mt(double delta_t, const simulate_task &st, bool record) {
+    // time of all tasks of a type is summed up, so with threads it is more than wall clock time
+    static const unsigned stages[] = {
+        profiler::instance().get_stage("sim ships"), profiler::instance().get_stage("sim submarines"),
+        profiler::instance().get_stage("sim airplanes"), profiler::instance().get_stage("sim torpedoes"),
+        profiler::instance().get_stage("sim depth charges"), profiler::instance().get_stage("sim gun shells"),
+        profiler::instance().get_stage("sim water splashes"), profiler::instance().get_stage("sim particles")};
+    profiler::scope ps(stages[st.type]);
+    switch (st.type) {
+    // ------------------------------ ships ------------------------------
+    case simulate_task::ship_objects:
+        for (unsigned i = st.begin; i < st.end; ++i) {
+            // dead objects are not simulated and leave no trail
+            if (ships[i]->simulate(delta_t) && record)
                 ships[i]->remember_position(get_time());
-        } catch (sea_object::is_dead_exception &) {
-            // nothing to do
         }
-    }
+        break;
 
     // ------------------------------ submarines ------------------------------
-    for (unsigned i = idxoff; i < submarines.size(); i += idxmod) {
-        if (submarines[i].get() != player) {
-            double dist = submarines[i]->get_pos().distance(player->get_pos());
-            if (dist < nearest_contact)
-                nearest_contact = dist;
-        }
-        try {
-            submarines[i]->simulate(delta_t);
-            if (record)
+    case simulate_task::submarine_objects:
+        for (unsigned i = st.begin; i < st.end; ++i) {
+            // dead objects are not simulated and leave no trail
+            if (submarines[i]->simulate(delta_t) && record)
                 submarines[i]->remember_position(get_time());
-        } catch (sea_object::is_dead_exception &) {
-            // nothing to do
         }
-    }
+        break;
 
     // ------------------------------ airplanes ------------------------------
-    for (unsigned i = idxoff; i < airplanes.size(); i += idxmod) {
-        if (airplanes[i].get() != player) {
-            double dist = airplanes[i]->get_pos().distance(player->get_pos());
-            if (dist < nearest_contact)
-                nearest_contact = dist;
-        }
-        try {
+    case simulate_task::airplane_objects:
+        for (unsigned i = st.begin; i < st.end; ++i)
             airplanes[i]->simulate(delta_t);
-        } catch (sea_object::is_dead_exception &) {
-            // nothing to do
-        }
-    }
+        break;
 
     // ------------------------------ torpedoes ------------------------------
-    for (unsigned i = idxoff; i < torpedoes.size(); i += idxmod) {
-        try {
-            torpedoes[i]->simulate(delta_t);
-            if (record)
+    case simulate_task::torpedo_objects:
+        for (unsigned i = st.begin; i < st.end; ++i) {
+            // dead objects are not simulated and leave no trail
+            if (torpedoes[i]->simulate(delta_t) && record)
                 torpedoes[i]->remember_position(get_time());
-        } catch (sea_object::is_dead_exception &) {
-            // nothing to do
         }
-    }
+        break;
 
     // ------------------------------ depth_charges ------------------------------
-    for (unsigned i = idxoff; i < depth_charges.size(); i += idxmod) {
-        try {
+    case simulate_task::depth_charge_objects:
+        for (unsigned i = st.begin; i < st.end; ++i)
             depth_charges[i]->simulate(delta_t);
-        } catch (sea_object::is_dead_exception &) {
-            // nothing to do
-        }
-    }
+        break;
 
     // ------------------------------ gun_shells ------------------------------
-    for (unsigned i = idxoff; i < gun_shells.size(); i += idxmod) {
-        try {
+    case simulate_task::gun_shell_objects:
+        for (unsigned i = st.begin; i < st.end; ++i)
             gun_shells[i]->simulate(delta_t);
-        } catch (sea_object::is_dead_exception &) {
-            // nothing to do
-        }
-    }
+        break;
 
     // ------------------------------ water_splashes ------------------------------
-    for (unsigned i = idxoff; i < water_splashes.size(); i += idxmod) {
-        try {
+    case simulate_task::water_splash_objects:
+        for (unsigned i = st.begin; i < st.end; ++i)
             water_splashes[i]->simulate(delta_t);
-        } catch (sea_object::is_dead_exception &) {
-            // nothing to do
-        }
-    }
-
-    // for convoys/particles it doesn't hurt to mix simulate() with compact().
-    // ------------------------------ convoys ------------------------------
-    for (unsigned i = idxoff; i < convoys.size(); i += idxmod) {
-        if (!convoys[i])
-            continue;
-        convoys[i]->simulate(delta_t); // fixme: handle erasing of empty convoys!
-    }
+        break;
 
     // ------------------------------ particles ------------------------------
-    for (unsigned i = idxoff; i < particles.size(); i += idxmod) {
-        if (!particles[i])
-            continue;
-        if (!particles[i]->is_defunct()) {
-            particles[i]->simulate(*this, delta_t);
+    case simulate_task::particle_objects:
+        for (unsigned i = st.begin; i < st.end; ++i) {
+            if (!particles[i])
+                continue;
+            if (!particles[i]->is_defunct()) {
+                particles[i]->simulate(*this, delta_t);
+            }
         }
+        break;
     }
 }
 
@@ -635,26 +739,6 @@ void game::add_logbook_entry(const string &s) {
 
 ******************************************************************************************/
 
-template <class T>
-inline vector<T *> visible_obj(const game *gm, const std::vector<std::unique_ptr<T>> &v, const sea_object *o) {
-    vector<T *> result;
-    const sensor *s = o->get_sensor(o->lookout_system);
-    if (!s)
-        return result;
-    const lookout_sensor *ls = dynamic_cast<const lookout_sensor *>(s);
-    if (!ls)
-        return result;
-    result.reserve(v.size());
-    for (unsigned i = 0; i < v.size(); ++i) {
-        // do not handle dead or defunct objects!
-        if (v[i] && v[i]->is_reference_ok()) {
-            if (ls->is_detected(gm, o, v[i].get()))
-                result.push_back(v[i].get());
-        }
-    }
-    return result;
-}
-
 vector<ship *> game::visible_ships(const sea_object *o) const {
     return myworld->visible_ships(this, o);
 }
@@ -696,20 +780,23 @@ vector<sonar_contact> game::sonar_ships(const sea_object *o) const {
     if (!pss)
         return result;
 
-    result.reserve(ships.size());
+    // ships beyond sensor range can't be heard, so only nearby ships are candidates.
+    vector<unsigned> candidates;
+    myworld->query_range(world::indexed_ships, o->get_pos().xy(), pss->get_range(), candidates);
+    result.reserve(candidates.size());
 
     // collect the nearest contacts, limited to some value!
-    vector<pair<double, ship *>> contacts(MAX_ACUSTIC_CONTACTS, make_pair(1e30, (ship *)0));
-    for (unsigned k = 0; k < ships.size(); ++k) {
+    vector<pair<double, unsigned>> contacts(MAX_ACUSTIC_CONTACTS, make_pair(1e30, kinematic_store::no_entry));
+    for (unsigned k : candidates) {
         // do not handle dead/defunct objects
-        if (!ships[k]->is_reference_ok())
+        if (!ships[k]->is_step_reference_ok())
             continue;
 
         // When the detecting unit is a ship it should not detect itself.
         if (o == ships[k].get())
             continue;
 
-        double d = ships[k]->get_pos().xy().square_distance(o->get_pos().xy());
+        double d = ships[k]->get_step_pos().xy().square_distance(o->get_pos().xy());
         unsigned i = 0;
         for (; i < contacts.size(); ++i) {
             if (contacts[i].first > d)
@@ -720,19 +807,17 @@ vector<sonar_contact> game::sonar_ships(const sea_object *o) const {
             for (unsigned j = contacts.size() - 1; j > i; --j)
                 contacts[j] = contacts[j - 1];
 
-            contacts[i] = make_pair(d, ships[k].get());
+            contacts[i] = make_pair(d, k);
         }
     }
 
-    unsigned size = contacts.size();
-    for (unsigned i = 0; i < size; i++) {
-        ship *sh = contacts[i].second;
-        if (sh == 0)
-            break;
-
-        if (pss->is_detected(this, o, sh))
-            result.push_back(sonar_contact(sh->get_pos().xy(), sh->get_class()));
-    }
+    // test the nearest contacts in order of distance
+    candidates.clear();
+    for (unsigned i = 0; i < contacts.size() && contacts[i].second != kinematic_store::no_entry; i++)
+        candidates.push_back(contacts[i].second);
+    myworld->detect(this, pss, o, world::indexed_ships, candidates);
+    for (unsigned k : candidates)
+        result.push_back(sonar_contact(ships[k]->get_step_pos().xy(), ships[k]->get_class()));
     return result;
 }
 
@@ -744,20 +829,19 @@ vector<sonar_contact> game::sonar_submarines(const sea_object *o) const {
     const passive_sonar_sensor *pss = dynamic_cast<const passive_sonar_sensor *>(s);
     if (!pss)
         return result;
-    result.reserve(submarines.size());
-    for (unsigned k = 0; k < submarines.size(); ++k) {
-        // do not handle dead/defunct objects
-        if (!submarines[k]->is_reference_ok())
-            continue;
-
-        // When the detecting unit is a submarine it should not
-        // detect itself.
-        if (o == submarines[k].get())
-            continue;
-
-        if (pss->is_detected(this, o, submarines[k].get()))
-            result.push_back(sonar_contact(submarines[k]->get_pos().xy(), submarines[k]->get_class()));
-    }
+    vector<unsigned> candidates;
+    myworld->query_range(world::indexed_submarines, o->get_pos().xy(), pss->get_range(), candidates);
+    // do not handle dead/defunct objects. When the detecting unit is a submarine
+    // it should not detect itself.
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                    [&](unsigned k) {
+                                        return !submarines[k]->is_step_reference_ok() || o == submarines[k].get();
+                                    }),
+                     candidates.end());
+    myworld->detect(this, pss, o, world::indexed_submarines, candidates);
+    result.reserve(candidates.size());
+    for (unsigned k : candidates)
+        result.push_back(sonar_contact(submarines[k]->get_step_pos().xy(), submarines[k]->get_class()));
     return result;
 }
 
@@ -778,11 +862,12 @@ vector<submarine *> game::radar_submarines(const sea_object *o) const {
     const radar_sensor *ls = dynamic_cast<const radar_sensor *>(s);
     if (!ls)
         return result;
-    result.reserve(submarines.size());
-    for (unsigned k = 0; k < submarines.size(); ++k) {
-        if (ls->is_detected(this, o, submarines[k].get()))
-            result.push_back(submarines[k].get());
-    }
+    vector<unsigned> candidates;
+    myworld->query_range(world::indexed_submarines, o->get_pos().xy(), ls->get_range(), candidates);
+    myworld->detect(this, ls, o, world::indexed_submarines, candidates);
+    result.reserve(candidates.size());
+    for (unsigned k : candidates)
+        result.push_back(submarines[k].get());
     return result;
 }
 
@@ -794,11 +879,12 @@ vector<ship *> game::radar_ships(const sea_object *o) const {
     const radar_sensor *ls = dynamic_cast<const radar_sensor *>(s);
     if (!ls)
         return result;
-    result.reserve(ships.size());
-    for (unsigned k = 0; k < ships.size(); ++k) {
-        if (ls->is_detected(this, o, ships[k].get()))
-            result.push_back(ships[k].get());
-    }
+    vector<unsigned> candidates;
+    myworld->query_range(world::indexed_ships, o->get_pos().xy(), ls->get_range(), candidates);
+    myworld->detect(this, ls, o, world::indexed_ships, candidates);
+    result.reserve(candidates.size());
+    for (unsigned k : candidates)
+        result.push_back(ships[k].get());
     return result;
 }
 
@@ -823,42 +909,6 @@ vector<vector2> game::convoy_positions() const {
 
 pair<double, noise> game::sonar_listen_ships(const ship *listener,
                                              angle rel_listening_dir) const {
-    // collect all ships for sound strength measurement
-    vector<const ship *> tmpships;
-    tmpships.reserve(ships.size() + submarines.size() /* + torpedoes.size() */ - 1);
-    for (unsigned i = 0; i < ships.size(); ++i)
-        if (ships[i].get() != listener)
-            tmpships.push_back(ships[i].get());
-    for (unsigned i = 0; i < submarines.size(); ++i)
-        if (dynamic_cast<const ship *>(submarines[i].get()) != listener)
-            tmpships.push_back(submarines[i].get());
-    // fixme: add torpedoes here as well... later...
-
-#if 0
-	// fixme, test, only detect one ship
-	tmpships.resize(1);
-#endif
-
-    // fixme: the lower part of this function is sonar dependent and should go to a sonar class...
-
-    // compute noise strengths for all ships for all frequency bands, real strengths, not dB!
-    noise n;
-#if 1
-    // as first, add background noise
-    n += noise::compute_ambient_noise_strength(0.2 /* sea state, fixme make dynamic later */);
-#endif
-
-    // next, add noise from receiver vessel
-    // if we do that, weaker noises are wiped out...
-    // fixme: GHG/BG have blind spots at aft, so the receiver caused noise is reduced much more.
-    // we should handle receiver vessel as additional noise source with distance 50, direction 180° relative!
-    n += listener->get_noise_signature().compute_signal_strength(50 /* distance */,
-                                                                 listener->get_speed(),
-                                                                 false /*cavitation=off for listener*/);
-
-    angle hdg = listener->get_heading();
-    bool listen_to_starboard = (rel_listening_dir.value_pm180() >= 0);
-
     // detection formula:
     // compute noise of target = L_t
     // compute ambient noise = L_a
@@ -886,45 +936,21 @@ pair<double, noise> game::sonar_listen_ships(const ship *listener,
 
     // fixme: ghost images appear with higher frequencies!!! seems to be a ghg "feature"
 
-    // add noise of vessels
-    vector2 lp = listener->get_pos().xy();
-    for (unsigned i = 0; i < tmpships.size(); ++i) {
-        const ship *s = tmpships[i];
-        vector2 relpos = s->get_pos().xy() - lp;
-        double distance = relpos.length();
-        double speed = s->get_speed(); // s->get_throttle_speed();
-        bool cavit = s->screw_cavitation();
-        angle direction_to_noise(relpos);
-        angle rel_dir_to_noise = direction_to_noise - hdg;
-        bool noise_is_starboard = (rel_dir_to_noise.value_pm180() >= 0);
-        // check if noise is on active side of phones
-        if (listen_to_starboard == noise_is_starboard) {
-            noise nsig = s->get_noise_signature().compute_signal_strength(distance, speed, cavit);
-            // compute strengths for all bands
-            for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
-                double signalstrength = compute_signal_strength_GHG(rel_dir_to_noise,
-                                                                    noise::typical_frequency[b],
-                                                                    rel_listening_dir);
-                // printf("signalstrength is = %f\n", signalstrength);
-                nsig.frequencies[b] *= signalstrength;
-            }
-            n += nsig;
-        }
+    // The sonar operator and the displays listen to many directions per step, so the
+    // noise sources and what the listener receives from them are computed only once
+    // per step. Listening to a direction then only weights the received strengths.
+    std::shared_ptr<const noise_field::reception> r;
+    {
+        mutex_locker ml(noise_field_mutex);
+        // during a step the field exists, so only calls between steps build it here
+        if (!mynoisefield)
+            update_noise_field();
+        // cavitation is off for listener
+        r = mynoisefield->get_reception(listener, listener->get_pos().xy(), listener->get_heading(),
+                                        listener->get_noise_signature().compute_source_level(listener->get_speed(), false));
     }
-    // now compute back to dB, quantize to integer dB values, to
-    // simulate shadowing of weak signals by background noise
-    // divide by receiver sensitivity before doing so, to avoid cutting off weak signals.
-    const double GHG_receiver_sensitivity_dB = -3; // weakest signal strength to be detectable
-    double abs_strength =
-        floor(std::max(n.compute_total_noise_strength_dB() - GHG_receiver_sensitivity_dB, 0.0)) + GHG_receiver_sensitivity_dB;
-
-    // fixme: depending on listener angle, use only port or starboard phones to listen to signals!
-    //        (which set to use must be given as parameter) <OK>
+
     // fixme: add sensitivity of receiver (see harpoon docs...)  TO BE DONE NEXT
-    // fixme: add noise produced by receiver/own ship            TO BE DONE NEXT
-    // fixme: discretize strengths!!! (by angle and frequency!) <OK, MAYBE A BIT CRUDE>
-    //        this could be done also by quantizing the strength (in dB) of the signal,
-    //        or both. To be tested...
     // fixme: identify type of noise (by sonarman). compute similarity to known
     //        noise signatures (minimum sim of squares of distances between measured
     //        values and known reference values). this should be done in another function...
@@ -933,70 +959,95 @@ pair<double, noise> game::sonar_listen_ships(const ship *listener,
     //        <OK> BUT: this doesnt work well. To determine the signal type by distribution
     //        to just four frequency bands is not realistic. Signals are distuingished
     //        by their frequency mixture., CHANGE THIS LATER
-    return make_pair(abs_strength, n.to_dB());
+    return r->listen(rel_listening_dir);
+}
+
+void game::update_noise_field() const {
+    mutex_locker ml(noise_field_mutex);
+    mynoisefield = std::make_unique<noise_field>();
+    for (auto &s : ships)
+        mynoisefield->add_source(s.get(), s->get_pos().xy(),
+                                 s->get_noise_signature().compute_source_level(s->get_speed(), s->screw_cavitation()));
+    for (auto &s : submarines)
+        mynoisefield->add_source(static_cast<const ship *>(s.get()), s->get_pos().xy(),
+                                 s->get_noise_signature().compute_source_level(s->get_speed(), s->screw_cavitation()));
+    // fixme: add torpedoes here as well... later...
+}
+
+void game::invalidate_noise_field() {
+    mutex_locker ml(noise_field_mutex);
+    mynoisefield.reset();
 }
 
 //
 // create new objects
 //
 void game::spawn_ship(std::unique_ptr<ship> s) {
-    myworld->spawn_ship(std::move(s));
+    execute_or_defer([this, s = std::move(s)]() mutable { myworld->spawn_ship(std::move(s)); });
 }
 
 void game::spawn_submarine(std::unique_ptr<submarine> u) {
-    myworld->spawn_submarine(std::move(u));
+    execute_or_defer([this, u = std::move(u)]() mutable { myworld->spawn_submarine(std::move(u)); });
 }
 
 void game::spawn_airplane(std::unique_ptr<airplane> a) {
-    myworld->spawn_airplane(std::move(a));
+    execute_or_defer([this, a = std::move(a)]() mutable { myworld->spawn_airplane(std::move(a)); });
 }
 
 void game::spawn_torpedo(std::unique_ptr<torpedo> t) {
-    myworld->spawn_torpedo(std::move(t));
+    execute_or_defer([this, t = std::move(t)]() mutable { myworld->spawn_torpedo(std::move(t)); });
 }
 
 void game::spawn_gun_shell(std::unique_ptr<gun_shell> s, const double &calibre) {
-    vector3 pos = s->get_pos();
-    myworld->spawn_gun_shell(std::move(s));
-    // vary the sound effect based on the gun size
-    if (calibre <= 120.0)
-        myevents->add_event(std::make_unique<event_gunfire_light>(pos));
-    else if (calibre <= 200.0)
-        myevents->add_event(std::make_unique<event_gunfire_medium>(pos));
-    else
-        myevents->add_event(std::make_unique<event_gunfire_heavy>(pos));
+    execute_or_defer([this, s = std::move(s), calibre]() mutable {
+        vector3 pos = s->get_pos();
+        myworld->spawn_gun_shell(std::move(s));
+        // vary the sound effect based on the gun size
+        if (calibre <= 120.0)
+            myevents->add_event(std::make_unique<event_gunfire_light>(pos));
+        else if (calibre <= 200.0)
+            myevents->add_event(std::make_unique<event_gunfire_medium>(pos));
+        else
+            myevents->add_event(std::make_unique<event_gunfire_heavy>(pos));
+    });
 }
 
 void game::spawn_water_splash(std::unique_ptr<water_splash> s) {
-    myworld->spawn_water_splash(std::move(s));
+    execute_or_defer([this, s = std::move(s)]() mutable { myworld->spawn_water_splash(std::move(s)); });
 }
 
 void game::spawn_depth_charge(std::unique_ptr<depth_charge> dc) {
-    vector3 pos = dc->get_pos();
-    myworld->spawn_depth_charge(std::move(dc));
-    myevents->add_event(std::make_unique<event_depth_charge_in_water>(pos));
+    execute_or_defer([this, dc = std::move(dc)]() mutable {
+        vector3 pos = dc->get_pos();
+        myworld->spawn_depth_charge(std::move(dc));
+        myevents->add_event(std::make_unique<event_depth_charge_in_water>(pos));
+    });
 }
 
 void game::spawn_convoy(std::unique_ptr<convoy> cv) {
-    myworld->spawn_convoy(std::move(cv));
+    execute_or_defer([this, cv = std::move(cv)]() mutable { myworld->spawn_convoy(std::move(cv)); });
 }
 
 void game::spawn_particle(std::unique_ptr<particle> pt) {
-    myworld->spawn_particle(std::move(pt));
+    execute_or_defer([this, pt = std::move(pt)]() mutable { myworld->spawn_particle(std::move(pt)); });
 }
 
 void game::dc_explosion(const depth_charge &dc) {
-    // Create water splash.
-    spawn_water_splash(std::make_unique<depth_charge_water_splash>(*this, dc.get_pos().xy().xy0()));
-    myevents->add_event(std::make_unique<event_depth_charge_exploding>(dc.get_pos()));
-
-    // are subs affected?
-    // fixme: ships can be damaged by DCs also...
-    // fixme: ai should not be able to release dcs with a depth less than 30m or so, to
-    // avoid suicide
-    for (unsigned k = 0; k < submarines.size(); ++k) {
-        submarines[k]->depth_charge_explosion(dc);
-    }
+    // the depth charge is killed by the caller, so it still exists when a deferred
+    // command is executed.
+    execute_or_defer([this, &dc]() {
+        // Create water splash.
+        spawn_water_splash(std::make_unique<depth_charge_water_splash>(*this, dc.get_pos().xy().xy0()));
+        myevents->add_event(std::make_unique<event_depth_charge_exploding>(dc.get_pos()));
+
+        // are subs affected?
+        // fixme: ships can be damaged by DCs also...
+        // fixme: ai should not be able to release dcs with a depth less than 30m or so, to
+        // avoid suicide
+        for (unsigned k = 0; k < submarines.size(); ++k) {
+            submarines[k]->depth_charge_explosion(dc);
+        }
+    });
 }
 
 void game::torp_explode(const torpedo *t) {
@@ -1007,11 +1058,13 @@ void game::torp_explode(const torpedo *t) {
 }
 
 void game::ship_sunk(const ship *s) {
-    myevents->add_event(std::make_unique<event_ship_sunk>());
-    ostringstream oss;
-    oss << texts::get(83) << " " << s->get_description(2);
-    date d((unsigned)time);
-    myscoring->record_sunk_ship(d, s->get_description(2), s->get_modelname(), s->get_specfilename(), s->get_skin_layout(), s->get_tonnage());
+    execute_or_defer([this, s]() {
+        myevents->add_event(std::make_unique<event_ship_sunk>());
+        ostringstream oss;
+        oss << texts::get(83) << " " << s->get_description(2);
+        date d((unsigned)time);
+        myscoring->record_sunk_ship(d, s->get_description(2), s->get_modelname(), s->get_specfilename(), s->get_skin_layout(), s->get_tonnage());
+    });
 }
 
 const std::list<sink_record> &game::get_sunken_ships() const {
@@ -1041,19 +1094,24 @@ void game::ping_ASDIC(list<vector3> &contacts, sea_object *d,
 
         // remember ping (for drawing)
         // fixme: seems redundant with event list...!
-        mypings->add_ping(d->get_pos().xy(),
-                          ass->get_bearing() + d->get_heading(), time,
-                          ass->get_range(), ass->get_detection_cone());
-        myevents->add_event(std::make_unique<event_ping>(d->get_pos()));
+        // detection below is done immediately, only storing the ping must be deferred.
+        execute_or_defer([this, pos = d->get_pos(), bearing = ass->get_bearing() + d->get_heading(),
+                          range = ass->get_range(), cone = ass->get_detection_cone()]() {
+            mypings->add_ping(pos.xy(), bearing, time, range, cone);
+            myevents->add_event(std::make_unique<event_ping>(pos));
+        });
 
         // fixme: noise from ships can disturb ASDIC or may generate more contacs.
         // ocean floor echoes ASDIC etc...
-        for (unsigned k = 0; k < submarines.size(); ++k) {
-            if (ass->is_detected(this, d, submarines[k].get())) {
-                contacts.push_back(submarines[k]->get_pos() +
-                                   vector3(rnd(40) - 20.0f, rnd(40) - 20.0f,
-                                           rnd(40) - 20.0f));
-            }
+        // Only submarines in the sonar beam can give an echo.
+        vector<unsigned> candidates;
+        myworld->query_sector(world::indexed_submarines, d->get_pos().xy(), ass->get_range(),
+                              ass->get_bearing() + d->get_heading(), ass->get_detection_cone(), candidates);
+        myworld->detect(this, ass, d, world::indexed_submarines, candidates);
+        for (unsigned k : candidates) {
+            contacts.push_back(submarines[k]->get_step_pos() +
+                               vector3(rnd(40) - 20.0f, rnd(40) - 20.0f,
+                                       rnd(40) - 20.0f));
         }
 
         if (move_sensor) {
@@ -1082,46 +1140,55 @@ const std::list<ping> &game::get_pings() const {
 }
 
 template <class C>
-ship *game::check_units(torpedo *t, const std::vector<std::unique_ptr<C>> &units) {
+ship *game::check_units(torpedo *t, const std::vector<std::unique_ptr<C>> &units, world::indexed_type type) {
     const vector3 &t_pos = t->get_pos();
-    bv_tree::param p0 = t->compute_bv_tree_params();
-    for (unsigned k = 0; k < units.size(); ++k) {
+    // broad phase: only units whose collision sphere touches the torpedo's one can be hit,
+    // so the trees are only traversed for real candidates.
+    std::vector<unsigned> candidates;
+    myworld->query_swept_sphere(type, t_pos, t_pos, t->get_collision_radius(), candidates);
+    if (candidates.empty())
+        return nullptr;
+    flat_bv_tree::param p0 = t->compute_flat_bv_tree_params();
+    for (unsigned k : candidates) {
         // fixme use bv_trees here with special code for magnetic ignition torpedoes
         // like intersection of sphere around torpedo head with bv tree
-        const vector3 &partner_pos = units[k]->get_pos();
+        const vector3 partner_pos = units[k]->get_step_pos();
         matrix4 rel_trans = matrix4::trans(partner_pos - t_pos);
-        bv_tree::param p1 = units[k]->compute_bv_tree_params();
+        flat_bv_tree::param p1 = units[k]->compute_flat_bv_tree_params(units[k]->get_step_orientation());
         p1.transform = rel_trans * p1.transform;
         vector3f contact_point;
-        if (bv_tree::closest_collision(p0, p1, contact_point))
+        if (flat_bv_tree::closest_collision(p0, p1, contact_point))
             return units[k].get();
-        // old code:
-        // if ( is_collision ( t, units[k] ) )
-        //	return units[k];
     }
 
     return 0;
 }
 
 bool game::check_torpedo_hit(torpedo *t, bool runlengthfailure) {
-    ship *s = check_units(t, ships);
+    ship *s = check_units(t, ships, world::indexed_ships);
 
     if (!s)
-        s = check_units(t, submarines);
+        s = check_units(t, submarines, world::indexed_submarines);
 
     if (s) {
-        if (runlengthfailure) {
-            myevents->add_event(std::make_unique<event_torpedo_dud_shortrange>());
-        } else {
-            // Only ships that are alive can be sunk. Already sinking
-            // or destroyed ships cannot be destroyed again.
-            if (!s->is_alive())
-                return false;
+        // Only ships that are alive can be sunk. Already sinking
+        // or destroyed ships cannot be destroyed again.
+        if (!runlengthfailure && !s->is_step_alive())
+            return false;
+
+        // the hit changes the target ship, so it must be deferred when called
+        // from a parallel simulation task. The torpedo is killed by the caller
+        // and thus still exists when the command is executed.
+        execute_or_defer([this, s, t, runlengthfailure]() {
+            if (runlengthfailure) {
+                myevents->add_event(std::make_unique<event_torpedo_dud_shortrange>());
+                return;
+            }
 
             // now check if torpedo fuse works
             if (!t->test_contact_fuse()) {
                 myevents->add_event(std::make_unique<event_torpedo_dud>());
-                return true;
+                return;
             }
 
             if (s->damage(t->get_pos(), t->get_hit_points())) {
@@ -1133,7 +1200,7 @@ bool game::check_torpedo_hit(torpedo *t, bool runlengthfailure) {
             // explosion of torpedo
             spawn_particle(std::make_unique<explosion_particle>(s->get_pos() + vector3(0, 0, 5)));
             torp_explode(t);
-        }
+        });
         return true;
     }
 
@@ -1332,37 +1399,7 @@ vector<sea_object *> game::visible_sea_objects(const sea_object *o) const {
 }
 
 ship *game::sonar_acoustical_torpedo_target(const torpedo *o) const {
-    ship *loudest_object = 0;
-    double loudest_object_sf = 0.0f;
-    const sensor *s = o->get_sensor(o->passive_sonar_system);
-    const passive_sonar_sensor *pss = 0;
-
-    if (s)
-        pss = dynamic_cast<const passive_sonar_sensor *>(s);
-
-    if (pss) {
-        for (unsigned k = 0; k < ships.size(); ++k) {
-            double sf = 0.0f;
-            if (pss->is_detected(sf, this, o, ships[k].get())) {
-                if (sf > loudest_object_sf) {
-                    loudest_object_sf = sf;
-                    loudest_object = ships[k].get();
-                }
-            }
-        }
-
-        for (unsigned k = 0; k < submarines.size(); ++k) {
-            double sf = 0.0f;
-            if (pss->is_detected(sf, this, o, submarines[k].get())) {
-                if (sf > loudest_object_sf) {
-                    loudest_object_sf = sf;
-                    loudest_object = submarines[k].get();
-                }
-            }
-        }
-    }
-
-    return loudest_object;
+    return myworld->sonar_acoustical_torpedo_target(this, o);
 }
 
 bool game::is_day_mode() const {
@@ -1471,6 +1508,11 @@ double game::compute_water_height(const vector2 &pos) const {
     return mywater->get_height(pos);
 }
 
+void game::compute_water_heights(const vector2 &origin, const std::vector<vector2f> &offsets,
+                                 std::vector<float> &heights) const {
+    mywater->get_heights(origin, offsets, heights);
+}
+
 sea_object *game::load_ptr(unsigned nr) const {
     if (nr == 0)
         return 0;
@@ -1570,55 +1612,8 @@ unsigned game::process_freezetime() {
     return myfreezer->process_freezetime();
 }
 
-game::simulate_worker::simulate_worker(game &gm_)
-    : thread("simuwork"), gm(gm_), delta_t(0.0), idxoff(0), idxmod(0), done(true) {
-}
-
-void game::simulate_worker::request_abort() {
-    mutex_locker ml(mtx);
-    thread::request_abort();
-    cond.signal();
-}
-
-void game::simulate_worker::loop() {
-    {
-        mutex_locker ml(mtx);
-        if (done)
-            cond.wait(mtx);
-        if (abort_requested())
-            return;
-    }
-    gm.simulate_objects_mt(delta_t, idxoff, idxmod, record, nearest_contact);
-    {
-        mutex_locker ml(mtx);
-        done = true;
-        condfini.signal();
-    }
-}
-
-void game::simulate_worker::work(double dt, unsigned io, unsigned im, bool r) {
-    mutex_locker ml(mtx);
-    if (!done)
-        throw error("work() called without sync before");
-    done = false;
-    delta_t = dt;
-    idxoff = io;
-    idxmod = im;
-    record = r;
-    nearest_contact = 1e30;
-    cond.signal();
-}
-
-double game::simulate_worker::sync() {
-    mutex_locker ml(mtx);
-    if (!done) {
-        condfini.wait(mtx);
-    }
-    return nearest_contact;
-}
-
 void game::add_event(event *e) {
-    myevents->add_event(e);
+    execute_or_defer([this, e]() { myevents->add_event(e); });
 }
 
 const std::list<std::unique_ptr<event>> &game::get_events() const {
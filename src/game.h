@@ -34,7 +34,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "condvar.h"
 #include "mutex.h"
 #include "random_generator.h"
-#include "thread.h"
+#include "rnd.h"
+#include "thread_pool.h"
 #include <list>
 #include <memory>
 #include <vector>
@@ -67,6 +68,7 @@ class time_freezer;
 class scoring_manager;
 class save_manager;
 class game_loader;
+class noise_field;
 struct ping;
 struct sink_record;
 struct job;
@@ -170,31 +172,78 @@ class game {
     // terrain height data
     std::unique_ptr<height_generator> myheightgen;
 
-    // multi-threading helper for simulation
-    void simulate_objects_mt(double delta_t, unsigned idxoff, unsigned idxmod, bool record,
-                             double &nearest_contact);
-
-    class simulate_worker : public ::thread {
-        ::mutex mtx;
-        condvar cond;
-        condvar condfini;
-        game &gm;
-        double delta_t;
-        unsigned idxoff;
-        unsigned idxmod;
-        bool record;
-        double nearest_contact;
-        bool done;
-
-      public:
-        simulate_worker(game &gm_);
-        void loop();
-        void request_abort();
-        void work(double dt, unsigned io, unsigned im, bool record);
-        double sync();
+    /// range of objects of one type that is simulated as one unit of work
+    struct simulate_task {
+        enum object_type { ship_objects,
+                           submarine_objects,
+                           airplane_objects,
+                           torpedo_objects,
+                           depth_charge_objects,
+                           gun_shell_objects,
+                           water_splash_objects,
+                           particle_objects };
+        object_type type;
+        unsigned begin, end;
+        simulate_task(object_type t, unsigned b, unsigned e) : type(t), begin(b), end(e) {}
     };
 
-    ::thread::auto_ptr<simulate_worker> myworker;
+    /// split all objects into simulation tasks. Expensive objects get a task each,
+    /// cheap ones are grouped, so work stealing can balance the load.
+    void compute_simulate_tasks(std::vector<simulate_task> &tasks) const;
+
+    /// simulate all objects, in parallel if a thread pool is available.
+    void simulate_objects(double delta_t, bool record, double &nearest_contact);
+
+    /// simulate objects of one task
+    ///@note Threading contract: the tasks of a step run in parallel and every task changes
+    ///	only the objects of its range. Other objects are read only through state that does
+    ///	not change during the step:
+    ///	- position, velocity, orientation, heading and alive state at the start of the step,
+    ///	  see sea_object::get_step_pos,
+    ///	- spatial indices and sensor records of world, see world::detect,
+    ///	- the noise field of passive sonars, see sonar_listen_ships,
+    ///	- immutable data like models, specs and collision trees.
+    ///	Everything that changes other objects, world or game (spawn_*, damage, events, convoy
+    ///	contacts) is passed to execute_or_defer and executed after all tasks in task order.
+    ///	Every task draws random numbers (rnd, random) from its own rnd_stream seeded with the
+    ///	step and task number, so the results don't depend on the number of cores.
+    void simulate_objects_mt(double delta_t, const simulate_task &st, bool record);
+
+    /// multi-threading helper for simulation, only created for more than one cpu core
+    std::unique_ptr<thread_pool> mypool;
+
+    /// create thread pool according to configuration ("cpucores", 0 means all hardware threads)
+    void init_thread_pool();
+
+    /// rates of the fixed time step simulation, in steps per second of game time
+    struct step_rates {
+        double step_rate;       ///< rigid body integration and object simulation
+        double collision_rate;  ///< collision checks
+        double visibility_rate; ///< computation of max. view distance
+        unsigned max_steps;     ///< max. steps per call of simulate, remaining time is dropped on overload
+        step_rates() : step_rate(20), collision_rate(10), visibility_rate(1), max_steps(8192) {}
+    };
+    step_rates rates;
+    double step_accumulator;       // game time not yet simulated, less than one step
+    double collision_accumulator;  // game time since last collision check
+    double visibility_accumulator; // game time since last view distance computation
+
+    /// noise sources of the current step for passive sonar. Collected before the objects
+    /// are simulated, between steps on first use.
+    mutable std::unique_ptr<noise_field> mynoisefield;
+    mutable ::mutex noise_field_mutex;
+
+    /// collect noise sources of all ships and submarines at their current state
+    void update_noise_field() const;
+
+    /// drop noise field when objects moved or were removed
+    void invalidate_noise_field();
+
+    /// read step rates from configuration and reset accumulators
+    void init_step_rates();
+
+    /// simulate one fixed time step of all objects and stages that are due
+    void simulate_step(double delta_t);
 
     player_info playerinfo;
 
@@ -223,6 +272,11 @@ class game {
     std::unique_ptr<save_manager> mysave;
 
     random_generator random_gen;
+    /// threads without an rnd_stream share random_gen
+    ::mutex random_mutex;
+
+    /// number of simulation steps done, seeds the random streams of simulation tasks
+    unsigned long long simulation_step = 0;
 
     game();
     game &operator=(const game &other);
@@ -244,8 +298,17 @@ class game {
     static std::string read_description_of_savegame(const std::string &filename);
 
     void compute_max_view_dist(); // fixme - public?
+    /// advance game time by delta_t. Simulation is done in fixed steps, time
+    /// that is left over is accumulated for the next call.
     virtual void simulate(double delta_t);
 
+    /// get fraction of a step that real time is ahead of the last simulated state, in [0,1).
+    /// Renderers interpolate objects with it, see sea_object::get_render_pos.
+    double get_interpolation_factor() const {
+        double f = step_accumulator * rates.step_rate;
+        return f < 1.0 ? f : 1.0;
+    }
+
     const std::list<sink_record> &get_sunken_ships() const;
     const logbook &get_players_logbook() const { return players_logbook; }
     void add_logbook_entry(const std::string &s);
@@ -338,7 +401,38 @@ class game {
     void spawn_convoy(std::unique_ptr<convoy> cv);
     void spawn_particle(std::unique_ptr<particle> pt);
 
+    /// command issued by an object while objects are simulated in parallel
+    struct deferred_command {
+        virtual ~deferred_command() = default;
+        virtual void exec() = 0;
+    };
+
+    /// true when the caller is a parallel simulation task that must not change the world directly
+    static bool deferring_commands();
+
+    /// record a command of the current simulation task
+    static void defer_command(std::unique_ptr<deferred_command> dc);
+
+    /// execute command f now, or record it when called from a parallel simulation task.
+    /// Recorded commands are executed on the main thread after all objects were simulated,
+    /// in the order of the tasks that issued them, so results do not depend on thread scheduling.
+    template <class F>
+    static void execute_or_defer(F f) {
+        if (!deferring_commands()) {
+            f();
+            return;
+        }
+        struct call : public deferred_command {
+            F func;
+            call(F &&f_) : func(std::move(f_)) {}
+            void exec() override { func(); }
+        };
+        defer_command(std::make_unique<call>(std::move(f)));
+    }
+
     // simulation events
+    // Note! these functions and spawn_*, add_event, ping_ASDIC and check_torpedo_hit
+    // may be called from parallel simulation tasks. They defer all changes to the world.
     void dc_explosion(const depth_charge &dc); // depth charge exploding
     void torp_explode(const torpedo *t);       // torpedo explosion/impact
     void ship_sunk(const ship *s);             // a ship sinks
@@ -353,7 +447,7 @@ class game {
     const std::list<ping> &get_pings() const;
 
     template <class C>
-    ship *check_units(torpedo *t, const std::vector<std::unique_ptr<C>> &units);
+    ship *check_units(torpedo *t, const std::vector<std::unique_ptr<C>> &units, world::indexed_type type);
 
     /// check if torpedo t hits any ship/sub and in that case spawn events
     bool check_torpedo_hit(torpedo *t, bool runlengthfailure);
@@ -379,6 +473,9 @@ class game {
 
     /// compute height of water at given world space position.
     double compute_water_height(const vector2 &pos) const;
+    /// compute heights of water at positions origin + offsets[i], use this for many positions.
+    void compute_water_heights(const vector2 &origin, const std::vector<vector2f> &offsets,
+                               std::vector<float> &heights) const;
 
     // Translate pointers to numbers and vice versa. Used for load/save
     sea_object *load_ptr(unsigned nr) const;
@@ -410,6 +507,7 @@ class game {
     const ping_manager &get_ping_manager() const { return *mypings; }
     const trail_manager &get_trail_manager() const { return *mytrails; }
     const visibility_manager &get_visibility_manager() const { return *myvisibility; }
+    const physics_system &get_physics_system() const { return *myphysics; }
 
     /// get pointers to all ships for collision tests.
     std::vector<ship *> get_all_ships() const;
@@ -417,10 +515,23 @@ class game {
     virtual const player_info &get_player_info() const { return playerinfo; }
 
     /// return random integer number determining game behaviour
-    unsigned random() { return random_gen.rnd(); }
+    ///@note Simulation tasks draw from their own stream, see rnd_stream.
+    unsigned random() {
+        if (rnd_stream *rs = rnd_stream::current())
+            return unsigned(rs->generator()());
+        mutex_locker ml(random_mutex);
+        return random_gen.rnd();
+    }
 
     /// return random float number [0...1] determining game behaviour
-    float randomf() { return random_gen.rndf(); }
+    float randomf() {
+        if (rnd_stream *rs = rnd_stream::current()) {
+            std::mt19937 &gen = rs->generator();
+            return float(gen() - gen.min()) / (float(gen.max() - gen.min()) + 1.0f);
+        }
+        mutex_locker ml(random_mutex);
+        return random_gen.rndf();
+    }
 };
 
 #endif
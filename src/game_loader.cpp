@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "game_loader.h"
 #include "airplane.h"
+#include "asset_preloader.h"
 #include "convoy.h"
 #include "datadirs.h"
 #include "depth_charge.h"
@@ -55,36 +56,38 @@ void game_loader::load(game &g, const std::string &filename) {
     g.myheightgen = std::make_unique<terrain<Sint16>>(get_map_dir() + "terrain/terrain.xml",
                                                       get_map_dir() + "terrain/", TERRAIN_NR_LEVELS + 1);
 
+    // Load specs, models and textures of all object types once, before any entity is created
+    asset_preloader assets(g.mypool.get());
+    assets.add_objects(sg, "ships", "ship");
+    assets.add_objects(sg, "submarines", "submarine");
+    assets.add_objects(sg, "airplanes", "airplane");
+    assets.add_objects(sg, "torpedoes", "torpedo");
+    assets.load();
+    assets.log_report();
+
     // Create entities from XML
     xml_elem sh = sg.child("ships");
     for (xml_elem::iterator it = sh.iterate("ship"); !it.end(); it.next()) {
-        xml_doc spec(data_file().get_filename(it.elem().attr("type")));
-        spec.load();
-        g.ships.push_back(std::make_unique<ship>(g, spec.first_child()));
+        g.ships.push_back(std::make_unique<ship>(g, assets.get_spec(it.elem().attr("type"))));
     }
 
     xml_elem su = sg.child("submarines");
     for (xml_elem::iterator it = su.iterate("submarine"); !it.end(); it.next()) {
-        xml_doc spec(data_file().get_filename(it.elem().attr("type")));
-        spec.load();
-        g.submarines.push_back(std::make_unique<submarine>(g, spec.first_child()));
+        g.submarines.push_back(std::make_unique<submarine>(g, assets.get_spec(it.elem().attr("type"))));
     }
 
     if (sg.has_child("airplanes")) {
         xml_elem ap = sg.child("airplanes");
         for (xml_elem::iterator it = ap.iterate("airplane"); !it.end(); it.next()) {
-            xml_doc spec(data_file().get_filename(it.elem().attr("type")));
-            spec.load();
-            g.airplanes.push_back(std::make_unique<airplane>(g, spec.first_child()));
+            g.airplanes.push_back(std::make_unique<airplane>(g, assets.get_spec(it.elem().attr("type"))));
         }
     }
 
     if (sg.has_child("torpedoes")) {
         xml_elem tp = sg.child("torpedoes");
         for (xml_elem::iterator it = tp.iterate("torpedo"); !it.end(); it.next()) {
-            xml_doc spec(data_file().get_filename(it.elem().attr("type")));
-            spec.load();
-            g.torpedoes.push_back(std::make_unique<torpedo>(g, spec.first_child(), torpedo::setup()));
+            g.torpedoes.push_back(std::make_unique<torpedo>(g, assets.get_spec(it.elem().attr("type")),
+                                                            torpedo::setup()));
         }
     }
 
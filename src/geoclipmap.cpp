@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "geoclipmap.h"
 #include "global_data.h"
+#include "log.h"
 #include <fstream>
 /*
 Note: the geoclipmap renderer code can't handle levels < 0 yet, so no
@@ -49,10 +50,6 @@ geoclipmap::geoclipmap(unsigned nr_levels, unsigned resolution_exp, height_gener
       L(hg.get_sample_spacing()),
       color_res_fac(1 << hg.get_log2_color_res_factor()),
       log2_color_res_fac(hg.get_log2_color_res_factor()),
-      vboscratchbuf((resolution_vbo + 2) * (resolution_vbo + 2) * geoclipmap_fperv), // 4 floats per VBO sample (x,y,z,zc)
-      // ^ extra space for normals
-      texnormalscratchbuf_3f(resolution_vbo * 2 * resolution_vbo * 2 * 3),
-      texnormalscratchbuf(resolution_vbo * 2 * resolution_vbo * 2 * 3),
       idxscratchbuf(2 * (resolution_vbo + 4) * (resolution_vbo + 4) // patch triangles
                     + 2 * 4 * resolution_vbo                        // T-junction triangles
                     + 4 * 2 * resolution_vbo                        // outmost tri-fan
@@ -63,11 +60,17 @@ geoclipmap::geoclipmap(unsigned nr_levels, unsigned resolution_exp, height_gener
                     ),
       levels(nr_levels),
       height_gen(hg),
+      update_pending(false),
       wireframe(false) {
     // initialize vertex VBO and all level VBOs
     for (unsigned lvl = 0; lvl < levels.size(); ++lvl) {
         levels.reset(lvl, new level(*this, lvl, lvl + 1 == levels.size()));
     }
+    generation.levels.resize(levels.size());
+    if (height_gen.is_thread_safe())
+        workers = std::make_unique<thread_pool>(0, "gcmwork");
+    myupdater.reset(new updater(*this));
+    myupdater->start();
 
     myshader[0] = std::make_unique<glsl_shader_setup>(get_shader_dir() + "geoclipmap.vshader",
                                                       get_shader_dir() + "geoclipmap.fshader");
@@ -125,14 +128,53 @@ geoclipmap::~geoclipmap() {
 void geoclipmap::set_viewerpos(const vector3 &new_viewpos) {
     // check for a total reset of base_viewpos
     if (new_viewpos.xy().distance(base_viewpos) > 10000.0) {
+        // data in computation is relative to old base_viewpos, drop it
+        if (update_pending) {
+            myupdater->wait();
+            update_pending = false;
+        }
         for (unsigned i = 0; i < levels.size(); ++i) {
             levels[i]->clear_area();
         }
         base_viewpos = new_viewpos.xy();
     }
 
+    // take over data computed in background
+    if (update_pending && myupdater->is_finished()) {
+        // on errors compute again here, so the error is thrown in the caller's thread
+        if (!myupdater->wait())
+            compute_generation();
+        apply_generation();
+        update_pending = false;
+    }
+
+    // start update for new viewer position. Levels display their old data until
+    // it is finished, except when there is no data at all.
+    if (!update_pending) {
+        bool has_data = !levels.empty() && !levels[0]->get_area().empty();
+        unsigned nr_regions = plan_generation(new_viewpos);
+        if (nr_regions == 0 || !has_data) {
+            compute_generation();
+            apply_generation();
+        } else {
+            myupdater->request();
+            update_pending = true;
+        }
+    }
+
+    myshader[0]->use();
+    myshader[0]->set_uniform(loc_viewpos_offset[0], new_viewpos);
+    myshader[1]->use();
+    myshader[1]->set_uniform(loc_viewpos_offset[1], new_viewpos);
+}
+
+unsigned geoclipmap::plan_generation(const vector3 &new_viewpos) {
+    generation.viewpos = new_viewpos;
+    generation.base_viewpos = base_viewpos;
+    generation.tasks.clear();
+
     // for each level compute clip area for that new viewerpos
-    // for each level compute area that needs to get updated and do that
+    // for each level compute area that needs to get updated
 
     // empty area for innermost level
     area levelborder;
@@ -151,7 +193,10 @@ void geoclipmap::set_viewerpos(const vector3 &new_viewpos) {
     // log_debug("min_level=" << min_level);
 
     for (unsigned lvl = min_level; lvl < levels.size(); ++lvl) {
-        levelborder = levels[lvl]->set_viewerpos(new_viewpos, levelborder);
+        level_update &lu = generation.levels[lvl];
+        levelborder = levels[lvl]->plan_update(new_viewpos, levelborder, lu);
+        for (unsigned r = 0; r < lu.nr_regions; ++r)
+            generation.tasks.push_back(std::make_pair(lvl, r));
         // next level has coordinates with half resolution
         // let outer area of current level be inner area of next level
         levelborder.bl.x /= 2;
@@ -159,13 +204,83 @@ void geoclipmap::set_viewerpos(const vector3 &new_viewpos) {
         levelborder.tr.x /= 2;
         levelborder.tr.y /= 2;
     }
+    return unsigned(generation.tasks.size());
+}
 
+void geoclipmap::compute_generation() {
+    // every task has its own buffers, so regions can be computed in parallel
+    auto compute_task = [this](unsigned task, unsigned /*thread_idx*/) {
+        const auto &t = generation.tasks[task];
+        levels[t.first]->compute_region(generation.levels[t.first].regions[t.second], generation.base_viewpos);
+    };
+    if (workers) {
+        workers->run(unsigned(generation.tasks.size()), compute_task);
+    } else {
+        for (unsigned i = 0; i < generation.tasks.size(); ++i)
+            compute_task(i, 0);
+    }
+}
+
+void geoclipmap::apply_generation() {
+    for (unsigned lvl = 0; lvl < levels.size(); ++lvl)
+        levels[lvl]->apply_update(generation.levels[lvl], generation.viewpos);
+
+    // the transition between levels is computed for the position the levels were made for
     myshader[0]->use();
-    myshader[0]->set_uniform(loc_viewpos[0], new_viewpos - base_viewpos.xy0());
-    myshader[0]->set_uniform(loc_viewpos_offset[0], new_viewpos);
+    myshader[0]->set_uniform(loc_viewpos[0], generation.viewpos - base_viewpos.xy0());
     myshader[1]->use();
-    myshader[1]->set_uniform(loc_viewpos[1], new_viewpos - base_viewpos.xy0());
-    myshader[1]->set_uniform(loc_viewpos_offset[1], new_viewpos);
+    myshader[1]->set_uniform(loc_viewpos[1], generation.viewpos - base_viewpos.xy0());
+}
+
+geoclipmap::updater::updater(geoclipmap &g)
+    : ::thread("gcmupdate"), gcm(g), state(idle) {
+}
+
+void geoclipmap::updater::loop() {
+    {
+        mutex_locker ml(mtx);
+        while (state != requested && !abort_requested())
+            cond.wait(mtx);
+        if (abort_requested())
+            return;
+        state = computing;
+    }
+    bool ok = true;
+    try {
+        gcm.compute_generation();
+    } catch (std::exception &e) {
+        log_warning("computing terrain data failed: " << e.what());
+        ok = false;
+    }
+    mutex_locker ml(mtx);
+    state = ok ? finished : failed;
+    cond.signal();
+}
+
+void geoclipmap::updater::request_abort() {
+    mutex_locker ml(mtx);
+    thread::request_abort();
+    cond.signal();
+}
+
+void geoclipmap::updater::request() {
+    mutex_locker ml(mtx);
+    state = requested;
+    cond.signal();
+}
+
+bool geoclipmap::updater::is_finished() {
+    mutex_locker ml(mtx);
+    return state == finished || state == failed;
+}
+
+bool geoclipmap::updater::wait() {
+    mutex_locker ml(mtx);
+    while (state == requested || state == computing)
+        cond.wait(mtx);
+    bool ok = state != failed;
+    state = idle;
+    return ok;
 }
 
 void geoclipmap::display(const frustum &f, const vector3 &view_delta, bool is_mirror, int above_water) const {
@@ -253,7 +368,8 @@ geoclipmap::level::level(geoclipmap &gcm_, unsigned idx, bool outmost_level)
     }
 }
 
-geoclipmap::area geoclipmap::level::set_viewerpos(const vector3 &new_viewpos, const geoclipmap::area &inner) {
+geoclipmap::area geoclipmap::level::plan_update(const vector3 &new_viewpos, const geoclipmap::area &inner,
+                                                level_update &lu) const {
     // x_base/y_base tells offset in sample data according to level and
     // viewer position (new_viewpos)
     // this multiply with 0.5 then round then *2 lets the patches map to
@@ -267,66 +383,77 @@ geoclipmap::area geoclipmap::level::set_viewerpos(const vector3 &new_viewpos, co
                         int(floor(0.5 * new_viewpos.y / L_l - 0.25 * gcm.resolution + 0.5)) * 2),
                vector2i(int(floor(0.5 * new_viewpos.x / L_l + 0.25 * gcm.resolution + 0.5)) * 2,
                         int(floor(0.5 * new_viewpos.y / L_l + 0.25 * gcm.resolution + 0.5)) * 2));
-    tmp_inner = inner;
-    tmp_outer = outer;
+    lu.inner = inner;
+    lu.outer = outer;
+    lu.nr_regions = 0;
     // log_debug("index="<<index<<" area inner="<<inner.bl<<"|"<<inner.tr<<" outer="<<outer.bl<<"|"<<outer.tr);
     //  for vertex updates we only need to know the outer area...
     //  compute part of "outer" that is NOT covered by old outer area,
     //  this gives a rectangular or L-shaped form, but this can not be expressed
     //  as area, only with at least 2 areas...
-    if (vboarea.empty() || vboarea.intersection(outer).empty()) {
-        vboarea = outer; // set this to make the update work correctly
-        dataoffset = gcm.clamp(outer.bl);
-        update_region(outer);
+    lu.reset = vboarea.empty() || vboarea.intersection(outer).empty();
+    if (lu.reset) {
+        lu.regions[lu.nr_regions++].upar = outer;
     } else {
         area outercmp = outer;
+        area upars[4];
         unsigned nr_updates = 0;
         if (outercmp.bl.y < vboarea.bl.y) {
-            update_region(area(outercmp.bl, vector2i(outercmp.tr.x, vboarea.bl.y - 1)));
+            upars[nr_updates++] = area(outercmp.bl, vector2i(outercmp.tr.x, vboarea.bl.y - 1));
             outercmp.bl.y = vboarea.bl.y;
-            ++nr_updates;
         }
         if (vboarea.tr.y < outercmp.tr.y) {
-            update_region(area(vector2i(outercmp.bl.x, vboarea.tr.y + 1), outercmp.tr));
+            upars[nr_updates++] = area(vector2i(outercmp.bl.x, vboarea.tr.y + 1), outercmp.tr);
             outercmp.tr.y = vboarea.tr.y;
-            ++nr_updates;
         }
         if (outercmp.bl.x < vboarea.bl.x) {
-            update_region(area(outercmp.bl, vector2i(vboarea.bl.x - 1, outercmp.tr.y)));
+            upars[nr_updates++] = area(outercmp.bl, vector2i(vboarea.bl.x - 1, outercmp.tr.y));
             outercmp.bl.x = vboarea.bl.x;
-            ++nr_updates;
         }
         if (vboarea.tr.x < outercmp.tr.x) {
-            update_region(area(vector2i(vboarea.tr.x + 1, outercmp.bl.y), outercmp.tr));
+            upars[nr_updates++] = area(vector2i(vboarea.tr.x + 1, outercmp.bl.y), outercmp.tr);
             outercmp.tr.x = vboarea.tr.x;
-            ++nr_updates;
         }
         if (nr_updates > 2)
             throw error("got more than 2 update regions?! BUG!");
+        for (unsigned i = 0; i < nr_updates; ++i)
+            lu.regions[lu.nr_regions++].upar = upars[i];
+    }
+    return outer;
+}
+
+void geoclipmap::level::apply_update(const level_update &lu, const vector3 &viewpos) {
+    tmp_inner = lu.inner;
+    tmp_outer = lu.outer;
+    if (lu.reset) {
+        vboarea = lu.outer; // set this to make the update work correctly
+        dataoffset = gcm.clamp(lu.outer.bl);
     }
+    for (unsigned i = 0; i < lu.nr_regions; ++i)
+        upload_region(lu.regions[i]);
     // we updated the vertices, so update area/offset
-    dataoffset = gcm.clamp(outer.bl - vboarea.bl + dataoffset);
-    vboarea = outer;
+    dataoffset = gcm.clamp(lu.outer.bl - vboarea.bl + dataoffset);
+    vboarea = lu.outer;
 
     if (outmost) {
         // give 8 vertices to fill horizon gap
         static const int dx[8] = {-1, 0, 1, 1, 1, 0, -1, -1};
         static const int dy[8] = {-1, -1, -1, 0, 1, 1, 1, 0};
+        float horizon[8 * geoclipmap_fperv];
         for (unsigned i = 0; i < 8; ++i) {
             // 21km in x and y dir gives total length of < 30km
-            gcm.vboscratchbuf[4 * i + 0] = new_viewpos.x + 21000 * dx[i] - gcm.base_viewpos.x;
-            gcm.vboscratchbuf[4 * i + 1] = new_viewpos.y + 21000 * dy[i] - gcm.base_viewpos.y;
-            gcm.vboscratchbuf[4 * i + 2] = 0; // fixme: later give +- 10 for land/sea
-            gcm.vboscratchbuf[4 * i + 3] = 0; // same value here
+            horizon[4 * i + 0] = viewpos.x + 21000 * dx[i] - gcm.base_viewpos.x;
+            horizon[4 * i + 1] = viewpos.y + 21000 * dy[i] - gcm.base_viewpos.y;
+            horizon[4 * i + 2] = 0; // fixme: later give +- 10 for land/sea
+            horizon[4 * i + 3] = 0; // same value here
         }
         vertices.init_sub_data(gcm.resolution_vbo * gcm.resolution_vbo * geoclipmap_fperv * 4,
-                               8 * geoclipmap_fperv * 4, &gcm.vboscratchbuf[0]);
+                               8 * geoclipmap_fperv * 4, horizon);
     }
-
-    return outer;
 }
 
-void geoclipmap::level::update_region(const geoclipmap::area &upar) {
+void geoclipmap::level::compute_region(region_data &rd, const vector2 &base_viewpos) const {
+    const area &upar = rd.upar;
     if (upar.empty())
         throw error("update area empty?! BUG!"); // continue; // can happen on initial update
     vector2i sz = upar.size();
@@ -349,7 +476,12 @@ void geoclipmap::level::update_region(const geoclipmap::area &upar) {
     // data per vertex? 4 floats x,y,z,zc plus normal? or normal as texmap?
     // normal computation is not trivial!
 
-    // update VBO toroidically
+    // update VBO toroidically, the data is computed here to a buffer per region
+    // and uploaded later by upload_region.
+    rd.vbodata.resize((sz.x + 2) * (sz.y + 2) * geoclipmap_fperv); // 4 floats per VBO sample (x,y,z,zc)
+    rd.normals_3f.resize(sz.x * 2 * sz.y * 2);
+    rd.normals.resize(sz.x * 2 * sz.y * 2 * 3);
+    std::vector<float> &vbodata = rd.vbodata;
 
     // compute the heights first (+1 in every direction to compute normals too)
     vector2i upcrd = upar.bl + vector2i(-1, -1);
@@ -363,14 +495,14 @@ void geoclipmap::level::update_region(const geoclipmap::area &upar) {
     // It is even WRONG to call x / 2 sometimes, as -1 / 2 gives 0 and not -1 as the shift method does,
     // when we want to round down...
     gcm.height_gen.compute_heights(index, upcrd, sz + vector2i(2, 2),
-                                   &gcm.vboscratchbuf[2], geoclipmap_fperv,
+                                   &vbodata[2], geoclipmap_fperv,
                                    geoclipmap_fperv * (sz.x + 2));
     unsigned ptr = 0;
     for (int y = 0; y < sz.y + 2; ++y) {
         vector2i upcrd2 = upcrd;
         for (int x = 0; x < sz.x + 2; ++x) {
-            gcm.vboscratchbuf[ptr + 0] = upcrd2.x * L_l - gcm.base_viewpos.x;
-            gcm.vboscratchbuf[ptr + 1] = upcrd2.y * L_l - gcm.base_viewpos.y;
+            vbodata[ptr + 0] = upcrd2.x * L_l - base_viewpos.x;
+            vbodata[ptr + 1] = upcrd2.y * L_l - base_viewpos.y;
             ptr += geoclipmap_fperv;
             ++upcrd2.x;
         }
@@ -387,16 +519,16 @@ void geoclipmap::level::update_region(const geoclipmap::area &upar) {
     const vector2i szc(((upar.tr.x + 1) >> 1) - upcrd.x + 1, ((upar.tr.y + 1) >> 1) - upcrd.y + 1);
     unsigned ptr3 = ptr = ((sz.x + 2) * (1 - (upar.bl.y & 1)) + (1 - (upar.bl.x & 1))) * geoclipmap_fperv;
     gcm.height_gen.compute_heights(index + 1, upcrd, szc,
-                                   &gcm.vboscratchbuf[ptr + 3], 2 * geoclipmap_fperv,
+                                   &vbodata[ptr + 3], 2 * geoclipmap_fperv,
                                    geoclipmap_fperv * (sz.x + 2) * 2);
 
     // interpolate z_c, first fill in missing columns on even rows
     for (int y = 0; y < szc.y; ++y) {
         unsigned ptr2 = ptr;
         for (int x = 0; x < szc.x - 1; ++x) {
-            float f0 = gcm.vboscratchbuf[ptr2 + 3];
-            float f1 = gcm.vboscratchbuf[ptr2 + 2 * geoclipmap_fperv + 3];
-            gcm.vboscratchbuf[ptr2 + geoclipmap_fperv + 3] = (f0 + f1) * 0.5f;
+            float f0 = vbodata[ptr2 + 3];
+            float f1 = vbodata[ptr2 + 2 * geoclipmap_fperv + 3];
+            vbodata[ptr2 + geoclipmap_fperv + 3] = (f0 + f1) * 0.5f;
             ptr2 += 2 * geoclipmap_fperv;
         }
         ptr += 2 * (sz.x + 2) * geoclipmap_fperv;
@@ -423,9 +555,9 @@ void geoclipmap::level::update_region(const geoclipmap::area &upar) {
     for (int y = 0; y < szc.y - 1; ++y) {
         unsigned ptr2 = ptr;
         for (int x = 0; x < szc.x * 2 - 1; ++x) { // here we could spare 1 column
-            float f0 = gcm.vboscratchbuf[ptr2 - (sz.x + 2) * geoclipmap_fperv + 3];
-            float f1 = gcm.vboscratchbuf[ptr2 + (sz.x + 2) * geoclipmap_fperv + 3];
-            gcm.vboscratchbuf[ptr2 + 3] = (f0 + f1) * 0.5f;
+            float f0 = vbodata[ptr2 - (sz.x + 2) * geoclipmap_fperv + 3];
+            float f1 = vbodata[ptr2 + (sz.x + 2) * geoclipmap_fperv + 3];
+            vbodata[ptr2 + 3] = (f0 + f1) * 0.5f;
             ptr2 += geoclipmap_fperv;
         }
         ptr += 2 * (sz.x + 2) * geoclipmap_fperv;
@@ -436,18 +568,21 @@ void geoclipmap::level::update_region(const geoclipmap::area &upar) {
     // log_debug("tex scratch sz="<<sz);
     //  first retrieve vector3f normals, then transform them to RGB normals
     //  index-1 because normals have double resolution as geometry
-    gcm.height_gen.compute_normals(int(index) - 1, upar.bl * 2, sz * 2, &gcm.texnormalscratchbuf_3f[0]);
+    gcm.height_gen.compute_normals(int(index) - 1, upar.bl * 2, sz * 2, &rd.normals_3f[0]);
     for (int y = 0; y < sz.y * 2; ++y) {
         for (int x = 0; x < sz.x * 2; ++x) {
-            const vector3f &nm = gcm.texnormalscratchbuf_3f[tptr2++];
-            gcm.texnormalscratchbuf[tptr + 0] = Uint8(nm.x * 127 + 128);
-            gcm.texnormalscratchbuf[tptr + 1] = Uint8(nm.y * 127 + 128);
-            gcm.texnormalscratchbuf[tptr + 2] = Uint8(nm.z * 127 + 128);
+            const vector3f &nm = rd.normals_3f[tptr2++];
+            rd.normals[tptr + 0] = Uint8(nm.x * 127 + 128);
+            rd.normals[tptr + 1] = Uint8(nm.y * 127 + 128);
+            rd.normals[tptr + 2] = Uint8(nm.z * 127 + 128);
             tptr += 3;
         }
     }
+}
 
-    ptr = 0;
+void geoclipmap::level::upload_region(const region_data &rd) {
+    const area &upar = rd.upar;
+    const vector2i sz = upar.size();
     geoclipmap::area vboupdate(gcm.clamp(upar.bl - vboarea.bl + dataoffset),
                                gcm.clamp(upar.tr - vboarea.bl + dataoffset));
     // check for continuous update areas
@@ -463,36 +598,37 @@ void geoclipmap::level::update_region(const geoclipmap::area &upar) {
 			// area crosses VBO border horizontally and vertically
 			int szx = gcm.resolution_vbo - vboupdate.bl.x;
 			int szy = gcm.resolution_vbo - vboupdate.bl.y;
-			update_VBO_and_tex(vector2i(0, 0), sz.x, vector2i(szx, szy), vboupdate.bl);
-			update_VBO_and_tex(vector2i(szx, 0), sz.x, vector2i(vboupdate.tr.x + 1, szy),
+			update_VBO_and_tex(rd, vector2i(0, 0), sz.x, vector2i(szx, szy), vboupdate.bl);
+			update_VBO_and_tex(rd, vector2i(szx, 0), sz.x, vector2i(vboupdate.tr.x + 1, szy),
 					   vector2i(gcm.mod(vboupdate.bl.x + szx), vboupdate.bl.y));
-			update_VBO_and_tex(vector2i(0, szy), sz.x, vector2i(szx, vboupdate.tr.y + 1),
+			update_VBO_and_tex(rd, vector2i(0, szy), sz.x, vector2i(szx, vboupdate.tr.y + 1),
 					   vector2i(vboupdate.bl.x, gcm.mod(vboupdate.bl.y + szy)));
-			update_VBO_and_tex(vector2i(szx, szy), sz.x, vector2i(vboupdate.tr.x + 1, vboupdate.tr.y + 1),
+			update_VBO_and_tex(rd, vector2i(szx, szy), sz.x, vector2i(vboupdate.tr.x + 1, vboupdate.tr.y + 1),
 					   vector2i(gcm.mod(vboupdate.bl.x + szx), gcm.mod(vboupdate.bl.y + szy)));
 		} else {
 #endif
         // area crosses VBO border horizontally
         int szx = gcm.resolution_vbo - vboupdate.bl.x;
-        update_VBO_and_tex(vector2i(0, 0), sz.x, vector2i(szx, sz.y), vboupdate.bl);
-        update_VBO_and_tex(vector2i(szx, 0), sz.x, vector2i(vboupdate.tr.x + 1, sz.y),
+        update_VBO_and_tex(rd, vector2i(0, 0), sz.x, vector2i(szx, sz.y), vboupdate.bl);
+        update_VBO_and_tex(rd, vector2i(szx, 0), sz.x, vector2i(vboupdate.tr.x + 1, sz.y),
                            vector2i(gcm.mod(vboupdate.bl.x + szx), vboupdate.bl.y));
 #if 0
 		}
 	} else if (vboupdate.tr.y < vboupdate.bl.y) {
 		// area crosses VBO border vertically
 		int szy = gcm.resolution_vbo - vboupdate.bl.y;
-		update_VBO_and_tex(vector2i(0, 0), sz.x, vector2i(sz.x, szy), vboupdate.bl);
-		update_VBO_and_tex(vector2i(0, szy), sz.x, vector2i(sz.x, vboupdate.tr.y + 1),
+		update_VBO_and_tex(rd, vector2i(0, 0), sz.x, vector2i(sz.x, szy), vboupdate.bl);
+		update_VBO_and_tex(rd, vector2i(0, szy), sz.x, vector2i(sz.x, vboupdate.tr.y + 1),
 				   vector2i(vboupdate.bl.x, gcm.mod(vboupdate.bl.y + szy)));
 #endif
     } else {
         // no border crossed
-        update_VBO_and_tex(vector2i(0, 0), sz.x, sz, vboupdate.bl);
+        update_VBO_and_tex(rd, vector2i(0, 0), sz.x, sz, vboupdate.bl);
     }
 }
 
-void geoclipmap::level::update_VBO_and_tex(const vector2i &scratchoff,
+void geoclipmap::level::update_VBO_and_tex(const region_data &rd,
+                                           const vector2i &scratchoff,
                                            int scratchmod,
                                            const vector2i &sz,
                                            const vector2i &vbooff) {
@@ -514,14 +650,14 @@ void geoclipmap::level::update_VBO_and_tex(const vector2i &scratchoff,
         // log_debug("update texture xy off ="<<vbooff.x<<"|"<<gcm.mod(vbooff.y+y)<<" idx="<<((scratchoff.y+y)*scratchmod+scratchoff.x)*3);
         glTexSubImage2D(GL_TEXTURE_2D, 0 /* mipmap level */,
                         vbooff.x * 2, (vbooff.y * 2 + y) & (gcm.resolution_vbo_mod * 2 + 1), sz.x * 2, 1, GL_RGB, GL_UNSIGNED_BYTE,
-                        &gcm.texnormalscratchbuf[((scratchoff.y * 2 + y) * scratchmod * 2 + scratchoff.x * 2) * 3]);
+                        &rd.normals[((scratchoff.y * 2 + y) * scratchmod * 2 + scratchoff.x * 2) * 3]);
     }
     // copy data to real VBO.
     // we need to do it line by line anyway.
     for (int y = 0; y < sz.y; ++y) {
         vertices.init_sub_data((vbooff.x + gcm.mod(vbooff.y + y) * gcm.resolution_vbo) * geoclipmap_fperv * 4,
                                sz.x * geoclipmap_fperv * 4,
-                               &gcm.vboscratchbuf[((scratchoff.y + y + 1) * (scratchmod + 2) + 1 + scratchoff.x) * geoclipmap_fperv]);
+                               &rd.vbodata[((scratchoff.y + y + 1) * (scratchmod + 2) + 1 + scratchoff.x) * geoclipmap_fperv]);
     }
 }
 
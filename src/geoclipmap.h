@@ -31,10 +31,18 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "shader.h"
 #include "simplex_noise.h"
 #include "texture.h"
+#include "thread.h"
+#include "thread_pool.h"
 #include "vertexbufferobject.h"
 
 #include <sstream>
 
+/// Geometry clipmap renderer for terrain.
+///@note Height and normal data for regions that become visible are computed by
+///	a worker thread (and a thread pool, if the height generator allows that).
+///	Levels keep displaying their old data until all levels of an update are
+///	computed, then the data is uploaded to VBOs and textures on the GL thread
+///	all at once, so the levels always fit together.
 class geoclipmap {
   public:
     /// create geoclipmap data
@@ -68,13 +76,6 @@ class geoclipmap {
     // base viewerpos in 2d
     vector2 base_viewpos;
 
-    // scratch buffer for VBO data, for transmission
-    std::vector<float> vboscratchbuf;
-
-    // scratch buffer for texture data, for transmission
-    std::vector<vector3f> texnormalscratchbuf_3f;
-    std::vector<Uint8> texnormalscratchbuf;
-
     // scratch buffer for index generation, for transmission
     std::vector<uint32_t> idxscratchbuf;
 
@@ -95,6 +96,34 @@ class geoclipmap {
         }
     };
 
+    /// cpu side data of a region of a level, computed by a worker
+    struct region_data {
+        /// area to update in per-level coordinates
+        area upar;
+        /// VBO data, x,y,z,zc per sample with one extra sample all around
+        std::vector<float> vbodata;
+        /// normals with double resolution as geometry, as vectors and as RGB texture data
+        std::vector<vector3f> normals_3f;
+        std::vector<Uint8> normals;
+    };
+
+    /// all data to switch a level to a new area
+    struct level_update {
+        area inner, outer;
+        bool reset;          // replace all data of the level
+        unsigned nr_regions; // at most one horizontal and one vertical region
+        region_data regions[2];
+        level_update() : reset(false), nr_regions(0) {}
+    };
+
+    /// update of all levels for one viewer position
+    struct update_generation {
+        vector3 viewpos;
+        vector2 base_viewpos;
+        std::vector<level_update> levels;
+        std::vector<std::pair<unsigned, unsigned>> tasks; // level and region per task
+    };
+
     /// per-level data
     class level {
         geoclipmap &gcm;
@@ -129,8 +158,9 @@ class geoclipmap {
                                    const vector2i &vbooff) const;
         unsigned generate_indices_T(uint32_t *buffer, unsigned idxbase) const;
         unsigned generate_indices_horizgap(uint32_t *buffer, unsigned idxbase) const;
-        void update_region(const geoclipmap::area &upar);
-        void update_VBO_and_tex(const vector2i &scratchoff,
+        void upload_region(const region_data &rd);
+        void update_VBO_and_tex(const region_data &rd,
+                                const vector2i &scratchoff,
                                 int scratchmod,
                                 const vector2i &sz,
                                 const vector2i &vbooff);
@@ -140,16 +170,52 @@ class geoclipmap {
 
       public:
         level(geoclipmap &gcm_, unsigned idx, bool outmost_level);
-        area set_viewerpos(const vector3 &new_viewpos, const geoclipmap::area &inner);
+        /// compute area for new viewer position and the regions that need new data
+        area plan_update(const vector3 &new_viewpos, const geoclipmap::area &inner, level_update &lu) const;
+        /// compute data of a region, can be called by any thread
+        void compute_region(region_data &rd, const vector2 &base_viewpos) const;
+        /// upload computed data and switch to new area, must be called by GL thread
+        void apply_update(const level_update &lu, const vector3 &viewpos);
         void display(const frustum &f, bool is_mirror = false) const;
         texture &normals_tex() const { return *normals; }
         texture &colors_tex() const { return *colors; }
+        const area &get_area() const { return vboarea; }
         void clear_area();
     };
 
     ptrvector<level> levels;
     height_generator &height_gen;
 
+    /// computes update generations in the background
+    class updater : public ::thread {
+        geoclipmap &gcm;
+        ::mutex mtx;
+        condvar cond;
+        enum { idle, requested, computing, finished, failed } state;
+
+      public:
+        updater(geoclipmap &g);
+        void loop() override;
+        void request_abort() override;
+        /// start computation of gcm's current generation
+        void request();
+        /// is the requested generation computed?
+        bool is_finished();
+        /// wait until the requested generation is computed, returns false on error
+        bool wait();
+    };
+
+    update_generation generation;
+    bool update_pending; // generation is computed by the updater
+    std::unique_ptr<thread_pool> workers; // only when height generator is thread safe
+
+    /// plan update of all levels for new viewer position, returns number of regions to compute
+    unsigned plan_generation(const vector3 &new_viewpos);
+    /// compute all regions of the generation
+    void compute_generation();
+    /// upload data of generation and switch levels to it
+    void apply_generation();
+
     int mod(int n) const {
         return n & resolution_vbo_mod;
     }
@@ -188,6 +254,9 @@ class geoclipmap {
     texture::ptr horizon_normal;
     texture::ptr noise_texture;
 
+    // last member, so the thread is stopped before the data it uses is destroyed
+    thread::auto_ptr<updater> myupdater;
+
   public:
     bool wireframe; // for testing purposes only
 };
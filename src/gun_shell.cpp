@@ -27,10 +27,26 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "log.h"
 #include "model.h"
 #include "particle.h"
+#include "sensor_detection.h"
 #include "ship.h"
+#include "submarine.h"
 #include "system.h"
+#include "torpedo.h"
 #include "water_splash.h"
 
+memory_pool &gun_shell::get_pool() {
+    static memory_pool pool("gun_shell");
+    return pool;
+}
+
+void *gun_shell::operator new(std::size_t size) {
+    return get_pool().allocate(size);
+}
+
+void gun_shell::operator delete(void *p, std::size_t size) {
+    get_pool().deallocate(p, size);
+}
+
 gun_shell::gun_shell(game &gm_)
     : sea_object(gm_, "gun_shell.ddxml"), damage_amount(0) {
     // for loading
@@ -109,29 +125,34 @@ void gun_shell::check_collision() {
     */
     vector3 dv2 = position - oldpos;
     // avoid NaN on first round
-    double dvl = dv2.square_length();
-    if (dvl < 1e-8)
+    if (dv2.square_length() < 1e-8)
         return;
-    dvl = sqrt(dvl);
-    vector3 dv = dv2 * (1.0 / dvl);
-    std::vector<ship *> allships = gm.get_all_ships();
-    for (unsigned i = 0; i < allships.size(); ++i) {
-        ship *s = allships[i];
-        vector3 k = s->get_pos() - oldpos;
-        double kd = k * dv;
-        double r = s->get_bounding_radius();
-        double tmp = kd * kd - k * k + r * r;
-        if (tmp <= 0.0)
-            continue;
-        tmp = sqrt(tmp);
-        double t0 = -kd + tmp, t1 = -kd - tmp;
-        if (t0 * t1 < 0.0 || (t0 >= 0.0 && t0 <= dvl) || (t1 >= 0.0 && t1 <= dvl)) {
-            // log_debug("gun_shell "<<this<<" intersects bsphere of "<<s);
-            check_collision_precise(*s, -k, dv2 - k);
+    // broad phase: only objects whose collision sphere is touched by the shell's path
+    // in this step are checked precisely. Order is torpedoes, submarines, ships as before.
+    const world &w = gm.get_world();
+    for (auto &t : w.get_torpedoes()) {
+        const vector3 t_pos = t->get_step_pos();
+        if (sphere(t_pos, t->get_collision_radius()).intersects_swept(oldpos, position, 0.0)) {
+            check_collision_precise(*t, oldpos - t_pos, position - t_pos);
             if (alive_stat == dead)
                 return; // no more checks after hit
         }
     }
+    std::vector<unsigned> candidates;
+    w.query_swept_sphere(world::indexed_submarines, oldpos, position, 0.0, candidates);
+    for (unsigned i : candidates) {
+        ship &s = *w.get_submarines()[i];
+        check_collision_precise(s, oldpos - s.get_step_pos(), position - s.get_step_pos());
+        if (alive_stat == dead)
+            return;
+    }
+    w.query_swept_sphere(world::indexed_ships, oldpos, position, 0.0, candidates);
+    for (unsigned i : candidates) {
+        ship &s = *w.get_ships()[i];
+        check_collision_precise(s, oldpos - s.get_step_pos(), position - s.get_step_pos());
+        if (alive_stat == dead)
+            return;
+    }
 
     // now check for water impact if not dead yet (when impact to object was found)
     // we check agains maximum water z, or a rather crude, but satisfying replacement (10m)
@@ -151,7 +172,7 @@ void gun_shell::check_collision() {
 void gun_shell::check_collision_precise(ship &s, const vector3 &oldrelpos,
                                         const vector3 &newrelpos) {
     // transform positions to s' local bbox space
-    quaternion qco = s.get_orientation().conj();
+    quaternion qco = s.get_step_orientation().conj();
     vector3f oldrelbbox = vector3f(qco.rotate(oldrelpos));
     vector3f newrelbbox = vector3f(qco.rotate(newrelpos));
     // now the model::get_min/get_max values can be used to compute the axis aligned bbox
@@ -226,18 +247,21 @@ void gun_shell::check_collision_voxel(ship &s, const vector3f &oldrelpos, const
                 // we hit a part of the object!
                 log_debug("..... Object hit! .....");
                 // first compute exact real word position of impact
-                vector3 impactpos = s.get_pos() + s.get_orientation().rotate(s.get_model().get_base_mesh_transformation() * voxpos);
+                vector3 impactpos = s.get_step_pos() + s.get_step_orientation().rotate(s.get_model().get_base_mesh_transformation() * voxpos);
                 // move gun shell pos to hit position to
                 // let the explosion be at right position
                 position = impactpos;
                 log_debug("Hit object at real world pos " << impactpos);
-                log_debug("that is relative: " << s.get_pos() - impactpos);
-                // now damage the ship
-                if (s.damage(impactpos, int(damage_amount))) { // fixme, crude
-                    gm.ship_sunk(&s);
-                } else {
-                    s.ignite();
-                }
+                log_debug("that is relative: " << s.get_step_pos() - impactpos);
+                // now damage the ship. That changes another object, so it must be
+                // deferred when called from a parallel simulation task.
+                game::execute_or_defer([&gm = gm, &s, impactpos, dmg = int(damage_amount)]() {
+                    if (s.damage(impactpos, dmg)) { // fixme, crude
+                        gm.ship_sunk(&s);
+                    } else {
+                        s.ignite();
+                    }
+                });
 #if 0
 				//spawn some location marker object for testing
 				//at exact impact position
@@ -251,11 +275,11 @@ void gun_shell::check_collision_voxel(ship &s, const vector3f &oldrelpos, const
     }
 }
 
-void gun_shell::simulate(double delta_time) {
+bool gun_shell::simulate(double delta_time) {
     check_collision();
     oldpos = position;
     // log_debug("GS: position="<<position);
-    sea_object::simulate(delta_time);
+    return sea_object::simulate(delta_time);
 }
 
 void gun_shell::display(const texture *caustic_map) const {
@@ -281,3 +305,9 @@ void gun_shell::display(const texture *caustic_map) const {
 float gun_shell::surface_visibility(const vector2 &watcher) const {
     return 100.0f; // square meters... test hack
 }
+
+void gun_shell::get_sensor_target(sensor_target &st) const {
+    sea_object::get_sensor_target(st);
+    st.surface_scale = 0.0;
+    st.surface_offset = surface_visibility(vector2());
+}
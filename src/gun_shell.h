@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #ifndef GUN_SHELL_H
 #define GUN_SHELL_H
 
+#include "memory_pool.h"
 #include "sea_object.h"
 
 class ship;
@@ -55,11 +56,17 @@ class gun_shell : public sea_object {
     virtual void load(const xml_elem &parent);
     virtual void save(xml_elem &parent) const;
 
-    virtual void simulate(double delta_time);
+    virtual bool simulate(double delta_time);
     virtual void display(const texture *caustic_map = NULL) const;
     virtual float surface_visibility(const vector2 &watcher) const;
+    virtual void get_sensor_target(sensor_target &st) const;
     // acceleration is only gravity and already handled by sea_object
     virtual double damage() const { return damage_amount; }
+
+    /// objects are allocated from a memory_pool, they are created and deleted often
+    static void *operator new(std::size_t size);
+    static void operator delete(void *p, std::size_t size);
+    static memory_pool &get_pool();
 };
 
 #endif
@@ -121,6 +121,9 @@ class height_generator {
         }
     }
 
+    /// can the compute functions be called by several threads at once?
+    virtual bool is_thread_safe() const { return false; }
+
     /// get absolute minimum and maximum height of all levels, used for clipping
     ///@param minh - minimum height values of all levels and samples
     ///@param maxh - maximum height values of all levels and samples
@@ -56,28 +56,19 @@ height_generator_map::height_generator_map(const std::string &filename)
     doc.load();
     xml_elem er = doc.child("dftd-map");
     xml_elem et = er.child("topology");
-    realwidth = et.attrf("realwidth");
-    realoffset.x = et.attrf("realoffsetx");
-    realoffset.y = et.attrf("realoffsety");
     sdl_image surf(get_map_dir() + et.attr("heights"));
     const image_data* img = surf.get_image_data();
-    mapw = img->width;
-    maph = img->height;
-    pixelw_real = realwidth / mapw;
-    mapoff.x = realoffset.x / pixelw_real;
-    mapoff.y = realoffset.y / pixelw_real;
-    realheight = maph * realwidth / mapw;
-    sample_spacing = pixelw_real / (1 << subdivision_steps);
-    log2_color_res_factor = 0;
-    height_data.resize(vector2i(mapw, maph));
+    const unsigned w = img->width;
+    const unsigned h = img->height;
+    height_data.resize(vector2i(w, h));
     if (img->bytes_per_pixel < 1)
         throw error(string("height_generator_map: need at least 1 bpp, in ") + filename);
     const uint8_t* offset = img->pixels.data();
     unsigned bpp = img->bytes_per_pixel;
-    for (int yy = 0; yy < int(maph); yy++) {
-        for (int xx = 0; xx < int(mapw); ++xx) {
+    for (int yy = 0; yy < int(h); yy++) {
+        for (int xx = 0; xx < int(w); ++xx) {
             uint8_t c = offset[xx * bpp];
-            height_data.at(xx, maph - 1 - yy) = (float(c) - 128) * 4;
+            height_data.at(xx, h - 1 - yy) = (float(c) - 128) * 4;
         }
         offset += img->pitch;
     }
@@ -98,14 +89,85 @@ height_generator_map::height_generator_map(const std::string &filename)
         if (bpp != 3)
             throw error("color bpp != 3");
     }
+    init(et.attrf("realwidth"), vector2(et.attrf("realoffsetx"), et.attrf("realoffsety")), true);
+}
+
+height_generator_map::height_generator_map(const bivector<float> &heights, double realwidth_,
+                                           const vector2 &realoffset_, bool cache_tiles)
+    : subdivision_steps(7), height_data(heights), cw(0), ch(0) {
+    init(realwidth_, realoffset_, cache_tiles);
+}
+
+void height_generator_map::init(double realwidth_, const vector2 &realoffset_, bool cache_tiles) {
+    realwidth = realwidth_;
+    realoffset = realoffset_;
+    mapw = height_data.size().x;
+    maph = height_data.size().y;
+    pixelw_real = realwidth / mapw;
+    mapoff.x = realoffset.x / pixelw_real;
+    mapoff.y = realoffset.y / pixelw_real;
+    realheight = maph * realwidth / mapw;
+    sample_spacing = pixelw_real / (1 << subdivision_steps);
+    log2_color_res_factor = 0;
     for (unsigned i = 0; i < subdivision_steps + 3; ++i) {
         noisemaps[i] = bivector<float>(vector2i(256, 256), 0.f).add_gauss_noise(float(1 << i), rndgen);
+        if (cache_tiles)
+            tile_caches[i] = std::make_unique<tile_cache_type>(unsigned(tiles_per_level));
     }
 }
 
 bivector<float> height_generator_map::generate_patch(int detail, const vector2i &coord_bl,
                                                      const vector2i &coord_sz) {
-    // without caching this is slow as hell, but we don't care for first test.
+    if (detail == int(subdivision_steps) || detail + 3 < 0 || !tile_caches[detail + 3])
+        return upsample_patch(detail, coord_bl, coord_sz);
+    // every sample only depends on its coordinates, not on the requested area,
+    // so the patch can be assembled from tiles of the same detail level.
+    // Overlapping requests (e.g. neighbouring geoclipmap updates and all requests
+    // on coarser levels done while generating the tiles) reuse the tiles then.
+    const int tile_size = 1 << tile_shift;
+    bivector<float> result(coord_sz);
+    const vector2i coord_tr = coord_bl + coord_sz - vector2i(1, 1);
+    for (int ty = coord_bl.y >> tile_shift; ty <= (coord_tr.y >> tile_shift); ++ty) {
+        for (int tx = coord_bl.x >> tile_shift; tx <= (coord_tr.x >> tile_shift); ++tx) {
+            tile_cache_type::value_ptr t = get_tile(detail, vector2i(tx, ty));
+            // intersection of tile and requested area in patch coordinates
+            vector2i tile_bl(tx * tile_size, ty * tile_size);
+            vector2i bl = tile_bl.max(coord_bl) - coord_bl;
+            vector2i tr = (tile_bl + vector2i(tile_size - 1, tile_size - 1)).min(coord_tr) - coord_bl;
+            vector2i toff = coord_bl - tile_bl;
+            for (int y = bl.y; y <= tr.y; ++y)
+                for (int x = bl.x; x <= tr.x; ++x)
+                    result.at(x, y) = t->at(x + toff.x, y + toff.y);
+        }
+    }
+    return result;
+}
+
+height_generator_map::tile_cache_type::value_ptr height_generator_map::get_tile(int detail, const vector2i &tile) {
+    tile_cache_type &cache = *tile_caches[detail + 3];
+    {
+        mutex_locker ml(tile_cache_mutex);
+        tile_cache_type::value_ptr t = cache.find(tile);
+        if (t)
+            return t;
+    }
+    // generate without lock, so other threads can go on. If two threads generate the
+    // same tile, the first one is kept.
+    const int tile_size = 1 << tile_shift;
+    bivector<float> t = upsample_patch(detail, tile * tile_size, vector2i(tile_size, tile_size));
+    mutex_locker ml(tile_cache_mutex);
+    return cache.insert(tile, std::move(t));
+}
+
+height_generator_map::tile_cache_type::statistics height_generator_map::get_cache_statistics(int detail) {
+    mutex_locker ml(tile_cache_mutex);
+    if (detail + 3 < 0 || detail >= int(subdivision_steps) || !tile_caches[detail + 3])
+        return tile_cache_type::statistics();
+    return tile_caches[detail + 3]->get_statistics();
+}
+
+bivector<float> height_generator_map::upsample_patch(int detail, const vector2i &coord_bl,
+                                                     const vector2i &coord_sz) {
     if (detail < int(subdivision_steps)) {
         // with smooth upsampling we can create 2n+1 values from n+3 values, so if we
         // assume coord_sz.x/y = m = 2n+1, thus (m-1)/2+3 = n+3
@@ -24,6 +24,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "bivector.h"
 #include "height_generator.h"
+#include "lru_cache.h"
+#include "mutex.h"
 
 class height_generator_map : public height_generator {
     const unsigned subdivision_steps;
@@ -39,6 +41,11 @@ class height_generator_map : public height_generator {
     bivector<float> noisemaps[7 + 3];
 
   public:
+    struct tile_hash {
+        size_t operator()(const vector2i &v) const { return std::hash<int>()(v.x) ^ (std::hash<int>()(v.y) * 16777619U); }
+    };
+    typedef lru_cache<vector2i, bivector<float>, tile_hash> tile_cache_type;
+
     height_generator_map(const std::string &filename);
 
     void compute_heights(int detail, const vector2i &coord_bl,
@@ -50,9 +57,37 @@ class height_generator_map : public height_generator {
 
     void get_min_max_height(double &minh, double &maxh) const;
 
+    /// get hit/miss counters of patch cache of a detail level
+    tile_cache_type::statistics get_cache_statistics(int detail);
+
+    /// patches are generated from constant data and the patch cache is locked
+    bool is_thread_safe() const { return true; }
+
   protected:
+    /// generated patches are cached as square tiles of 2^tile_shift samples per detail level
+    static const unsigned tile_shift = 6;
+    /// number of cached tiles per detail level (16kb each)
+    static const unsigned tiles_per_level = 256;
+    // one cache per detail level, indexed like noisemaps with detail + 3
+    std::unique_ptr<tile_cache_type> tile_caches[7 + 3];
+    ::mutex tile_cache_mutex;
+
+    /// get patch of detail level, assembled from cached tiles
     bivector<float> generate_patch(int detail, const vector2i &coord_bl,
                                    const vector2i &coord_sz);
+    /// compute patch of detail level by upsampling the next coarser level
+    bivector<float> upsample_patch(int detail, const vector2i &coord_bl,
+                                   const vector2i &coord_sz);
+    /// get tile from cache or generate it
+    tile_cache_type::value_ptr get_tile(int detail, const vector2i &tile);
+
+    /// create from height samples of the map instead of a file, without colors, e.g. for tests
+    ///@param heights - height per sample of the map, y pointing upwards
+    ///@param cache_tiles - if false every patch is computed directly without tiles
+    height_generator_map(const bivector<float> &heights, double realwidth, const vector2 &realoffset,
+                         bool cache_tiles);
+    /// set up map geometry from height data, noise and tile caches
+    void init(double realwidth, const vector2 &realoffset, bool cache_tiles);
 
     void gen_col(float h, Uint8 *c);
 };
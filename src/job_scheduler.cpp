@@ -22,34 +22,119 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "job_scheduler.h"
 #include "error.h"
+#include "thread_pool.h"
+#include <chrono>
 
 job_scheduler::~job_scheduler() {
     for (auto &job_pair : jobs) {
-        delete job_pair.second;
+        delete job_pair.first;
     }
 }
 
 void job_scheduler::register_job(job *j) {
-    jobs.push_back(std::make_pair(0.0, j));
+    if (jobs.find(j) != jobs.end())
+        throw error("[job_scheduler::register_job] job already registered");
+    job_info &ji = jobs[j];
+    ji.j = j;
+    ji.id = next_id++;
+    ids[ji.id] = j;
+    queue.push(due_entry{current_time + j->get_period(), ji.id});
 }
 
 void job_scheduler::unregister_job(job *j) {
-    for (auto it = jobs.begin(); it != jobs.end(); ++it) {
-        if (it->second == j) {
-            delete it->second;
-            jobs.erase(it);
-            return;
-        }
-    }
-    throw error("[job_scheduler::unregister_job] job not found in list");
+    auto it = jobs.find(j);
+    if (it == jobs.end())
+        throw error("[job_scheduler::unregister_job] job not found in list");
+    // the heap entry is removed when it is due
+    ids.erase(it->second.id);
+    jobs.erase(it);
+    delete j;
+}
+
+const job_scheduler::statistics &job_scheduler::get_statistics(const job *j) const {
+    auto it = jobs.find(const_cast<job *>(j));
+    if (it == jobs.end())
+        throw error("[job_scheduler::get_statistics] job not found in list");
+    return it->second.stats;
+}
+
+job_scheduler::job_info *job_scheduler::find_job(unsigned id) {
+    auto it = ids.find(id);
+    if (it == ids.end())
+        return nullptr;
+    return &jobs[it->second];
+}
+
+double job_scheduler::run_job(job *j) {
+    auto start = std::chrono::steady_clock::now();
+    j->run();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void job_scheduler::record_run(unsigned id, double t) {
+    // the job may have unregistered itself when it was run
+    job_info *ji = find_job(id);
+    if (!ji)
+        return;
+    ++ji->stats.runs;
+    ji->stats.total_time += t;
+    ji->stats.max_time = std::max(ji->stats.max_time, t);
+    ji->stats.last_time = t;
 }
 
 void job_scheduler::update(double delta_t) {
-    for (auto &job_pair : jobs) {
-        job_pair.first += delta_t;
-        if (job_pair.first >= job_pair.second->get_period()) {
-            job_pair.first -= job_pair.second->get_period();
-            job_pair.second->run();
+    current_time += delta_t;
+    if (queue.empty() || queue.top().due > current_time)
+        return;
+
+    // collect all due jobs first, so every job runs at most once per update.
+    // Only ids are stored, a job may unregister other due jobs when it is run.
+    std::vector<due_entry> due_jobs;
+    while (!queue.empty() && queue.top().due <= current_time) {
+        due_jobs.push_back(queue.top());
+        queue.pop();
+    }
+
+    // independent jobs in parallel, they don't change the job lists
+    std::vector<unsigned> parallel_jobs; // indices in due_jobs
+    std::vector<job *> parallel_job_ptrs;
+    if (pool) {
+        for (unsigned i = 0; i < unsigned(due_jobs.size()); ++i) {
+            job_info *ji = find_job(due_jobs[i].id);
+            if (ji && ji->j->is_independent()) {
+                parallel_jobs.push_back(i);
+                parallel_job_ptrs.push_back(ji->j);
+            }
+        }
+    }
+    std::vector<bool> done(due_jobs.size(), false);
+    if (parallel_jobs.size() > 1) {
+        std::vector<double> times(parallel_jobs.size());
+        pool->run(unsigned(parallel_jobs.size()), [&parallel_job_ptrs, &times](unsigned task, unsigned) {
+            times[task] = run_job(parallel_job_ptrs[task]);
+        });
+        for (unsigned i = 0; i < unsigned(parallel_jobs.size()); ++i) {
+            record_run(due_jobs[parallel_jobs[i]].id, times[i]);
+            done[parallel_jobs[i]] = true;
+        }
+    }
+
+    // others serially in order of due time
+    for (unsigned i = 0; i < unsigned(due_jobs.size()); ++i) {
+        if (done[i])
+            continue;
+        job_info *ji = find_job(due_jobs[i].id);
+        if (ji)
+            record_run(due_jobs[i].id, run_job(ji->j));
+    }
+
+    // schedule next runs. Jobs that fell behind are due again in the next update,
+    // like the time accumulation done before.
+    for (auto &de : due_jobs) {
+        job_info *ji = find_job(de.id);
+        if (ji) {
+            de.due += ji->j->get_period();
+            queue.push(de);
         }
     }
 }
@@ -23,40 +23,97 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #ifndef JOB_SCHEDULER_H
 #define JOB_SCHEDULER_H
 
-#include <list>
+#include <cstddef>
+#include <map>
+#include <queue>
 #include <utility>
+#include <vector>
+
+class thread_pool;
 
 /// Interface for periodic tasks
 struct job {
     job() {}
     virtual void run() = 0;
     virtual double get_period() const = 0;
+    /// jobs that don't touch shared state may run in parallel with other independent jobs.
+    /// They must not register or unregister jobs.
+    virtual bool is_independent() const { return false; }
     virtual ~job() {}
 };
 
 /// Manages periodic task execution (jobs)
+///@note Jobs are kept in a heap ordered by the time they are due next, so an
+///	update where no job is due costs O(1). Due independent jobs are run in
+///	parallel when a thread pool is set, the others serially afterwards. These
+///	may unregister any job, even themselves, so jobs are looked up by id before
+///	they are run, when their statistics are recorded and before they are scheduled.
 class job_scheduler {
+  public:
+    /// run time statistics of a job (wall clock time in seconds)
+    struct statistics {
+        unsigned long runs;
+        double total_time;
+        double max_time;
+        double last_time;
+        statistics() : runs(0), total_time(0), max_time(0), last_time(0) {}
+        double get_average_time() const { return runs ? total_time / runs : 0.0; }
+    };
+
   private:
-    std::list<std::pair<double, job *>> jobs; ///< Jobs with accumulated time
+    struct job_info {
+        job *j;
+        unsigned id;
+        statistics stats;
+    };
+    /// heap entry, jobs that were unregistered are skipped when they come up
+    struct due_entry {
+        double due;
+        unsigned id;
+        bool operator>(const due_entry &other) const {
+            return due > other.due || (due == other.due && id > other.id);
+        }
+    };
+
+    std::map<job *, job_info> jobs; ///< registered jobs
+    std::map<unsigned, job *> ids;  ///< job of registration id
+    std::priority_queue<due_entry, std::vector<due_entry>, std::greater<due_entry>> queue;
+    double current_time;            ///< sum of all update times
+    unsigned next_id;
+    thread_pool *pool;
+
+    job_info *find_job(unsigned id);
+    /// run job and return time needed
+    static double run_job(job *j);
+    /// add run time to statistics of job, if it is still registered
+    void record_run(unsigned id, double t);
 
   public:
-    job_scheduler() = default;
+    job_scheduler() : current_time(0), next_id(0), pool(nullptr) {}
     ~job_scheduler();
 
     // Non-copyable
     job_scheduler(const job_scheduler &) = delete;
     job_scheduler &operator=(const job_scheduler &) = delete;
 
-    /// Register a new job (scheduler takes ownership)
+    /// Register a new job (scheduler takes ownership), it is due one period from now
     void register_job(job *j);
 
     /// Unregister and delete a job
     void unregister_job(job *j);
 
-    /// Update all jobs and execute those whose period has elapsed
+    /// Update all jobs and execute those whose period has elapsed.
+    /// Every job is run at most once per update.
     /// @param delta_t - time elapsed since last update
     void update(double delta_t);
 
+    /// Set pool for running independent jobs in parallel, nullptr runs all jobs serially.
+    /// The pool must live as long as it is set.
+    void set_thread_pool(thread_pool *tp) { pool = tp; }
+
+    /// Get run time statistics of a job
+    const statistics &get_statistics(const job *j) const;
+
     /// Get number of registered jobs
     size_t job_count() const { return jobs.size(); }
 
@@ -0,0 +1,121 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// packed kinematic state of many objects for fast sweeps
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "kinematic_store.h"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+void kinematic_store::columns::resize(unsigned n) {
+    for (auto *v : {&pos_x, &pos_y, &pos_z, &vel_x, &vel_y, &vel_z, &rot_s, &rot_x, &rot_y, &rot_z, &heading})
+        v->resize(n);
+    state.resize(n);
+}
+
+void kinematic_store::columns::set(unsigned i, const vector3 &pos, const vector3 &vel, const quaternion &ori, angle hdg,
+                                   uint8_t st) {
+    pos_x[i] = pos.x;
+    pos_y[i] = pos.y;
+    pos_z[i] = pos.z;
+    vel_x[i] = vel.x;
+    vel_y[i] = vel.y;
+    vel_z[i] = vel.z;
+    rot_s[i] = ori.s;
+    rot_x[i] = ori.v.x;
+    rot_y[i] = ori.v.y;
+    rot_z[i] = ori.v.z;
+    heading[i] = hdg.value();
+    state[i] = st;
+}
+
+void kinematic_store::resize(unsigned n) {
+    step.resize(n);
+    current.resize(n);
+}
+
+void kinematic_store::set(unsigned i, const vector3 &pos, const vector3 &vel, const quaternion &ori, angle hdg, uint8_t st) {
+    step.set(i, pos, vel, ori, hdg, st);
+    current.set(i, pos, vel, ori, hdg, st);
+}
+
+void kinematic_store::set_current(unsigned i, const vector3 &pos, const vector3 &vel, const quaternion &ori, angle hdg,
+                                  uint8_t st) {
+    current.set(i, pos, vel, ori, hdg, st);
+}
+
+void kinematic_store::get_positions_2d(std::vector<vector2> &result) const {
+    const unsigned n = size();
+    result.resize(n);
+    for (unsigned i = 0; i < n; ++i)
+        result[i] = vector2(step.pos_x[i], step.pos_y[i]);
+}
+
+void kinematic_store::compute_square_distances(const vector3 &p, std::vector<double> &result) const {
+    const unsigned n = size();
+    result.resize(n);
+    const double *x = step.pos_x.data(), *y = step.pos_y.data(), *z = step.pos_z.data();
+    double *r = result.data();
+    for (unsigned i = 0; i < n; ++i) {
+        // same order of operations as vector3::square_distance
+        double dx = x[i] - p.x, dy = y[i] - p.y, dz = z[i] - p.z;
+        r[i] = dx * dx + dy * dy + dz * dz;
+    }
+}
+
+double kinematic_store::min_distance(const vector3 &p, unsigned skip) const {
+    const unsigned n = size();
+    if (n == 0 || (n == 1 && skip == 0))
+        return -1.0;
+    const double *x = step.pos_x.data(), *y = step.pos_y.data(), *z = step.pos_z.data();
+    double result = HUGE_VAL;
+    // two loops around the skipped entry, so the loops have no branches
+    const unsigned end0 = std::min(skip, n);
+    for (unsigned i = 0; i < end0; ++i) {
+        double dx = x[i] - p.x, dy = y[i] - p.y, dz = z[i] - p.z;
+        double d2 = dx * dx + dy * dy + dz * dz;
+        result = d2 < result ? d2 : result;
+    }
+    for (unsigned i = end0 + 1; i < n; ++i) {
+        double dx = x[i] - p.x, dy = y[i] - p.y, dz = z[i] - p.z;
+        double d2 = dx * dx + dy * dy + dz * dz;
+        result = d2 < result ? d2 : result;
+    }
+    return std::sqrt(result);
+}
+
+void kinematic_store::filter_state(std::vector<unsigned> &entries, uint8_t min_state, unsigned skip) const {
+    unsigned j = 0;
+    for (unsigned i = 0; i < entries.size(); ++i) {
+        const unsigned e = entries[i];
+        if (e != skip && step.state[e] >= min_state)
+            entries[j++] = e;
+    }
+    entries.resize(j);
+}
+
+void kinematic_store::find_state(uint8_t min_state, std::vector<unsigned> &result) const {
+    const unsigned n = size();
+    result.clear();
+    for (unsigned i = 0; i < n; ++i)
+        if (step.state[i] >= min_state)
+            result.push_back(i);
+}
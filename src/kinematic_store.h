@@ -0,0 +1,105 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// packed kinematic state of many objects for fast sweeps
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef KINEMATIC_STORE_H
+#define KINEMATIC_STORE_H
+
+#include "angle.h"
+#include "quaternion.h"
+#include "vector2.h"
+#include "vector3.h"
+#include <cstdint>
+#include <vector>
+
+/// Position, velocity, orientation and state of objects as structure of arrays.
+///@note Loops over many objects that only need their kinematic state read
+///	contiguous arrays instead of dereferencing every object, so the compiler
+///	can vectorize them. Objects write their state at the end of simulate, but into
+///	a second set of arrays that becomes visible with publish after all objects
+///	were simulated. So during a step all functions return the state at its start
+///	and parallel simulation tasks can read it while objects change, see
+///	sea_object::get_step_pos.
+class kinematic_store {
+  public:
+    /// marks no entry, e.g. for sweeps that exclude nothing
+    static const unsigned no_entry = 0xffffffffU;
+
+    kinematic_store() {}
+
+    /// get number of entries
+    unsigned size() const { return unsigned(step.pos_x.size()); }
+    /// set number of entries, new entries are zero
+    void resize(unsigned n);
+    /// remove all entries
+    void clear() { resize(0); }
+
+    /// store state of entry i between simulation steps, it is visible at once
+    void set(unsigned i, const vector3 &pos, const vector3 &vel, const quaternion &ori, angle hdg, uint8_t st);
+    /// store state of entry i during a simulation step, it is visible after publish.
+    ///@note Parallel tasks may write different entries at the same time.
+    void set_current(unsigned i, const vector3 &pos, const vector3 &vel, const quaternion &ori, angle hdg,
+                     uint8_t st);
+    /// make state stored with set_current visible, call after all objects were simulated
+    void publish() { step = current; }
+
+    vector3 get_pos(unsigned i) const { return vector3(step.pos_x[i], step.pos_y[i], step.pos_z[i]); }
+    vector3 get_velocity(unsigned i) const { return vector3(step.vel_x[i], step.vel_y[i], step.vel_z[i]); }
+    quaternion get_orientation(unsigned i) const {
+        return quaternion(step.rot_s[i], vector3(step.rot_x[i], step.rot_y[i], step.rot_z[i]));
+    }
+    angle get_heading(unsigned i) const { return angle(step.heading[i]); }
+    uint8_t get_state(unsigned i) const { return step.state[i]; }
+
+    /// get xy positions of all entries
+    void get_positions_2d(std::vector<vector2> &result) const;
+    /// compute square distances of all entries to a point
+    void compute_square_distances(const vector3 &p, std::vector<double> &result) const;
+    /// compute distance of entry nearest to a point
+    ///@param skip - entry to ignore, e.g. the object itself
+    ///@returns distance or -1 if there is no entry
+    double min_distance(const vector3 &p, unsigned skip = no_entry) const;
+    /// keep only entries whose state is at least min_state
+    ///@param skip - entry to remove, e.g. the object itself
+    void filter_state(std::vector<unsigned> &entries, uint8_t min_state, unsigned skip = no_entry) const;
+    /// get all entries whose state is at least min_state
+    void find_state(uint8_t min_state, std::vector<unsigned> &result) const;
+
+  protected:
+    /// state of all entries as structure of arrays
+    struct columns {
+        std::vector<double> pos_x, pos_y, pos_z;
+        std::vector<double> vel_x, vel_y, vel_z;
+        std::vector<double> rot_s, rot_x, rot_y, rot_z;
+        std::vector<double> heading; ///< in degrees
+        std::vector<uint8_t> state;  ///< alive status of object
+        void resize(unsigned n);
+        void set(unsigned i, const vector3 &pos, const vector3 &vel, const quaternion &ori, angle hdg, uint8_t st);
+    };
+    columns step;    ///< state at the start of the step, read by all functions
+    columns current; ///< state at the end of simulate, see publish
+
+  private:
+    kinematic_store(const kinematic_store &) = delete;
+    kinematic_store &operator=(const kinematic_store &) = delete;
+};
+
+#endif
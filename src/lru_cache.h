@@ -0,0 +1,111 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// A cache of limited size that drops least recently used values
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+/// A cache holding at most a fixed number of values, the least recently used value is dropped first.
+///@note Values are held by shared pointers, so a value that was found stays valid
+///	for the user even if the cache drops it meanwhile. The cache itself is not
+///	thread safe, lock it when using it from several threads.
+template <class K, class V, class H = std::hash<K>>
+class lru_cache {
+  public:
+    typedef std::shared_ptr<const V> value_ptr;
+
+    /// counters for cache efficiency
+    struct statistics {
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long evictions;
+        statistics() : hits(0), misses(0), evictions(0) {}
+        double get_hit_rate() const { return (hits + misses) ? double(hits) / (hits + misses) : 0.0; }
+    };
+
+    /// create cache
+    ///@param capacity - maximum number of values, at least 1
+    lru_cache(unsigned capacity) : capacity(capacity ? capacity : 1) {}
+
+    /// find a value and mark it as most recently used, returns empty pointer if not cached
+    value_ptr find(const K &key) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            ++stats.misses;
+            return value_ptr();
+        }
+        ++stats.hits;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    /// insert a value as most recently used, drops the least recently used value if full.
+    ///@returns the cached value, that is the already stored one if key was cached before
+    value_ptr insert(const K &key, V &&value) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+            return it->second->second;
+        }
+        if (index.size() >= capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+            ++stats.evictions;
+        }
+        entries.emplace_front(key, std::make_shared<const V>(std::move(value)));
+        index[key] = entries.begin();
+        return entries.front().second;
+    }
+
+    /// drop all values, statistics are kept
+    void clear() {
+        index.clear();
+        entries.clear();
+    }
+
+    /// get number of cached values
+    unsigned size() const { return unsigned(index.size()); }
+
+    /// get maximum number of cached values
+    unsigned get_capacity() const { return capacity; }
+
+    /// get counters
+    const statistics &get_statistics() const { return stats; }
+
+  protected:
+    typedef std::list<std::pair<K, value_ptr>> entry_list;
+    const unsigned capacity;
+    entry_list entries; // most recently used first
+    std::unordered_map<K, typename entry_list::iterator, H> index;
+    statistics stats;
+
+  private:
+    lru_cache(const lru_cache &) = delete;
+    lru_cache &operator=(const lru_cache &) = delete;
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Read only memory mapping of a file
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "mapped_file.h"
+#include "error.h"
+
+#ifdef WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+mapped_file::mapped_file(const std::string &filename_)
+    : filename(filename_), ptr(nullptr), length(0), file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr) {
+    file_handle = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+        throw file_read_error(filename);
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(file_handle, &sz)) {
+        CloseHandle(file_handle);
+        throw file_read_error(filename);
+    }
+    length = size_t(sz.QuadPart);
+    // empty files can't be mapped
+    if (length == 0)
+        return;
+    mapping_handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping_handle)
+        ptr = static_cast<const unsigned char *>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (!ptr) {
+        if (mapping_handle)
+            CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+        throw file_read_error(filename);
+    }
+}
+
+mapped_file::~mapped_file() {
+    if (ptr)
+        UnmapViewOfFile(ptr);
+    if (mapping_handle)
+        CloseHandle(mapping_handle);
+    CloseHandle(file_handle);
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+mapped_file::mapped_file(const std::string &filename_)
+    : filename(filename_), ptr(nullptr), length(0) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw file_read_error(filename);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw file_read_error(filename);
+    }
+    length = size_t(st.st_size);
+    // empty files can't be mapped
+    if (length > 0) {
+        void *p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            throw file_read_error(filename);
+        }
+        ptr = static_cast<const unsigned char *>(p);
+    }
+    // the mapping stays valid without the descriptor
+    close(fd);
+}
+
+mapped_file::~mapped_file() {
+    if (ptr)
+        munmap(const_cast<unsigned char *>(ptr), length);
+}
+
+#endif
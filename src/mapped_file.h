@@ -0,0 +1,60 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Read only memory mapping of a file
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+/// A file mapped read only into memory.
+///@note Pages are loaded by the operating system on first access, so only the
+///	parts of the file that are really used are read from disk.
+class mapped_file {
+  public:
+    /// map whole file, throws file_read_error if file can't be opened or mapped
+    mapped_file(const std::string &filename);
+    /// unmap file
+    ~mapped_file();
+    /// get pointer to file contents
+    const unsigned char *data() const { return ptr; }
+    /// get size of file in bytes
+    size_t size() const { return length; }
+    /// get name of file
+    const std::string &get_filename() const { return filename; }
+
+  protected:
+    std::string filename;
+    const unsigned char *ptr;
+    size_t length;
+#ifdef WIN32
+    void *file_handle;
+    void *mapping_handle;
+#endif
+
+  private:
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// pool of memory blocks for objects that are created and deleted often
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "memory_pool.h"
+#include "log.h"
+#include <algorithm>
+#include <new>
+
+memory_pool::memory_pool(const char *name_, unsigned blocks_per_slab_)
+    : name(name_), blocks_per_slab(blocks_per_slab_ ? blocks_per_slab_ : 1),
+      free_lists(size_class(max_block_size) + 1, nullptr) {
+}
+
+memory_pool::~memory_pool() {
+    // blocks still in use would point to freed memory, rather leak then
+    if (stats.in_use > 0) {
+        log_warning("memory pool " << name << " destroyed with " << stats.in_use
+                                   << " blocks in use, keeping its slabs allocated");
+        return;
+    }
+    for (void *s : slabs)
+        ::operator delete(s);
+}
+
+void *memory_pool::allocate(std::size_t size) {
+    if (size > max_block_size) {
+        void *p = ::operator new(size);
+        mutex_locker ml(mtx);
+        ++stats.misses;
+        ++stats.in_use;
+        stats.high_water_mark = std::max(stats.high_water_mark, stats.in_use);
+        return p;
+    }
+    const unsigned sc = size_class(size);
+    mutex_locker ml(mtx);
+    free_block *&fl = free_lists[sc];
+    if (fl) {
+        ++stats.hits;
+    } else {
+        // carve a new slab into blocks and put them in the free list
+        const std::size_t block_size = std::max(std::size_t(sc) * granularity, sizeof(free_block));
+        char *slab = static_cast<char *>(::operator new(block_size * blocks_per_slab));
+        slabs.push_back(slab);
+        for (unsigned i = blocks_per_slab; i > 0; --i) {
+            free_block *b = reinterpret_cast<free_block *>(slab + (i - 1) * block_size);
+            b->next = fl;
+            fl = b;
+        }
+        ++stats.misses;
+    }
+    free_block *b = fl;
+    fl = b->next;
+    ++stats.in_use;
+    stats.high_water_mark = std::max(stats.high_water_mark, stats.in_use);
+    return b;
+}
+
+void memory_pool::deallocate(void *p, std::size_t size) {
+    if (!p)
+        return;
+    if (size > max_block_size) {
+        ::operator delete(p);
+        mutex_locker ml(mtx);
+        --stats.in_use;
+        return;
+    }
+    mutex_locker ml(mtx);
+    free_block *b = static_cast<free_block *>(p);
+    free_block *&fl = free_lists[size_class(size)];
+    b->next = fl;
+    fl = b;
+    --stats.in_use;
+}
+
+memory_pool::statistics memory_pool::get_statistics() const {
+    mutex_locker ml(mtx);
+    return stats;
+}
+
+void memory_pool::log_statistics() const {
+    mutex_locker ml(mtx);
+    log_info("memory pool " << name << ": hits=" << stats.hits << " misses=" << stats.misses << " in use="
+                            << stats.in_use << " high water mark=" << stats.high_water_mark);
+}
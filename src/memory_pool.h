@@ -0,0 +1,91 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// pool of memory blocks for objects that are created and deleted often
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef MEMORY_POOL_H
+#define MEMORY_POOL_H
+
+#include "mutex.h"
+#include <cstddef>
+#include <vector>
+
+/// Free list allocator for small objects of a class hierarchy.
+///@note Memory is taken from slabs of many blocks and freed blocks are kept
+///	in a free list per size class, so creating and deleting objects in the
+///	simulation does not touch the global heap. Classes use it by defining
+///	their operator new and delete, so std::unique_ptr and std::make_unique
+///	work as before. Slabs are released when the pool is destroyed, unless
+///	blocks are still in use, then they are kept and a warning is logged.
+class memory_pool {
+  public:
+    /// usage counters
+    struct statistics {
+        unsigned long hits;          ///< allocations served from a free list
+        unsigned long misses;        ///< allocations that needed new memory
+        std::size_t in_use;          ///< number of blocks currently allocated
+        std::size_t high_water_mark; ///< maximum of in_use
+        statistics() : hits(0), misses(0), in_use(0), high_water_mark(0) {}
+    };
+
+    /// create pool
+    ///@param name - name for log output
+    ///@param blocks_per_slab - number of blocks to allocate at once per size class
+    memory_pool(const char *name, unsigned blocks_per_slab = 256);
+    ~memory_pool();
+
+    /// allocate a block of at least size bytes, thread safe
+    void *allocate(std::size_t size);
+    /// give back a block, size must be the same as for allocation, thread safe
+    void deallocate(void *p, std::size_t size);
+
+    /// get current usage counters
+    statistics get_statistics() const;
+    /// get name of pool
+    const char *get_name() const { return name; }
+    /// write usage counters to log
+    void log_statistics() const;
+
+    /// blocks larger than this are taken from the heap directly
+    static const std::size_t max_block_size = 4096;
+    /// block sizes are multiples of this
+    static const std::size_t granularity = 16;
+
+  protected:
+    /// a free block stores the pointer to the next free block
+    struct free_block {
+        free_block *next;
+    };
+
+    const char *name;
+    const unsigned blocks_per_slab;
+    mutable ::mutex mtx;
+    std::vector<free_block *> free_lists; ///< per size class
+    std::vector<void *> slabs;
+    statistics stats;
+
+    static unsigned size_class(std::size_t size) { return unsigned((size + granularity - 1) / granularity); }
+
+  private:
+    memory_pool(const memory_pool &) = delete;
+    memory_pool &operator=(const memory_pool &) = delete;
+};
+
+#endif
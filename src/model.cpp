@@ -31,10 +31,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "caustics.h"
 #include "datadirs.h"
 #include "dmath.h"
+#include "filehelper.h"
 #include "log.h"
 #include "matrix4.h"
 #include "oglext/OglExt.h"
 #include "plane.h"
+#include "sensor_detection.h"
 #include "system.h"
 #include "triangle_intersection.h"
 #include "xml.h"
@@ -301,12 +303,28 @@ model::model(const string &filename_, bool use_material)
         }
     }
     fclose(ftest);
+    source_filename = filename2;
 
     // determine loader by extension here.
+    bool compiled = false;
     if (extension == ".off") {
         read_off_file(filename2);
     } else if (extension == ".xml" || extension == ".ddxml") {
-        read_dftd_model_file(filename2);
+        // take geometry from compiled model file if it is up to date
+        std::unique_ptr<model_bin_file::reader> bin;
+        try {
+            bin = std::make_unique<model_bin_file::reader>(model_bin_file::get_filename(filename2),
+                                                           model_bin_file::compute_key(filename2));
+        } catch (file_read_error &) {
+            // no compiled model file, nothing to report
+        } catch (error &e) {
+            log_info(e.what() << ", reading " << filename2);
+        }
+        read_dftd_model_file(filename2, bin);
+        if (bin) {
+            read_compiled_file(*bin);
+            compiled = true;
+        }
     } else {
         throw error(string("model: unknown extension or file format: ") + filename2);
     }
@@ -321,7 +339,9 @@ model::model(const string &filename_, bool use_material)
     }
 
     compute_bounds();
-    compute_normals();
+    // compiled models have normals and tangents already
+    if (!compiled)
+        compute_normals();
     compile();
 
     // try to read physical data file, needs min/max data etc., so call it after
@@ -1238,8 +1258,11 @@ void model::mesh::compute_bv_tree() {
         ++tri_index;
     } while (tit->next());
     // clear memory first
+    flat_bounding_volume_tree.reset();
     bounding_volume_tree.reset();
     bounding_volume_tree = bv_tree::create(vertices, leaf_nodes);
+    if (bounding_volume_tree.get())
+        flat_bounding_volume_tree = std::make_unique<flat_bv_tree>(*bounding_volume_tree);
 }
 
 const bv_tree &model::mesh::get_bv_tree() const {
@@ -1248,6 +1271,12 @@ const bv_tree &model::mesh::get_bv_tree() const {
     return *bounding_volume_tree.get();
 }
 
+const flat_bv_tree &model::mesh::get_flat_bv_tree() const {
+    if (!flat_bounding_volume_tree.get())
+        throw std::runtime_error("bv_tree not existing");
+    return *flat_bounding_volume_tree.get();
+}
+
 model::material::map::map()
     : tex(0), ref_count(0) {
 }
@@ -1334,6 +1363,21 @@ void model::material::map::get_all_layout_names(std::set<std::string> &result) c
         result.insert(it->first);
 }
 
+void model::material::map::get_texture_filenames(const std::string &name, const std::string &basepath,
+                                                 std::vector<std::string> &result) const {
+    // same file choice as in register_layout
+    std::map<string, skin>::const_iterator it = skins.find(name);
+    if (it != skins.end()) {
+        if (it->second.ref_count == 0)
+            result.push_back(basepath + it->second.filename);
+    } else if (ref_count == 0) {
+        if (is_file(basepath + filename))
+            result.push_back(basepath + filename);
+        else
+            result.push_back(get_texture_dir() + filename);
+    }
+}
+
 model::material::material(const std::string &nm) : name(nm), shininess(50.0f), two_sided(false) {
 }
 
@@ -1462,6 +1506,16 @@ void model::material::get_all_layout_names(std::set<std::string> &result) const
         specularmap->get_all_layout_names(result);
 }
 
+void model::material::get_texture_filenames(const std::string &name, const std::string &basepath,
+                                            std::vector<std::string> &result) const {
+    if (colormap.get())
+        colormap->get_texture_filenames(name, basepath, result);
+    if (normalmap.get())
+        normalmap->get_texture_filenames(name, basepath, result);
+    if (specularmap.get())
+        specularmap->get_texture_filenames(name, basepath, result);
+}
+
 model::material_glsl::material_glsl(const std::string &nm, const std::string &vsfn, const std::string &fsfn)
     : material(nm),
       vertexshaderfn(vsfn),
@@ -1531,6 +1585,15 @@ void model::material_glsl::get_all_layout_names(std::set<std::string> &result) c
     }
 }
 
+void model::material_glsl::get_texture_filenames(const std::string &name, const std::string &basepath,
+                                                 std::vector<std::string> &result) const {
+    for (unsigned i = 0; i < nrtex; ++i) {
+        if (texmaps[i].get()) {
+            texmaps[i]->get_texture_filenames(name, basepath, result);
+        }
+    }
+}
+
 void model::mesh::display(const texture *caustic_map) const {
     // set up material
     if (mymaterial != 0) {
@@ -1820,6 +1883,14 @@ void model::read_phys_file(const string &filename) {
         for (unsigned i = 0; i < voxel_data.size(); ++i)
             voxel_data[i].relative_mass /= mass_part_sum;
     }
+    for (unsigned i = 0; i < voxel_data.size(); ++i) {
+        const voxel &v = voxel_data[i];
+        voxel_soa.x.push_back(v.relative_position.x);
+        voxel_soa.y.push_back(v.relative_position.y);
+        voxel_soa.z.push_back(v.relative_position.z);
+        voxel_soa.part_of_volume.push_back(v.part_of_volume);
+        voxel_soa.relative_mass.push_back(v.relative_mass);
+    }
     // compute neighbouring information
     ptr = 0;
     int dx[6] = {0, -1, 0, 1, 0, 0};
@@ -1854,14 +1925,8 @@ void model::read_phys_file(const string &filename) {
 }
 
 float model::get_cross_section(float angle) const {
-    unsigned cs = cross_sections.size();
-    if (cs == 0)
-        return 0.0f;
-    float fcs = angle * cs / 360.0;
-    float fac = fcs - floor(fcs);
-    unsigned id0 = unsigned(floor(fcs)) % cs;
-    unsigned id1 = (id0 + 1) % cs;
-    return cross_sections[id0] * (1.0f - fac) + cross_sections[id1] * fac;
+    // sensors interpolate the cross sections of their targets the same way
+    return sensor_target::interpolate_cross_section(cross_sections, angle);
 }
 
 string model::tolower(const string &s) {
@@ -2122,7 +2187,7 @@ static string next_part_of_string(const string &s, string::size_type &fromwhere)
     }
 }
 
-void model::read_dftd_model_file(const std::string &filename) {
+void model::read_dftd_model_file(const std::string &filename, std::unique_ptr<model_bin_file::reader> &bin) {
     xml_doc doc(filename);
     doc.load();
     xml_elem root = doc.child("dftd-model");
@@ -2130,6 +2195,12 @@ void model::read_dftd_model_file(const std::string &filename) {
     // fixme: float is a bad idea for a version string, because of accuracy
     if (version > 1.21) // fixme with relations 1.2
         throw xml_error("model file format version unknown ", root.doc_name());
+    // check compiled file before parsing of geometry is skipped, so it can't fail later
+    if (bin && !check_compiled_file(*bin, root)) {
+        log_info("compiled model doesn't match model file, reading " << filename);
+        bin.reset();
+    }
+    const bool read_geometry = !bin;
 
     // read elements.
     map<unsigned, material *> mat_id_mapping;
@@ -2206,6 +2277,9 @@ void model::read_dftd_model_file(const std::string &filename) {
                     throw xml_error(string("referenced unknown material id, mesh ") + msh->name, e.doc_name());
                 }
             }
+            // geometry is read from compiled model file later
+            if (!read_geometry)
+                continue;
             // vertices
             xml_elem verts = e.child("vertices");
             unsigned nrverts = verts.attru("nr");
@@ -2297,6 +2371,75 @@ void model::read_dftd_model_file(const std::string &filename) {
     }
 }
 
+bool model::check_compiled_file(model_bin_file::reader &r, const xml_elem &root) const {
+    std::vector<Uint32> info;
+    r.read(info);
+    unsigned nr_of_meshes = 0;
+    for (xml_elem::iterator it = root.iterate("mesh"); !it.end(); it.next())
+        ++nr_of_meshes;
+    return info.size() == 1 && info[0] == nr_of_meshes;
+}
+
+void model::read_compiled_file(model_bin_file::reader &r) {
+    // number of meshes has been checked by check_compiled_file already
+    for (vector<mesh *>::iterator it = meshes.begin(); it != meshes.end(); ++it)
+        (*it)->read_compiled(r);
+    r.finish();
+}
+
+void model::write_compiled_file() const {
+    string::size_type st = source_filename.rfind(".");
+    string extension = (st == string::npos) ? "" : tolower(source_filename.substr(st));
+    if (extension != ".xml" && extension != ".ddxml")
+        throw error(string("only models read from .ddxml files can be compiled: ") + source_filename);
+    model_bin_file::writer w(model_bin_file::get_filename(source_filename), model_bin_file::compute_key(source_filename));
+    w.write(std::vector<Uint32>(1, Uint32(meshes.size())));
+    for (vector<mesh *>::const_iterator it = meshes.begin(); it != meshes.end(); ++it)
+        (*it)->write_compiled(w);
+    w.finish();
+}
+
+void model::mesh::write_compiled(model_bin_file::writer &w) const {
+    w.write(std::vector<Uint32>(1, Uint32(indices_type)));
+    w.write(vertices);
+    w.write(normals);
+    w.write(tangentsx);
+    w.write(righthanded);
+    w.write(texcoords);
+    w.write(indices);
+    std::vector<bv_tree::stored_node> nodes;
+    if (bounding_volume_tree.get())
+        bounding_volume_tree->store(nodes);
+    w.write(nodes);
+}
+
+void model::mesh::read_compiled(model_bin_file::reader &r) {
+    std::vector<Uint32> info;
+    r.read(info);
+    if (info.size() != 1 || info[0] > pt_triangle_strip)
+        throw error(string("compiled model has invalid data, mesh ") + name);
+    set_indices_type(primitive_type(info[0]));
+    r.read(vertices);
+    r.read(normals);
+    r.read(tangentsx);
+    r.read(righthanded);
+    r.read(texcoords);
+    r.read(indices);
+    const size_t nv = vertices.size();
+    if (normals.size() != nv || tangentsx.size() != righthanded.size() || (!tangentsx.empty() && tangentsx.size() != nv) ||
+        (!texcoords.empty() && texcoords.size() != nv))
+        throw error(string("compiled model has invalid data, mesh ") + name);
+    for (vector<Uint32>::const_iterator it = indices.begin(); it != indices.end(); ++it)
+        if (*it >= nv)
+            throw error(string("vertex index out of range in compiled model, mesh ") + name);
+    std::vector<bv_tree::stored_node> nodes;
+    r.read(nodes);
+    flat_bounding_volume_tree.reset();
+    bounding_volume_tree = bv_tree::restore(nodes, unsigned(nv));
+    if (bounding_volume_tree.get())
+        flat_bounding_volume_tree = std::make_unique<flat_bv_tree>(*bounding_volume_tree);
+}
+
 void model::read_objects(const xml_elem &parent, object &parentobj) {
     for (xml_elem::iterator it = parent.iterate("object"); !it.end(); it.next()) {
         xml_elem e = it.elem();
@@ -2421,6 +2564,11 @@ void model::get_all_layout_names(std::set<std::string> &result) const {
     result.insert(default_layout);
 }
 
+void model::get_texture_filenames(const std::string &name, std::vector<std::string> &result) const {
+    for (vector<material *>::const_iterator it = materials.begin(); it != materials.end(); ++it)
+        (*it)->get_texture_filenames(name, basepath, result);
+}
+
 /* must handle object-tree, later...
 bool model::is_inside(const vector3f& p) const
 {
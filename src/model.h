@@ -24,9 +24,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define MODEL_H
 
 #include "bv_tree.h"
+#include "flat_bv_tree.h"
 #include "color.h"
 #include "matrix3.h"
 #include "matrix4.h"
+#include "model_bin_file.h"
 #include "shader.h"
 #include "texture.h"
 #include "vector3.h"
@@ -95,6 +97,8 @@ class model {
             void unregister_layout(const std::string &name);
             void set_layout(const std::string &layout);
             void get_all_layout_names(std::set<std::string> &result) const;
+            void get_texture_filenames(const std::string &name, const std::string &basepath,
+                                       std::vector<std::string> &result) const;
         };
 
         std::string name;
@@ -114,6 +118,8 @@ class model {
         virtual void unregister_layout(const std::string &name);
         virtual void set_layout(const std::string &layout);
         virtual void get_all_layout_names(std::set<std::string> &result) const;
+        virtual void get_texture_filenames(const std::string &name, const std::string &basepath,
+                                           std::vector<std::string> &result) const;
         virtual bool needs_texcoords() const { return colormap.get() != 0; }
         virtual bool use_default_shader() const { return true; }
     };
@@ -131,6 +137,8 @@ class model {
         void unregister_layout(const std::string &name);
         void set_layout(const std::string &layout);
         void get_all_layout_names(std::set<std::string> &result) const;
+        void get_texture_filenames(const std::string &name, const std::string &basepath,
+                                   std::vector<std::string> &result) const;
         void compute_texloc();
         const std::string &get_vertexshaderfn() const { return vertexshaderfn; }
         const std::string &get_fragmentshaderfn() const { return fragmentshaderfn; }
@@ -263,6 +271,7 @@ class model {
         void compute_bv_tree();
         bool has_bv_tree() const { return bounding_volume_tree.get(); }
         const bv_tree &get_bv_tree() const;
+        const flat_bv_tree &get_flat_bv_tree() const;
 
         void get_plain_triangle(unsigned triangle, Uint32 indices[3]) const;
         void get_strip_triangle(unsigned triangle, Uint32 indices[3]) const;
@@ -270,6 +279,11 @@ class model {
         void set_indices_type(primitive_type pt);
         primitive_type get_indices_type() const { return indices_type; }
 
+        /// write compiled data of mesh: geometry, normals, tangents and bv_tree if computed
+        void write_compiled(model_bin_file::writer &w) const;
+        /// read compiled data of mesh, throws error if data is inconsistent
+        void read_compiled(model_bin_file::reader &r);
+
         /// slow intersection test on triangle-triangle tests
         bool intersects(const mesh &other, const matrix4f &transformation_this_to_other) const;
 
@@ -279,6 +293,7 @@ class model {
       protected:
         primitive_type indices_type;
         std::unique_ptr<bv_tree> bounding_volume_tree;
+        std::unique_ptr<flat_bv_tree> flat_bounding_volume_tree; // same tree as contiguous array for collision tests
         void (model::mesh::*get_triangle_ptr)(unsigned triangle, Uint32 indices[3]) const;
 
       private:
@@ -313,6 +328,14 @@ class model {
         }
     };
 
+    /// voxel values needed for buoyancy as structure of arrays, for vectorized computation
+    struct voxel_arrays {
+        std::vector<float> x, y, z; ///< relative_position
+        std::vector<float> part_of_volume;
+        std::vector<float> relative_mass;
+        unsigned size() const { return unsigned(x.size()); }
+    };
+
   protected:
     // a 3d object, references meshes
     struct object {
@@ -345,6 +368,8 @@ class model {
 
     // store that for debugging purposes.
     std::string filename;
+    // file the model was read from, found in model dir if needed
+    std::string source_filename;
 
     std::vector<material *> materials;
     std::vector<mesh *> meshes;
@@ -404,6 +429,8 @@ class model {
     double total_volume_by_voxels;
     /// per voxel: relative 3d position and part of volume that is inside (0...1)
     std::vector<voxel> voxel_data;
+    /// voxel_data as structure of arrays
+    voxel_arrays voxel_soa;
     /// voxel for 3-space coordinate of it, -1 if not existing
     std::vector<int> voxel_index_by_pos;
 
@@ -414,7 +441,13 @@ class model {
 
     void read_off_file(const std::string &fn);
 
-    void read_dftd_model_file(const std::string &filename);
+    /// read model file. Geometry is not parsed if it is taken from compiled model file bin,
+    /// bin is reset if it doesn't match the model file.
+    void read_dftd_model_file(const std::string &filename, std::unique_ptr<model_bin_file::reader> &bin);
+    /// check that compiled model file has the meshes of the model file, reads first section of it
+    bool check_compiled_file(model_bin_file::reader &r, const xml_elem &root) const;
+    /// read geometry of all meshes from compiled model file
+    void read_compiled_file(model_bin_file::reader &r);
     void write_color_to_dftd_model_file(xml_elem &parent, const color &c,
                                         const std::string &type) const;
     color read_color_from_dftd_model_file(const xml_elem &parent, const std::string &type);
@@ -460,6 +493,7 @@ class model {
     float get_height() const { return (max - min).z; }
     vector3f get_boundbox_size() const { return max - min; }
     float get_cross_section(float angle) const; // give angle in degrees.
+    const std::vector<float> &get_cross_sections() const { return cross_sections; }
     static std::string tolower(const std::string &s);
     void add_mesh(mesh *m) { meshes.push_back(m); } // fixme: maybe recompute bounds
     void add_material(material *m) { materials.push_back(m); }
@@ -471,6 +505,11 @@ class model {
     // write our own model file format.
     void write_to_dftd_model_file(const std::string &filename, bool store_normals = true) const;
 
+    /// write compiled model data (.ddbin) next to the model file it was read from.
+    ///@note Later loads take geometry, normals and tangents from there as long as the
+    ///	model file is unchanged. Compute bv_trees before if they should be stored, too.
+    void write_compiled_file() const;
+
     // manipulate object angle(s), returns false on error (wrong id or angle out of bounds)
     bool set_object_angle(unsigned objid, double ang);
     bool set_object_angle(const std::string &objname, double ang);
@@ -496,6 +535,10 @@ class model {
     // collect all possible layout names from all materials/maps and insert them in "result"
     void get_all_layout_names(std::set<std::string> &result) const;
 
+    /// collect image files that register_layout would load for a layout, so they can be
+    /// decoded in advance. Textures that are loaded already are left out.
+    void get_texture_filenames(const std::string &name, std::vector<std::string> &result) const;
+
     std::string get_filename() const { return filename; }
 
     /*
@@ -514,6 +557,8 @@ class model {
     float get_total_volume_by_voxels() const { return total_volume_by_voxels; }
     /// request voxel data
     const std::vector<voxel> &get_voxel_data() const { return voxel_data; }
+    /// request voxel data as structure of arrays
+    const voxel_arrays &get_voxel_arrays() const { return voxel_soa; }
     /// get voxel data by position, may return 0 for not existing voxels
     const voxel *get_voxel_by_pos(const vector3i &v) const {
         int i = voxel_index_by_pos[(v.z * voxel_resolution.y + v.y) * voxel_resolution.x + v.x];
@@ -0,0 +1,42 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Compiled binary model data (.ddbin)
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "model_bin_file.h"
+#include "mapped_file.h"
+
+const binary_container::format model_bin_file::file_format = {"DFTDMODL", model_bin_file::version, "compiled model"};
+const char *const model_bin_file::extension = ".ddbin";
+
+uint64_t model_bin_file::compute_key(const std::string &model_filename) {
+    mapped_file f(model_filename);
+    uint64_t v = version;
+    return hash(f.data(), f.size(), hash(&v, sizeof(v)));
+}
+
+std::string model_bin_file::get_filename(const std::string &model_filename) {
+    std::string::size_type st = model_filename.rfind('.');
+    std::string::size_type sl = model_filename.rfind('/');
+    if (st == std::string::npos || (sl != std::string::npos && st < sl))
+        return model_filename + extension;
+    return model_filename.substr(0, st) + extension;
+}
@@ -0,0 +1,81 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Compiled binary model data (.ddbin)
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef MODEL_BIN_FILE_H
+#define MODEL_BIN_FILE_H
+
+#include "binary_container.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/// A file of raw arrays (sections) with the compiled data of a model.
+///@note The .ddxml model file stays the source of all data. The compiled file holds
+///	what is parsed and computed from it when loading (vertices, indices, normals,
+///	tangents, bounding volume tree) and is identified by a key computed from the
+///	contents of the model file, so it gets stale with every change of the model.
+///	The file is a binary_container, its checksum is verified when it is opened.
+///	Sections are copied from the mapped file to the mesh data.
+class model_bin_file : public binary_container {
+  public:
+    /// version of file format, increase on every change of format or contents
+    static const uint32_t version = 1;
+    /// magic, version and name of file kind
+    static const format file_format;
+    /// extension of compiled model files
+    static const char *const extension;
+
+    /// compute key from contents of model file, throws file_read_error if file can't be read
+    static uint64_t compute_key(const std::string &model_filename);
+    /// get name of compiled file for a model file
+    static std::string get_filename(const std::string &model_filename);
+
+    /// writes a compiled file section by section
+    class writer : public binary_container::writer {
+      public:
+        /// open temporary file for writing, throws error on failure
+        writer(const std::string &filename, uint64_t key) : binary_container::writer(filename, file_format, key) {}
+    };
+
+    /// reads a compiled file section by section
+    class reader : public binary_container::reader {
+      public:
+        /// map file and check header and checksum.
+        ///@note throws file_read_error if file is missing and error if it is stale or corrupt
+        reader(const std::string &filename, uint64_t key) : binary_container::reader(filename, file_format, key, true) {}
+        /// read next section, throws error if its size is no multiple of the element size
+        template <class T>
+        void read(std::vector<T> &data) {
+            size_t size;
+            const unsigned char *p = next_section(size);
+            if (size % sizeof(T) != 0)
+                throw_unexpected();
+            data.resize(size / sizeof(T));
+            if (size)
+                memcpy(static_cast<void *>(data.data()), p, size);
+        }
+    };
+};
+
+#endif
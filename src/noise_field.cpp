@@ -0,0 +1,107 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Table of underwater noise sources for passive sonar
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "noise_field.h"
+#include <algorithm>
+#include <cmath>
+
+// integral power by squaring, much cheaper than pow for the high exponents of the GHG
+static double power(double x, unsigned e) {
+    double result = 1.0;
+    while (e) {
+        if (e & 1)
+            result *= x;
+        x *= x;
+        e >>= 1;
+    }
+    return result;
+}
+
+void noise_field::add_source(const void *owner, const vector2 &pos, const noise &source_level) {
+    owners.push_back(owner);
+    positions.push_back(pos);
+    source_levels.push_back(source_level);
+}
+
+std::shared_ptr<const noise_field::reception> noise_field::get_reception(const void *listener, const vector2 &pos,
+                                                                         angle heading, const noise &own_level) {
+    auto &r = receptions[listener];
+    if (!r)
+        r = std::make_shared<reception>(*this, listener, pos, heading, own_level);
+    return r;
+}
+
+noise_field::reception::reception(const noise_field &nf, const void *listener, const vector2 &pos, angle heading,
+                                  const noise &own_level) {
+    // as first, add background noise
+    own_noise += noise::compute_ambient_noise_strength(0.2 /* sea state, fixme make dynamic later */);
+    // next, add noise from receiver vessel
+    // if we do that, weaker noises are wiped out...
+    // fixme: GHG/BG have blind spots at aft, so the receiver caused noise is reduced much more.
+    // we should handle receiver vessel as additional noise source with distance 50, direction 180 degrees relative!
+    own_noise += noise_signature::compute_received_strength(own_level, 50 /* distance */);
+
+    for (unsigned i = 0; i < nf.size(); ++i) {
+        if (nf.owners[i] == listener)
+            continue;
+        vector2 relpos = nf.positions[i] - pos;
+        double distance = relpos.length();
+        angle direction_to_noise(relpos);
+        angle rel_dir_to_noise = direction_to_noise - heading;
+        // GHG/BG listen with port or starboard phones only
+        side &sd = sides[(rel_dir_to_noise.value_pm180() >= 0) ? 1 : 0];
+        sd.dir_cos.push_back(rel_dir_to_noise.cos());
+        sd.dir_sin.push_back(rel_dir_to_noise.sin());
+        noise nsig = noise_signature::compute_received_strength(nf.source_levels[i], distance);
+        for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b)
+            sd.strength[b].push_back(nsig.frequencies[b]);
+    }
+}
+
+std::pair<double, noise> noise_field::reception::listen(angle rel_listening_dir) const {
+    // directivity of GHG is cos(delta)^(f*0.04), see compute_signal_strength_GHG,
+    // the exponents are integral for the typical frequencies of the bands.
+    unsigned exponent[noise::NR_OF_FREQUENCY_BANDS];
+    for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b)
+        exponent[b] = unsigned(std::lround(noise::typical_frequency[b] * 0.04));
+    const double lc = rel_listening_dir.cos(), ls = rel_listening_dir.sin();
+
+    noise n = own_noise;
+    const side &sd = sides[(rel_listening_dir.value_pm180() >= 0) ? 1 : 0];
+    for (unsigned i = 0; i < sd.size(); ++i) {
+        // cosine of angle between listening direction and source, sources behind are not heard
+        double c = sd.dir_cos[i] * lc + sd.dir_sin[i] * ls;
+        if (c <= 0.0)
+            continue;
+        for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b)
+            n.frequencies[b] += sd.strength[b][i] * power(c, exponent[b]);
+    }
+
+    // now compute back to dB, quantize to integer dB values, to
+    // simulate shadowing of weak signals by background noise
+    // divide by receiver sensitivity before doing so, to avoid cutting off weak signals.
+    const double GHG_receiver_sensitivity_dB = -3; // weakest signal strength to be detectable
+    double abs_strength =
+        floor(std::max(n.compute_total_noise_strength_dB() - GHG_receiver_sensitivity_dB, 0.0)) + GHG_receiver_sensitivity_dB;
+    return std::make_pair(abs_strength, n.to_dB());
+}
@@ -0,0 +1,87 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Table of underwater noise sources for passive sonar
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef NOISE_FIELD_H
+#define NOISE_FIELD_H
+
+#include "angle.h"
+#include "sonar.h"
+#include "vector2.h"
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+///\brief All noise sources of one simulation step with their level per frequency band.
+///@note The table is built once per step and shared by all listeners. What a listener
+///	receives from each source (propagation loss, direction) is computed once per step
+///	as reception, so listening to many directions only weights the cached strengths
+///	by the directivity of the hydrophones.
+class noise_field {
+  public:
+    /// noise received by one listener, for any listening direction
+    class reception {
+      public:
+        /// compute received noise of all sources except the listener itself
+        ///@param own_level - noise level of the listener in dB, see noise_signature::compute_source_level
+        reception(const noise_field &nf, const void *listener, const vector2 &pos, angle heading,
+                  const noise &own_level);
+
+        /// listen with GHG to a direction relative to the listener's heading
+        ///@returns absolute strength in dB and received noise (in dB)
+        std::pair<double, noise> listen(angle rel_listening_dir) const;
+
+        /// number of sources that can be heard
+        unsigned size() const { return unsigned(sides[0].size() + sides[1].size()); }
+
+      protected:
+        noise own_noise; // ambient noise and noise of the listener, flat
+        // sources on port (0) and starboard (1) side, structure of arrays
+        struct side {
+            std::vector<double> dir_cos, dir_sin; // of direction to source relative to heading
+            std::vector<double> strength[noise::NR_OF_FREQUENCY_BANDS];
+            unsigned size() const { return unsigned(dir_cos.size()); }
+        };
+        side sides[2];
+    };
+
+    /// add a noise source. The owner identifies the source, so a listener doesn't hear itself.
+    ///@param source_level - level of the source in dB, see noise_signature::compute_source_level
+    void add_source(const void *owner, const vector2 &pos, const noise &source_level);
+
+    /// get shared reception for a listener, computed on first request.
+    ///@note not thread safe, callers must lock
+    std::shared_ptr<const reception> get_reception(const void *listener, const vector2 &pos, angle heading,
+                                                   const noise &own_level);
+
+    /// number of sources
+    unsigned size() const { return unsigned(owners.size()); }
+
+  protected:
+    std::vector<const void *> owners;
+    std::vector<vector2> positions;
+    std::vector<noise> source_levels;
+    std::unordered_map<const void *, std::shared_ptr<const reception>> receptions;
+};
+
+#endif
@@ -25,11 +25,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define OCEAN_WAVE_GENERATOR
 
 #include "global_constants.h"
+#include "ocean_wave_kernels.h"
+#include "random_generator.h"
 #include "rnd.h"
 #include "vector3.h"
 #include <complex>
 #include <cstdlib>
+#include <memory>
+#include <stdexcept>
 #include <fftw3.h>
+#include <type_traits>
 #include <vector>
 
 // use float fftw (faster) or double (default) ?
@@ -68,17 +73,28 @@ class ocean_wave_generator {
     T a;           // wave height scalar
     T Lm;          // tile size in m
     T w0;          // cycle time, 0.0 if no cycling needed
+    std::vector<std::complex<T>> gauss;  // random values of h0tilde, kept to recompute it for other wind
     std::vector<std::complex<T>> h0tilde;
-    std::vector<std::complex<T>> htilde; // holds values for one fix time.
+    ocean_wave_kernels::path kernel_path;
+
+    // per frequency tables as structure of arrays, indexed y*N+x with y in [0...N/2].
+    // h0 is h0tilde(K), hm is conj(h0tilde(-K)), omega the (cycled) angular frequency.
+    std::vector<T> h0_re, h0_im, hm_re, hm_im, omega;
+    std::vector<T> normal_kx, normal_ky; // K
+    std::vector<T> disp_kx, disp_ky;     // -K/|K|, the factor 2*PI/Lm gets divided out
+    std::vector<T> htilde_re, htilde_im; // holds values for one fix time.
+    mutable std::vector<T> grad_x_re, grad_x_im, grad_y_re, grad_y_im;
 
     ocean_wave_generator &operator=(const ocean_wave_generator &);
-    static T myrnd();
-    static std::complex<T> gaussrand();
-    T phillips(const vector2t<T> &K) const;
-    std::complex<T> h0_tilde(const vector2t<T> &K) const;
-    void compute_h0tilde();
-    std::complex<T> h_tilde(const vector2t<T> &K, int kx, int ky, T time) const;
+    static T myrnd(random_generator *rg);
+    static std::complex<T> gaussrand(random_generator *rg);
+    T phillips(const vector2t<T> &K, const vector2t<T> &winddir, T windspeed) const;
+    void compute_h0tilde(unsigned seed);
+    void compute_tables();
+    void split_h0tilde();
     void compute_htilde(T time);
+    void multiply_ik(const std::vector<T> &kx, const std::vector<T> &ky) const;
+    void copy_to_fft_input(const std::vector<T> &re, const std::vector<T> &im, FFT_COMPLEX_TYPE *dst) const;
 
     FFT_COMPLEX_TYPE *fft_in, *fft_in2; // can't be a vector, since the type is an array
     FFT_REAL_TYPE *fft_out, *fft_out2;  // for sake of uniformity
@@ -128,7 +144,8 @@ class ocean_wave_generator {
         T windspeed = T(20.0),
         T waveheight = T(0.0001), // fixme: compute that automatically from Lm, etc.?
         T tilesize = T(100.0),
-        T cycletime = T(10.0));
+        T cycletime = T(10.0),
+        unsigned seed = 0); // seed for random values, 0 to use global random numbers
     /// copy the object, htilde is not copied
     ocean_wave_generator(const ocean_wave_generator<T> &owg);
     // make a (smaller) copy, gridsize must be <= owg.gridsize,
@@ -142,20 +159,30 @@ class ocean_wave_generator {
     void compute_normals(std::vector<vector3t<T>> &wavenormals) const;
     // give negative values to use default factor, positive for displacement scaling
     void compute_displacements(const T &scalefac, std::vector<vector2t<T>> &wavedisplacements) const;
+    /// get the spectrum (h0tilde) currently used
+    const std::vector<std::complex<T>> &get_spectrum() const { return h0tilde; }
+    /// compute the spectrum for other wind parameters with the same random values,
+    /// so the waves keep their shape and only change their size (weather changes)
+    void compute_spectrum(const vector2t<T> &winddir, T windspeed, std::vector<std::complex<T>> &spectrum) const;
+    /// use linear blend of two spectra, fac 0 gives s0, fac 1 gives s1. Call set_time() afterwards.
+    void blend_spectrum(const std::vector<std::complex<T>> &s0, const std::vector<std::complex<T>> &s1, T fac);
+    /// select implementation of the per frequency kernels, default is the fastest one
+    void set_kernel_path(ocean_wave_kernels::path p) { kernel_path = p; }
+    ocean_wave_kernels::path get_kernel_path() const { return kernel_path; }
     ~ocean_wave_generator();
 };
 
 template <class T>
-T ocean_wave_generator<T>::myrnd() {
-    return T(rnd());
+T ocean_wave_generator<T>::myrnd(random_generator *rg) {
+    return rg ? T(rg->rndf()) : T(rnd());
 }
 
 template <class T>
-std::complex<T> ocean_wave_generator<T>::gaussrand() {
+std::complex<T> ocean_wave_generator<T>::gaussrand(random_generator *rg) {
     T x1, x2, w;
     do {
-        x1 = T(2.0) * myrnd() - T(1.0);
-        x2 = T(2.0) * myrnd() - T(1.0);
+        x1 = T(2.0) * myrnd(rg) - T(1.0);
+        x2 = T(2.0) * myrnd(rg) - T(1.0);
         w = x1 * x1 + x2 * x2;
     } while (w >= T(1.0));
     w = sqrt((T(-2.0) * log(w)) / w);
@@ -163,8 +190,8 @@ std::complex<T> ocean_wave_generator<T>::gaussrand() {
 }
 
 template <class T>
-T ocean_wave_generator<T>::phillips(const vector2t<T> &K) const {
-    T v2 = v * v;
+T ocean_wave_generator<T>::phillips(const vector2t<T> &K, const vector2t<T> &winddir, T windspeed) const {
+    T v2 = windspeed * windspeed;
     T k2 = K.square_length();
     if (k2 == T(0))
         return T(0);
@@ -174,7 +201,7 @@ T ocean_wave_generator<T>::phillips(const vector2t<T> &K) const {
     // note: Khat = K.normal() * W should be taken, but we use K
     // and divide |K * W|^2 by |K|^2 = k2 later.
     // note: a greater exponent could be used (e.g. 6) to align waves even more to the wind
-    T KdotW = K * W;
+    T KdotW = K * winddir;
     T KdotWhat = KdotW * KdotW / k2;
     T eterm = exp(-g2 / (k2 * v4)) / k4;
     T dampfac = T(1.0 / 100);
@@ -186,18 +213,26 @@ T ocean_wave_generator<T>::phillips(const vector2t<T> &K) const {
 }
 
 template <class T>
-std::complex<T> ocean_wave_generator<T>::h0_tilde(const vector2t<T> &K) const {
+void ocean_wave_generator<T>::compute_h0tilde(unsigned seed) {
     // in comparison to the water engine by ??? here some randomization is missing.
     // there this complex number is multiplied with a random sinus value
     // that means a random phase. But it doesn't seem to change the appearance much.
-    std::complex<T> g = gaussrand(); // split in two expressions to make it compileable under VC6
-    T p = sqrt(T(0.5) * phillips(K));
-    return g * p; // * f;
+    // with a seed the waves are the same on every run
+    std::unique_ptr<random_generator> rg;
+    if (seed)
+        rg = std::make_unique<random_generator>(seed);
+    gauss.resize((N + 1) * (N + 1));
+    for (auto &g : gauss)
+        g = gaussrand(rg.get());
+    compute_spectrum(W, v, h0tilde);
 }
 
 template <class T>
-void ocean_wave_generator<T>::compute_h0tilde() {
+void ocean_wave_generator<T>::compute_spectrum(const vector2t<T> &winddir, T windspeed,
+                                               std::vector<std::complex<T>> &spectrum) const {
     const T pi2 = T(2.0 * M_PI);
+    const vector2t<T> Wn = winddir.normal();
+    spectrum.resize((N + 1) * (N + 1));
     // outer parts of arrays (x2,y2 away from zero) hold higher frequencies.
     // the significant frequencies are very close to zero, anything above
     // +-N/4 or so is only very high frequency
@@ -205,31 +240,122 @@ void ocean_wave_generator<T>::compute_h0tilde() {
         T Ky = pi2 * y2 / Lm;
         for (int x = 0, x2 = -N / 2; x <= N; ++x, ++x2) {
             T Kx = pi2 * x2 / Lm;
-            h0tilde[y * (N + 1) + x] = h0_tilde(vector2t<T>(Kx, Ky));
+            T p = sqrt(T(0.5) * phillips(vector2t<T>(Kx, Ky), Wn, windspeed));
+            spectrum[y * (N + 1) + x] = gauss[y * (N + 1) + x] * p;
         }
     }
 }
 
 template <class T>
-std::complex<T> ocean_wave_generator<T>::h_tilde(const vector2t<T> &K, int kx, int ky, T time) const {
-    std::complex<T> h0_tildeK = h0tilde[ky * (N + 1) + kx];
-    std::complex<T> h0_tildemKconj = conj(h0tilde[(N - ky) * (N + 1) + (N - kx)]);
-    // all frequencies should be multiples of one base frequency (see paper).
-    T wK = sqrt(GRAVITY * K.length());
-    T wK2 = (w0 == T(0.0)) ? wK : T(floor(wK / w0) * w0);
-    T xp = wK2 * time;
-    T cxp = cos(xp);
-    T sxp = sin(xp);
-    return h0_tildeK * std::complex<T>(cxp, sxp) + h0_tildemKconj * std::complex<T>(cxp, -sxp);
+void ocean_wave_generator<T>::blend_spectrum(const std::vector<std::complex<T>> &s0,
+                                             const std::vector<std::complex<T>> &s1, T fac) {
+    if (s0.size() != h0tilde.size() || s1.size() != h0tilde.size())
+        throw std::invalid_argument("ocean_wave_generator: spectrum size mismatch");
+    const T fac0 = T(1) - fac;
+    for (unsigned i = 0; i < unsigned(h0tilde.size()); ++i)
+        h0tilde[i] = s0[i] * fac0 + s1[i] * fac;
+    split_h0tilde();
 }
 
 template <class T>
-void ocean_wave_generator<T>::compute_htilde(T time) {
+void ocean_wave_generator<T>::compute_tables() {
     const T pi2 = T(2.0 * M_PI);
+    const unsigned n = unsigned(N * (N / 2 + 1));
+    omega.resize(n);
+    normal_kx.resize(n);
+    normal_ky.resize(n);
+    disp_kx.resize(n);
+    disp_ky.resize(n);
     for (int y = 0; y <= N / 2; ++y) {
         for (int x = 0; x < N; ++x) {
+            const unsigned i = unsigned(y * N + x);
             vector2t<T> K(pi2 * (x - N / 2) / Lm, pi2 * (y - N / 2) / Lm);
-            htilde[y * N + x] = h_tilde(K, x, y, time);
+            // all frequencies should be multiples of one base frequency (see paper).
+            T wK = sqrt(GRAVITY * K.length());
+            omega[i] = (w0 == T(0.0)) ? wK : T(floor(wK / w0) * w0);
+            normal_kx[i] = K.x;
+            normal_ky[i] = K.y;
+            vector2t<T> Kd((x - N / 2), (y - N / 2));
+            T k = Kd.length();
+            disp_kx[i] = (k != 0) ? -Kd.x * (T(1) / k) : T(0);
+            disp_ky[i] = (k != 0) ? -Kd.y * (T(1) / k) : T(0);
+        }
+    }
+    htilde_re.resize(n);
+    htilde_im.resize(n);
+    grad_x_re.resize(n);
+    grad_x_im.resize(n);
+    grad_y_re.resize(n);
+    grad_y_im.resize(n);
+    split_h0tilde();
+}
+
+template <class T>
+void ocean_wave_generator<T>::split_h0tilde() {
+    const unsigned n = unsigned(N * (N / 2 + 1));
+    h0_re.resize(n);
+    h0_im.resize(n);
+    hm_re.resize(n);
+    hm_im.resize(n);
+    for (int y = 0; y <= N / 2; ++y) {
+        for (int x = 0; x < N; ++x) {
+            const unsigned i = unsigned(y * N + x);
+            const std::complex<T> &h0 = h0tilde[y * (N + 1) + x];
+            const std::complex<T> &hm = h0tilde[(N - y) * (N + 1) + (N - x)];
+            h0_re[i] = h0.real();
+            h0_im[i] = h0.imag();
+            hm_re[i] = hm.real();
+            hm_im[i] = -hm.imag();
+        }
+    }
+}
+
+template <class T>
+void ocean_wave_generator<T>::compute_htilde(T time) {
+    // htilde = h0tilde(K) * e^(i*w*t) + conj(h0tilde(-K)) * e^(-i*w*t)
+    const unsigned n = unsigned(htilde_re.size());
+    if constexpr (std::is_same_v<T, float>) {
+        ocean_wave_kernels::evolve(kernel_path, n, h0_re.data(), h0_im.data(), hm_re.data(), hm_im.data(),
+                                   omega.data(), time, htilde_re.data(), htilde_im.data());
+    } else {
+        for (unsigned i = 0; i < n; ++i) {
+            T xp = omega[i] * time;
+            T c = cos(xp);
+            T s = sin(xp);
+            htilde_re[i] = (h0_re[i] * c - h0_im[i] * s) + (hm_re[i] * c + hm_im[i] * s);
+            htilde_im[i] = (h0_re[i] * s + h0_im[i] * c) + (hm_im[i] * c - hm_re[i] * s);
+        }
+    }
+}
+
+template <class T>
+void ocean_wave_generator<T>::multiply_ik(const std::vector<T> &kx, const std::vector<T> &ky) const {
+    // grad_x = i * kx * htilde, grad_y = i * ky * htilde
+    const unsigned n = unsigned(htilde_re.size());
+    if constexpr (std::is_same_v<T, float>) {
+        ocean_wave_kernels::multiply_ik(kernel_path, n, htilde_re.data(), htilde_im.data(), kx.data(), ky.data(),
+                                        grad_x_re.data(), grad_x_im.data(), grad_y_re.data(), grad_y_im.data());
+    } else {
+        for (unsigned i = 0; i < n; ++i) {
+            grad_x_re[i] = -htilde_im[i] * kx[i];
+            grad_x_im[i] = htilde_re[i] * kx[i];
+            grad_y_re[i] = -htilde_im[i] * ky[i];
+            grad_y_im[i] = htilde_re[i] * ky[i];
+        }
+    }
+}
+
+template <class T>
+void ocean_wave_generator<T>::copy_to_fft_input(const std::vector<T> &re, const std::vector<T> &im,
+                                                FFT_COMPLEX_TYPE *dst) const {
+    // we must transpose it, fftw has x*(N/2+1)+y, we use y*N+x
+    for (int y = 0; y <= N / 2; ++y) {
+        const T *sre = &re[y * N];
+        const T *sim = &im[y * N];
+        for (int x = 0; x < N; ++x) {
+            int ptr = x * (N / 2 + 1) + y;
+            dst[ptr][0] = sre[x];
+            dst[ptr][1] = sim[x];
         }
     }
 }
@@ -241,12 +367,13 @@ ocean_wave_generator<T>::ocean_wave_generator(
     T windspeed,
     T waveheight,
     T tilesize,
-    T cycletime)
+    T cycletime,
+    unsigned seed)
     : N(int(gridsize)), W(winddir.normal()), v(windspeed), a(waveheight), Lm(tilesize),
-      w0(cycletime < T(0.0) ? T(0.0) : T(2.0 * M_PI) / cycletime) {
+      w0(cycletime < T(0.0) ? T(0.0) : T(2.0 * M_PI) / cycletime), kernel_path(ocean_wave_kernels::get_best_path()) {
     h0tilde.resize((N + 1) * (N + 1));
-    compute_h0tilde();
-    htilde.resize(N * (N / 2 + 1));
+    compute_h0tilde(seed);
+    compute_tables();
     allocmem();
     plan = FFT_CREATE_PLAN(N, N, fft_in, fft_out, 0);
     plan2 = FFT_CREATE_PLAN(N, N, fft_in2, fft_out2, 0);
@@ -254,9 +381,10 @@ ocean_wave_generator<T>::ocean_wave_generator(
 
 template <class T>
 ocean_wave_generator<T>::ocean_wave_generator(const ocean_wave_generator<T> &owg)
-    : N(owg.N), W(owg.W), v(owg.v), a(owg.a), Lm(owg.Lm), w0(owg.w0), h0tilde(owg.h0tilde) {
+    : N(owg.N), W(owg.W), v(owg.v), a(owg.a), Lm(owg.Lm), w0(owg.w0), gauss(owg.gauss), h0tilde(owg.h0tilde),
+      kernel_path(owg.kernel_path) {
     // clear htilde, create new fftw plans.
-    htilde.resize(N * (N / 2 + 1));
+    compute_tables();
     allocmem();
     plan = FFT_CREATE_PLAN(N, N, fft_in, fft_out, 0);
     plan2 = FFT_CREATE_PLAN(N, N, fft_in2, fft_out2, 0);
@@ -265,13 +393,16 @@ ocean_wave_generator<T>::ocean_wave_generator(const ocean_wave_generator<T> &owg
 template <class T>
 ocean_wave_generator<T>::ocean_wave_generator(const ocean_wave_generator<T> &owg, int gridsize,
                                               int clearlowfreq)
-    : N(gridsize <= owg.N ? gridsize : owg.N), W(owg.W), v(owg.v), a(owg.a), Lm(owg.Lm), w0(owg.w0) {
+    : N(gridsize <= owg.N ? gridsize : owg.N), W(owg.W), v(owg.v), a(owg.a), Lm(owg.Lm), w0(owg.w0),
+      kernel_path(owg.kernel_path) {
     h0tilde.resize((N + 1) * (N + 1));
+    gauss.resize((N + 1) * (N + 1));
     // copy h0 tilde instead of computing it
     int offset = (owg.N - N) / 2;
     for (int y = 0; y <= N; ++y) {
         for (int x = 0; x <= N; ++x) {
             h0tilde[y * (N + 1) + x] = owg.h0tilde[(y + offset) * (owg.N + 1) + (x + offset)];
+            gauss[y * (N + 1) + x] = owg.gauss[(y + offset) * (owg.N + 1) + (x + offset)];
         }
     }
     bool clearhigh = false;
@@ -290,6 +421,10 @@ ocean_wave_generator<T>::ocean_wave_generator(const ocean_wave_generator<T> &owg
                 h0tilde[y * (N + 1) + (N - x)] = 0;
                 h0tilde[(N - y) * (N + 1) + x] = 0;
                 h0tilde[(N - y) * (N + 1) + (N - x)] = 0;
+                gauss[y * (N + 1) + x] = 0;
+                gauss[y * (N + 1) + (N - x)] = 0;
+                gauss[(N - y) * (N + 1) + x] = 0;
+                gauss[(N - y) * (N + 1) + (N - x)] = 0;
             }
         }
     } else {
@@ -297,10 +432,11 @@ ocean_wave_generator<T>::ocean_wave_generator(const ocean_wave_generator<T> &owg
         for (int y = N / 2 + 1 - clearlowfreq; y <= N / 2 - 1 + clearlowfreq; ++y) {
             for (int x = N / 2 + 1 - clearlowfreq; x <= N / 2 - 1 + clearlowfreq; ++x) {
                 h0tilde[y * (N + 1) + x] = 0;
+                gauss[y * (N + 1) + x] = 0;
             }
         }
     }
-    htilde.resize(N * (N / 2 + 1));
+    compute_tables();
     allocmem();
     plan = FFT_CREATE_PLAN(N, N, fft_in, fft_out, 0);
     plan2 = FFT_CREATE_PLAN(N, N, fft_in2, fft_out2, 0);
@@ -320,17 +456,9 @@ void ocean_wave_generator<T>::set_time(T time) {
 
 template <class T>
 void ocean_wave_generator<T>::compute_heights(std::vector<T> &waveheights) const {
-    // this loop is a bit overhead, we could store htilde already in a fft_complex array
-    // then we must transpose it, fftw has x*(N/2+1)+y, we use y*N+x
+    // this copy is a bit overhead, we could store htilde already in a fft_complex array
     // this overhead shouldn't matter.
-    for (int y = 0; y <= N / 2; ++y) {
-        for (int x = 0; x < N; ++x) {
-            const std::complex<T> &c = htilde[y * N + x];
-            int ptr = x * (N / 2 + 1) + y;
-            fft_in[ptr][0] = c.real();
-            fft_in[ptr][1] = c.imag();
-        }
-    }
+    copy_to_fft_input(htilde_re, htilde_im, fft_in);
 
     FFT_EXECUTE_PLAN(plan);
 
@@ -377,18 +505,9 @@ void ocean_wave_generator<T>::compute_finite_normals(const std::vector<T> &heigh
 
 template <class T>
 void ocean_wave_generator<T>::compute_normals(std::vector<vector3t<T>> &wavenormals) const {
-    const T pi2 = T(2.0) * T(M_PI);
-    for (int y = 0; y <= N / 2; ++y) {
-        for (int x = 0; x < N; ++x) {
-            const std::complex<T> &c = htilde[y * N + x];
-            vector2t<T> K(pi2 * (x - N / 2) / Lm, pi2 * (y - N / 2) / Lm);
-            int ptr = x * (N / 2 + 1) + y;
-            fft_in[ptr][0] = -c.imag() * K.x;
-            fft_in[ptr][1] = c.real() * K.x;
-            fft_in2[ptr][0] = -c.imag() * K.y;
-            fft_in2[ptr][1] = c.real() * K.y;
-        }
-    }
+    multiply_ik(normal_kx, normal_ky);
+    copy_to_fft_input(grad_x_re, grad_x_im, fft_in);
+    copy_to_fft_input(grad_y_re, grad_y_im, fft_in2);
 
     FFT_EXECUTE_PLAN(plan);
     FFT_EXECUTE_PLAN(plan2);
@@ -409,23 +528,9 @@ void ocean_wave_generator<T>::compute_normals(std::vector<vector3t<T>> &wavenorm
 template <class T>
 void ocean_wave_generator<T>::compute_displacements(const T &scalefac,
                                                     std::vector<vector2t<T>> &wavedisplacements) const {
-    for (int y = 0; y <= N / 2; ++y) {
-        for (int x = 0; x < N; ++x) {
-            const std::complex<T> &c = htilde[y * N + x];
-            vector2t<T> K((x - N / 2), (y - N / 2)); // the factor 2*PI/Lm gets divided out later, so we don't need to multiply it.
-            T k = K.length();
-            vector2t<T> Kh;
-            if (k != 0)
-                Kh = K * (T(1) / k);
-            else
-                Kh.x = Kh.y = T(0);
-            int ptr = x * (N / 2 + 1) + y;
-            fft_in[ptr][0] = c.imag() * Kh.x;
-            fft_in[ptr][1] = -c.real() * Kh.x;
-            fft_in2[ptr][0] = c.imag() * Kh.y;
-            fft_in2[ptr][1] = -c.real() * Kh.y;
-        }
-    }
+    multiply_ik(disp_kx, disp_ky);
+    copy_to_fft_input(grad_x_re, grad_x_im, fft_in);
+    copy_to_fft_input(grad_y_re, grad_y_im, fft_in2);
 
     FFT_EXECUTE_PLAN(plan);
     FFT_EXECUTE_PLAN(plan2);
@@ -0,0 +1,407 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// SIMD kernels for the ocean wave generator
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "ocean_wave_kernels.h"
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define OCEAN_WAVE_X86
+#if defined(__GNUC__) || defined(__clang__)
+#define OCEAN_WAVE_TARGET_SSE2 __attribute__((target("sse2")))
+#define OCEAN_WAVE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+// without fma, so the compiler can't contract multiply and add
+#define OCEAN_WAVE_TARGET_AVX2_NOFMA __attribute__((target("avx2")))
+#else
+#define OCEAN_WAVE_TARGET_SSE2
+#define OCEAN_WAVE_TARGET_AVX2
+#define OCEAN_WAVE_TARGET_AVX2_NOFMA
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace ocean_wave_kernels {
+
+// constants of the cephes sinf/cosf polynomials, valid for |x| < 8192
+static const float four_over_pi = 1.27323954473516f;
+static const float dp1 = -0.78515625f;
+static const float dp2 = -2.4187564849853515625e-4f;
+static const float dp3 = -3.77489497744594108e-8f;
+static const float sin_p0 = -1.9515295891e-4f;
+static const float sin_p1 = 8.3321608736e-3f;
+static const float sin_p2 = -1.6666654611e-1f;
+static const float cos_p0 = 2.443315711809948e-5f;
+static const float cos_p1 = -1.388731625493765e-3f;
+static const float cos_p2 = 4.166664568298827e-2f;
+
+const char *get_name(path p) {
+    switch (p) {
+    case scalar:
+        return "scalar";
+    case sse2:
+        return "sse2";
+    case avx2:
+        return "avx2";
+    default:
+        return "unknown";
+    }
+}
+
+bool is_supported(path p) {
+    switch (p) {
+    case scalar:
+        return true;
+#ifdef OCEAN_WAVE_X86
+#if defined(__GNUC__) || defined(__clang__)
+    case sse2:
+        return __builtin_cpu_supports("sse2");
+    case avx2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(_MSC_VER)
+    case sse2:
+    case avx2: {
+        int info[4];
+        __cpuid(info, 1);
+        bool has_sse2 = (info[3] & (1 << 26)) != 0;
+        bool has_fma = (info[2] & (1 << 12)) != 0;
+        bool has_osxsave = (info[2] & (1 << 27)) != 0;
+        if (p == sse2)
+            return has_sse2;
+        if (!has_fma || !has_osxsave || (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }
+#endif
+#endif
+    default:
+        return false;
+    }
+}
+
+path get_best_path() {
+    static const path best = is_supported(avx2) ? avx2 : (is_supported(sse2) ? sse2 : scalar);
+    return best;
+}
+
+// ------------------------------- scalar ---------------------------------
+
+static void evolve_scalar(unsigned i, unsigned n, const float *h0_re, const float *h0_im,
+                          const float *hm_re, const float *hm_im, const float *omega, float t,
+                          float *out_re, float *out_im) {
+    for (; i < n; ++i) {
+        float xp = omega[i] * t;
+        float c = std::cos(xp);
+        float s = std::sin(xp);
+        out_re[i] = (h0_re[i] * c - h0_im[i] * s) + (hm_re[i] * c + hm_im[i] * s);
+        out_im[i] = (h0_re[i] * s + h0_im[i] * c) + (hm_im[i] * c - hm_re[i] * s);
+    }
+}
+
+static void multiply_ik_scalar(unsigned i, unsigned n, const float *re, const float *im, const float *kx, const float *ky,
+                               float *x_re, float *x_im, float *y_re, float *y_im) {
+    for (; i < n; ++i) {
+        x_re[i] = -im[i] * kx[i];
+        x_im[i] = re[i] * kx[i];
+        y_re[i] = -im[i] * ky[i];
+        y_im[i] = re[i] * ky[i];
+    }
+}
+
+static void sample_heights_scalar(unsigned i, unsigned n, const float *x, const float *y, const float *data,
+                                  unsigned stride, unsigned res_shift, float *out) {
+    const int mask = (1 << res_shift) - 1;
+    for (; i < n; ++i) {
+        float fx = std::floor(x[i]);
+        float fy = std::floor(y[i]);
+        float fracx = x[i] - fx;
+        float fracy = y[i] - fy;
+        int ix = int(fx) & mask;
+        int iy = int(fy) & mask;
+        int ix2 = (ix + 1) & mask;
+        int iy2 = (iy + 1) & mask;
+        float a = data[unsigned(ix + (iy << res_shift)) * stride];
+        float b = data[unsigned(ix2 + (iy << res_shift)) * stride];
+        float c = data[unsigned(ix + (iy2 << res_shift)) * stride];
+        float d = data[unsigned(ix2 + (iy2 << res_shift)) * stride];
+        float e = a * (1.0f - fracx) + b * fracx;
+        float f = c * (1.0f - fracx) + d * fracx;
+        out[i] = (1.0f - fracy) * e + fracy * f;
+    }
+}
+
+#ifdef OCEAN_WAVE_X86
+// ------------------------------- sse2 -----------------------------------
+
+OCEAN_WAVE_TARGET_SSE2 static inline void sincos_sse2(__m128 x, __m128 &s, __m128 &c) {
+    const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(int(0x80000000)));
+    __m128 sign_sin = _mm_and_ps(x, sign_mask);
+    x = _mm_andnot_ps(sign_mask, x);
+    // octant, rounded up to even
+    __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(four_over_pi)));
+    j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    __m128 y = _mm_cvtepi32_ps(j);
+    // extended precision modular arithmetic
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(dp1)));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(dp2)));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(dp3)));
+    __m128 z = _mm_mul_ps(x, x);
+    __m128 pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(cos_p0), z), _mm_set1_ps(cos_p1));
+    pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(cos_p2));
+    pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+    pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+    __m128 ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(sin_p0), z), _mm_set1_ps(sin_p1));
+    ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(sin_p2));
+    ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), x), x);
+    // select polynomials and signs by octant
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+    __m128 rs = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+    __m128 rc = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+    sign_sin = _mm_xor_ps(sign_sin, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+    __m128 sign_cos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+    s = _mm_xor_ps(rs, sign_sin);
+    c = _mm_xor_ps(rc, sign_cos);
+}
+
+OCEAN_WAVE_TARGET_SSE2 static void evolve_sse2(unsigned n, const float *h0_re, const float *h0_im,
+                                               const float *hm_re, const float *hm_im, const float *omega, float t,
+                                               float *out_re, float *out_im) {
+    unsigned i = 0;
+    const __m128 tt = _mm_set1_ps(t);
+    for (; i + 4 <= n; i += 4) {
+        __m128 s, c;
+        sincos_sse2(_mm_mul_ps(_mm_loadu_ps(omega + i), tt), s, c);
+        __m128 ar = _mm_loadu_ps(h0_re + i), ai = _mm_loadu_ps(h0_im + i);
+        __m128 br = _mm_loadu_ps(hm_re + i), bi = _mm_loadu_ps(hm_im + i);
+        __m128 r = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(ar, c), _mm_mul_ps(ai, s)),
+                              _mm_add_ps(_mm_mul_ps(br, c), _mm_mul_ps(bi, s)));
+        __m128 m = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ar, s), _mm_mul_ps(ai, c)),
+                              _mm_sub_ps(_mm_mul_ps(bi, c), _mm_mul_ps(br, s)));
+        _mm_storeu_ps(out_re + i, r);
+        _mm_storeu_ps(out_im + i, m);
+    }
+    evolve_scalar(i, n, h0_re, h0_im, hm_re, hm_im, omega, t, out_re, out_im);
+}
+
+OCEAN_WAVE_TARGET_SSE2 static void multiply_ik_sse2(unsigned n, const float *re, const float *im, const float *kx, const float *ky,
+                                                    float *x_re, float *x_im, float *y_re, float *y_im) {
+    unsigned i = 0;
+    const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(int(0x80000000)));
+    for (; i + 4 <= n; i += 4) {
+        __m128 r = _mm_loadu_ps(re + i), mi = _mm_xor_ps(_mm_loadu_ps(im + i), sign_mask);
+        __m128 a = _mm_loadu_ps(kx + i), b = _mm_loadu_ps(ky + i);
+        _mm_storeu_ps(x_re + i, _mm_mul_ps(mi, a));
+        _mm_storeu_ps(x_im + i, _mm_mul_ps(r, a));
+        _mm_storeu_ps(y_re + i, _mm_mul_ps(mi, b));
+        _mm_storeu_ps(y_im + i, _mm_mul_ps(r, b));
+    }
+    multiply_ik_scalar(i, n, re, im, kx, ky, x_re, x_im, y_re, y_im);
+}
+
+// ------------------------------- avx2 -----------------------------------
+
+OCEAN_WAVE_TARGET_AVX2 static inline void sincos_avx2(__m256 x, __m256 &s, __m256 &c) {
+    const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(int(0x80000000)));
+    __m256 sign_sin = _mm256_and_ps(x, sign_mask);
+    x = _mm256_andnot_ps(sign_mask, x);
+    __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(four_over_pi)));
+    j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+    __m256 y = _mm256_cvtepi32_ps(j);
+    x = _mm256_fmadd_ps(y, _mm256_set1_ps(dp1), x);
+    x = _mm256_fmadd_ps(y, _mm256_set1_ps(dp2), x);
+    x = _mm256_fmadd_ps(y, _mm256_set1_ps(dp3), x);
+    __m256 z = _mm256_mul_ps(x, x);
+    __m256 pc = _mm256_fmadd_ps(_mm256_set1_ps(cos_p0), z, _mm256_set1_ps(cos_p1));
+    pc = _mm256_fmadd_ps(pc, z, _mm256_set1_ps(cos_p2));
+    pc = _mm256_mul_ps(_mm256_mul_ps(pc, z), z);
+    pc = _mm256_add_ps(_mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), pc), _mm256_set1_ps(1.0f));
+    __m256 ps = _mm256_fmadd_ps(_mm256_set1_ps(sin_p0), z, _mm256_set1_ps(sin_p1));
+    ps = _mm256_fmadd_ps(ps, z, _mm256_set1_ps(sin_p2));
+    ps = _mm256_fmadd_ps(_mm256_mul_ps(ps, z), x, x);
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(2)));
+    __m256 rs = _mm256_blendv_ps(ps, pc, swap);
+    __m256 rc = _mm256_blendv_ps(pc, ps, swap);
+    sign_sin = _mm256_xor_ps(sign_sin, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29)));
+    __m256 sign_cos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+    s = _mm256_xor_ps(rs, sign_sin);
+    c = _mm256_xor_ps(rc, sign_cos);
+}
+
+OCEAN_WAVE_TARGET_AVX2 static void evolve_avx2(unsigned n, const float *h0_re, const float *h0_im,
+                                               const float *hm_re, const float *hm_im, const float *omega, float t,
+                                               float *out_re, float *out_im) {
+    unsigned i = 0;
+    const __m256 tt = _mm256_set1_ps(t);
+    for (; i + 8 <= n; i += 8) {
+        __m256 s, c;
+        sincos_avx2(_mm256_mul_ps(_mm256_loadu_ps(omega + i), tt), s, c);
+        __m256 ar = _mm256_loadu_ps(h0_re + i), ai = _mm256_loadu_ps(h0_im + i);
+        __m256 br = _mm256_loadu_ps(hm_re + i), bi = _mm256_loadu_ps(hm_im + i);
+        __m256 r = _mm256_add_ps(_mm256_fmsub_ps(ar, c, _mm256_mul_ps(ai, s)),
+                                 _mm256_fmadd_ps(br, c, _mm256_mul_ps(bi, s)));
+        __m256 m = _mm256_add_ps(_mm256_fmadd_ps(ar, s, _mm256_mul_ps(ai, c)),
+                                 _mm256_fmsub_ps(bi, c, _mm256_mul_ps(br, s)));
+        _mm256_storeu_ps(out_re + i, r);
+        _mm256_storeu_ps(out_im + i, m);
+    }
+    evolve_scalar(i, n, h0_re, h0_im, hm_re, hm_im, omega, t, out_re, out_im);
+}
+
+OCEAN_WAVE_TARGET_AVX2 static void multiply_ik_avx2(unsigned n, const float *re, const float *im, const float *kx, const float *ky,
+                                                    float *x_re, float *x_im, float *y_re, float *y_im) {
+    unsigned i = 0;
+    const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(int(0x80000000)));
+    for (; i + 8 <= n; i += 8) {
+        __m256 r = _mm256_loadu_ps(re + i), mi = _mm256_xor_ps(_mm256_loadu_ps(im + i), sign_mask);
+        __m256 a = _mm256_loadu_ps(kx + i), b = _mm256_loadu_ps(ky + i);
+        _mm256_storeu_ps(x_re + i, _mm256_mul_ps(mi, a));
+        _mm256_storeu_ps(x_im + i, _mm256_mul_ps(r, a));
+        _mm256_storeu_ps(y_re + i, _mm256_mul_ps(mi, b));
+        _mm256_storeu_ps(y_im + i, _mm256_mul_ps(r, b));
+    }
+    multiply_ik_scalar(i, n, re, im, kx, ky, x_re, x_im, y_re, y_im);
+}
+
+OCEAN_WAVE_TARGET_AVX2_NOFMA static void sample_heights_avx2(unsigned n, const float *x, const float *y, const float *data,
+                                                       unsigned stride, unsigned res_shift, float *out) {
+    unsigned i = 0;
+    const __m256i mask = _mm256_set1_epi32((1 << res_shift) - 1);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i vstride = _mm256_set1_epi32(int(stride));
+    const __m128i shift = _mm_cvtsi32_si128(int(res_shift));
+    const __m256 onef = _mm256_set1_ps(1.0f);
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i);
+        __m256 fx = _mm256_floor_ps(vx), fy = _mm256_floor_ps(vy);
+        __m256 fracx = _mm256_sub_ps(vx, fx), fracy = _mm256_sub_ps(vy, fy);
+        __m256i ix = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+        __m256i iy = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+        __m256i ix2 = _mm256_and_si256(_mm256_add_epi32(ix, one), mask);
+        __m256i row = _mm256_sll_epi32(iy, shift);
+        __m256i row2 = _mm256_sll_epi32(_mm256_and_si256(_mm256_add_epi32(iy, one), mask), shift);
+        __m256 a = _mm256_i32gather_ps(data, _mm256_mullo_epi32(_mm256_add_epi32(ix, row), vstride), 4);
+        __m256 b = _mm256_i32gather_ps(data, _mm256_mullo_epi32(_mm256_add_epi32(ix2, row), vstride), 4);
+        __m256 c = _mm256_i32gather_ps(data, _mm256_mullo_epi32(_mm256_add_epi32(ix, row2), vstride), 4);
+        __m256 d = _mm256_i32gather_ps(data, _mm256_mullo_epi32(_mm256_add_epi32(ix2, row2), vstride), 4);
+        __m256 rx = _mm256_sub_ps(onef, fracx);
+        __m256 e = _mm256_add_ps(_mm256_mul_ps(a, rx), _mm256_mul_ps(b, fracx));
+        __m256 f = _mm256_add_ps(_mm256_mul_ps(c, rx), _mm256_mul_ps(d, fracx));
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(onef, fracy), e), _mm256_mul_ps(fracy, f)));
+    }
+    sample_heights_scalar(i, n, x, y, data, stride, res_shift, out);
+}
+#endif
+
+void evolve(path p, unsigned n, const float *h0_re, const float *h0_im,
+            const float *h0mconj_re, const float *h0mconj_im, const float *omega, float t,
+            float *out_re, float *out_im) {
+    switch (p) {
+#ifdef OCEAN_WAVE_X86
+    case sse2:
+        evolve_sse2(n, h0_re, h0_im, h0mconj_re, h0mconj_im, omega, t, out_re, out_im);
+        break;
+    case avx2:
+        evolve_avx2(n, h0_re, h0_im, h0mconj_re, h0mconj_im, omega, t, out_re, out_im);
+        break;
+#endif
+    default:
+        evolve_scalar(0, n, h0_re, h0_im, h0mconj_re, h0mconj_im, omega, t, out_re, out_im);
+    }
+}
+
+void multiply_ik(path p, unsigned n, const float *re, const float *im, const float *kx, const float *ky,
+                 float *x_re, float *x_im, float *y_re, float *y_im) {
+    switch (p) {
+#ifdef OCEAN_WAVE_X86
+    case sse2:
+        multiply_ik_sse2(n, re, im, kx, ky, x_re, x_im, y_re, y_im);
+        break;
+    case avx2:
+        multiply_ik_avx2(n, re, im, kx, ky, x_re, x_im, y_re, y_im);
+        break;
+#endif
+    default:
+        multiply_ik_scalar(0, n, re, im, kx, ky, x_re, x_im, y_re, y_im);
+    }
+}
+
+// normal at a sample from the central differences of the heights around it
+static void wave_normal_at(int x, int y, const float *data, unsigned stride, unsigned res_shift, float *out) {
+    const int mask = (1 << res_shift) - 1;
+    int x1 = (x + mask) & mask;
+    int x2 = (x + 1) & mask;
+    int y1 = (y + mask) & mask;
+    int y2 = (y + 1) & mask;
+    float hdx = data[unsigned(x2 + (y << res_shift)) * stride] - data[unsigned(x1 + (y << res_shift)) * stride];
+    float hdy = data[unsigned(x + (y2 << res_shift)) * stride] - data[unsigned(x + (y1 << res_shift)) * stride];
+    float len = 1.0f / std::sqrt(hdx * hdx + hdy * hdy + 1.0f);
+    out[0] = -hdx * len;
+    out[1] = -hdy * len;
+    out[2] = len;
+}
+
+void sample_normal(float x, float y, const float *data, unsigned stride, unsigned res_shift, double rollfac,
+                   float *out) {
+    const int mask = (1 << res_shift) - 1;
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    float fracx = x - fx;
+    float fracy = y - fy;
+    int ix = int(fx) & mask;
+    int iy = int(fy) & mask;
+    int ix2 = (ix + 1) & mask;
+    int iy2 = (iy + 1) & mask;
+    // interpolate the normals of the four samples around according to fracx/y
+    float a[3], b[3], c[3], d[3], g[3];
+    wave_normal_at(ix, iy, data, stride, res_shift, a);
+    wave_normal_at(ix2, iy, data, stride, res_shift, b);
+    wave_normal_at(ix, iy2, data, stride, res_shift, c);
+    wave_normal_at(ix2, iy2, data, stride, res_shift, d);
+    for (unsigned k = 0; k < 3; ++k) {
+        float e = a[k] * (1.0f - fracx) + b[k] * fracx;
+        float f = c[k] * (1.0f - fracx) + d[k] * fracx;
+        g[k] = e * (1.0f - fracy) + f * fracy;
+    }
+    g[2] *= (1.0f / rollfac);
+    float len = 1.0f / std::sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+    out[0] = g[0] * len;
+    out[1] = g[1] * len;
+    out[2] = g[2] * len;
+}
+
+void sample_heights(path p, unsigned n, const float *x, const float *y, const float *data, unsigned stride,
+                    unsigned res_shift, float *out) {
+    switch (p) {
+#ifdef OCEAN_WAVE_X86
+    case avx2:
+        sample_heights_avx2(n, x, y, data, stride, res_shift, out);
+        break;
+#endif
+    default:
+        sample_heights_scalar(0, n, x, y, data, stride, res_shift, out);
+    }
+}
+
+} // namespace ocean_wave_kernels
@@ -0,0 +1,75 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// SIMD kernels for the ocean wave generator
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef OCEAN_WAVE_KERNELS_H
+#define OCEAN_WAVE_KERNELS_H
+
+/// Kernels for the per frequency work of ocean_wave_generator on float arrays.
+///@note All arrays are structures of arrays. The scalar path is the reference, the
+///	SIMD paths compute sine and cosine with a polynomial, so their results differ
+///	from the scalar path by some float epsilons. The best path supported by the
+///	cpu is selected at runtime. The polynomial is exact enough for |omega*t| < 8192,
+///	which holds since times are taken modulo the wave cycle time.
+namespace ocean_wave_kernels {
+/// implementations of the kernels
+enum path {
+    scalar,
+    sse2,
+    avx2,
+    nr_of_paths
+};
+
+/// get name of path
+const char *get_name(path p);
+
+/// is path supported by this cpu and build?
+bool is_supported(path p);
+
+/// get fastest supported path
+path get_best_path();
+
+/// compute spectrum at time t, out = h0 * e^(i*omega*t) + h0mconj * e^(-i*omega*t)
+void evolve(path p, unsigned n, const float *h0_re, const float *h0_im,
+            const float *h0mconj_re, const float *h0mconj_im, const float *omega, float t,
+            float *out_re, float *out_im);
+
+/// multiply spectrum by i*kx and i*ky, used for displacement and normal spectra
+void multiply_ik(path p, unsigned n, const float *re, const float *im, const float *kx, const float *ky,
+                 float *x_re, float *x_im, float *y_re, float *y_im);
+
+/// bilinear interpolation of heights in a periodic tile of 2^res_shift * 2^res_shift samples.
+///@param x - sample coordinates in units of samples, may lie outside the tile (wrapped), same for y
+///@param data - height of sample i is data[i * stride]
+///@note The AVX2 path uses gathers and the same operations as the scalar path, so
+///	results are identical. The SSE2 path has no gather and uses the scalar code.
+void sample_heights(path p, unsigned n, const float *x, const float *y, const float *data, unsigned stride,
+                    unsigned res_shift, float *out);
+
+/// interpolated normal at sample coordinates x, y of a periodic tile, like sample_heights.
+///@param rollfac - divides z of the normal before normalizing, values > 1 exaggerate the slope
+///@note normals of the four samples around are computed from central differences of
+///	their heights and interpolated bilinearly. Scalar only, out is x, y, z.
+void sample_normal(float x, float y, const float *data, unsigned stride, unsigned res_shift, double rollfac,
+                   float *out);
+} // namespace ocean_wave_kernels
+
+#endif
@@ -22,7 +22,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "ocean_wave_generator.h"
 #include "rnd.h"
+#include <chrono>
+#include <cstring>
 #include <fstream>
+#include <iostream>
 using namespace std;
 typedef unsigned char Uint8;
 
@@ -33,7 +36,61 @@ typedef unsigned char Uint8;
 #define fmax(x, y) (x > y) ? x : y
 #endif
 
+// measure ns per frequency sample for every kernel path
+static int benchmark(unsigned res) {
+    const unsigned runs = 20;
+    ocean_wave_generator<float> owg(res, vector2f(1, 1), 12, 1e-8, 256, 10, 1234);
+    const unsigned n = res * (res / 2 + 1);
+    std::vector<float> h0_re(n), h0_im(n), hm_re(n), hm_im(n), omega(n), kx(n), ky(n), out[4];
+    for (unsigned i = 0; i < n; ++i) {
+        h0_re[i] = rnd() - 0.5f;
+        h0_im[i] = rnd() - 0.5f;
+        hm_re[i] = rnd() - 0.5f;
+        hm_im[i] = rnd() - 0.5f;
+        omega[i] = rnd() * 6.0f;
+        kx[i] = rnd() - 0.5f;
+        ky[i] = rnd() - 0.5f;
+    }
+    for (auto &o : out)
+        o.resize(n);
+    vector<float> heights;
+    vector<vector2f> displacements;
+    cout << "benchmark, resolution " << res << ", " << n << " samples, ns/sample\n";
+    cout << "path\tevolve\tmult_ik\tset_time+heights+displacements\n";
+    for (unsigned p = 0; p < ocean_wave_kernels::nr_of_paths; ++p) {
+        auto path = ocean_wave_kernels::path(p);
+        if (!ocean_wave_kernels::is_supported(path))
+            continue;
+        typedef std::chrono::steady_clock clk;
+        auto ns_per_sample = [&](clk::time_point t0) {
+            return std::chrono::duration<double, std::nano>(clk::now() - t0).count() / (double(runs) * n);
+        };
+        auto t0 = clk::now();
+        for (unsigned r = 0; r < runs; ++r)
+            ocean_wave_kernels::evolve(path, n, h0_re.data(), h0_im.data(), hm_re.data(), hm_im.data(),
+                                       omega.data(), r * 0.5f, out[0].data(), out[1].data());
+        double t_evolve = ns_per_sample(t0);
+        t0 = clk::now();
+        for (unsigned r = 0; r < runs; ++r)
+            ocean_wave_kernels::multiply_ik(path, n, out[0].data(), out[1].data(), kx.data(), ky.data(),
+                                            out[0].data(), out[1].data(), out[2].data(), out[3].data());
+        double t_mult = ns_per_sample(t0);
+        owg.set_kernel_path(path);
+        t0 = clk::now();
+        for (unsigned r = 0; r < runs; ++r) {
+            owg.set_time(r * 0.5f);
+            owg.compute_heights(heights);
+            owg.compute_displacements(-1.0f, displacements);
+        }
+        double t_full = ns_per_sample(t0);
+        cout << ocean_wave_kernels::get_name(path) << "\t" << t_evolve << "\t" << t_mult << "\t" << t_full << "\n";
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+        return benchmark(argc > 2 ? unsigned(atoi(argv[2])) : 256);
     const unsigned resbig = 1024;
     const unsigned ressml = 128;
     seed_global_rnd(1234);
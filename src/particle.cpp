@@ -29,6 +29,19 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "texture.h"
 #include <algorithm>
 
+memory_pool &particle::get_pool() {
+    static memory_pool pool("particle");
+    return pool;
+}
+
+void *particle::operator new(std::size_t size) {
+    return get_pool().allocate(size);
+}
+
+void particle::operator delete(void *p, std::size_t size) {
+    get_pool().deallocate(p, size);
+}
+
 #ifdef WIN32
 
 // more c99 stuff missing from wintel
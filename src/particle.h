@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define PARTICLE_H
 
 #include "color.h"
+#include "memory_pool.h"
 #include "vector3.h"
 #include <memory>
 #include <vector>
@@ -116,6 +117,10 @@ class particle {
     virtual const texture &get_tex_and_col(game &gm, const colorf &light_color, colorf &col) const = 0;
 
     virtual double get_life_time() const = 0;
+    /// objects are allocated from a memory_pool, they are created and deleted often
+    static void *operator new(std::size_t size);
+    static void operator delete(void *p, std::size_t size);
+    static memory_pool &get_pool();
 };
 
 class smoke_particle : public particle {
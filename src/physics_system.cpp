@@ -21,11 +21,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 // subsim (C)+(W) Thorsten Jordan. SEE LICENSE
 
 #include "physics_system.h"
-#include "bv_tree.h"
+#include "flat_bv_tree.h"
 #include "log.h"
 #include "matrix4.h"
 #include "sea_object.h"
 #include "ship.h"
+#include "sweep_and_prune.h"
 #include "vector3.h"
 #include <algorithm>
 
@@ -35,26 +36,43 @@ void physics_system::check_collisions(const std::vector<ship *> &allships) {
     unsigned m = 0; // Note: torpedoes count would need to be passed in or determined differently
 
     // Precompute BV-tree params once per ship (O(N)) instead of O(N^2) - was the main bottleneck
-    std::vector<bv_tree::param> params;
+    std::vector<flat_bv_tree::param> params;
     params.reserve(allships.size());
     for (unsigned k = 0; k < allships.size(); ++k) {
-        params.push_back(allships[k]->compute_bv_tree_params());
+        params.push_back(allships[k]->compute_flat_bv_tree_params());
     }
 
-    // now check for collisions for all ships idx i with partner index > max(m,i)
-    // so we have N^2/2 tests and not N^2.
+    // broad phase: only pairs of ships whose bounding spheres intersect can collide.
+    // The sphere of the bv_tree root encloses the whole model, so this test
+    // never rejects a real collision. Before, every pair was tested with
+    // bv_tree::closest_collision, which dominated the frame for big convoys.
+    std::vector<sphere> spheres(allships.size());
+    for (unsigned k = 0; k < allships.size(); ++k) {
+        spheref s = params[k].get_transformed_sphere();
+        spheres[k] = sphere(allships[k]->get_pos() + vector3(s.center), s.radius);
+    }
+    std::vector<std::pair<unsigned, unsigned>> candidates;
+    unsigned long nr_swept = sweep_and_prune(spheres, candidates);
+
+    // narrow phase: check for collisions for candidate pairs (i, j) with i < j,
+    // in the same order as a test of all pairs would do.
     // we don't check for torpedo<->torpedo collisions.
-    for (unsigned i = 0; i < allships.size(); ++i) {
+    unsigned long nr_tested = 0;
+    for (unsigned c = 0; c < candidates.size(); ++c) {
+        const unsigned i = candidates[c].first;
+        const unsigned j = candidates[c].second;
+        if (j < m)
+            continue;
+        ++nr_tested;
         const vector3 &actor_pos = allships[i]->get_pos();
-        const bv_tree::param &p0 = params[i];
-        for (unsigned j = std::max(i + 1, m); j < allships.size(); ++j) {
-            const vector3 &partner_pos = allships[j]->get_pos();
-            matrix4 rel_trans = matrix4::trans(partner_pos - actor_pos);
-            bv_tree::param p1 = params[j];
-            p1.transform = rel_trans * p1.transform;
+        const flat_bv_tree::param &p0 = params[i];
+        const vector3 &partner_pos = allships[j]->get_pos();
+        matrix4 rel_trans = matrix4::trans(partner_pos - actor_pos);
+        flat_bv_tree::param p1 = params[j];
+        p1.transform = rel_trans * p1.transform;
 #if 0
 			std::list<vector3f> contact_points;
-			bool intersects = bv_tree::collides(p0, p1, contact_points);
+			bool intersects = flat_bv_tree::collides(p0, p1, contact_points);
 			if (intersects) {
 				// compute intersection pos, sum of contact points
 				vector3f sum;
@@ -67,15 +85,24 @@ void physics_system::check_collisions(const std::vector<ship *> &allships) {
 				collision_response(*allships[i], *allships[j], vector3(sum) + actor_pos);
 			}
 #else
-            vector3f contact_point;
-            bool intersects = bv_tree::closest_collision(p0, p1, contact_point);
-            if (intersects) {
-                collision_response(*allships[i], *allships[j], contact_point + actor_pos);
-            }
-#endif
+        vector3f contact_point;
+        bool intersects = flat_bv_tree::closest_collision(p0, p1, contact_point);
+        if (intersects) {
+            collision_response(*allships[i], *allships[j], contact_point + actor_pos);
         }
+#endif
     }
 
+    const unsigned long n = allships.size();
+    last_stats.pairs_total = n * (n - std::min(n, 1UL)) / 2;
+    last_stats.pairs_swept = nr_swept;
+    last_stats.pairs_tested = nr_tested;
+    last_stats.pairs_culled = last_stats.pairs_total - nr_tested;
+    total_stats.pairs_total += last_stats.pairs_total;
+    total_stats.pairs_swept += last_stats.pairs_swept;
+    total_stats.pairs_tested += last_stats.pairs_tested;
+    total_stats.pairs_culled += last_stats.pairs_culled;
+
     // collision response:
     // the two objects collide at a position P that is relative to their center
     // (P(a) and P(b)). We have to compute their velocity (direction and strength,
@@ -32,6 +32,15 @@ class ship;
 /// Manages physics simulation: collision detection and response
 class physics_system {
   public:
+    /// statistics of broad phase collision culling
+    struct collision_statistics {
+        unsigned long pairs_total;  ///< pairs a brute force test would check
+        unsigned long pairs_swept;  ///< pairs whose bounding spheres were compared
+        unsigned long pairs_tested; ///< pairs that needed a narrow phase (bv_tree) test
+        unsigned long pairs_culled; ///< pairs rejected by the broad phase
+        collision_statistics() : pairs_total(0), pairs_swept(0), pairs_tested(0), pairs_culled(0) {}
+    };
+
     physics_system() = default;
     ~physics_system() = default;
 
@@ -48,6 +57,16 @@ class physics_system {
     /// @param b - second colliding object
     /// @param collision_pos - position where collision occurred
     void collision_response(sea_object &a, sea_object &b, const vector3 &collision_pos);
+
+    /// statistics of the last call to check_collisions
+    const collision_statistics &get_last_statistics() const { return last_stats; }
+
+    /// statistics accumulated over all calls to check_collisions
+    const collision_statistics &get_total_statistics() const { return total_stats; }
+
+  protected:
+    collision_statistics last_stats;
+    collision_statistics total_stats;
 };
 
 #endif
@@ -0,0 +1,188 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// profiler - measures time of simulation and rendering stages per frame
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "profiler.h"
+#include "error.h"
+#include "log.h"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+profiler::profiler()
+    : enabled(false), recording(false), nr_of_stages(0), history_pos(0), nr_of_frames(0), time_base(clock::now()),
+      recording_full(false) {
+}
+
+unsigned profiler::get_stage(const std::string &name) {
+    mutex_locker ml(mtx);
+    const unsigned n = nr_of_stages.load();
+    for (unsigned i = 0; i < n; ++i)
+        if (stages[i].name == name)
+            return i;
+    if (n == max_stages)
+        throw error("profiler: too many stages");
+    stages[n].name = name;
+    nr_of_stages.store(n + 1);
+    return n;
+}
+
+unsigned profiler::get_thread_index() {
+    // called with mtx locked
+    std::size_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+    auto it = std::find(thread_ids.begin(), thread_ids.end(), id);
+    if (it != thread_ids.end())
+        return unsigned(it - thread_ids.begin());
+    thread_ids.push_back(id);
+    return unsigned(thread_ids.size() - 1);
+}
+
+void profiler::add_sample(unsigned stage, clock::time_point start, clock::time_point end) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    stages[stage].frame_ns.fetch_add(uint64_t(ns), std::memory_order_relaxed);
+    if (recording.load(std::memory_order_relaxed)) {
+        mutex_locker ml(mtx);
+        if (events.size() >= max_recorded_events) {
+            // recording is stopped at the end of the frame
+            recording_full = true;
+            return;
+        }
+        trace_event te;
+        te.stage = stage;
+        te.thread = get_thread_index();
+        te.start_us = std::chrono::duration<double, std::micro>(start - time_base).count();
+        te.duration_us = ns * 0.001;
+        events.push_back(te);
+    }
+}
+
+void profiler::end_frame() {
+    const unsigned n = nr_of_stages.load();
+    std::vector<float> frame(n);
+    for (unsigned i = 0; i < n; ++i) {
+        frame[i] = float(stages[i].frame_ns.exchange(0, std::memory_order_relaxed) * 1e-6);
+        stages[i].history[history_pos] = frame[i];
+    }
+    history_pos = (history_pos + 1) % history_length;
+    nr_of_frames = std::min(nr_of_frames + 1, history_length);
+    if (recording.load(std::memory_order_relaxed)) {
+        mutex_locker ml(mtx);
+        frames.push_back(frame);
+        if (frames.size() >= max_recorded_frames)
+            recording_full = true;
+        if (recording_full) {
+            log_warning("profiler: recording reached " << frames.size() << " frames and " << events.size()
+                                                       << " scopes, stopping it");
+            stop_recording();
+        }
+    }
+}
+
+double profiler::get_average_ms(unsigned stage) const {
+    if (nr_of_frames == 0)
+        return 0.0;
+    double sum = 0.0;
+    for (float t : stages[stage].history)
+        sum += t;
+    return sum / nr_of_frames;
+}
+
+double profiler::get_max_ms(unsigned stage) const {
+    const auto &h = stages[stage].history;
+    return *std::max_element(h.begin(), h.end());
+}
+
+std::string profiler::get_overlay_text() const {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    const unsigned n = nr_of_stages.load();
+    for (unsigned i = 0; i < n; ++i)
+        oss << stages[i].name << ": " << get_average_ms(i) << " ms (max " << get_max_ms(i) << ")\n";
+    return oss.str();
+}
+
+void profiler::start_recording(const std::string &filename) {
+    mutex_locker ml(mtx);
+    frames.clear();
+    events.clear();
+    recording_file = filename;
+    recording_full = false;
+    recording.store(true);
+}
+
+void profiler::stop_recording() {
+    mutex_locker ml(mtx);
+    recording.store(false);
+    if (recording_file.empty())
+        return;
+    // clear the file name first, so a failed write is not repeated
+    const std::string filename = recording_file;
+    recording_file.clear();
+    // stopping happens at the end of a frame too, a profiler must not end the game
+    try {
+        write_recording(filename);
+    } catch (std::exception &e) {
+        log_warning(e.what());
+    }
+    std::vector<std::vector<float>>().swap(frames);
+    std::vector<trace_event>().swap(events);
+}
+
+void profiler::write_csv(std::ostream &out) const {
+    mutex_locker ml(mtx);
+    const unsigned n = nr_of_stages.load();
+    out << "frame";
+    for (unsigned i = 0; i < n; ++i)
+        out << "," << stages[i].name;
+    out << "\n";
+    for (unsigned f = 0; f < frames.size(); ++f) {
+        out << f;
+        // stages created later have no value in earlier frames
+        for (unsigned i = 0; i < n; ++i)
+            out << "," << (i < frames[f].size() ? frames[f][i] : 0.0f);
+        out << "\n";
+    }
+}
+
+void profiler::write_chrome_trace(std::ostream &out) const {
+    mutex_locker ml(mtx);
+    out << "{\"traceEvents\":[";
+    out << std::fixed << std::setprecision(3);
+    for (unsigned i = 0; i < events.size(); ++i) {
+        const trace_event &te = events[i];
+        out << (i ? ",\n" : "\n") << "{\"name\":\"" << stages[te.stage].name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+            << te.thread << ",\"ts\":" << te.start_us << ",\"dur\":" << te.duration_us << "}";
+    }
+    out << "\n]}\n";
+}
+
+void profiler::write_recording(const std::string &filename) const {
+    std::ofstream out(filename.c_str());
+    if (!out.good())
+        throw error(std::string("profiler: can't write ") + filename);
+    if (filename.size() >= 5 && filename.substr(filename.size() - 5) == ".json")
+        write_chrome_trace(out);
+    else
+        write_csv(out);
+}
@@ -0,0 +1,158 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// profiler - measures time of simulation and rendering stages per frame
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "mutex.h"
+#include "singleton.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/// Collects wall clock time of named stages per frame.
+///@note Stages are measured with profile_scope(name) in the code. When the
+///	profiler is disabled a scope costs one atomic load. Times of a stage are
+///	summed over all threads and calls per frame, end_frame() moves them to a
+///	history for averages. While recording, every frame is kept for CSV output
+///	and every scope for a Chrome trace (chrome://tracing, JSON format), up to
+///	a maximum number of frames and scopes. When it is reached the recording is
+///	stopped at the end of the frame. Stopping writes the recording to its file.
+///	Render stages measure CPU time for issuing commands, not GPU time.
+class profiler : public singleton<class profiler> {
+    friend class singleton<profiler>;
+
+  public:
+    typedef std::chrono::steady_clock clock;
+
+    /// maximum number of different stages
+    static const unsigned max_stages = 64;
+    /// number of frames to average for overlay
+    static const unsigned history_length = 64;
+    /// maximum number of frames in a recording
+    static const unsigned max_recorded_frames = 65536;
+    /// maximum number of scopes in a recording
+    static const unsigned max_recorded_events = 1048576;
+
+    /// get id of stage with that name, creates the stage if needed. Thread safe.
+    unsigned get_stage(const std::string &name);
+    /// get number of stages
+    unsigned get_nr_of_stages() const { return nr_of_stages.load(); }
+    /// get name of stage
+    const std::string &get_stage_name(unsigned stage) const { return stages[stage].name; }
+
+    void set_enabled(bool e) { enabled.store(e, std::memory_order_relaxed); }
+    bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    /// add measured time of a stage, thread safe
+    void add_sample(unsigned stage, clock::time_point start, clock::time_point end);
+
+    /// finish current frame, called once per frame from main thread
+    void end_frame();
+
+    /// average time per frame in milliseconds of a stage over the last frames
+    double get_average_ms(unsigned stage) const;
+    /// maximum time per frame in milliseconds of a stage over the last frames
+    double get_max_ms(unsigned stage) const;
+    /// get lines with average and maximum times of all stages
+    std::string get_overlay_text() const;
+
+    /// start keeping all frames and scopes for output, clears old recording
+    ///@param filename - file the recording is written to when it stops, empty to keep it in memory
+    void start_recording(const std::string &filename = std::string());
+    /// stop keeping frames and scopes, writes them to the file of the recording if it has one.
+    ///@note a failed write is only logged, the recording is dropped then
+    void stop_recording();
+    bool is_recording() const { return recording.load(std::memory_order_relaxed); }
+    /// write recorded frames as CSV, one line per frame, one column per stage in milliseconds
+    void write_csv(std::ostream &out) const;
+    /// write recorded scopes as Chrome trace event JSON
+    void write_chrome_trace(std::ostream &out) const;
+    /// write CSV or Chrome trace to a file, depending on extension .csv or .json
+    void write_recording(const std::string &filename) const;
+
+    /// measures time of a stage between construction and destruction
+    class scope {
+      public:
+        scope(unsigned stage_) : stage(stage_), active(profiler::instance().is_enabled()) {
+            if (active)
+                start = clock::now();
+        }
+        ~scope() {
+            if (active)
+                profiler::instance().add_sample(stage, start, clock::now());
+        }
+
+      protected:
+        unsigned stage;
+        bool active;
+        clock::time_point start;
+
+      private:
+        scope(const scope &) = delete;
+        scope &operator=(const scope &) = delete;
+    };
+
+  protected:
+    profiler();
+
+    struct stage_data {
+        std::string name;
+        std::atomic<uint64_t> frame_ns;       ///< time in current frame
+        std::vector<float> history;           ///< times of last frames in ms, ring buffer
+        stage_data() : frame_ns(0), history(history_length, 0.0f) {}
+    };
+    /// one measured scope for the trace
+    struct trace_event {
+        unsigned stage;
+        unsigned thread;
+        double start_us, duration_us;
+    };
+
+    std::atomic<bool> enabled;
+    std::atomic<bool> recording;
+    std::atomic<unsigned> nr_of_stages;
+    stage_data stages[max_stages];
+    unsigned history_pos;
+    unsigned nr_of_frames;
+    clock::time_point time_base;
+    mutable ::mutex mtx;                     ///< for stage creation and recording
+    std::string recording_file;              ///< where the recording is written to on stop
+    bool recording_full;                     ///< maximum size of recording was reached
+    std::vector<std::vector<float>> frames;  ///< recorded frames, ms per stage
+    std::vector<trace_event> events;         ///< recorded scopes
+    std::vector<std::size_t> thread_ids;     ///< hashes of threads seen in trace
+
+    unsigned get_thread_index();
+};
+
+#define PROFILER_CONCAT2(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT2(a, b)
+/// measure time of the rest of the enclosing block as stage "name"
+#define profile_scope(name)                                                                                   \
+    static const unsigned PROFILER_CONCAT(profile_stage_, __LINE__) = profiler::instance().get_stage(name); \
+    profiler::scope PROFILER_CONCAT(profile_scope_, __LINE__)(PROFILER_CONCAT(profile_stage_, __LINE__))
+
+#endif
@@ -9,6 +9,7 @@ the Free Software Foundation; either version 2 of the License, or
 */
 
 #include "rnd.h"
+#include "mutex.h"
 #include <random>
 
 namespace {
@@ -16,10 +17,35 @@ std::mt19937 &global_rng() {
     static std::mt19937 rng(0u);
     return rng;
 }
+
+// threads without their own stream share the generator
+::mutex &global_rng_mutex() {
+    static ::mutex mtx;
+    return mtx;
+}
+
+thread_local rnd_stream *current_stream = nullptr;
 } // namespace
 
+rnd_stream::rnd_stream(unsigned long long step, unsigned task) : previous(current_stream) {
+    std::seed_seq seq{unsigned(step & 0xffffffffu), unsigned(step >> 32), task};
+    gen.seed(seq);
+    current_stream = this;
+}
+
+rnd_stream::~rnd_stream() {
+    current_stream = previous;
+}
+
+rnd_stream *rnd_stream::current() {
+    return current_stream;
+}
+
 double rnd() {
-    static std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    if (current_stream)
+        return dist(current_stream->generator());
+    mutex_locker ml(global_rng_mutex());
     return dist(global_rng());
 }
 
@@ -27,9 +53,13 @@ unsigned rnd(unsigned b) {
     if (b == 0)
         return 0;
     std::uniform_int_distribution<unsigned> dist(0, b - 1);
+    if (current_stream)
+        return dist(current_stream->generator());
+    mutex_locker ml(global_rng_mutex());
     return dist(global_rng());
 }
 
 void seed_global_rnd(unsigned seed) {
+    mutex_locker ml(global_rng_mutex());
     global_rng().seed(seed);
 }
@@ -11,8 +11,32 @@ the Free Software Foundation; either version 2 of the License, or
 #ifndef RND_H
 #define RND_H
 
+#include <random>
+
 double rnd();
 unsigned rnd(unsigned b);
 void seed_global_rnd(unsigned seed);
 
+///\brief Random number stream of the current thread, rnd() draws from it while it exists.
+///@note Parallel simulation tasks get their own stream seeded from step and task number,
+///	so their numbers don't depend on thread scheduling or the number of threads.
+///	Streams are nested per thread, the destructor restores the previous one.
+class rnd_stream {
+  public:
+    rnd_stream(unsigned long long step, unsigned task);
+    ~rnd_stream();
+
+    std::mt19937 &generator() { return gen; }
+
+    /// stream of the calling thread or nullptr if there is none
+    static rnd_stream *current();
+
+  private:
+    std::mt19937 gen;
+    rnd_stream *previous;
+
+    rnd_stream(const rnd_stream &) = delete;
+    rnd_stream &operator=(const rnd_stream &) = delete;
+};
+
 #endif
@@ -26,6 +26,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "game.h"
 #include "global_constants.h"
 #include "global_data.h"
+#include "kinematic_store.h"
 #include "log.h"
 #include "model.h"
 #include "sensors.h"
@@ -36,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "xml.h"
 using std::list;
 using std::string;
+using std::vector;
 
 void sea_object::degrees2meters(bool west, unsigned degx, unsigned minx, bool south,
                                 unsigned degy, unsigned miny, double &x, double &y) {
@@ -165,10 +167,15 @@ double sea_object::get_cross_section(const vector2 &d) const {
 }
 
 string sea_object::compute_skin_name() const {
-    for (list<skin_variant>::const_iterator it = skin_variants.begin();
-         it != skin_variants.end(); ++it) {
+    return compute_skin_name(skin_variants, skin_regioncode, skin_country, skin_date);
+}
+
+string sea_object::compute_skin_name(const list<skin_variant> &variants, const string &regioncode, countrycode ctry,
+                                     const date &d) {
+    for (list<skin_variant>::const_iterator it = variants.begin();
+         it != variants.end(); ++it) {
         // check date
-        if (skin_date < it->from || skin_date > it->until) {
+        if (d < it->from || d > it->until) {
             continue;
         }
         // iterate over regioncodes
@@ -177,7 +184,7 @@ string sea_object::compute_skin_name() const {
             bool match = false;
             for (list<string>::const_iterator it2 = it->regions.begin();
                  it2 != it->regions.end(); ++it2) {
-                if (skin_regioncode == *it2) {
+                if (regioncode == *it2) {
                     match = true;
                     break;
                 }
@@ -192,7 +199,7 @@ string sea_object::compute_skin_name() const {
             bool match = false;
             for (list<string>::const_iterator it2 = it->countries.begin();
                  it2 != it->countries.end(); ++it2) {
-                if (*it2 == string(countrycodes[skin_country])) {
+                if (*it2 == string(countrycodes[ctry])) {
                     match = true;
                     break;
                 }
@@ -207,38 +214,98 @@ string sea_object::compute_skin_name() const {
     return model::default_layout;
 }
 
-void sea_object::set_random_skin_name(const date &d) {
-    unsigned nr_possible = 0;
-    for (list<skin_variant>::const_iterator it = skin_variants.begin();
-         it != skin_variants.end(); ++it) {
+vector<string> sea_object::valid_skin_names(const list<skin_variant> &variants, const date &d) {
+    vector<string> result;
+    for (list<skin_variant>::const_iterator it = variants.begin(); it != variants.end(); ++it) {
         if (d >= it->from && d <= it->until)
-            ++nr_possible;
+            result.push_back(it->name);
+    }
+    return result;
+}
+
+void sea_object::set_random_skin_name(const date &d) {
+    vector<string> names = valid_skin_names(skin_variants, d);
+    if (names.empty()) {
+        // can't set anything, shouldn't happen
+        log_debug("Could not chose valid skin, using default");
+        set_skin_layout(model::default_layout);
+        return;
     }
-    if (nr_possible == 0) {
-        log_debug("Could not chose valid skin, using anyone");
-        nr_possible = skin_variants.size();
-        if (nr_possible == 0) {
-            set_skin_layout(model::default_layout);
-            return; // can't set anything, shouldn't happen
+    const string &name = names[rnd(unsigned(names.size()))];
+    skin_date = d;
+    skin_regioncode = "NN";
+    skin_country = UNKNOWNCOUNTRY;
+    log_debug("using skin name " << name << " as random skin");
+    set_skin_layout(name);
+}
+
+string sea_object::get_skin_layout(const xml_elem &spec, const xml_elem &parent) {
+    string regioncode;
+    countrycode ctry;
+    date d;
+    read_skin_selection(parent, regioncode, ctry, d);
+    return compute_skin_name(read_skin_variants(spec.child("classification")), regioncode, ctry, d);
+}
+
+vector<string> sea_object::get_random_skin_layouts(const xml_elem &spec, const date &d) {
+    vector<string> names = valid_skin_names(read_skin_variants(spec.child("classification")), d);
+    if (names.empty())
+        names.push_back(model::default_layout);
+    return names;
+}
+
+list<sea_object::skin_variant> sea_object::read_skin_variants(const xml_elem &cl) {
+    list<skin_variant> result;
+    for (xml_elem::iterator it = cl.iterate("skin"); !it.end(); it.next()) {
+        skin_variant sv;
+        sv.name = it.elem().attr("name");
+        if (it.elem().has_attr("regions")) {
+            // empty list means all/any...
+            sv.regions = string_split(it.elem().attr("regions"));
+        }
+        if (it.elem().has_attr("countries")) {
+            // empty list means all/any...
+            sv.countries = string_split(it.elem().attr("countries"));
+        }
+        if (it.elem().has_attr("from")) {
+            sv.from = date(it.elem().attr("from"));
+        } else {
+            sv.from = date(1939, 1, 1);
+        }
+        if (it.elem().has_attr("until")) {
+            sv.until = date(it.elem().attr("until"));
+        } else {
+            sv.until = date(1945, 12, 31);
         }
+        result.push_back(sv);
+        // 		cout << "read skin variant: " << sv.name << " ctr=" << sv.countries
+        // 		     << " rgn=" << sv.regions << " from=" << sv.from << " until=" << sv.until
+        // 		     << "\n";
     }
-    unsigned chosen = rnd(nr_possible);
-    for (list<skin_variant>::const_iterator it = skin_variants.begin();
-         it != skin_variants.end(); ++it) {
-        if (d >= it->from && d <= it->until) {
-            if (chosen == 0) {
-                skin_date = d;
-                skin_regioncode = "NN";
-                skin_country = UNKNOWNCOUNTRY;
-                log_debug("using skin name " << it->name << " as random skin");
-                set_skin_layout(it->name);
-                return;
+    return result;
+}
+
+void sea_object::read_skin_selection(const xml_elem &parent, string &regioncode, countrycode &ctry, date &d) {
+    if (parent.has_child("skin")) {
+        // read attributes
+        xml_elem sk = parent.child("skin");
+        regioncode = sk.attr("region");
+        std::string sc = sk.attr("country");
+        ctry = UNKNOWNCOUNTRY;
+        for (int i = UNKNOWNCOUNTRY; i < NR_OF_COUNTRIES; ++i) {
+            //			cout << "load cmp ctr '" << sc << "' '" << string(countrycodes[i]) << "'\n";
+            if (sc == string(countrycodes[i])) {
+                ctry = countrycode(i);
+                break;
             }
-            --chosen;
         }
+        d = date(sk.attr("date"));
+    } else {
+        // set default skin values
+        regioncode = "NA"; // north atlantic
+        ctry = UNKNOWNCOUNTRY;
+        d = date(1941, 1, 1);
     }
-    // set default layout if everything else fails
-    set_skin_layout(model::default_layout);
 }
 
 void sea_object::set_skin_layout(const std::string &layout) {
@@ -266,7 +333,7 @@ sea_object::sea_object(game &gm_, const string &modelname_)
       sensors(last_sensor_system),
       target(0),
       invulnerable(false), country(UNKNOWNCOUNTRY), party(UNKNOWNPARTY),
-      redetect_time(0) {
+      redetect_time(0), previous_state_valid(false), kinematics(nullptr), kinematics_index(0) {
     // no specfile, so specfilename is empty, do not call get_rel_path with empty string!
     mymodel.load(modelcache(), /*data_file().get_rel_path(specfilename) + */ modelname);
     if (!mymodel->get_base_mesh().has_bv_tree()) {
@@ -302,38 +369,13 @@ sea_object::sea_object(game &gm_, const xml_elem &parent)
       sensors(last_sensor_system),
       target(0),
       invulnerable(false), country(UNKNOWNCOUNTRY), party(UNKNOWNPARTY),
-      redetect_time(0) {
+      redetect_time(0), previous_state_valid(false), kinematics(nullptr), kinematics_index(0) {
     xml_elem cl = parent.child("classification");
     specfilename = cl.attr("identifier");
     modelname = cl.attr("modelname");
 
     // read skin data
-    for (xml_elem::iterator it = cl.iterate("skin"); !it.end(); it.next()) {
-        skin_variant sv;
-        sv.name = it.elem().attr("name");
-        if (it.elem().has_attr("regions")) {
-            // empty list means all/any...
-            sv.regions = string_split(it.elem().attr("regions"));
-        }
-        if (it.elem().has_attr("countries")) {
-            // empty list means all/any...
-            sv.countries = string_split(it.elem().attr("countries"));
-        }
-        if (it.elem().has_attr("from")) {
-            sv.from = date(it.elem().attr("from"));
-        } else {
-            sv.from = date(1939, 1, 1);
-        }
-        if (it.elem().has_attr("until")) {
-            sv.until = date(it.elem().attr("until"));
-        } else {
-            sv.until = date(1945, 12, 31);
-        }
-        skin_variants.push_back(sv);
-        // 		cout << "read skin variant: " << sv.name << " ctr=" << sv.countries
-        // 		     << " rgn=" << sv.regions << " from=" << sv.from << " until=" << sv.until
-        // 		     << "\n";
-    }
+    skin_variants = read_skin_variants(cl);
 
     mymodel.load(modelcache(), data_file().get_rel_path(specfilename) + modelname);
     if (!mymodel->get_base_mesh().has_bv_tree()) {
@@ -433,31 +475,13 @@ void sea_object::load(const xml_elem &parent) {
     xml_elem st = parent.child("state");
     position = st.child("position").attrv3();
     orientation = st.child("orientation").attrq();
+    previous_state_valid = false;
     linear_momentum = st.child("linear_momentum").attrv3();
     angular_momentum = st.child("angular_momentum").attrv3();
     compute_helper_values();
 
     // read skin info
-    if (parent.has_child("skin")) {
-        // read attributes
-        xml_elem sk = parent.child("skin");
-        skin_regioncode = sk.attr("region");
-        std::string sc = sk.attr("country");
-        skin_country = UNKNOWNCOUNTRY;
-        for (int i = UNKNOWNCOUNTRY; i < NR_OF_COUNTRIES; ++i) {
-            //			cout << "load cmp ctr '" << sc << "' '" << string(countrycodes[i]) << "'\n";
-            if (sc == string(countrycodes[i])) {
-                skin_country = countrycode(i);
-                break;
-            }
-        }
-        skin_date = date(sk.attr("date"));
-    } else {
-        // set default skin values
-        skin_regioncode = "NA"; // north atlantic
-        skin_country = UNKNOWNCOUNTRY;
-        skin_date = date(1941, 1, 1);
-    }
+    read_skin_selection(parent, skin_regioncode, skin_country, skin_date);
     skin_name = compute_skin_name();
     // register new skin name. Note! if skin_name was already set and registered,
     // the old one is not unregistered. But we don't use sea_object in that way.
@@ -503,23 +527,28 @@ string sea_object::get_description(unsigned detail) const {
         return descr_near;
 }
 
-void sea_object::simulate(double delta_time) {
+bool sea_object::simulate(double delta_time) {
+    // remember state for interpolation in rendering
+    previous_position = position;
+    previous_orientation = orientation;
+    previous_state_valid = true;
+
     // check and change states
     if (alive_stat == defunct) {
-        // with that trick we do not need to handle this situation in every heir of sea_object.
-        throw is_dead_exception();
+        // heirs return when we return false, so they need not handle this situation.
+        return false;
     } else if (alive_stat == dead2) {
         // change state to defunct.
         alive_stat = defunct;
-        throw is_dead_exception();
+        return false;
     } else if (alive_stat == dead) {
         // change state to dead2.
         alive_stat = dead2;
-        throw is_dead_exception();
+        return false;
     }
 
     // check target. heirs should check for "out of range" condition too
-    if (target && !target->is_alive())
+    if (target && !target->is_step_alive())
         target = 0;
 
     // check if list of detected objects needs to be compressed.
@@ -613,6 +642,7 @@ void sea_object::simulate(double delta_time) {
 
     // update helper variables
     compute_helper_values();
+    sync_kinematic_state();
 
     // OLD COMMENT, BUT STILL HELPFUL:
     // this leads to another model for acceleration/max_speed/turning etc.
@@ -659,6 +689,7 @@ void sea_object::simulate(double delta_time) {
     // in reality applied force is transformed by inertia tensor, which is rotated according to
     // orientation. we don't use mass here, so apply rotation to stored velocity/acceleration.
     // fixme: use orientation here and compute heading from it, not vice versa!
+    return true;
 }
 
 bool sea_object::damage(const vector3 &fromwhere, unsigned strength) {
@@ -697,6 +728,71 @@ float sea_object::surface_visibility(const vector2 &watcher) const {
 
 void sea_object::manipulate_position(const vector3 &newpos) {
     position = newpos;
+    // don't interpolate the jump
+    previous_state_valid = false;
+    store_kinematic_state();
+}
+
+void sea_object::set_kinematic_entry(kinematic_store *store, unsigned idx) {
+    kinematics = store;
+    kinematics_index = idx;
+    store_kinematic_state();
+}
+
+void sea_object::store_kinematic_state() const {
+    if (kinematics)
+        kinematics->set(kinematics_index, position, velocity, orientation, heading, uint8_t(alive_stat));
+}
+
+void sea_object::sync_kinematic_state() const {
+    if (kinematics)
+        kinematics->set_current(kinematics_index, position, velocity, orientation, heading, uint8_t(alive_stat));
+}
+
+vector3 sea_object::get_step_pos() const {
+    return kinematics ? kinematics->get_pos(kinematics_index) : position;
+}
+
+vector3 sea_object::get_step_velocity() const {
+    return kinematics ? kinematics->get_velocity(kinematics_index) : velocity;
+}
+
+quaternion sea_object::get_step_orientation() const {
+    return kinematics ? kinematics->get_orientation(kinematics_index) : orientation;
+}
+
+angle sea_object::get_step_heading() const {
+    return kinematics ? kinematics->get_heading(kinematics_index) : heading;
+}
+
+double sea_object::get_step_speed() const {
+    // see compute_helper_values
+    return get_step_orientation().conj().rotate(get_step_velocity()).y;
+}
+
+vector2 sea_object::get_step_engine_noise_source() const {
+    return get_step_pos().xy() - get_step_heading().direction() * 0.3f * get_length();
+}
+
+sea_object::alive_status sea_object::get_step_alive_status() const {
+    return kinematics ? alive_status(kinematics->get_state(kinematics_index)) : alive_stat;
+}
+
+vector3 sea_object::get_render_pos(double alpha) const {
+    if (!previous_state_valid)
+        return position;
+    return previous_position + (position - previous_position) * alpha;
+}
+
+quaternion sea_object::get_render_orientation(double alpha) const {
+    if (!previous_state_valid)
+        return orientation;
+    // normalized linear interpolation, good enough for the small rotation of one step.
+    // q and -q are the same rotation, so take the nearer one.
+    quaternion q0 = previous_orientation;
+    if (q0.s * orientation.s + q0.v * orientation.v < 0)
+        q0 = q0 * -1.0;
+    return (q0 * (1.0 - alpha) + orientation * alpha).normal();
 }
 
 void sea_object::manipulate_speed(double localforwardspeed) {
@@ -707,8 +803,10 @@ void sea_object::manipulate_speed(double localforwardspeed) {
 
 void sea_object::manipulate_heading(angle hdg) {
     orientation = quaternion::rot(-hdg.value(), 0, 0, 1);
+    previous_state_valid = false;
     linear_momentum = orientation.rotate(local_velocity) * mass;
     compute_helper_values();
+    store_kinematic_state();
 }
 
 // fixme: should move to ship or maybe return pos. airplanes have engines, but not
@@ -717,6 +815,17 @@ vector2 sea_object::get_engine_noise_source() const {
     return get_pos().xy() - get_heading().direction() * 0.3f * get_length();
 }
 
+void sea_object::get_sensor_target(sensor_target &st) const {
+    st = sensor_target();
+    st.pos = get_pos();
+    st.heading = get_heading();
+    st.noise_source = get_engine_noise_source();
+    st.noise_factor = get_noise_factor();
+    st.depth_factor = gm.get_depth_factor(get_pos());
+    if (mymodel)
+        st.cross_sections = &mymodel->get_cross_sections();
+}
+
 void sea_object::display(const texture *caustic_map) const {
     if (mymodel) {
         //		cout << "render with skin layout = " << skin_name << "\n";
@@ -751,7 +860,7 @@ void sea_object::compress(std::vector<sea_object *> &vec) {
     // this algorithm keeps the order of objects.
     unsigned j = 0;
     for (unsigned i = 0; i < vec.size(); ++i) {
-        if (vec[i]->is_reference_ok()) {
+        if (vec[i]->is_step_reference_ok()) {
             sea_object *tmp = vec[i];
             vec[i] = 0;
             vec[j] = tmp;
@@ -763,7 +872,7 @@ void sea_object::compress(std::vector<sea_object *> &vec) {
 
 void sea_object::compress(std::list<sea_object *> &lst) {
     for (std::list<sea_object *>::iterator it = lst.begin(); it != lst.end();) {
-        if ((*it)->is_reference_ok()) {
+        if ((*it)->is_step_reference_ok()) {
             ++it;
         } else {
             it = lst.erase(it);
@@ -40,6 +40,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 // Forward declarations
 class ai;
 class game;
+class kinematic_store;
 class sensor;
 class sensors;
 class texture;
@@ -61,16 +62,11 @@ class game;
 class sensor;
 class texture;
 class model;
+struct sensor_target;
 
 ///\brief Base class for all physical objects in the game world. Simulates dynamics with position, velocity, acceleration etc.
 class sea_object {
   public:
-    /// special class to make handling of dead/defunct objects easier.
-    class is_dead_exception : public std::runtime_error {
-      public:
-        is_dead_exception() : std::runtime_error("dead!") {}
-    };
-
     // inactive means burning, sinking etc. it just means AI does nothing sensible.
     // objects can be inactive for any time.
     // when they should be removed, they are set to "dead" state,
@@ -211,6 +207,16 @@ class sea_object {
     // computes name of skin variant name according to data above.
     std::string compute_skin_name() const;
 
+    // read skin variants from the classification element of a spec file
+    static std::list<skin_variant> read_skin_variants(const xml_elem &cl);
+    // read skin selection data of a saved object, default values if it has none
+    static void read_skin_selection(const xml_elem &parent, std::string &regioncode, countrycode &ctry, date &d);
+    // computes name of skin variant according to the selection data
+    static std::string compute_skin_name(const std::list<skin_variant> &variants, const std::string &regioncode,
+                                         countrycode ctry, const date &d);
+    // names of skin variants that are valid at a date
+    static std::vector<std::string> valid_skin_names(const std::list<skin_variant> &variants, const date &d);
+
     //
     // ---------------- rigid body variables, maybe group in extra class ----------------
     //
@@ -276,6 +282,16 @@ class sea_object {
 
     /// Detection time counter (counts down). When it reaches zero, detection of other objects is triggered.
     double redetect_time;
+
+    /// state before the last simulation step, for interpolation in rendering
+    vector3 previous_position;
+    quaternion previous_orientation;
+    bool previous_state_valid; ///< false until first step or after position was manipulated
+
+    /// entry of this object in the packed kinematic state of the world, if any
+    kinematic_store *kinematics;
+    unsigned kinematics_index;
+    alive_status get_step_alive_status() const;
     /// list of visible objects, recreated regularly
     std::vector<sea_object *> visible_objects;
     /// list of radar detected objects, recreated regularly  , fixme: use some contact type here as well
@@ -315,7 +331,9 @@ class sea_object {
     const std::string &get_modelname() const { return modelname; }
     const std::string &get_skin_layout() const { return skin_name; }
 
-    virtual void simulate(double delta_time);
+    /// simulate one step and advance the dead states.
+    ///@returns false if the object is dead or defunct and was not simulated, heirs then return at once
+    virtual bool simulate(double delta_time);
     //	virtual bool is_collision(const sea_object* other);
     //	virtual bool is_collision(const vector2& pos);
 
@@ -355,6 +373,34 @@ class sea_object {
     virtual const vector3 &get_local_velocity() const { return local_velocity; }
     virtual double get_speed() const { return get_local_velocity().y; }
     virtual const quaternion &get_orientation() const { return orientation; }
+    /// position between the states before and after the last simulation step, for smooth rendering
+    ///@param alpha - interpolation factor in [0,1), see game::get_interpolation_factor
+    vector3 get_render_pos(double alpha) const;
+    /// orientation between the states before and after the last simulation step, like get_render_pos
+    quaternion get_render_orientation(double alpha) const;
+    /// set entry of object in packed kinematic state and store current state there
+    void set_kinematic_entry(kinematic_store *store, unsigned idx);
+    /// write current kinematic state to the entry of the object, if it has one
+    void store_kinematic_state() const;
+    /// like store_kinematic_state, but others see the state after the step, see kinematic_store::publish
+    void sync_kinematic_state() const;
+    const kinematic_store *get_kinematic_store() const { return kinematics; }
+    unsigned get_kinematic_index() const { return kinematics_index; }
+    /// state at the start of the current simulation step, read from the packed kinematic state.
+    ///@note Parallel simulation tasks change their objects while others read them, so other
+    ///	objects must be read with these functions there, see game::simulate_objects_mt.
+    ///	Objects without entry return their current state.
+    vector3 get_step_pos() const;
+    vector3 get_step_velocity() const;
+    quaternion get_step_orientation() const;
+    angle get_step_heading() const;
+    double get_step_speed() const;
+    vector2 get_step_engine_noise_source() const;
+    bool is_step_alive() const { return get_step_alive_status() == alive; }
+    bool is_step_reference_ok() const {
+        alive_status st = get_step_alive_status();
+        return st == alive || st == inactive;
+    }
     virtual double get_turn_velocity() const { return turn_velocity; }
     virtual double get_pitch_velocity() const { return pitch_velocity; }
     virtual double get_roll_velocity() const { return roll_velocity; }
@@ -388,6 +434,8 @@ class sea_object {
     */
     virtual double get_noise_factor() const { return 0; }
     virtual vector2 get_engine_noise_source() const;
+    /// extract values for batch detection by sensors, see sensor_detection.h
+    virtual void get_sensor_target(sensor_target &st) const;
 
     virtual void display(const texture *caustic_map = NULL) const;
     virtual void display_mirror_clip() const;
@@ -417,6 +465,14 @@ class sea_object {
     /// set random skin_name by given date, only to use for convoy creation
     void set_random_skin_name(const date &d);
 
+    /// name of the skin layout that load() registers for an object
+    ///@param spec - root element of the spec file of the object
+    ///@param parent - element the object was saved to
+    static std::string get_skin_layout(const xml_elem &spec, const xml_elem &parent);
+
+    /// names of all skin layouts that set_random_skin_name can choose at a date
+    static std::vector<std::string> get_random_skin_layouts(const xml_elem &spec, const date &d);
+
     /// get linear velocity of any point when considered relative to object
     vector3 compute_linear_velocity(const vector3 &p) const;
 
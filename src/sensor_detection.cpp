@@ -0,0 +1,177 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Batch detection of many targets by one sensor
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "sensor_detection.h"
+#include "rnd.h"
+#include <cmath>
+
+double sensor_target::get_cross_section(const vector2 &watcher) const {
+    if (!cross_sections)
+        return 0.0;
+    // same angle as sea_object::get_cross_section
+    vector2 r = pos.xy() - watcher;
+    return interpolate_cross_section(*cross_sections, (angle(r) - heading).value());
+}
+
+float sensor_target::interpolate_cross_section(const std::vector<float> &cs, float angle) {
+    const unsigned n = cs.size();
+    if (n == 0)
+        return 0.0f;
+    float fcs = angle * n / 360.0;
+    float fac = fcs - floor(fcs);
+    unsigned id0 = unsigned(floor(fcs)) % n;
+    unsigned id1 = (id0 + 1) % n;
+    return cs[id0] * (1.0f - fac) + cs[id1] * fac;
+}
+
+namespace sensor_detection {
+
+bool is_within_detection_cone(const sensor_params &sp, const vector2 &r, const angle &h) {
+    // When the detection angle is larger equal 360 degrees
+    // the target is everytime within this detection angle.
+    if (sp.detection_cone >= 360.0f)
+        return true;
+    angle dir = sp.bearing + h;
+    angle dir_to_target = angle(r);
+    angle diff = dir - dir_to_target;
+    double delta_angle = diff.value_pm180();
+    return delta_angle >= -sp.detection_cone && delta_angle <= sp.detection_cone;
+}
+
+double passive_distance_factor(double range, double d) {
+    double df = 0;
+    if (d <= range) {
+        df = range / d;
+        df *= df;
+    }
+    return df;
+}
+
+double active_distance_factor(double range, double d) {
+    double df = passive_distance_factor(range, d);
+    return df * df;
+}
+
+bool lookout_detects(const sensor_target &d, double max_view_dist, const sensor_target &t) {
+    const vector2 dpos = d.pos.xy();
+    double dist = (t.pos.xy() - dpos).length();
+    if (dist >= max_view_dist)
+        return false;
+    // avoid divide by zero
+    if (dist < 1.0)
+        return true;
+    // see lookout_sensor::is_detected for the reasons of the factor
+    const double visfactor = 0.05;
+    return t.surface_visibility(dpos) / dist >= visfactor;
+}
+
+bool passive_sonar_detects(const sensor_params &sp, const sensor_target &d, const sensor_target &t,
+                           double &sound_level) {
+    sound_level = 0.0;
+    // Surfaced submarines detect anything with their passive sonars.
+    if (d.is_submarine && !d.submerged)
+        return false;
+    vector2 r = t.noise_source - d.pos.xy();
+    if (!is_within_detection_cone(sp, r, d.heading))
+        return false;
+    // The noise modificator for the detecting unit must be subtracted from 1.
+    const double dnoisefac = 1.0f - d.noise_factor;
+    sound_level = dnoisefac * t.noise_factor * passive_distance_factor(sp.range, r.length());
+    return sound_level > (0.1f + 0.01f * rnd(10));
+}
+
+bool radar_detects(const sensor_params &sp, const sensor_target &d, const sensor_target &t) {
+    // Submerged submarines cannot use radar.
+    if (d.is_submarine && d.submerged)
+        return false;
+    const vector2 dpos = d.pos.xy();
+    vector2 r = t.pos.xy() - dpos;
+    if (!is_within_detection_cone(sp, r, d.heading))
+        return false;
+    double df = active_distance_factor(sp.range, r.length());
+    double vis = t.surface_visibility(dpos);
+    return df * vis > (0.1f + 0.01f * rnd(10));
+}
+
+bool active_sonar_detects(const sensor_params &sp, const sensor_target &d, const sensor_target &t) {
+    // Surfaced submarines cannot use ASDIC.
+    if (d.is_submarine && !d.submerged)
+        return false;
+    // Only submerged submarines can be detected with ASDIC.
+    if (!t.is_submarine || !t.submerged)
+        return false;
+    const vector2 dpos = d.pos.xy();
+    vector2 r = t.pos.xy() - dpos;
+    if (!is_within_detection_cone(sp, r, d.heading))
+        return false;
+    double dist_factor = active_distance_factor(sp.range, r.length());
+    const double dnoisefac = 1.0f - d.noise_factor;
+    double sonar_vis = t.sonar_visibility(dpos);
+    double prod = dist_factor * sonar_vis * dnoisefac * t.depth_factor;
+    return prod > (0.1f + 0.01f * rnd(10));
+}
+
+void lookout(const sensor_target &d, double max_view_dist, const std::vector<sensor_target> &targets, mask &result) {
+    reset(result, unsigned(targets.size()));
+    for (unsigned i = 0; i < targets.size(); ++i)
+        if (lookout_detects(d, max_view_dist, targets[i]))
+            set(result, i);
+}
+
+void passive_sonar(const sensor_params &sp, const sensor_target &d, const std::vector<sensor_target> &targets,
+                   mask &result, std::vector<double> *sound_levels) {
+    reset(result, unsigned(targets.size()));
+    if (sound_levels)
+        sound_levels->assign(targets.size(), 0.0);
+    // the detecting unit's state is the same for all targets
+    if (d.is_submarine && !d.submerged)
+        return;
+    for (unsigned i = 0; i < targets.size(); ++i) {
+        double sound_level;
+        if (passive_sonar_detects(sp, d, targets[i], sound_level))
+            set(result, i);
+        if (sound_levels)
+            (*sound_levels)[i] = sound_level;
+    }
+}
+
+void radar(const sensor_params &sp, const sensor_target &d, const std::vector<sensor_target> &targets, mask &result) {
+    reset(result, unsigned(targets.size()));
+    if (d.is_submarine && d.submerged)
+        return;
+    for (unsigned i = 0; i < targets.size(); ++i)
+        if (radar_detects(sp, d, targets[i]))
+            set(result, i);
+}
+
+void active_sonar(const sensor_params &sp, const sensor_target &d, const std::vector<sensor_target> &targets,
+                  mask &result) {
+    reset(result, unsigned(targets.size()));
+    if (d.is_submarine && !d.submerged)
+        return;
+    for (unsigned i = 0; i < targets.size(); ++i)
+        if (active_sonar_detects(sp, d, targets[i]))
+            set(result, i);
+}
+
+} // namespace sensor_detection
@@ -0,0 +1,119 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// Batch detection of many targets by one sensor
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef SENSOR_DETECTION_H
+#define SENSOR_DETECTION_H
+
+#include "angle.h"
+#include "vector3.h"
+#include <cstdint>
+#include <vector>
+
+///\brief Values of an object that sensors need, extracted once with sea_object::get_sensor_target.
+///@note With these records a sensor can test many targets without virtual calls or
+///	dynamic_cast per pair. Visibilities depend on the watcher only by the cross section.
+///	The sensors test single pairs with the same records and formulas.
+struct sensor_target {
+    vector3 pos;
+    angle heading;
+    vector2 noise_source;  ///< position of engine noise, see sea_object::get_engine_noise_source
+    double noise_factor;   ///< see sea_object::get_noise_factor
+    double depth_factor;   ///< detectability by depth for active sonar, see game::get_depth_factor
+    /// cross sections of the model over angles, nullptr if the object has no model
+    const std::vector<float> *cross_sections;
+    /// surface visibility is surface_scale * cross section + surface_offset
+    double surface_scale, surface_offset;
+    /// sonar visibility is sonar_scale * cross section / 700
+    double sonar_scale;
+    bool is_submarine;
+    bool submerged; ///< submarine is submerged
+
+    sensor_target()
+        : noise_factor(0), depth_factor(1), cross_sections(nullptr), surface_scale(1), surface_offset(0),
+          sonar_scale(0), is_submarine(false), submerged(false) {}
+
+    /// cross section seen by a watcher, see sea_object::get_cross_section
+    double get_cross_section(const vector2 &watcher) const;
+    /// interpolate cross sections over angles, angle in degrees. Used by model::get_cross_section
+    static float interpolate_cross_section(const std::vector<float> &cross_sections, float angle);
+    /// see sea_object::surface_visibility
+    float surface_visibility(const vector2 &watcher) const {
+        // deep submarines and shells are not seen by their cross section
+        double cs = (surface_scale != 0.0) ? get_cross_section(watcher) : 0.0;
+        return float(surface_scale * cs + surface_offset);
+    }
+    /// see submarine::sonar_visibility
+    float sonar_visibility(const vector2 &watcher) const {
+        return (sonar_scale != 0.0) ? float(sonar_scale * (1.0 / 700.0 * get_cross_section(watcher))) : 0.0f;
+    }
+};
+
+/// Detection of target records by one sensor, sensor::is_detected and sensor::detect use it.
+namespace sensor_detection {
+/// detection result, bit i of word i/64 is set when target i is detected
+typedef std::vector<uint64_t> mask;
+
+/// clear mask for n targets
+inline void reset(mask &m, unsigned n) { m.assign((n + 63) / 64, 0); }
+inline void set(mask &m, unsigned i) { m[i >> 6] |= uint64_t(1) << (i & 63); }
+inline bool test(const mask &m, unsigned i) { return ((m[i >> 6] >> (i & 63)) & 1) != 0; }
+
+/// range, bearing and size of detection cone of a sensor
+struct sensor_params {
+    double range;
+    angle bearing;
+    double detection_cone;
+};
+
+/// is target at relative position r within the detection cone, h is heading of detecting unit
+bool is_within_detection_cone(const sensor_params &sp, const vector2 &r, const angle &h);
+/// decline of signal strength of passive sensors at distance d
+double passive_distance_factor(double range, double d);
+/// decline of signal strength of active sensors at distance d
+double active_distance_factor(double range, double d);
+
+/// can lookouts of d see target t, see lookout_sensor
+bool lookout_detects(const sensor_target &d, double max_view_dist, const sensor_target &t);
+/// can passive sonar of d hear target t, see passive_sonar_sensor
+///@param sound_level - noise level of the target, 0 if it can't be heard
+bool passive_sonar_detects(const sensor_params &sp, const sensor_target &d, const sensor_target &t,
+                           double &sound_level);
+/// can radar of d detect target t, see radar_sensor
+bool radar_detects(const sensor_params &sp, const sensor_target &d, const sensor_target &t);
+/// can active sonar of d detect target t, see active_sonar_sensor
+bool active_sonar_detects(const sensor_params &sp, const sensor_target &d, const sensor_target &t);
+
+/// lookouts, see lookout_sensor
+void lookout(const sensor_target &d, double max_view_dist, const std::vector<sensor_target> &targets, mask &result);
+/// passive sonar, see passive_sonar_sensor
+///@param sound_levels - if not nullptr, noise level per target (0 if not heard)
+void passive_sonar(const sensor_params &sp, const sensor_target &d, const std::vector<sensor_target> &targets,
+                   mask &result, std::vector<double> *sound_levels = nullptr);
+/// radar, see radar_sensor
+void radar(const sensor_params &sp, const sensor_target &d, const std::vector<sensor_target> &targets, mask &result);
+/// active sonar (ASDIC), see active_sonar_sensor
+void active_sonar(const sensor_params &sp, const sensor_target &d, const std::vector<sensor_target> &targets,
+                  mask &result);
+} // namespace sensor_detection
+
+#endif
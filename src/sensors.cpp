@@ -34,34 +34,19 @@ sensor::sensor(double range, double detection_cone) : range(range), bearing(0.0f
                                                       move_direction(1) {}
 
 double sensor::get_distance_factor(double d) const {
-    double df = 0;
-
-    if (d <= range) {
-        df = range / d;
-        df *= df;
-    }
-
-    return df;
+    return sensor_detection::passive_distance_factor(range, d);
 }
 
 bool sensor::is_within_detection_cone(const vector2 &r, const angle &h) const {
-    bool within_angle = false;
-
-    if (detection_cone >= 360.0f) {
-        // When the detection angle is larger equal 360 degrees
-        // the target is everytime within this detection angle.
-        within_angle = true;
-    } else {
-        angle dir = bearing + h;
-        angle dir_to_target = angle(r);
-        angle diff = dir - dir_to_target;
-        double delta_angle = diff.value_pm180();
-
-        if (delta_angle >= -detection_cone && delta_angle <= detection_cone)
-            within_angle = true;
-    }
+    return sensor_detection::is_within_detection_cone(get_params(), r, h);
+}
 
-    return within_angle;
+sensor_detection::sensor_params sensor::get_params() const {
+    sensor_detection::sensor_params sp;
+    sp.range = range;
+    sp.bearing = bearing;
+    sp.detection_cone = detection_cone;
+    return sp;
 }
 
 void sensor::auto_move_bearing(sensor_move_mode mode) {
@@ -83,62 +68,55 @@ lookout_sensor::lookout_sensor(lookout_type type) : sensor() {}
 
 bool lookout_sensor::is_detected(const game *gm, const sea_object *d,
                                  const sea_object *t) const {
-    bool detected = false;
-    double max_view_dist = gm->get_max_view_distance();
-    vector2 r = t->get_pos().xy() - d->get_pos().xy();
-    double dist = r.length();
-
-    if (dist < max_view_dist) {
-        if (dist < 1.0)
-            return true; // avoid divide by zero
-
-        // the probabilty of visibility depends on indivial values
-        // relative course, distance to and type of watcher.
-        // (height of masts, experience etc.), weather fixme
-        double vis = t->surface_visibility(d->get_pos().xy());
-
-        // The Malaya has 1500 m cross section at broadside.
-        // It can be seen at maximum distance (30km)
-        // 1500/30000 = 0.05, so the factor must be less or equal than that.
-        // A destroyer (771m) is then visible from its broadside at 15420 meters.
-        // A corvette (232m) is then visible from its broadside at 4640 meters.
-        // A carrier (1087m) is then visible from its broadside at 21740 meters.
-        // A small tanker (576m) is then visible from its broadside at 11520 meters.
-        // A large freighter (889m) is then visible from its broadside at 17780 meters.
-        // A VIIc sub (120m) is then visible from its broadside at 2400 meters.
-        // The factor is obviously too large. A sub can be seen from its broadside
-        // at superb conditions in 5km at least, but that would lead to a factor so
-        // that large freighters are visible from 37km (~20sm)!
-        // Effects like smoke or wake are ignored here, but are essential, fixme!!!
-        // A ship's/sub's speed influenced the visibility, especially for subs!
-        // fixme: earth curvature is ignored here!!!
-        // fixme: we should visualize the visibility for testing purposes.
-        const double visfactor = 0.05;
-
-        // this model ignores special features of visibility for water splashes, particles or grenades...
-        // all of these have a cross section of 100 square meters hard coded for testing,
-        // except particles, which have a real cross section
-
-        // multiply with overall visibility factor: max_view_dist/30km.
-        // the idea behind this formula is that at night smaller objects are harder to detect.
-        // however it's results are bad.
-        // double condition_visfactor = (max_view_dist/30000.0) * 0.5 + 0.5;
-
-        // visibility depends on visible area in viewer's projected space.
-        // Projected area ~ Real area / Real distance.
-        if (/*condition_visfactor * */ vis / dist >= visfactor)
-            detected = true;
-        // fixme: add some randomization! really?
-    }
-
-    return detected;
+    // the probabilty of visibility depends on indivial values
+    // relative course, distance to and type of watcher.
+    // (height of masts, experience etc.), weather fixme
+    // The Malaya has 1500 m cross section at broadside.
+    // It can be seen at maximum distance (30km)
+    // 1500/30000 = 0.05, so the factor must be less or equal than that.
+    // A destroyer (771m) is then visible from its broadside at 15420 meters.
+    // A corvette (232m) is then visible from its broadside at 4640 meters.
+    // A carrier (1087m) is then visible from its broadside at 21740 meters.
+    // A small tanker (576m) is then visible from its broadside at 11520 meters.
+    // A large freighter (889m) is then visible from its broadside at 17780 meters.
+    // A VIIc sub (120m) is then visible from its broadside at 2400 meters.
+    // The factor is obviously too large. A sub can be seen from its broadside
+    // at superb conditions in 5km at least, but that would lead to a factor so
+    // that large freighters are visible from 37km (~20sm)!
+    // Effects like smoke or wake are ignored here, but are essential, fixme!!!
+    // A ship's/sub's speed influenced the visibility, especially for subs!
+    // fixme: earth curvature is ignored here!!!
+    // fixme: we should visualize the visibility for testing purposes.
+
+    // this model ignores special features of visibility for water splashes, particles or grenades...
+    // all of these have a cross section of 100 square meters hard coded for testing,
+    // except particles, which have a real cross section
+
+    // multiply with overall visibility factor: max_view_dist/30km.
+    // the idea behind this formula is that at night smaller objects are harder to detect.
+    // however it's results are bad.
+    // double condition_visfactor = (max_view_dist/30000.0) * 0.5 + 0.5;
+
+    // visibility depends on visible area in viewer's projected space.
+    // Projected area ~ Real area / Real distance.
+    // The factor is applied in sensor_detection::lookout_detects.
+    // fixme: add some randomization! really?
+    sensor_target dt, tt;
+    d->get_sensor_target(dt);
+    t->get_sensor_target(tt);
+    return sensor_detection::lookout_detects(dt, gm->get_max_view_distance(), tt);
 }
 
 bool lookout_sensor::is_detected(const game *gm, const sea_object *d,
                                  const particle *p) const {
+    return particle_detected(gm->get_max_view_distance(), d->get_pos().xy(), p->get_pos().xy(),
+                             p->get_width() * p->get_height());
+}
+
+bool lookout_sensor::particle_detected(double max_view_dist, const vector2 &viewer, const vector2 &pos,
+                                       double area) {
     bool detected = false;
-    double max_view_dist = gm->get_max_view_distance();
-    vector2 r = p->get_pos().xy() - d->get_pos().xy();
+    vector2 r = pos - viewer;
     double dist = r.length();
 
     if (dist < max_view_dist) {
@@ -146,7 +124,7 @@ bool lookout_sensor::is_detected(const game *gm, const sea_object *d,
             return true; // avoid divide by zero
 
         // the probabilty of visibility depends on cross section
-        double vis = p->get_width() * p->get_height();
+        double vis = area;
 
         if (vis < 100.0)
             vis = 100.0;
@@ -162,6 +140,11 @@ bool lookout_sensor::is_detected(const game *gm, const sea_object *d,
     return detected;
 }
 
+void lookout_sensor::detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                            sensor_detection::mask &result) const {
+    sensor_detection::lookout(d, gm->get_max_view_distance(), targets, result);
+}
+
 // Class passive_sonar_sensor
 passive_sonar_sensor::passive_sonar_sensor(passive_sonar_type type) : sensor() {
     init(type);
@@ -185,35 +168,12 @@ void passive_sonar_sensor::init(passive_sonar_type type) {
 
 bool passive_sonar_sensor::is_detected(double &sound_level,
                                        const game *gm, const sea_object *d, const sea_object *t) const {
-    bool detected = false;
-    sound_level = 0.0f;
-
-    // Surfaced submarines detect anything with their passive sonars.
-    const submarine *sub = dynamic_cast<const submarine *>(d);
-    if (sub && !sub->is_submerged()) {
-        detected = false;
-    } else {
-        vector2 r = t->get_engine_noise_source() - d->get_pos().xy();
-
-        if (is_within_detection_cone(r, d->get_heading())) {
-            double df = get_distance_factor(r.length());
-
-            // The throttle speed is the real noise of the ship.
-            // A ship on flank speed is really deaf.
-            double dnoisefac = d->get_noise_factor();
-            double tnoisefac = t->get_noise_factor();
-
-            // The noise modificator for the detecting unit must be
-            // subtracted from 1.
-            dnoisefac = 1.0f - dnoisefac;
-            sound_level = dnoisefac * tnoisefac * df;
-
-            if (sound_level > (0.1f + 0.01f * rnd(10)))
-                detected = true;
-        }
-    }
-
-    return detected;
+    // The throttle speed is the real noise of the ship.
+    // A ship on flank speed is really deaf.
+    sensor_target dt, tt;
+    d->get_sensor_target(dt);
+    t->get_sensor_target(tt);
+    return sensor_detection::passive_sonar_detects(get_params(), dt, tt, sound_level);
 }
 
 bool passive_sonar_sensor::is_detected(const game *gm, const sea_object *d,
@@ -223,19 +183,21 @@ bool passive_sonar_sensor::is_detected(const game *gm, const sea_object *d,
     return is_detected(sound_level, gm, d, t);
 }
 
+void passive_sonar_sensor::detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                                  sensor_detection::mask &result) const {
+    sensor_detection::passive_sonar(get_params(), d, targets, result);
+}
+
+void passive_sonar_sensor::detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                                  sensor_detection::mask &result, std::vector<double> &sound_levels) const {
+    sensor_detection::passive_sonar(get_params(), d, targets, result, &sound_levels);
+}
+
 // Class active_sensor
 active_sensor::active_sensor(double range) : sensor(range) {}
 
 double active_sensor::get_distance_factor(double d) const {
-    double df = 0;
-
-    if (d <= get_range()) {
-        df = get_range() / d;
-        df *= df;
-        df *= df;
-    }
-
-    return df;
+    return sensor_detection::active_distance_factor(get_range(), d);
 }
 
 // Class radar_rensor
@@ -282,25 +244,16 @@ bool radar_sensor::is_detected(const game *gm, const sea_object *d,
     if (!t)
         return false; // should not happen
 
-    bool detected = false;
-
-    // Surfaced submarines cannot use ASDIC.
-    const submarine *dsub = dynamic_cast<const submarine *>(d);
-    if ((dsub && !dsub->is_submerged()) || !dsub) {
-        vector2 r = t->get_pos().xy() - d->get_pos().xy();
-        if (is_within_detection_cone(r, d->get_heading())) {
-            double df = get_distance_factor(r.length());
-            double vis = 1.0f;
-
-            // Radars use the surface visibility factor. 2004/05/16 fixme adapt constants
-            vis = t->surface_visibility(d->get_pos().xy());
-
-            if (df * vis > (0.1f + 0.01f * rnd(10)))
-                detected = true;
-        }
-    }
+    // Radars use the surface visibility factor. 2004/05/16 fixme adapt constants
+    sensor_target dt, tt;
+    d->get_sensor_target(dt);
+    t->get_sensor_target(tt);
+    return sensor_detection::radar_detects(get_params(), dt, tt);
+}
 
-    return detected;
+void radar_sensor::detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                          sensor_detection::mask &result) const {
+    sensor_detection::radar(get_params(), d, targets, result);
 }
 
 // Class active_sonar_sensor
@@ -319,37 +272,15 @@ void active_sonar_sensor::init(active_sonar_type type) {
 
 bool active_sonar_sensor::is_detected(const game *gm, const sea_object *d,
                                       const sea_object *t) const {
-    bool detected = false;
-
-    // Surfaced submarines cannot use ASDIC.
-    const submarine *dsub = dynamic_cast<const submarine *>(d);
-    if (dsub && !dsub->is_submerged()) {
-        detected = false;
-    } else {
-        // Only submerged submarines can be detected with ASDIC.
-        const submarine *tsub = dynamic_cast<const submarine *>(t);
-        if (tsub && tsub->is_submerged()) {
-            vector2 r = t->get_pos().xy() - d->get_pos().xy();
-
-            // Verify if target is within detection cone of the sensor.
-            if (is_within_detection_cone(r, d->get_heading())) {
-                double dist_factor = get_distance_factor(r.length());
-                // The throttle speed is the real noise of the ship.
-                // A ship on flank speed is really deaf.
-                double dnoisefac = d->get_noise_factor();
-                // The noise modificator for the detecting unit must be
-                // subtracted from 1.
-                dnoisefac = 1.0f - dnoisefac;
-                double sonar_vis = tsub->sonar_visibility(d->get_pos().xy());
-                // The deeper the submarine dives as harder it is detectable.
-                double depth_factor = gm->get_depth_factor(t->get_pos());
-                double prod = dist_factor * sonar_vis * dnoisefac * depth_factor;
-
-                if (prod > (0.1f + 0.01f * rnd(10)))
-                    detected = true;
-            }
-        }
-    }
+    // The deeper the submarine dives as harder it is detectable,
+    // see game::get_depth_factor.
+    sensor_target dt, tt;
+    d->get_sensor_target(dt);
+    t->get_sensor_target(tt);
+    return sensor_detection::active_sonar_detects(get_params(), dt, tt);
+}
 
-    return detected;
+void active_sonar_sensor::detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                                 sensor_detection::mask &result) const {
+    sensor_detection::active_sonar(get_params(), d, targets, result);
 }
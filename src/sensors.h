@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 // subsim (C) + (W). See LICENSE
 
 #include "angle.h"
+#include "sensor_detection.h"
 #include "vector3.h"
 
 #ifndef _SENSORS_H_
@@ -141,6 +142,18 @@ class sensor {
     */
     virtual bool is_detected(const game *gm, const sea_object *d,
                              const sea_object *t) const = 0;
+    /**
+            Batch version of is_detected. Verifies which targets can be detected
+            by detecting unit d, with the same results as is_detected per pair.
+            @param gm game object. Some parameters are stored here.
+            @param d detecting unit, see sea_object::get_sensor_target
+            @param targets target units
+            @param result bit i is set when targets[i] is detected
+    */
+    virtual void detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                        sensor_detection::mask &result) const = 0;
+    /// get range, bearing and detection cone for batch detection
+    sensor_detection::sensor_params get_params() const;
 };
 
 ///\brief Class for lookout.
@@ -160,6 +173,10 @@ class lookout_sensor : public sensor {
     */
     virtual bool is_detected(const game *gm, const sea_object *d, const sea_object *t) const;
     virtual bool is_detected(const game *gm, const sea_object *d, const particle *p) const;
+    virtual void detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                        sensor_detection::mask &result) const;
+    /// is a particle of visible area (width * height) at pos seen from viewer, used by is_detected
+    static bool particle_detected(double max_view_dist, const vector2 &viewer, const vector2 &pos, double area);
 };
 
 ///\brief Class for passive sonar based sensors.
@@ -196,6 +213,14 @@ class passive_sonar_sensor : public sensor {
             @param t target unit
     */
     virtual bool is_detected(double &sound_level, const game *gm, const sea_object *d, const sea_object *t) const;
+    virtual void detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                        sensor_detection::mask &result) const;
+    /**
+            Batch version of is_detected with sound levels.
+            @param sound_levels noise level per target
+    */
+    virtual void detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                        sensor_detection::mask &result, std::vector<double> &sound_levels) const;
 };
 
 ///\brief Base class for active sensors.
@@ -251,6 +276,8 @@ class radar_sensor : public active_sensor {
             @param t target unit
     */
     virtual bool is_detected(const game *gm, const sea_object *d, const sea_object *t) const;
+    virtual void detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                        sensor_detection::mask &result) const;
 };
 
 ///\brief Class for active sonar based sensors.
@@ -272,6 +299,8 @@ class active_sonar_sensor : public active_sensor {
             @param t target unit
     */
     virtual bool is_detected(const game *gm, const sea_object *d, const sea_object *t) const;
+    virtual void detect(const game *gm, const sensor_target &d, const std::vector<sensor_target> &targets,
+                        sensor_detection::mask &result) const;
 };
 
 #endif /* _SENSORS_H_ */
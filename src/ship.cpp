@@ -22,6 +22,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "ship.h"
 #include "ai.h"
+#include "ballistic_table.h"
+#include "buoyancy_kernel.h"
 #include "date.h"
 #include "game.h"
 #include "global_constants.h"
@@ -32,6 +34,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "particle.h"
 #include "sensors.h"
 #include "system.h"
+#include <limits>
 
 using std::istringstream;
 using std::list;
@@ -42,10 +45,6 @@ using std::pair;
 using std::string;
 using std::vector;
 
-map<double, map<double, double>> ship::dist_angle_relation;
-#define MAX_INCLINATION 45.0
-#define MAX_DECLINATION -20.0
-#define ANGLE_GAP 0.1
 #define GUN_RELOAD_TIME 5.0
 
 void ship::generic_rudder::simulate(double delta_time) {
@@ -100,46 +99,6 @@ double ship::generic_rudder::bypass_factor() const {
 
 // fixme: redefine display, call base display
 
-void ship::fill_dist_angle_relation_map(const double initial_velocity) {
-    if (dist_angle_relation.find(initial_velocity) == dist_angle_relation.end()) {
-        for (double a = 0; a > MAX_DECLINATION + ANGLE_GAP; a -= ANGLE_GAP) {
-            angle elevation(a);
-            double z = 4; // meters, initial height above water
-            double vz = initial_velocity * elevation.sin();
-            double dist = 0;
-            double vdist = initial_velocity * elevation.cos();
-
-            for (double dt = 0; dt < 120.0; dt += 0.001) {
-                dist += vdist * dt;
-                z += vz * dt;
-                vz += 0 - GRAVITY * dt;
-                if (z <= 0)
-                    break;
-            }
-
-            dist_angle_relation[initial_velocity][dist] = a;
-        }
-
-        for (double a = 0; a < MAX_INCLINATION + ANGLE_GAP; a += ANGLE_GAP) {
-            angle elevation(a);
-            double z = 4; // meters, initial height above water
-            double vz = initial_velocity * elevation.sin();
-            double dist = 0;
-            double vdist = initial_velocity * elevation.cos();
-
-            for (double dt = 0; dt < 120.0; dt += 0.001) {
-                dist += vdist * dt;
-                z += vz * dt;
-                vz += 0 - GRAVITY * dt;
-                if (z <= 0)
-                    break;
-            }
-
-            dist_angle_relation[initial_velocity][dist] = a;
-        }
-    }
-}
-
 ship::ship(game &gm_, const xml_elem &parent)
     : sea_object(gm_, parent),
       tonnage(0),
@@ -239,9 +198,9 @@ ship::ship(game &gm_, const xml_elem &parent)
             new_turret.calibre = it.elem().attrf("calibre");
             new_turret.gun_barrels.resize(num_barrels);
 
-            // setup angles map for this initial velocity
-            fill_dist_angle_relation_map(new_turret.initial_velocity);
-            calc_max_gun_range(new_turret.initial_velocity);
+            // setup angles table for this initial velocity
+            new_turret.ballistics = &ballistic_table::get(new_turret.initial_velocity);
+            calc_max_gun_range(*new_turret.ballistics);
 
             gun_turrets.push_back(new_turret);
         }
@@ -438,9 +397,9 @@ void ship::load(const xml_elem &parent) {
 			turret.gun_barrels.push_back(new_barrel);
 		}
 		
-		// setup angles map for this initial velocity
-		fill_dist_angle_relation_map(turret.initial_velocity);
-		calc_max_gun_range(turret.initial_velocity);
+		// setup angles table for this initial velocity
+		turret.ballistics = &ballistic_table::get(turret.initial_velocity);
+		calc_max_gun_range(*turret.ballistics);
 		
 		gun_turrets.push_back(turret);
 	}
@@ -513,8 +472,9 @@ void ship::save(xml_elem &parent) const {
 #endif
 }
 
-void ship::simulate(double delta_time) {
-    sea_object::simulate(delta_time);
+bool ship::simulate(double delta_time) {
+    if (!sea_object::simulate(delta_time))
+        return false;
 
     // screw animation
     if (throttle != 0) {
@@ -584,7 +544,7 @@ void ship::simulate(double delta_time) {
         if (position.z < -200) // used for ships.
             kill();
         throttle = stop;
-        return;
+        return true;
     }
 
     // Adjust fuel_level.
@@ -672,6 +632,7 @@ void ship::simulate(double delta_time) {
 
         gun_turret++;
     }
+    return true;
 }
 
 // #include "global_data.h"
@@ -838,12 +799,9 @@ void ship::compute_force_and_torque(vector3 &F, vector3 &T) const {
     // fixme: re-normalization of rotation quaterionions ("orientation")
     //        should be done frequently...
 
-    double lift_force_sum = 0; // = -GRAVITY * mass;
-    // double debug_liftforcesum=0,debug_gravityforcesum=0;
-    vector3 dr_torque;
-    const std::vector<model::voxel> &voxel_data = mymodel->get_voxel_data();
+    const model::voxel_arrays &voxels = mymodel->get_voxel_arrays();
+    const unsigned nr_voxels = voxels.size();
     const vector3f &voxel_size = mymodel->get_voxel_size();
-    const float voxel_radius = mymodel->get_voxel_radius();
     // Note! voxel_vol is volume of voxel measure from model file. However this
     // may not be the exact volume of the model (with historical accuary),
     // thus we use the stored tonnage from the spec file as the volume,
@@ -856,55 +814,47 @@ void ship::compute_force_and_torque(vector3 &F, vector3 &T) const {
     const float voxel_vol = voxel_size.x * voxel_size.y * voxel_size.z * volume_scale;
     const double voxel_vol_force = voxel_vol * GRAVITY * 1000.0; // 1000kg per cubic meter
     const matrix4f transmat = orientation.rotmat4() * mymodel->get_base_mesh_transformation() * matrix4f::diagonal(voxel_size);
-    double vol_below_water = 0;
-    const double gravity_force = mass * -GRAVITY;
-    // fixme: split loop to two cores to speed up physics a tiny bit
-    // takes 21-23ms for 1000 times, so whole loop has ca.
-    // 52500-57500 cycles. cpu usage is rather low, at
-    // 30% at 60fps vsync, so total cpu time is
-    // 750,000,000 cycles, and this loop 7/1000 per cent
-    // of full cpu time, so multicore wont help much here,
-    // most cpu time is spent elsewhere
     // Depth threshold: voxels below -10m are definitely submerged (waves ?2m).
-    // Skip expensive compute_water_height for these - saves ~50% calls when submerged.
+    // Skip expensive water height lookup for these - saves ~50% calls when submerged.
     const double deep_submerged_z = -10.0;
-
-    for (unsigned i = 0; i < voxel_data.size(); ++i) {
-        // instead of a per-voxel matrix-vector multiplication we could
-        // transform all other vectors to mesh-vertex-space and skip
-        // the matrix multiplication here, then later re-transform the
-        // resulting force-vectors back to model space.
-        // we know here that transmat only has non-projective part
-        // so mul4vec3xlat is sufficient.
-        vector3f p = transmat.mul4vec3xlat(voxel_data[i].relative_position);
-        const double voxel_z = p.z + position.z;
-
-        double voxel_below_water;
-        if (voxel_z < deep_submerged_z) {
-            // Deeply submerged: skip water height lookup, voxel is fully below surface
-            voxel_below_water = -1.0; // clamped, gives submerged_part = 1.0
-        } else {
-            float wh = gm.compute_water_height(vector2(position.x + p.x, position.y + p.y));
-            voxel_below_water = std::max(std::min((voxel_z - wh) / voxel_radius, 1.0), -1.0);
+    const buoyancy_kernel::path kernel_path = buoyancy_kernel::get_best_path();
+
+    // transform all voxels first and query water height for all voxels near the
+    // surface with one call, that is much cheaper than one call per voxel.
+    // transmat only has non-projective part, so the kernel can use mul4vec3xlat.
+    buoyancy_x.resize(nr_voxels);
+    buoyancy_y.resize(nr_voxels);
+    buoyancy_z.resize(nr_voxels);
+    buoyancy_kernel::transform(kernel_path, nr_voxels, voxels.x.data(), voxels.y.data(), voxels.z.data(), transmat,
+                               buoyancy_x.data(), buoyancy_y.data(), buoyancy_z.data());
+    buoyancy_offsets.clear();
+    buoyancy_indices.clear();
+    for (unsigned i = 0; i < nr_voxels; ++i) {
+        if (buoyancy_z[i] + position.z >= deep_submerged_z) {
+            buoyancy_offsets.push_back(vector2f(buoyancy_x[i], buoyancy_y[i]));
+            buoyancy_indices.push_back(i);
         }
-        if (voxel_below_water < 1.0 /*p.z + position.z < wh*/) {
-            // voxels partly below water must be computed or torque is severely wrong
-            double submerged_part = 1.0 - (voxel_below_water + 1.0) * 0.5;
-            double lift_force = voxel_data[i].part_of_volume * voxel_vol_force * submerged_part;
-            vol_below_water += voxel_data[i].part_of_volume * submerged_part;
-            lift_force_sum += lift_force;
-            // debug_liftforcesum+=lift_force;
-            vector3 lift_torque = p.cross(vector3(0, 0, lift_force));
-            dr_torque += lift_torque;
-            // std::cout << "i=" << i << " subm=" << submerged_part << " vdw=" << voxel_data[i].part_of_volume << " lift_force=" << lift_force << " lift_torque=" << lift_torque << "\n";
-        }
-        double relative_gravity_force = gravity_force * voxel_data[i].relative_mass;
-        // add part because of flooding
-        relative_gravity_force += flooded_mass[i] * -GRAVITY;
-        lift_force_sum += relative_gravity_force;
-        // debug_gravityforcesum+=relative_gravity_force;
-        dr_torque += p.cross(vector3(0, 0, relative_gravity_force));
     }
+    gm.compute_water_heights(position.xy(), buoyancy_offsets, buoyancy_heights);
+    // deeply submerged voxels get a water height far above, so they count as fully below water
+    buoyancy_water_heights.assign(nr_voxels, std::numeric_limits<float>::max());
+    for (unsigned j = 0; j < buoyancy_indices.size(); ++j)
+        buoyancy_water_heights[buoyancy_indices[j]] = buoyancy_heights[j];
+
+    // sum lift force of the part of each voxel below water and gravity force of
+    // voxel mass plus flooded mass, and the torque of both relative to the center.
+    buoyancy_kernel::parameters par;
+    par.position_z = float(position.z);
+    par.voxel_radius = mymodel->get_voxel_radius();
+    par.voxel_volume_force = float(voxel_vol_force);
+    par.gravity_force = float(mass * -GRAVITY);
+    par.flooded_gravity = float(-GRAVITY);
+    const buoyancy_kernel::sums sums =
+        buoyancy_kernel::accumulate(kernel_path, nr_voxels, buoyancy_x.data(), buoyancy_y.data(), buoyancy_z.data(),
+                                    buoyancy_water_heights.data(), voxels.part_of_volume.data(),
+                                    voxels.relative_mass.data(), flooded_mass.data(), par);
+    const double lift_force_sum = sums.force_z;
+    const vector3 dr_torque(sums.torque_x, sums.torque_y, 0.0);
     //	std::cout << "mass=" << mass << " lift_force_sum=" << lift_force_sum << " grav=" << -GRAVITY*mass << "\n";
     //	std::cout << "vol below water=" << vol_below_water << " of " << voxel_data.size() << "\n";
     // DBGOUT3(debug_liftforcesum,debug_gravityforcesum,mass);
@@ -1039,8 +989,6 @@ ship::gun_status ship::fire_shell_at(const vector2 &pos) {
     gun_status res = GUN_FIRED;
     gun_turret_itr gun_turret = gun_turrets.begin();
     gun_barrel_itr gun_barrel;
-    // fixme! move dist_angle relation also,
-    // maybe approximate that relation with splines.
 
     while (gun_turret != gun_turrets.end()) {
         struct gun_turret *gun = &(*gun_turret);
@@ -1053,7 +1001,7 @@ ship::gun_status ship::fire_shell_at(const vector2 &pos) {
                         double distance = deltapos.length();
                         angle direction(deltapos);
 
-                        double max_shooting_distance = (dist_angle_relation[gun_turret->initial_velocity].rbegin())->first;
+                        double max_shooting_distance = gun_turret->ballistics->get_max_range();
                         if (distance > max_shooting_distance)
                             res = TARGET_OUT_OF_RANGE; // can't do anything
 
@@ -1066,7 +1014,7 @@ ship::gun_status ship::fire_shell_at(const vector2 &pos) {
                                 //	use an extra bit of correction for wind etc.
                                 //	to do that, we need to know where the last shot impacted!
                                 angle elevation;
-                                if (true == calculate_gun_angle(distance, elevation, gun_turret->initial_velocity)) {
+                                if (true == calculate_gun_angle(distance, elevation, *gun_turret->ballistics)) {
                                     if (elevation.value() > gun->max_inclination) {
                                         res = TARGET_OUT_OF_RANGE;
                                     } else if (elevation.value() < gun->max_declination) {
@@ -1177,20 +1125,12 @@ bool ship::is_gun_manned() {
     return gun_turrets.begin()->is_gun_manned;
 }
 
-bool ship::calculate_gun_angle(const double distance, angle &elevation, const double initial_velocity) {
-    bool withinRange = false;
-
-    map<double, double>::iterator it = dist_angle_relation[initial_velocity].lower_bound(distance);
-    if (it != dist_angle_relation[initial_velocity].end()) {
-        elevation = angle(it->second);
-        withinRange = true;
-    }
-
-    return withinRange;
+bool ship::calculate_gun_angle(const double distance, angle &elevation, const ballistic_table &ballistics) {
+    return ballistics.get_elevation(distance, elevation);
 }
 
-void ship::calc_max_gun_range(double initial_velocity) {
-    double max_range = dist_angle_relation[initial_velocity].rbegin()->first;
+void ship::calc_max_gun_range(const ballistic_table &ballistics) {
+    double max_range = ballistics.get_max_range();
 
     maximum_gun_range = (max_range > maximum_gun_range) ? max_range : maximum_gun_range;
 }
@@ -1208,3 +1148,21 @@ bv_tree::param ship::compute_bv_tree_params() const {
     matrix4f basemeshtrans = get_model().get_base_mesh_transformation();
     return bv_tree::param(bv_tree, basemesh.vertices, rotmat * basemeshtrans);
 }
+
+flat_bv_tree::param ship::compute_flat_bv_tree_params() const {
+    return compute_flat_bv_tree_params(get_orientation());
+}
+
+flat_bv_tree::param ship::compute_flat_bv_tree_params(const quaternion &orient) const {
+    const model::mesh &basemesh = get_model().get_base_mesh();
+    matrix4 rotmat = orient.rotmat4();
+    matrix4f basemeshtrans = get_model().get_base_mesh_transformation();
+    return flat_bv_tree::param(basemesh.get_flat_bv_tree(), basemesh.vertices, rotmat * basemeshtrans);
+}
+
+double ship::get_collision_radius() const {
+    // rotation keeps the distance of the tree's sphere center to the position
+    const spheref bs = get_model().get_base_mesh().get_flat_bv_tree().get_sphere();
+    vector3f c = get_model().get_base_mesh_transformation().mul4vec3xlat(bs.center);
+    return std::max(get_bounding_radius(), double(c.length() + bs.radius));
+}
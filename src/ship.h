@@ -24,9 +24,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define SHIP_H
 
 #include "bv_tree.h"
+#include "flat_bv_tree.h"
 #include "sea_object.h"
 #include <map>
 
+class ballistic_table;
 class game;
 class particle;
 
@@ -171,6 +173,13 @@ class ship : public sea_object {
     // maximum of additional mass because of flooding, computed from spec/mdl file
     // can be volume * density of water.
     double max_flooded_mass;
+    // voxel positions, offsets and water heights near the surface and water height per voxel
+    // for buoyancy, kept to avoid allocations every step
+    mutable std::vector<float> buoyancy_x, buoyancy_y, buoyancy_z;
+    mutable std::vector<vector2f> buoyancy_offsets;
+    mutable std::vector<unsigned> buoyancy_indices;
+    mutable std::vector<float> buoyancy_heights;
+    mutable std::vector<float> buoyancy_water_heights;
 
     void compute_force_and_torque(vector3 &F, vector3 &T) const; // drag must be already included!
 
@@ -205,12 +214,6 @@ class ship : public sea_object {
 
     virtual bool causes_spray() const { return true; }
 
-    // some experience values of the crews to fire a grenade with right angle at any
-    // target. This depends on canon type (shot speed, min/max angles etc.) so we need
-    // several ai classes later.
-    static std::map<double, std::map<double, double>> dist_angle_relation;
-    static void fill_dist_angle_relation_map(const double initial_velocity);
-
     // deck gun
     struct gun_barrel {
         double load_time_remaining;
@@ -238,6 +241,8 @@ class ship : public sea_object {
         int start_of_exclusion_radius;
         int end_of_exclusion_radius;
         double calibre;
+        // elevation per distance for initial_velocity, shared by all guns of that velocity
+        const ballistic_table *ballistics;
 
         std::list<struct gun_barrel> gun_barrels;
 
@@ -255,6 +260,7 @@ class ship : public sea_object {
             start_of_exclusion_radius = 0;
             end_of_exclusion_radius = 0;
             calibre = 0.0;
+            ballistics = nullptr;
         }
     };
     bool gun_manning_is_changing;
@@ -269,8 +275,8 @@ class ship : public sea_object {
     int rudder_1_id, rudder_2_id;       // for display()
 
     bool is_target_in_blindspot(const struct gun_turret *gun, angle bearingToTarget);
-    bool calculate_gun_angle(const double distance, angle &elevation, const double initial_velocity);
-    void calc_max_gun_range(double initial_velocity);
+    bool calculate_gun_angle(const double distance, angle &elevation, const ballistic_table &ballistics);
+    void calc_max_gun_range(const ballistic_table &ballistics);
 
     bool detect_other_sea_objects() const { return true; }
 
@@ -284,7 +290,7 @@ class ship : public sea_object {
 
     virtual shipclass get_class() const { return myclass; }
 
-    virtual void simulate(double delta_time);
+    virtual bool simulate(double delta_time);
 
     virtual void sink();
 
@@ -348,6 +354,15 @@ class ship : public sea_object {
 
     /// compute bv_tree parameter values for collision tests
     virtual bv_tree::param compute_bv_tree_params() const;
+
+    /// compute flat_bv_tree parameter values for collision tests
+    virtual flat_bv_tree::param compute_flat_bv_tree_params() const;
+    /// like compute_flat_bv_tree_params, for another orientation of the ship
+    flat_bv_tree::param compute_flat_bv_tree_params(const quaternion &orient) const;
+
+    /// radius of a sphere around the position that encloses the collision tree in every
+    /// orientation and the bounding radius, used as broad phase for hit tests.
+    double get_collision_radius() const;
 };
 
 #endif
@@ -141,24 +141,38 @@ noise noise::compute_ambient_noise_strength(double seastate) {
 }
 
 noise noise_signature::compute_signal_strength(double distance, double speed, bool caviation) const {
+    return compute_received_strength(compute_source_level(speed, caviation), distance);
+}
+
+noise noise_signature::compute_source_level(double speed, bool caviation) const {
     noise result;
     for (unsigned band = 0; band < noise::NR_OF_FREQUENCY_BANDS; ++band) {
         // noise source caused noise
         double L_base = band_data[band].basic_noise_level + band_data[band].speed_factor * speed;
         if (caviation)
             L_base += noise::cavitation_noise;
-        // compute propagation reduction
-        // Sound intensity I = p^2 / (c * ro) with:
-        // p = Pressure (N/m^2 = Pa)
-        // c = speed of sound, 1465 m/s in sea water
-        // ro = specific gravity of water (1000kg/m^3)
-        // Intensity with propagation decreases with square of range, so:
-        // I_prop = I / R^2     and   L = 10 * log_10 (I / I_0), here  L = 10 * log_10 (I)
-        // so  L_prop = 10 * log_10 (I / R^2) = 10 * log_10 (I) - 10 * log_10 (R^2)
-        //            = L - 20 * log_10 (R)
-        if (distance < 1)
-            distance = 1;
-        double L_prop = -20 * log10(distance);
+        result.frequencies[band] = L_base;
+    }
+    return result;
+}
+
+noise noise_signature::compute_received_strength(const noise &source_level, double distance) {
+    noise result;
+    // compute propagation reduction
+    // Sound intensity I = p^2 / (c * ro) with:
+    // p = Pressure (N/m^2 = Pa)
+    // c = speed of sound, 1465 m/s in sea water
+    // ro = specific gravity of water (1000kg/m^3)
+    // Intensity with propagation decreases with square of range, so:
+    // I_prop = I / R^2     and   L = 10 * log_10 (I / I_0), here  L = 10 * log_10 (I)
+    // so  L_prop = 10 * log_10 (I / R^2) = 10 * log_10 (I) - 10 * log_10 (R^2)
+    //            = L - 20 * log_10 (R)
+    if (distance < 1)
+        distance = 1;
+    // same for all bands
+    const double L_prop = -20 * log10(distance);
+    for (unsigned band = 0; band < noise::NR_OF_FREQUENCY_BANDS; ++band) {
+        double L_base = source_level.frequencies[band];
         // compute absorption
         double L_absorb = -noise::noise_absorption[band] * distance;
         // sum up noise source noise
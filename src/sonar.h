@@ -171,6 +171,15 @@ struct noise_signature {
     */
     noise compute_signal_strength(double distance, double speed,
                                   bool caviation = false) const;
+
+    ///\brief returns noise level of source without propagation loss, in dB
+    noise compute_source_level(double speed, bool caviation = false) const;
+
+    ///\brief returns noise of a source with given level after propagation, flat, not in dB
+    /** @param	source_level	noise level of source in dB, see compute_source_level
+        @param	distance	distance to source in meters
+    */
+    static noise compute_received_strength(const noise &source_level, double distance);
 };
 
 // move to a GHG class later, fixme
@@ -0,0 +1,125 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// spatial index of 2d positions for range queries of sensors
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "spatial_index.h"
+#include "error.h"
+#include <algorithm>
+#include <cmath>
+
+spatial_index::spatial_index(double cell_size_)
+    : cell_size(cell_size_), cell_y_min(0), cell_y_max(-1) {
+    if (cell_size <= 0.0)
+        throw error("spatial_index: invalid cell size");
+}
+
+int spatial_index::cell_coord(double v) const {
+    // clamp so that far away or invalid positions still land in a valid cell
+    double c = std::floor(v / cell_size);
+    if (!(c > -1e9))
+        return -1000000000;
+    if (c > 1e9)
+        return 1000000000;
+    return int(c);
+}
+
+void spatial_index::clear() {
+    positions.clear();
+    cells.clear();
+    cell_objects.clear();
+    cell_y_min = 0;
+    cell_y_max = -1;
+}
+
+void spatial_index::build(const std::vector<vector2> &positions_) {
+    clear();
+    positions = positions_;
+    if (positions.empty())
+        return;
+    // sort object indices by cell key, then group them
+    std::vector<std::pair<int64_t, unsigned>> keys(positions.size());
+    cell_y_min = cell_coord(positions[0].y);
+    cell_y_max = cell_y_min;
+    for (unsigned i = 0; i < positions.size(); ++i) {
+        int cy = cell_coord(positions[i].y);
+        cell_y_min = std::min(cell_y_min, cy);
+        cell_y_max = std::max(cell_y_max, cy);
+        keys[i] = std::make_pair(make_key(cell_coord(positions[i].x), cy), i);
+    }
+    std::sort(keys.begin(), keys.end());
+    cell_objects.resize(keys.size());
+    for (unsigned i = 0; i < keys.size(); ++i) {
+        if (cells.empty() || cells.back().key != keys[i].first)
+            cells.push_back(cell{keys[i].first, i, i});
+        cell_objects[i] = keys[i].second;
+        cells.back().end = i + 1;
+    }
+}
+
+void spatial_index::collect(const vector2 &center, double radius, std::vector<unsigned> &result) const {
+    result.clear();
+    if (cells.empty() || !(radius >= 0.0))
+        return;
+    const int cx0 = cell_coord(center.x - radius), cx1 = cell_coord(center.x + radius);
+    const int cy0 = std::max(cell_y_min, cell_coord(center.y - radius));
+    const int cy1 = std::min(cell_y_max, cell_coord(center.y + radius));
+    for (int cy = cy0; cy <= cy1; ++cy) {
+        const int64_t k0 = make_key(cx0, cy), k1 = make_key(cx1, cy);
+        auto it = std::lower_bound(cells.begin(), cells.end(), k0,
+                                   [](const cell &c, int64_t k) { return c.key < k; });
+        for (; it != cells.end() && it->key <= k1; ++it)
+            result.insert(result.end(), cell_objects.begin() + it->first, cell_objects.begin() + it->end);
+    }
+}
+
+void spatial_index::query(const vector2 &center, double radius, std::vector<unsigned> &result) const {
+    collect(center, radius, result);
+    const double r2 = radius * radius;
+    result.erase(std::remove_if(result.begin(), result.end(),
+                                [&](unsigned i) { return positions[i].square_distance(center) > r2; }),
+                 result.end());
+    std::sort(result.begin(), result.end());
+}
+
+void spatial_index::query_sector(const vector2 &center, double radius, angle direction, double half_angle,
+                                 double tolerance, std::vector<unsigned> &result) const {
+    if (half_angle >= 180.0) {
+        query(center, radius + tolerance, result);
+        return;
+    }
+    collect(center, radius + tolerance, result);
+    const double r2 = (radius + tolerance) * (radius + tolerance);
+    auto outside = [&](unsigned i) {
+        vector2 d = positions[i] - center;
+        double dist2 = d.square_length();
+        if (dist2 > r2)
+            return true;
+        double dist = std::sqrt(dist2);
+        if (dist <= tolerance)
+            return false;
+        // the distance to the sector border is dist * sin(angle beyond border)
+        double delta = std::fabs((angle(d) - direction).value_pm180());
+        double allowed = half_angle + std::asin(tolerance / dist) * 180.0 / M_PI;
+        return delta > allowed;
+    };
+    result.erase(std::remove_if(result.begin(), result.end(), outside), result.end());
+    std::sort(result.begin(), result.end());
+}
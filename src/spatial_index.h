@@ -0,0 +1,87 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// spatial index of 2d positions for range queries of sensors
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include "angle.h"
+#include "vector2.h"
+#include <cstdint>
+#include <vector>
+
+/// A uniform grid over 2d positions that answers radius and sector queries.
+///@note Only occupied cells are stored, sorted by row and column, so the index
+///	works for objects spread over any area. A query visits one range of cells
+///	per grid row that it covers. Results are object indices in ascending order,
+///	so callers handle objects in the same order as with a linear scan.
+class spatial_index {
+  public:
+    /// create empty index
+    ///@param cell_size - edge length of grid cells in meters
+    spatial_index(double cell_size = 2000.0);
+
+    /// rebuild index from positions, index of position is the object index
+    void build(const std::vector<vector2> &positions);
+
+    /// remove all objects
+    void clear();
+
+    /// get number of objects the index was built for
+    unsigned get_nr_of_objects() const { return unsigned(positions.size()); }
+
+    /// get cell size in meters
+    double get_cell_size() const { return cell_size; }
+
+    /// collect indices of all objects within radius around center
+    ///@param result - sorted object indices, cleared before
+    void query(const vector2 &center, double radius, std::vector<unsigned> &result) const;
+
+    /// collect indices of all objects within a circle sector
+    ///@param direction - direction of sector center line (nautical angle)
+    ///@param half_angle - half opening angle of sector in degrees, >= 180 means full circle
+    ///@param tolerance - objects with a distance to the sector of at most this value are returned as well
+    ///@param result - sorted object indices, cleared before
+    void query_sector(const vector2 &center, double radius, angle direction, double half_angle,
+                      double tolerance, std::vector<unsigned> &result) const;
+
+  protected:
+    /// grid cell with range of objects in cell_objects
+    struct cell {
+        int64_t key;
+        unsigned first;
+        unsigned end;
+    };
+
+    double cell_size;
+    std::vector<vector2> positions;
+    std::vector<cell> cells;             // sorted by key
+    std::vector<unsigned> cell_objects;  // object indices, grouped by cell
+    int cell_y_min, cell_y_max;          // range of occupied rows
+
+    int cell_coord(double v) const;
+    static int64_t make_key(int cx, int cy) { return int64_t(cy) * (int64_t(1) << 32) + (int64_t(cx) - INT32_MIN); }
+
+    /// collect candidates in all cells touching the square around center
+    void collect(const vector2 &center, double radius, std::vector<unsigned> &result) const;
+};
+
+#endif
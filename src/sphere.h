@@ -45,6 +45,15 @@ class sphere_t {
         D r = radius + other.radius;
         return center.square_distance(other.center) < r * r;
     }
+    /// determine if a sphere of radius r moving from a to b touches this sphere
+    bool intersects_swept(const vector3t<D> &a, const vector3t<D> &b, const D &r) const {
+        // closest point of segment to center, parameter clamped to [0,1]
+        vector3t<D> d = b - a;
+        D dd = d.square_length();
+        D t = (dd > D(0)) ? std::min(std::max((center - a) * d / dd, D(0)), D(1)) : D(0);
+        D rr = radius + r;
+        return center.square_distance(a + d * t) <= rr * rr;
+    }
     /// build minimum combination sphere
     sphere_t<D> compute_bound(const sphere_t<D> &other) const {
         // new center is on axis between the two spheres
@@ -406,7 +406,7 @@ int submarine::find_stored_torpedo(bool usebow) {
     return tubenr;
 }
 
-void submarine::simulate(double delta_time) {
+bool submarine::simulate(double delta_time) {
     // diveplane animation
     if (diveplane_1_id >= 0)
         mymodel->set_object_angle(diveplane_1_id, -bow_depth_rudder.angle);
@@ -429,9 +429,11 @@ void submarine::simulate(double delta_time) {
     double mass_orig = mass;
     mass += mass_flooded_tanks;
     mass_inv = 1.0 / mass;
-    ship::simulate(delta_time);
+    bool simulated = ship::simulate(delta_time);
     mass = mass_orig;
     mass_inv = 1.0 / mass;
+    if (!simulated)
+        return false;
 
     if (!permanent_dive) {
         depth_steering_logic();
@@ -491,7 +493,7 @@ void submarine::simulate(double delta_time) {
         // fixme: limit update of bearing to each 5-30 secs or so,
         // quality depends on duration of observance and quality of crew!
         if (TDC.auto_mode_enabled()) {
-            TDC.set_bearing(angle(target->get_pos().xy() - get_pos().xy()));
+            TDC.set_bearing(angle(target->get_step_pos().xy() - get_pos().xy()));
         }
     }
 
@@ -549,6 +551,7 @@ void submarine::simulate(double delta_time) {
         hearing_device = hearing_device_GHG;
     else
         hearing_device = hearing_device_BG;
+    return true;
 }
 
 void submarine::set_target(sea_object *s) {
@@ -816,7 +819,7 @@ double submarine::get_max_speed() const {
     return ms;
 }
 
-float submarine::surface_visibility(const vector2 &watcher) const {
+void submarine::compute_surface_visibility_factors(double &scale, double &offset) const {
     // fixme: that model is too crude,
     // we compute cross sections with standard draught, so the hull is ~ 1m above
     // the water. In reality it is hidden in the waves when watched from a longer
@@ -827,11 +830,11 @@ float submarine::surface_visibility(const vector2 &watcher) const {
     // the rest of the code has to be adapted
 
     double depth = get_depth();
-    float dive_factor = 0.0f;
+    scale = 0.0;
+    offset = 0.0;
 
     if (depth >= 0.0f && depth < 10.0f) {
-        dive_factor = 0.1f * (10.0f - depth) *
-                      ship::surface_visibility(watcher);
+        scale = 0.1f * (10.0f - depth);
     }
 
     // Some modifiers when submarine is submerged.
@@ -852,13 +855,18 @@ float submarine::surface_visibility(const vector2 &watcher) const {
         }
 
         double speed = get_speed();
-        dive_factor += diverse_modifiers * (0.5f + 0.5f * speed / max_speed_forward);
+        offset = diverse_modifiers * (0.5f + 0.5f * speed / max_speed_forward);
     }
+}
 
-    return dive_factor;
+float submarine::surface_visibility(const vector2 &watcher) const {
+    double scale, offset;
+    compute_surface_visibility_factors(scale, offset);
+    double cs = (scale != 0.0) ? ship::surface_visibility(watcher) : 0.0;
+    return float(scale * cs + offset);
 }
 
-float submarine::sonar_visibility(const vector2 &watcher) const {
+float submarine::compute_sonar_dive_factor() const {
     double depth = get_depth();
     float diveFactor = 0.0f;
 
@@ -869,12 +877,25 @@ float submarine::sonar_visibility(const vector2 &watcher) const {
         // diving process.
         diveFactor = 0.125f * (depth - 2.0f);
     }
+    return diveFactor;
+}
+
+float submarine::sonar_visibility(const vector2 &watcher) const {
+    float diveFactor = compute_sonar_dive_factor();
 
     diveFactor *= 1.0 / 700.0 * get_cross_section(watcher);
 
     return diveFactor;
 }
 
+void submarine::get_sensor_target(sensor_target &st) const {
+    ship::get_sensor_target(st);
+    st.is_submarine = true;
+    st.submerged = is_submerged();
+    compute_surface_visibility_factors(st.surface_scale, st.surface_offset);
+    st.sonar_scale = compute_sonar_dive_factor();
+}
+
 void submarine::scope_to_level(float f) {
     scope_raise_to_level = myclamp(f, 0.0f, 1.0f);
 }
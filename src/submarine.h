@@ -216,6 +216,11 @@ class submarine : public ship {
 
     int diveplane_1_id, diveplane_2_id; // for display()
 
+    // surface visibility is scale * cross section + offset, depending on depth etc.
+    void compute_surface_visibility_factors(double &scale, double &offset) const;
+    // factor of cross section for active sonar, depending on depth
+    float compute_sonar_dive_factor() const;
+
   public:
     // there were more types, I, X (mine layer), XIV (milk cow), VIIf, (and VIId)
     // and some experimental types. (VIIc42, XVIIa/b)
@@ -236,7 +241,7 @@ class submarine : public ship {
     virtual void load(const xml_elem &parent);
     virtual void save(xml_elem &parent) const;
 
-    virtual void simulate(double delta_time);
+    virtual bool simulate(double delta_time);
 
     void set_target(sea_object *s);
 
@@ -282,6 +287,7 @@ class submarine : public ship {
     virtual float surface_visibility(const vector2 &watcher) const;
     virtual float sonar_visibility(const vector2 &watcher) const;
     virtual double get_noise_factor() const;
+    virtual void get_sensor_target(sensor_target &st) const;
     // return pointer to torpedo in tube or NULL if tube is empty
     virtual stored_torpedo &get_torp_in_tube(unsigned tubenr);
     virtual const stored_torpedo &get_torp_in_tube(unsigned tubenr) const;
@@ -47,6 +47,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "model.h"
 #include "audio_backend.h"
 #include "music.h"
+#include "profiler.h"
 #include "mymain.cpp"
 #include "scoring_manager.h"
 #include "ship.h"
@@ -370,6 +371,15 @@ game::run_state game__exec(game &gm, user_interface &ui) {
     double totaltime = 0;
     double measuretime = 5; // seconds
 
+    // profiler=1 measures stages and shows them, profiler_output names a
+    // .csv or .json (Chrome trace) file that gets the measured frames of the game,
+    // written when the game ends or the recording reaches its maximum size.
+    profiler &prof = profiler::instance();
+    prof.set_enabled(cfg::instance().geti("profiler") != 0);
+    const std::string profiler_output = cfg::instance().gets("profiler_output");
+    if (prof.is_enabled() && !profiler_output.empty())
+        prof.start_recording(profiler_output);
+
     ui.resume_all_sound();
 
     // draw one initial frame
@@ -383,36 +393,45 @@ game::run_state game__exec(game &gm, user_interface &ui) {
         // maybe limit input processing to 30 fps
         ui.process_input(events);
 
-        // this time_scaling is bad. hits may get computed wrong when time
-        // scaling is too high. fixme
         unsigned thistime = sys().millisec();
         if (gm.get_freezetime_start() > 0)
             throw error("freeze_time() called without unfreeze_time() call");
         lasttime += gm.process_freezetime();
         unsigned time_scale = ui.time_scaling();
-        double delta_time = (thistime - lasttime) / 1000.0; // * time_scale;
+        double delta_time = (thistime - lasttime) / 1000.0;
         totaltime += (thistime - lasttime) / 1000.0;
         lasttime = thistime;
 
-        // next simulation step
+        // next simulation step. The game simulates in fixed steps, so compressed
+        // time gives the same results as real time.
         if (!ui.paused()) {
-            for (unsigned j = 0; j < time_scale; ++j) {
-                gm.simulate(time_scale == 1 ? delta_time : (1.0 / 30.0));
-                // evaluate events of game, because they are cleared
-                // by next call of game::simulate and new ones are
-                // generated
-                const std::list<std::unique_ptr<event>> &events = gm.get_events();
-                for (auto it = events.begin(); it != events.end(); ++it) {
-                    (*it)->evaluate(ui);
-                }
+            profile_scope("simulate");
+            gm.simulate(delta_time * time_scale);
+            // evaluate events of game, because they are cleared
+            // by next call of game::simulate and new ones are
+            // generated
+            const std::list<std::unique_ptr<event>> &events = gm.get_events();
+            for (auto it = events.begin(); it != events.end(); ++it) {
+                (*it)->evaluate(ui);
             }
         }
 
         // fixme: make use of game::job interface, 3600/256 = 14.25 secs job period
         ui.set_time(gm.get_time());
-        ui.display();
+        {
+            profile_scope("display");
+            ui.display();
+        }
         ++frames;
 
+        // rolling stage times of the profiler
+        if (prof.is_enabled()) {
+            prof.end_frame();
+            sys().prepare_2d_drawing();
+            font_vtremington12->print(8, 8, prof.get_overlay_text(), color(255, 255, 255), true);
+            sys().unprepare_2d_drawing();
+        }
+
         // record fps
         if (totaltime - fpstime >= measuretime) {
             fpstime = totaltime;
@@ -425,6 +444,9 @@ game::run_state game__exec(game &gm, user_interface &ui) {
 
     ui.pause_all_sound();
 
+    if (prof.is_recording())
+        prof.stop_recording();
+
     return gm.get_run_state(); // if player is killed, end game (1), else show menu (0)
 }
 
@@ -1811,11 +1833,20 @@ int mymain(list<string> &args) {
     mycfg.register_option("water_detail", 128);
     mycfg.register_option("wave_fft_res", 128);
     mycfg.register_option("wave_phases", 256);
+    mycfg.register_option("wave_streaming", false); // compute wave phases on the fly
+    mycfg.register_option("wave_seed", 1); // 0 = different waves on every run
+    mycfg.register_option("wave_cache_dir", std::string("")); // directory for precomputed waves, empty = no cache
     mycfg.register_option("wavetile_length", 256.0f);
     mycfg.register_option("wave_tidecycle_time", 10.24f);
     mycfg.register_option("usex86sse", true);
     mycfg.register_option("language", 0);
-    mycfg.register_option("cpucores", 1);
+    mycfg.register_option("cpucores", 1); // 0 = use all hardware threads
+    mycfg.register_option("sim_step_rate", 20);       // simulation steps per second of game time
+    mycfg.register_option("sim_collision_rate", 10);  // collision checks per second of game time
+    mycfg.register_option("sim_visibility_rate", 1);  // view distance updates per second of game time
+    mycfg.register_option("sim_max_steps", 0);        // max. steps per frame, 0 = derive from max. time compression
+    mycfg.register_option("profiler", 0);             // 1 = measure simulation and render stages, show overlay
+    mycfg.register_option("profiler_output", std::string("")); // .csv or .json file for measured frames
     mycfg.register_option("terrain_texture_resolution", 0.1f);
     mycfg.register_option("terrain_detail", 1);
 
@@ -1904,6 +1935,10 @@ int mymain(list<string> &args) {
         mycfg.save(configdirectory + "config");
     }
 
+    // precomputed water is cached in the config directory if no other directory is set
+    if (mycfg.gets("wave_cache_dir").empty())
+        mycfg.set("wave_cache_dir", configdirectory + "wavecache/");
+
     //	mycfg.save("./testconf");
 
     glsl_shader::enable_hqsfx = mycfg.getb("use_hqsfx");
@@ -0,0 +1,65 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Broad phase collision detection with bounding spheres (sweep and prune)
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef SWEEP_AND_PRUNE_H
+#define SWEEP_AND_PRUNE_H
+
+#include "sphere.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/// Compute all pairs of intersecting spheres.
+///@note Spheres are sorted by their minimum x value, so only spheres overlapping
+///	in x need to be tested against each other. For objects spread over the sea
+///	this is nearly linear instead of quadratic.
+///@param spheres - bounding spheres of the objects
+///@param pairs - resulting index pairs (i, j) with i < j, sorted by i, then j.
+///@returns number of sphere pairs that were tested
+template <class D>
+unsigned long sweep_and_prune(const std::vector<sphere_t<D>> &spheres, std::vector<std::pair<unsigned, unsigned>> &pairs) {
+    pairs.clear();
+    std::vector<unsigned> order(spheres.size());
+    for (unsigned i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&spheres](unsigned a, unsigned b) {
+        return spheres[a].center.x - spheres[a].radius < spheres[b].center.x - spheres[b].radius;
+    });
+    unsigned long nr_tested = 0;
+    for (unsigned k = 0; k < order.size(); ++k) {
+        const sphere_t<D> &s0 = spheres[order[k]];
+        const D maxx = s0.center.x + s0.radius;
+        for (unsigned l = k + 1; l < order.size(); ++l) {
+            const sphere_t<D> &s1 = spheres[order[l]];
+            if (s1.center.x - s1.radius > maxx)
+                break; // all following spheres start even farther away
+            ++nr_tested;
+            if (s0.intersects(s1))
+                pairs.push_back(std::make_pair(std::min(order[k], order[l]), std::max(order[k], order[l])));
+        }
+    }
+    // keep order of a brute force test, so results don't depend on object positions
+    std::sort(pairs.begin(), pairs.end());
+    return nr_tested;
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// File of all terrain tiles, mapped into memory
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "terrain_tile_file.h"
+#include "block_codec.h"
+#include "error.h"
+#include <cstring>
+
+const binary_container::format terrain_tile_file::file_format = {"DFTDTILE", terrain_tile_file::version,
+                                                                  "terrain tile file"};
+const char *const terrain_tile_file::default_name = "tiles.ddtile";
+
+terrain_tile_file::terrain_tile_file(const std::string &filename)
+    : file(std::make_unique<reader>(filename, file_format, 0, false)) {
+    size_t size;
+    const unsigned char *p = file->get_section(0, size);
+    if (size != sizeof(params))
+        file->throw_corrupt();
+    memcpy(&params, p, sizeof(params));
+    if (params.tile_size == 0 || params.element_size == 0 || params.codec > codec_block ||
+        params.tiles_x != (params.cols + params.tile_size - 1) / params.tile_size ||
+        params.tiles_y != (params.rows + params.tile_size - 1) / params.tile_size ||
+        file->get_nr_of_sections() != 1 + uint64_t(params.tiles_x) * params.tiles_y)
+        file->throw_corrupt();
+    // raw tiles are copied without further checks
+    if (params.codec == codec_raw) {
+        const uint64_t tile_bytes = uint64_t(params.tile_size) * params.tile_size * params.element_size;
+        for (unsigned i = 1; i < file->get_nr_of_sections(); ++i) {
+            file->get_section(i, size);
+            if (size != 0 && size != tile_bytes)
+                file->throw_corrupt();
+        }
+    }
+}
+
+bool terrain_tile_file::read_tile(const vector2i &tile_idx, void *dest) const {
+    if (tile_idx.x < 0 || tile_idx.y < 0 || unsigned(tile_idx.x) >= params.tiles_x ||
+        unsigned(tile_idx.y) >= params.tiles_y)
+        throw error(std::string("invalid tile index in terrain tile file ") + file->get_filename());
+    size_t size;
+    const unsigned char *src = file->get_section(1 + unsigned(tile_idx.y) * params.tiles_x + tile_idx.x, size);
+    if (size == 0)
+        return false;
+    const size_t tile_bytes = size_t(params.tile_size) * params.tile_size * params.element_size;
+    if (params.codec == codec_raw)
+        memcpy(dest, src, tile_bytes);
+    else
+        block_codec::decompress(src, size, dest, tile_bytes);
+    return true;
+}
+
+terrain_tile_file::writer::writer(const std::string &filename_, const vector2i &image_size, unsigned tile_size,
+                                  unsigned element_size, codec_type codec_)
+    : binary_container::writer(filename_, file_format, 0),
+      nr_of_tiles((image_size.x + tile_size - 1) / tile_size, (image_size.y + tile_size - 1) / tile_size),
+      tile_bytes(size_t(tile_size) * tile_size * element_size), codec(codec_) {
+    parameters p;
+    memset(&p, 0, sizeof(p));
+    p.cols = uint32_t(image_size.x);
+    p.rows = uint32_t(image_size.y);
+    p.tile_size = tile_size;
+    p.element_size = element_size;
+    p.tiles_x = uint32_t(nr_of_tiles.x);
+    p.tiles_y = uint32_t(nr_of_tiles.y);
+    p.codec = uint32_t(codec);
+    write(&p, sizeof(p));
+    set_nr_of_sections(1 + unsigned(nr_of_tiles.x * nr_of_tiles.y));
+    if (codec == codec_block)
+        buffer.resize(block_codec::max_compressed_size(tile_bytes));
+}
+
+void terrain_tile_file::writer::add_tile(const vector2i &tile_idx, const void *data) {
+    if (tile_idx.x < 0 || tile_idx.y < 0 || tile_idx.x >= nr_of_tiles.x || tile_idx.y >= nr_of_tiles.y)
+        throw error(std::string("invalid tile index for terrain tile file ") + get_filename());
+    const unsigned section = 1 + unsigned(tile_idx.y * nr_of_tiles.x + tile_idx.x);
+    if (codec == codec_block)
+        write(section, buffer.data(), block_codec::compress(data, tile_bytes, buffer.data()));
+    else
+        write(section, data, tile_bytes);
+}
@@ -0,0 +1,113 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// File of all terrain tiles, mapped into memory
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef TERRAIN_TILE_FILE_H
+#define TERRAIN_TILE_FILE_H
+
+#include "binary_container.h"
+#include "vector2.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// All tiles of a tiled terrain image in one file, which is mapped into memory.
+///@note The file is a binary_container. Its first section holds image and tile
+///	dimensions and codec, followed by one section per tile (row major, tile index =
+///	tile coordinate / tile size). Tiles are stored in the same layout as in memory
+///	(morton order), either raw or compressed with block_codec. Missing tiles are
+///	empty sections. Loading a tile is a copy or a fast decompression from the mapped
+///	memory, instead of opening a file and decompressing bzip2 data as for the old
+///	tile folders. The checksum is not verified, that would read the whole file.
+class terrain_tile_file : public binary_container {
+  public:
+    /// version of file format, increase on every change of format
+    static const uint32_t version = 2;
+    /// magic, version and name of file kind
+    static const format file_format;
+    /// name of tile file in terrain data folder
+    static const char *const default_name;
+
+    /// codecs of tile data
+    enum codec_type {
+        codec_raw,
+        codec_block
+    };
+
+    /// map file and check header and table, throws error if file is missing or corrupt
+    terrain_tile_file(const std::string &filename);
+
+    /// get number of columns/rows of whole image
+    vector2i get_image_size() const { return vector2i(int(params.cols), int(params.rows)); }
+    /// get number of tiles in x/y direction
+    vector2i get_nr_of_tiles() const { return vector2i(int(params.tiles_x), int(params.tiles_y)); }
+    /// get edge length of tiles in samples
+    unsigned get_tile_size() const { return params.tile_size; }
+    /// get size of one sample in bytes
+    unsigned get_element_size() const { return params.element_size; }
+    /// get codec of tile data
+    codec_type get_codec() const { return codec_type(params.codec); }
+
+    /// read tile to dest, which must hold tile_size^2 samples.
+    ///@returns false if tile is not stored in the file, dest is unchanged then
+    ///@note throws error if tile index is invalid or tile data is corrupt
+    bool read_tile(const vector2i &tile_idx, void *dest) const;
+
+    /// writes a tile file, tiles may be added in any order
+    class writer : public binary_container::writer {
+      public:
+        /// open temporary file for writing, throws error on failure
+        writer(const std::string &filename, const vector2i &image_size, unsigned tile_size,
+               unsigned element_size, codec_type codec);
+        /// add tile with tile_size^2 samples in morton order
+        void add_tile(const vector2i &tile_idx, const void *data);
+
+      protected:
+        vector2i nr_of_tiles;
+        size_t tile_bytes;
+        codec_type codec;
+        std::vector<char> buffer;
+    };
+
+  protected:
+    /// image and tile dimensions, first section of file
+    struct parameters {
+        uint32_t cols;
+        uint32_t rows;
+        uint32_t tile_size;
+        uint32_t element_size;
+        uint32_t tiles_x;
+        uint32_t tiles_y;
+        uint32_t codec;
+        uint32_t reserved;
+    };
+
+    std::unique_ptr<reader> file;
+    parameters params;
+
+  private:
+    terrain_tile_file(const terrain_tile_file &) = delete;
+    terrain_tile_file &operator=(const terrain_tile_file &) = delete;
+};
+
+#endif
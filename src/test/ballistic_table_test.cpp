@@ -0,0 +1,74 @@
+/*
+ * Test para ballistic_table.h: distancias en forma cerrada iguales a una
+ * simulacion del proyectil, elevacion interpolada y tablas compartidas.
+ */
+#include "catch_amalgamated.hpp"
+#include "../ballistic_table.h"
+#include "../global_constants.h"
+#include "../thread_pool.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+// shell flight like gun_shell and sea_object::simulate do it, with a small time step
+double simulate_distance(double v, double elevation_deg, double dt) {
+    angle a(elevation_deg);
+    double vd = v * a.cos(), vz = v * a.sin();
+    double d = vd * ballistic_table::launch_straight_time;
+    double z = ballistic_table::launch_height + vz * ballistic_table::launch_straight_time;
+    if (z <= 0)
+        return vd * ballistic_table::launch_height / -vz;
+    while (true) {
+        double nz = z + vz * dt;
+        if (nz <= 0)
+            return d + vd * dt * z / (z - nz);
+        z = nz;
+        d += vd * dt;
+        vz -= GRAVITY * dt;
+    }
+}
+} // namespace
+
+TEST_CASE("ballistic_table - distancia igual que la simulacion", "[ballistic_table]") {
+    for (double v : {300.0, 700.0}) {
+        for (double a : {-10.0, -1.0, 0.0, 2.5, 10.0, 30.0, 44.0}) {
+            double d = ballistic_table::compute_distance(v, a);
+            REQUIRE(std::fabs(d - simulate_distance(v, a, 0.0005)) < 0.5 + d * 1e-4);
+        }
+    }
+    // without launch height and straight part the range at 45 degrees is v^2/g
+    double d45 = ballistic_table::compute_distance(500.0, 45.0);
+    REQUIRE(d45 > 500.0 * 500.0 / GRAVITY);
+    REQUIRE(d45 < 500.0 * 500.0 / GRAVITY + 500.0);
+}
+
+TEST_CASE("ballistic_table - elevacion para distancia", "[ballistic_table]") {
+    ballistic_table t(600.0);
+    REQUIRE(t.size() > 600);
+    angle e;
+    for (double a = -5.0; a < 40.0; a += 0.37) {
+        double d = ballistic_table::compute_distance(600.0, a);
+        REQUIRE(t.get_elevation(d, e));
+        // interpolation error is much smaller than the table step
+        double diff = e.value_pm180() - a;
+        REQUIRE(std::fabs(diff) < 0.01);
+    }
+    REQUIRE_FALSE(t.get_elevation(t.get_max_range() + 1.0, e));
+    REQUIRE(t.get_elevation(t.get_max_range(), e));
+    // closer than possible gives the lowest elevation
+    REQUIRE(t.get_elevation(0.0, e));
+    REQUIRE(e.value_pm180() == Catch::Approx(-20.0));
+}
+
+TEST_CASE("ballistic_table - tablas compartidas entre hilos", "[ballistic_table]") {
+    const ballistic_table &a = ballistic_table::get(812.0);
+    REQUIRE(&a == &ballistic_table::get(812.0));
+    REQUIRE(&a != &ballistic_table::get(813.0));
+    REQUIRE(a.get_initial_velocity() == 812.0);
+
+    thread_pool tp(4);
+    std::vector<const ballistic_table *> seen(64);
+    tp.run(64, [&](unsigned task, unsigned) { seen[task] = &ballistic_table::get(400.0 + (task % 4)); });
+    for (unsigned i = 0; i < 64; ++i)
+        REQUIRE(seen[i] == &ballistic_table::get(400.0 + (i % 4)));
+}
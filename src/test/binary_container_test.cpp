@@ -0,0 +1,69 @@
+/*
+ * Test para binary_container.h: secciones en orden y en cualquier orden,
+ * secciones vacias, comprobacion de la suma y archivos obsoletos.
+ */
+#include "catch_amalgamated.hpp"
+#include "../binary_container.h"
+#include "../error.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+const char *filename = "binary_container_test.bin";
+const binary_container::format test_format = {"DFTDTEST", 1, "test container"};
+} // namespace
+
+TEST_CASE("binary_container - secciones en cualquier orden", "[binary_container]") {
+    {
+        binary_container::writer w(filename, test_format, 7);
+        w.set_nr_of_sections(4);
+        std::vector<uint32_t> a({1, 2, 3}), b({4});
+        w.write(2, a.data(), a.size() * sizeof(uint32_t));
+        w.write(0, b.data(), b.size() * sizeof(uint32_t));
+        REQUIRE_THROWS_AS(w.write(2, a.data(), a.size() * sizeof(uint32_t)), error);
+        w.finish();
+    }
+    // the checksum is over the sections in table order, not in order of writing
+    binary_container::reader r(filename, test_format, 7, true);
+    REQUIRE(r.get_nr_of_sections() == 4);
+    size_t size;
+    uint64_t checksum = binary_container::hash(nullptr, 0);
+    for (unsigned i = 0; i < r.get_nr_of_sections(); ++i) {
+        const unsigned char *d = r.get_section(i, size);
+        checksum = binary_container::hash(d, size, checksum);
+    }
+    REQUIRE(checksum == r.get_checksum());
+    const uint32_t *p = reinterpret_cast<const uint32_t *>(r.get_section(2, size));
+    REQUIRE(size == 3 * sizeof(uint32_t));
+    REQUIRE(p[2] == 3);
+    r.get_section(1, size);
+    REQUIRE(size == 0);
+    r.get_section(3, size);
+    REQUIRE(size == 0);
+    REQUIRE_THROWS_AS(r.get_section(4, size), error);
+    std::remove(filename);
+}
+
+TEST_CASE("binary_container - obsoleto o corrupto", "[binary_container]") {
+    {
+        binary_container::writer w(filename, test_format, 7);
+        w.write(std::vector<double>(100, 0.5));
+        w.finish();
+    }
+    REQUIRE_NOTHROW(binary_container::reader(filename, test_format, 7, true));
+    REQUIRE_THROWS_AS(binary_container::reader(filename, test_format, 8, true), error);
+    binary_container::format other = test_format;
+    other.version = 2;
+    REQUIRE_THROWS_AS(binary_container::reader(filename, other, 7, true), error);
+    {
+        // first byte of the section, it follows the 48 bytes header
+        std::fstream f(filename, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(48);
+        f.put('x');
+    }
+    REQUIRE_NOTHROW(binary_container::reader(filename, test_format, 7, false));
+    REQUIRE_THROWS_AS(binary_container::reader(filename, test_format, 7, true), error);
+    std::remove(filename);
+}
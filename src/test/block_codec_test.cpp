@@ -0,0 +1,89 @@
+/*
+ * Test para block_codec.h: compresion y descompresion devuelven los datos
+ * originales, los datos comprimibles se reducen y los datos corruptos se detectan.
+ */
+#include "catch_amalgamated.hpp"
+#include "../block_codec.h"
+#include "../error.h"
+#include "../random_generator.h"
+#include <cstdint>
+#include <vector>
+
+namespace {
+std::vector<uint8_t> roundtrip(const std::vector<uint8_t> &data, size_t &compressed_size) {
+    std::vector<uint8_t> c(block_codec::max_compressed_size(data.size()));
+    compressed_size = block_codec::compress(data.data(), data.size(), c.data());
+    REQUIRE(compressed_size <= c.size());
+    std::vector<uint8_t> d(data.size());
+    block_codec::decompress(c.data(), compressed_size, d.data(), d.size());
+    return d;
+}
+
+// heights like in terrain tiles, smooth with some noise
+std::vector<uint8_t> make_heights(unsigned n, unsigned seed) {
+    random_generator rg(seed);
+    std::vector<uint8_t> data(n * 2);
+    int16_t h = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        if (rg.rndf() < 0.2f)
+            h += int16_t(rg.rndf() * 8.0f) - 4;
+        data[2 * i] = uint8_t(h & 0xff);
+        data[2 * i + 1] = uint8_t(uint16_t(h) >> 8);
+    }
+    return data;
+}
+} // namespace
+
+TEST_CASE("block_codec - datos vacios y pequenos", "[block_codec]") {
+    size_t cs;
+    for (unsigned n = 0; n < 20; ++n) {
+        std::vector<uint8_t> data(n, 7);
+        REQUIRE(roundtrip(data, cs) == data);
+    }
+}
+
+TEST_CASE("block_codec - datos aleatorios", "[block_codec]") {
+    random_generator rg(1);
+    std::vector<uint8_t> data(100000);
+    for (auto &d : data)
+        d = uint8_t(rg.rnd() & 0xff);
+    size_t cs;
+    REQUIRE(roundtrip(data, cs) == data);
+    REQUIRE(cs <= block_codec::max_compressed_size(data.size()));
+}
+
+TEST_CASE("block_codec - datos comprimibles", "[block_codec]") {
+    size_t cs;
+    // long runs need extended lengths and overlapping matches
+    std::vector<uint8_t> zeros(70000, 0);
+    REQUIRE(roundtrip(zeros, cs) == zeros);
+    REQUIRE(cs < 400);
+    std::vector<uint8_t> heights = make_heights(256 * 256, 2);
+    REQUIRE(roundtrip(heights, cs) == heights);
+    REQUIRE(cs < heights.size() / 2);
+}
+
+TEST_CASE("block_codec - datos corruptos", "[block_codec]") {
+    std::vector<uint8_t> data = make_heights(4096, 3);
+    std::vector<uint8_t> c(block_codec::max_compressed_size(data.size()));
+    size_t cs = block_codec::compress(data.data(), data.size(), c.data());
+    std::vector<uint8_t> d(data.size());
+    // wrong output size
+    REQUIRE_THROWS_AS(block_codec::decompress(c.data(), cs, d.data(), d.size() - 1), error);
+    // truncated input
+    REQUIRE_THROWS_AS(block_codec::decompress(c.data(), cs / 2, d.data(), d.size()), error);
+    // offset before start of output
+    const uint8_t bad[] = {0x10, 'a', 0x10, 0x00, 0x00};
+    REQUIRE_THROWS_AS(block_codec::decompress(bad, sizeof(bad), d.data(), 5), error);
+    // random garbage never writes outside the output
+    random_generator rg(4);
+    for (unsigned i = 0; i < 200; ++i) {
+        std::vector<uint8_t> garbage(64);
+        for (auto &g : garbage)
+            g = uint8_t(rg.rnd() & 0xff);
+        try {
+            block_codec::decompress(garbage.data(), garbage.size(), d.data(), 256);
+        } catch (error &) {
+        }
+    }
+}
@@ -0,0 +1,162 @@
+/*
+ * Test para buoyancy_kernel.h: la variante SIMD da los mismos valores que la
+ * escalar y que el bucle por voxel de antes en ship::compute_force_and_torque.
+ * Benchmark por barco con 1000, 5000 y 20000 voxels:
+ * buoyancy_kernel_test "[.benchmark]"
+ */
+#include "catch_amalgamated.hpp"
+#include "../buoyancy_kernel.h"
+#include "../random_generator.h"
+#include "../vector3.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+// voxels of a hull 80m long, 10m wide and 10m high, half of it below water
+struct hull {
+    struct voxel {
+        vector3f relative_position;
+        float part_of_volume, relative_mass;
+    };
+    std::vector<voxel> voxels;
+    std::vector<float> x, y, z, part_of_volume, relative_mass, flooded_mass, water_height;
+    matrix4f transmat;
+    buoyancy_kernel::parameters par;
+    hull(unsigned n, unsigned seed) {
+        random_generator rg(seed);
+        for (unsigned i = 0; i < n; ++i) {
+            voxel v;
+            v.relative_position = vector3f((rg.rndf() - 0.5f) * 10.0f, (rg.rndf() - 0.5f) * 80.0f, (rg.rndf() - 0.5f) * 10.0f);
+            v.part_of_volume = rg.rndf();
+            v.relative_mass = 1.0f / n;
+            voxels.push_back(v);
+            x.push_back(v.relative_position.x);
+            y.push_back(v.relative_position.y);
+            z.push_back(v.relative_position.z);
+            part_of_volume.push_back(v.part_of_volume);
+            relative_mass.push_back(v.relative_mass);
+            flooded_mass.push_back((i % 7 == 0) ? rg.rndf() * 100.0f : 0.0f);
+            // waves of some meters, a few voxels deeply submerged
+            water_height.push_back((i % 11 == 0) ? 3.0e38f : std::sin(v.relative_position.y * 0.1f) * 2.0f);
+        }
+        transmat = matrix4f::rot_z(12.0f) * matrix4f::rot_x(3.0f) * matrix4f::rot_y(-5.0f);
+        par.position_z = -0.5f;
+        par.voxel_radius = 0.8f;
+        par.voxel_volume_force = 9.81f * 1000.0f * 80.0f * 10.0f * 10.0f / n;
+        par.gravity_force = -9.81f * 4.0e6f;
+        par.flooded_gravity = -9.81f;
+    }
+
+    // the loop of ship::compute_force_and_torque before the kernels
+    buoyancy_kernel::sums reference() const {
+        buoyancy_kernel::sums s;
+        vector3 dr_torque;
+        for (unsigned i = 0; i < voxels.size(); ++i) {
+            vector3f p = transmat.mul4vec3xlat(voxels[i].relative_position);
+            const double voxel_z = p.z + par.position_z;
+            double voxel_below_water = std::max(std::min((voxel_z - water_height[i]) / par.voxel_radius, 1.0), -1.0);
+            if (voxel_below_water < 1.0) {
+                double submerged_part = 1.0 - (voxel_below_water + 1.0) * 0.5;
+                double lift_force = voxels[i].part_of_volume * par.voxel_volume_force * submerged_part;
+                s.volume_below_water += voxels[i].part_of_volume * submerged_part;
+                s.force_z += lift_force;
+                dr_torque += p.cross(vector3(0, 0, lift_force));
+            }
+            double relative_gravity_force = par.gravity_force * voxels[i].relative_mass;
+            relative_gravity_force += flooded_mass[i] * par.flooded_gravity;
+            s.force_z += relative_gravity_force;
+            dr_torque += p.cross(vector3(0, 0, relative_gravity_force));
+        }
+        s.torque_x = dr_torque.x;
+        s.torque_y = dr_torque.y;
+        return s;
+    }
+
+    buoyancy_kernel::sums compute(buoyancy_kernel::path p, std::vector<float> &tx, std::vector<float> &ty,
+                                  std::vector<float> &tz) const {
+        const unsigned n = unsigned(x.size());
+        tx.resize(n);
+        ty.resize(n);
+        tz.resize(n);
+        buoyancy_kernel::transform(p, n, &x[0], &y[0], &z[0], transmat, &tx[0], &ty[0], &tz[0]);
+        return buoyancy_kernel::accumulate(p, n, &tx[0], &ty[0], &tz[0], &water_height[0], &part_of_volume[0],
+                                           &relative_mass[0], &flooded_mass[0], par);
+    }
+};
+
+void require_close(double a, double b, double scale) {
+    REQUIRE(std::fabs(a - b) <= scale * 1e-4);
+}
+} // namespace
+
+TEST_CASE("buoyancy_kernel - escalar siempre disponible", "[buoyancy_kernel]") {
+    REQUIRE(buoyancy_kernel::is_supported(buoyancy_kernel::scalar));
+    REQUIRE(buoyancy_kernel::is_supported(buoyancy_kernel::get_best_path()));
+    REQUIRE(std::string(buoyancy_kernel::get_name(buoyancy_kernel::sse2)) == "sse2");
+}
+
+TEST_CASE("buoyancy_kernel - transformacion igual que mul4vec3xlat", "[buoyancy_kernel]") {
+    // odd size so the scalar tail of the SIMD loops is used too
+    hull h(1003, 1);
+    for (unsigned pi = 0; pi < buoyancy_kernel::nr_of_paths; ++pi) {
+        auto p = buoyancy_kernel::path(pi);
+        if (!buoyancy_kernel::is_supported(p))
+            continue;
+        std::vector<float> tx(h.x.size()), ty(h.x.size()), tz(h.x.size());
+        buoyancy_kernel::transform(p, unsigned(h.x.size()), &h.x[0], &h.y[0], &h.z[0], h.transmat, &tx[0], &ty[0], &tz[0]);
+        for (unsigned i = 0; i < h.voxels.size(); ++i) {
+            vector3f r = h.transmat.mul4vec3xlat(h.voxels[i].relative_position);
+            REQUIRE(tx[i] == r.x);
+            REQUIRE(ty[i] == r.y);
+            REQUIRE(tz[i] == r.z);
+        }
+    }
+}
+
+TEST_CASE("buoyancy_kernel - sumas iguales que el bucle por voxel", "[buoyancy_kernel]") {
+    hull h(5003, 2);
+    buoyancy_kernel::sums ref = h.reference();
+    // compare relative to the magnitude of the gravity force and its torque
+    const double force_scale = -h.par.gravity_force;
+    const double torque_scale = force_scale * 40.0;
+    std::vector<float> tx, ty, tz;
+    for (unsigned pi = 0; pi < buoyancy_kernel::nr_of_paths; ++pi) {
+        auto p = buoyancy_kernel::path(pi);
+        if (!buoyancy_kernel::is_supported(p))
+            continue;
+        buoyancy_kernel::sums s = h.compute(p, tx, ty, tz);
+        require_close(s.force_z, ref.force_z, force_scale);
+        require_close(s.torque_x, ref.torque_x, torque_scale);
+        require_close(s.torque_y, ref.torque_y, torque_scale);
+        require_close(s.volume_below_water, ref.volume_below_water, double(h.voxels.size()));
+    }
+    // some voxels are below, some above water
+    REQUIRE(ref.volume_below_water > 0.0);
+    REQUIRE(ref.volume_below_water < 0.9 * 5003 * 0.5);
+}
+
+TEST_CASE("buoyancy_kernel - sin voxels", "[buoyancy_kernel]") {
+    buoyancy_kernel::parameters par = {0.0f, 1.0f, 1.0f, -1.0f, -1.0f};
+    buoyancy_kernel::sums s = buoyancy_kernel::accumulate(buoyancy_kernel::get_best_path(), 0, nullptr, nullptr,
+                                                          nullptr, nullptr, nullptr, nullptr, nullptr, par);
+    REQUIRE(s.force_z == 0.0);
+    REQUIRE(s.volume_below_water == 0.0);
+}
+
+TEST_CASE("buoyancy_kernel - benchmark por barco", "[.benchmark][buoyancy_kernel]") {
+    for (unsigned n : {1000U, 5000U, 20000U}) {
+        hull h(n, 3);
+        std::vector<float> tx, ty, tz;
+        BENCHMARK("bucle por voxel " + std::to_string(n)) {
+            return h.reference().force_z;
+        };
+        BENCHMARK("escalar " + std::to_string(n)) {
+            return h.compute(buoyancy_kernel::scalar, tx, ty, tz).force_z;
+        };
+        BENCHMARK(std::string(buoyancy_kernel::get_name(buoyancy_kernel::get_best_path())) + " " + std::to_string(n)) {
+            return h.compute(buoyancy_kernel::get_best_path(), tx, ty, tz).force_z;
+        };
+    }
+}
@@ -1,6 +1,8 @@
 /* Test bv_tree.h/cpp: create() from vertices + leaf_data. */
 #include "catch_amalgamated.hpp"
 #include "../bv_tree.h"
+#include "../error.h"
+#include "../random_generator.h"
 #include <list>
 #include <vector>
 
@@ -19,3 +21,43 @@ TEST_CASE("bv_tree - create desde vertices y leaf_data", "[bv_tree]") {
     std::unique_ptr<bv_tree> tree = bv_tree::create(verts, leaves);
     REQUIRE(tree.get() != nullptr);
 }
+
+TEST_CASE("bv_tree - guardar y restaurar", "[bv_tree]") {
+    random_generator rg(1);
+    std::vector<vector3f> verts;
+    std::list<bv_tree::leaf_data> leaves;
+    for (unsigned i = 0; i < 50; ++i) {
+        bv_tree::leaf_data l;
+        for (unsigned k = 0; k < 3; ++k) {
+            l.tri_idx[k] = uint32_t(verts.size());
+            verts.push_back(vector3f(rg.rndf() * 10.0f, rg.rndf() * 10.0f, rg.rndf()));
+        }
+        leaves.push_back(l);
+    }
+    std::unique_ptr<bv_tree> tree = bv_tree::create(verts, leaves);
+    std::vector<bv_tree::stored_node> nodes;
+    tree->store(nodes);
+    REQUIRE(nodes.size() == 99);
+    std::unique_ptr<bv_tree> tree2 = bv_tree::restore(nodes, unsigned(verts.size()));
+    std::vector<bv_tree::stored_node> nodes2;
+    tree2->store(nodes2);
+    REQUIRE(nodes2.size() == nodes.size());
+    for (unsigned i = 0; i < nodes.size(); ++i) {
+        REQUIRE(nodes2[i].radius == nodes[i].radius);
+        REQUIRE(nodes2[i].center[0] == nodes[i].center[0]);
+        REQUIRE(nodes2[i].leaf.tri_idx[2] == nodes[i].leaf.tri_idx[2]);
+    }
+    // same collision results
+    spheref sp(vector3f(5, 5, 0.5f), 1.0f);
+    bv_tree::param p(*tree, verts, matrix4f::one()), p2(*tree2, verts, matrix4f::one());
+    REQUIRE(bv_tree::collides(p2, sp) == bv_tree::collides(p, sp));
+
+    REQUIRE(bv_tree::restore(std::vector<bv_tree::stored_node>(), 0).get() == nullptr);
+    // incomplete, with extra nodes or invalid indices
+    std::vector<bv_tree::stored_node> bad(nodes.begin(), nodes.end() - 1);
+    REQUIRE_THROWS_AS(bv_tree::restore(bad, unsigned(verts.size())), error);
+    bad = nodes;
+    bad.push_back(nodes.back());
+    REQUIRE_THROWS_AS(bv_tree::restore(bad, unsigned(verts.size())), error);
+    REQUIRE_THROWS_AS(bv_tree::restore(nodes, 10), error);
+}
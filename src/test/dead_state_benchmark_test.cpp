@@ -0,0 +1,172 @@
+/*
+ * Test para el fin de objetos en la simulacion: senalizar la muerte con
+ * excepcion (como antes en sea_object::simulate) o con valor de retorno.
+ * Los dos caminos dan los mismos estados; el benchmark compara su coste.
+ * Ejecutar con: dead_state_benchmark_test "[.benchmark]"
+ */
+#include "catch_amalgamated.hpp"
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+// the dead state machine of sea_object: alive -> dead -> dead2 -> defunct
+enum alive_status { defunct, dead, dead2, alive };
+
+struct is_dead_exception : public std::runtime_error {
+    is_dead_exception() : std::runtime_error("dead!") {}
+};
+
+// models sea_object, ship and torpedo with the old throwing control flow
+struct throwing_object {
+    alive_status alive_stat = alive;
+    double position = 0, run_length = 0, range = 1;
+    virtual ~throwing_object() {}
+    virtual void simulate(double delta_time) {
+        if (alive_stat == defunct) {
+            throw is_dead_exception();
+        } else if (alive_stat == dead2) {
+            alive_stat = defunct;
+            throw is_dead_exception();
+        } else if (alive_stat == dead) {
+            alive_stat = dead2;
+            throw is_dead_exception();
+        }
+        position += delta_time;
+    }
+};
+struct throwing_ship : public throwing_object {
+    void simulate(double delta_time) override {
+        throwing_object::simulate(delta_time);
+        position *= 1.0001;
+    }
+};
+struct throwing_torpedo : public throwing_ship {
+    void simulate(double delta_time) override {
+        throwing_ship::simulate(delta_time);
+        run_length += delta_time;
+        if (run_length > range)
+            alive_stat = dead;
+    }
+};
+
+// the same with status return, as sea_object::simulate does now
+struct status_object {
+    alive_status alive_stat = alive;
+    double position = 0, run_length = 0, range = 1;
+    virtual ~status_object() {}
+    virtual bool simulate(double delta_time) {
+        if (alive_stat == defunct) {
+            return false;
+        } else if (alive_stat == dead2) {
+            alive_stat = defunct;
+            return false;
+        } else if (alive_stat == dead) {
+            alive_stat = dead2;
+            return false;
+        }
+        position += delta_time;
+        return true;
+    }
+};
+struct status_ship : public status_object {
+    bool simulate(double delta_time) override {
+        if (!status_object::simulate(delta_time))
+            return false;
+        position *= 1.0001;
+        return true;
+    }
+};
+struct status_torpedo : public status_ship {
+    bool simulate(double delta_time) override {
+        if (!status_ship::simulate(delta_time))
+            return false;
+        run_length += delta_time;
+        if (run_length > range)
+            alive_stat = dead;
+        return true;
+    }
+};
+
+// torpedoes with staggered ranges, so some die in every step like in heavy combat
+template <class T>
+std::vector<std::unique_ptr<T>> make_torpedoes(unsigned n) {
+    std::vector<std::unique_ptr<T>> result;
+    for (unsigned i = 0; i < n; ++i) {
+        result.push_back(std::make_unique<T>());
+        result.back()->range = 0.05 * (i % 40);
+    }
+    return result;
+}
+
+template <class T>
+void reset(std::vector<std::unique_ptr<T>> &objs) {
+    for (auto &o : objs) {
+        o->alive_stat = alive;
+        o->run_length = 0;
+    }
+}
+
+// one simulation step like game::simulate_objects_mt before
+template <class T>
+unsigned step_throwing(std::vector<std::unique_ptr<T>> &objs, double delta_t) {
+    unsigned nr_simulated = 0;
+    for (auto &o : objs) {
+        try {
+            o->simulate(delta_t);
+            ++nr_simulated;
+        } catch (is_dead_exception &) {
+            // nothing to do
+        }
+    }
+    return nr_simulated;
+}
+
+template <class T>
+unsigned step_status(std::vector<std::unique_ptr<T>> &objs, double delta_t) {
+    unsigned nr_simulated = 0;
+    for (auto &o : objs)
+        if (o->simulate(delta_t))
+            ++nr_simulated;
+    return nr_simulated;
+}
+} // namespace
+
+TEST_CASE("estado muerto - valor de retorno igual que excepcion", "[dead_state]") {
+    auto t = make_torpedoes<throwing_torpedo>(200);
+    auto s = make_torpedoes<status_torpedo>(200);
+    for (unsigned step = 0; step < 60; ++step) {
+        REQUIRE(step_throwing(t, 0.05) == step_status(s, 0.05));
+        for (unsigned i = 0; i < t.size(); ++i) {
+            REQUIRE(t[i]->alive_stat == s[i]->alive_stat);
+            REQUIRE(t[i]->position == s[i]->position);
+        }
+    }
+    // all torpedoes ran out of range and are defunct now
+    REQUIRE(step_status(s, 0.05) == 0);
+    REQUIRE(s[39]->alive_stat == defunct);
+}
+
+TEST_CASE("estado muerto - benchmark excepcion contra valor de retorno", "[.benchmark][dead_state]") {
+    // every step some torpedoes die, the dead ones are kept like game does for two steps
+    BENCHMARK_ADVANCED("excepcion")(Catch::Benchmark::Chronometer meter) {
+        auto t = make_torpedoes<throwing_torpedo>(1000);
+        meter.measure([&] {
+            reset(t);
+            unsigned n = 0;
+            for (unsigned step = 0; step < 40; ++step)
+                n += step_throwing(t, 0.05);
+            return n;
+        });
+    };
+    BENCHMARK_ADVANCED("valor de retorno")(Catch::Benchmark::Chronometer meter) {
+        auto s = make_torpedoes<status_torpedo>(1000);
+        meter.measure([&] {
+            reset(s);
+            unsigned n = 0;
+            for (unsigned step = 0; step < 40; ++step)
+                n += step_status(s, 0.05);
+            return n;
+        });
+    };
+}
@@ -0,0 +1,81 @@
+/*
+ * Test para flat_bv_tree.h: el arbol plano da los mismos resultados que bv_tree.
+ */
+#include "catch_amalgamated.hpp"
+#include "../flat_bv_tree.h"
+#include "../random_generator.h"
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace {
+// una sopa de triangulos pequenos dentro de una caja alargada, como un casco
+struct soup {
+    std::vector<vector3f> vertices;
+    std::unique_ptr<bv_tree> tree;
+    std::unique_ptr<flat_bv_tree> flat;
+    soup(unsigned nr_tris, unsigned seed) {
+        random_generator rg(seed);
+        std::list<bv_tree::leaf_data> leaves;
+        for (unsigned i = 0; i < nr_tris; ++i) {
+            vector3f c((rg.rndf() - 0.5f) * 100.0f, (rg.rndf() - 0.5f) * 12.0f, (rg.rndf() - 0.5f) * 10.0f);
+            bv_tree::leaf_data ld;
+            for (unsigned k = 0; k < 3; ++k) {
+                ld.tri_idx[k] = uint32_t(vertices.size());
+                vertices.push_back(c + vector3f(rg.rndf() * 4.0f, rg.rndf() * 4.0f, rg.rndf() * 4.0f));
+            }
+            leaves.push_back(ld);
+        }
+        tree = bv_tree::create(vertices, leaves);
+        flat = std::make_unique<flat_bv_tree>(*tree);
+    }
+};
+} // namespace
+
+TEST_CASE("flat_bv_tree - numero de nodos", "[flat_bv_tree]") {
+    soup s(100, 1);
+    // a binary tree with n leaves has 2n-1 nodes
+    REQUIRE(s.flat->get_nr_of_nodes() == 199);
+    REQUIRE(s.flat->get_sphere().radius == s.tree->get_sphere().radius);
+    REQUIRE(s.flat->get_sphere().center.x == s.tree->get_sphere().center.x);
+}
+
+TEST_CASE("flat_bv_tree - un solo triangulo", "[flat_bv_tree]") {
+    soup a(1, 2);
+    REQUIRE(a.flat->get_nr_of_nodes() == 1);
+    flat_bv_tree::param pa(*a.flat, a.vertices, matrix4f::one());
+    REQUIRE(flat_bv_tree::collides(pa, spheref(a.vertices[0], 0.1f)));
+    REQUIRE_FALSE(flat_bv_tree::collides(pa, spheref(vector3f(1000, 0, 0), 1.0f)));
+}
+
+TEST_CASE("flat_bv_tree - mismos resultados que bv_tree", "[flat_bv_tree]") {
+    soup a(300, 3), b(250, 4);
+    random_generator rg(5);
+    unsigned nr_colliding = 0;
+    for (unsigned i = 0; i < 200; ++i) {
+        matrix4f ta = matrix4f::rot_z(rg.rndf() * 360.0f);
+        matrix4f tb = matrix4f::trans((rg.rndf() - 0.5f) * 150.0f, (rg.rndf() - 0.5f) * 60.0f, (rg.rndf() - 0.5f) * 10.0f) *
+                      matrix4f::rot_z(rg.rndf() * 360.0f) * matrix4f::rot_x(rg.rndf() * 20.0f);
+        bv_tree::param p0(*a.tree, a.vertices, ta), p1(*b.tree, b.vertices, tb);
+        flat_bv_tree::param f0(*a.flat, a.vertices, ta), f1(*b.flat, b.vertices, tb);
+
+        std::list<vector3f> cps, fcps;
+        bool c = bv_tree::collides(p0, p1, cps);
+        REQUIRE(flat_bv_tree::collides(f0, f1, fcps) == c);
+        REQUIRE(fcps == cps);
+
+        vector3f cp, fcp;
+        bool cc = bv_tree::closest_collision(p0, p1, cp);
+        REQUIRE(flat_bv_tree::closest_collision(f0, f1, fcp) == cc);
+        if (cc) {
+            REQUIRE(fcp == cp);
+            ++nr_colliding;
+        }
+
+        spheref sp(vector3f((rg.rndf() - 0.5f) * 100.0f, (rg.rndf() - 0.5f) * 20.0f, 0.0f), rg.rndf() * 3.0f);
+        REQUIRE(flat_bv_tree::collides(f0, sp) == bv_tree::collides(p0, sp));
+    }
+    // make sure both cases were tested
+    REQUIRE(nr_colliding > 0);
+    REQUIRE(nr_colliding < 200);
+}
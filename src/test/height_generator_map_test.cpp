@@ -1,6 +1,62 @@
+/*
+ * Test para height_generator_map.h: las alturas montadas con teselas de la
+ * cache son iguales que las calculadas directamente, en zonas de varias teselas.
+ */
 #include "catch_amalgamated.hpp"
 #include "../height_generator_map.h"
+#include "../random_generator.h"
+#include <vector>
 
-TEST_CASE("height_generator_map - Smoke test: compilación y estructura básica", "[height_generator_map][smoke]") {
-    REQUIRE(true);
+namespace {
+// map from height samples, the file constructor needs images
+class test_map : public height_generator_map {
+  public:
+    test_map(const bivector<float> &heights, bool cache_tiles)
+        : height_generator_map(heights, 256 * 4882.8125, vector2(-128 * 4882.8125, -128 * 4882.8125), cache_tiles) {}
+};
+
+bivector<float> make_heights() {
+    random_generator rg(3);
+    bivector<float> h(vector2i(256, 256));
+    for (int y = 0; y < 256; ++y)
+        for (int x = 0; x < 256; ++x)
+            h.at(x, y) = (rg.rndf() - 0.5f) * 1024.0f;
+    return h;
+}
+} // namespace
+
+TEST_CASE("height_generator_map - teselas iguales que calculo directo", "[height_generator_map]") {
+    const bivector<float> heights = make_heights();
+    test_map tiled(heights, true), direct(heights, false);
+    // tiles have 64x64 samples, the areas span several of them and start off the tile grid
+    struct area {
+        int detail;
+        vector2i bl, sz;
+    };
+    const area areas[] = {{0, vector2i(-70, 30), vector2i(200, 150)},
+                          {3, vector2i(-5, -131), vector2i(129, 65)},
+                          {-3, vector2i(1000, -2000), vector2i(97, 160)},
+                          {6, vector2i(-40, -40), vector2i(81, 81)}};
+    for (const area &a : areas) {
+        std::vector<float> t(a.sz.x * a.sz.y), d(a.sz.x * a.sz.y);
+        tiled.compute_heights(a.detail, a.bl, a.sz, t.data());
+        direct.compute_heights(a.detail, a.bl, a.sz, d.data());
+        REQUIRE(t == d);
+        // the same area again comes from the cache
+        tiled.compute_heights(a.detail, a.bl, a.sz, t.data());
+        REQUIRE(t == d);
+    }
+    REQUIRE(tiled.get_cache_statistics(0).hits > 0);
+    REQUIRE(direct.get_cache_statistics(0).hits == 0);
+}
+
+TEST_CASE("height_generator_map - parte de una zona igual que la zona entera", "[height_generator_map]") {
+    // every sample only depends on its coordinates, not on the requested area
+    test_map tiled(make_heights(), true);
+    std::vector<float> whole(300 * 200), part(100 * 70);
+    tiled.compute_heights(1, vector2i(-150, -100), vector2i(300, 200), whole.data());
+    tiled.compute_heights(1, vector2i(-17, 20), vector2i(100, 70), part.data());
+    for (int y = 0; y < 70; ++y)
+        for (int x = 0; x < 100; ++x)
+            REQUIRE(part[y * 100 + x] == whole[(y + 120) * 300 + x + 133]);
 }
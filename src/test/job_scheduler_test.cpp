@@ -1,6 +1,187 @@
+/*
+ * Test para job_scheduler.h: tareas periodicas, baja de tareas, tareas
+ * independientes en paralelo y estadisticas.
+ */
 #include "catch_amalgamated.hpp"
 #include "../job_scheduler.h"
+#include "../thread_pool.h"
+#include <atomic>
+#include <vector>
 
-TEST_CASE("job_scheduler - Smoke test: compilación y estructura básica", "[job_scheduler][smoke]") {
-    REQUIRE(true);
+namespace {
+struct counting_job : public job {
+    double period;
+    unsigned &runs;
+    bool independent;
+    counting_job(double p, unsigned &r, bool i = false) : period(p), runs(r), independent(i) {}
+    void run() override { ++runs; }
+    double get_period() const override { return period; }
+    bool is_independent() const override { return independent; }
+};
+
+struct order_job : public job {
+    double period;
+    int nr;
+    std::vector<int> &order;
+    order_job(double p, int n, std::vector<int> &o) : period(p), nr(n), order(o) {}
+    void run() override { order.push_back(nr); }
+    double get_period() const override { return period; }
+};
+
+/// unregisters another job when run
+struct killer_job : public job {
+    job_scheduler &js;
+    job *victim;
+    killer_job(job_scheduler &s, job *v) : js(s), victim(v) {}
+    void run() override {
+        if (victim) {
+            js.unregister_job(victim);
+            victim = nullptr;
+        }
+    }
+    double get_period() const override { return 1.0; }
+};
+
+/// unregisters itself when run
+struct suicide_job : public job {
+    job_scheduler &js;
+    unsigned &runs;
+    suicide_job(job_scheduler &s, unsigned &r) : js(s), runs(r) {}
+    void run() override {
+        ++runs;
+        js.unregister_job(this);
+    }
+    double get_period() const override { return 1.0; }
+};
+
+struct parallel_job : public job {
+    std::atomic<unsigned> &runs;
+    parallel_job(std::atomic<unsigned> &r) : runs(r) {}
+    void run() override { ++runs; }
+    double get_period() const override { return 1.0; }
+    bool is_independent() const override { return true; }
+};
+} // namespace
+
+TEST_CASE("job_scheduler - sin tareas", "[job_scheduler]") {
+    job_scheduler js;
+    REQUIRE_FALSE(js.has_jobs());
+    REQUIRE(js.job_count() == 0);
+    js.update(10.0);
+}
+
+TEST_CASE("job_scheduler - tareas se ejecutan segun su periodo", "[job_scheduler]") {
+    job_scheduler js;
+    unsigned fast = 0, slow = 0;
+    js.register_job(new counting_job(1.0, fast));
+    js.register_job(new counting_job(5.0, slow));
+    REQUIRE(js.job_count() == 2);
+    for (unsigned i = 0; i < 40; ++i)
+        js.update(0.25);
+    REQUIRE(fast == 10);
+    REQUIRE(slow == 2);
+}
+
+TEST_CASE("job_scheduler - una ejecucion por update como maximo", "[job_scheduler]") {
+    job_scheduler js;
+    unsigned runs = 0;
+    js.register_job(new counting_job(1.0, runs));
+    js.update(3.5);
+    REQUIRE(runs == 1);
+    // the time not yet handled is caught up in the following updates
+    js.update(0.0);
+    js.update(0.0);
+    REQUIRE(runs == 3);
+    js.update(0.0);
+    REQUIRE(runs == 3);
+}
+
+TEST_CASE("job_scheduler - orden por tiempo de vencimiento", "[job_scheduler]") {
+    job_scheduler js;
+    std::vector<int> order;
+    js.register_job(new order_job(2.0, 2, order));
+    js.register_job(new order_job(1.0, 1, order));
+    js.update(2.0);
+    REQUIRE(order == std::vector<int>({1, 2}));
+}
+
+TEST_CASE("job_scheduler - dar de baja tareas", "[job_scheduler]") {
+    job_scheduler js;
+    unsigned runs_a = 0, runs_b = 0;
+    auto *a = new counting_job(1.0, runs_a);
+    js.register_job(a);
+    js.register_job(new counting_job(1.0, runs_b));
+    js.update(1.0);
+    js.unregister_job(a);
+    REQUIRE(js.job_count() == 1);
+    js.update(1.0);
+    REQUIRE(runs_a == 1);
+    REQUIRE(runs_b == 2);
+    REQUIRE_THROWS(js.unregister_job(a));
+}
+
+TEST_CASE("job_scheduler - una tarea da de baja otra tarea vencida", "[job_scheduler]") {
+    job_scheduler js;
+    unsigned runs = 0;
+    auto *victim = new counting_job(1.0, runs);
+    // registered first, so the killer is run before the victim in the same update
+    js.register_job(new killer_job(js, victim));
+    js.register_job(victim);
+    js.update(1.0);
+    REQUIRE(runs == 0);
+    REQUIRE(js.job_count() == 1);
+    js.update(1.0);
+    REQUIRE(runs == 0);
+}
+
+TEST_CASE("job_scheduler - una tarea se da de baja a si misma", "[job_scheduler]") {
+    job_scheduler js;
+    unsigned runs = 0, other_runs = 0;
+    js.register_job(new suicide_job(js, runs));
+    js.register_job(new counting_job(1.0, other_runs));
+    js.update(1.0);
+    REQUIRE(runs == 1);
+    REQUIRE(js.job_count() == 1);
+    js.update(1.0);
+    REQUIRE(runs == 1);
+    REQUIRE(other_runs == 2);
+}
+
+TEST_CASE("job_scheduler - tareas independientes en paralelo", "[job_scheduler]") {
+    thread_pool tp(4);
+    job_scheduler js;
+    js.set_thread_pool(&tp);
+    std::atomic<unsigned> par_runs(0);
+    unsigned serial_runs = 0, self_runs = 0;
+    std::vector<job *> par_jobs;
+    for (unsigned i = 0; i < 16; ++i) {
+        par_jobs.push_back(new parallel_job(par_runs));
+        js.register_job(par_jobs.back());
+    }
+    js.register_job(new counting_job(1.0, serial_runs));
+    // serial jobs run after the parallel ones and may still change the job list
+    js.register_job(new suicide_job(js, self_runs));
+    for (unsigned i = 0; i < 5; ++i)
+        js.update(1.0);
+    REQUIRE(par_runs.load() == 80);
+    REQUIRE(serial_runs == 5);
+    REQUIRE(self_runs == 1);
+    REQUIRE(js.job_count() == 17);
+    for (auto *j : par_jobs)
+        REQUIRE(js.get_statistics(j).runs == 5);
+}
+
+TEST_CASE("job_scheduler - estadisticas por tarea", "[job_scheduler]") {
+    job_scheduler js;
+    unsigned runs = 0;
+    auto *j = new counting_job(0.5, runs);
+    js.register_job(j);
+    REQUIRE(js.get_statistics(j).runs == 0);
+    for (unsigned i = 0; i < 6; ++i)
+        js.update(0.5);
+    const auto &st = js.get_statistics(j);
+    REQUIRE(st.runs == 6);
+    REQUIRE(st.total_time >= 0.0);
+    REQUIRE(st.max_time >= st.last_time);
+    REQUIRE(st.get_average_time() <= st.max_time);
 }
@@ -0,0 +1,101 @@
+/*
+ * Test para kinematic_store.h: estado cinematico empaquetado, estado del paso
+ * publicado tras simular y barridos de distancia.
+ */
+#include "catch_amalgamated.hpp"
+#include "../kinematic_store.h"
+#include "../random_generator.h"
+#include <vector>
+
+static std::vector<vector3> fill(kinematic_store &ks, unsigned n, unsigned seed) {
+    random_generator rg(seed);
+    std::vector<vector3> pos(n);
+    ks.resize(n);
+    for (unsigned i = 0; i < n; ++i) {
+        pos[i] = vector3((rg.rndf() - 0.5) * 50000.0, (rg.rndf() - 0.5) * 50000.0, -rg.rndf() * 100.0);
+        ks.set(i, pos[i], vector3(i, 0, 0), quaternion::rot(i, 0, 0, 1), angle(i), uint8_t(i % 4));
+    }
+    return pos;
+}
+
+TEST_CASE("kinematic_store - guardar y leer estado", "[kinematic_store]") {
+    kinematic_store ks;
+    REQUIRE(ks.size() == 0);
+    ks.resize(2);
+    REQUIRE(ks.get_pos(1) == vector3());
+    quaternion q = quaternion::rot(30.0, 0, 0, 1);
+    ks.set(1, vector3(1, 2, 3), vector3(4, 5, 6), q, angle(30), 2);
+    REQUIRE(ks.get_pos(1) == vector3(1, 2, 3));
+    REQUIRE(ks.get_velocity(1) == vector3(4, 5, 6));
+    REQUIRE(ks.get_orientation(1).s == q.s);
+    REQUIRE(ks.get_orientation(1).v == q.v);
+    REQUIRE(ks.get_heading(1).value() == 30.0);
+    REQUIRE(ks.get_state(1) == 2);
+    ks.clear();
+    REQUIRE(ks.size() == 0);
+}
+
+TEST_CASE("kinematic_store - estado del paso visible tras publicar", "[kinematic_store]") {
+    kinematic_store ks;
+    ks.resize(3);
+    ks.set(0, vector3(1, 0, 0), vector3(), quaternion(), angle(0), 3);
+    ks.set(1, vector3(2, 0, 0), vector3(), quaternion(), angle(0), 3);
+    // written at the end of simulate, others still see the state at the start of the step
+    ks.set_current(1, vector3(5, 0, 0), vector3(1, 0, 0), quaternion(), angle(10), 2);
+    REQUIRE(ks.get_pos(1) == vector3(2, 0, 0));
+    REQUIRE(ks.get_state(1) == 3);
+    REQUIRE(ks.min_distance(vector3(5, 0, 0)) == 3.0);
+    ks.publish();
+    REQUIRE(ks.get_pos(1) == vector3(5, 0, 0));
+    REQUIRE(ks.get_velocity(1) == vector3(1, 0, 0));
+    REQUIRE(ks.get_heading(1).value() == 10.0);
+    REQUIRE(ks.get_state(1) == 2);
+    // entries not written during the step keep their state
+    REQUIRE(ks.get_pos(0) == vector3(1, 0, 0));
+    REQUIRE(ks.get_state(0) == 3);
+    REQUIRE(ks.get_pos(2) == vector3());
+}
+
+TEST_CASE("kinematic_store - barridos iguales a bucle sobre objetos", "[kinematic_store]") {
+    kinematic_store ks;
+    auto pos = fill(ks, 1000, 17);
+    const vector3 p(1234.5, -678.9, -10.0);
+    std::vector<double> d2;
+    ks.compute_square_distances(p, d2);
+    REQUIRE(d2.size() == pos.size());
+    double nearest = 1e30, nearest_skip = 1e30;
+    const unsigned skip = 321;
+    for (unsigned i = 0; i < pos.size(); ++i) {
+        REQUIRE(d2[i] == pos[i].square_distance(p));
+        nearest = std::min(nearest, pos[i].distance(p));
+        if (i != skip)
+            nearest_skip = std::min(nearest_skip, pos[i].distance(p));
+    }
+    REQUIRE(ks.min_distance(p) == nearest);
+    REQUIRE(ks.min_distance(p, skip) == nearest_skip);
+    REQUIRE(ks.min_distance(pos[skip]) == 0.0);
+    std::vector<vector2> p2;
+    ks.get_positions_2d(p2);
+    REQUIRE(p2[skip] == pos[skip].xy());
+}
+
+TEST_CASE("kinematic_store - barrido sin entradas", "[kinematic_store]") {
+    kinematic_store ks;
+    REQUIRE(ks.min_distance(vector3()) < 0.0);
+    ks.resize(1);
+    REQUIRE(ks.min_distance(vector3(), 0) < 0.0);
+    REQUIRE(ks.min_distance(vector3(3, 4, 0)) == 5.0);
+}
+
+TEST_CASE("kinematic_store - filtro por estado", "[kinematic_store]") {
+    kinematic_store ks;
+    ks.resize(6);
+    for (unsigned i = 0; i < 6; ++i)
+        ks.set(i, vector3(), vector3(), quaternion(), angle(), uint8_t(i % 5));
+    std::vector<unsigned> found;
+    ks.find_state(3, found);
+    REQUIRE(found == std::vector<unsigned>({3, 4}));
+    std::vector<unsigned> entries = {5, 4, 3, 2, 1, 0};
+    ks.filter_state(entries, 1, 4);
+    REQUIRE(entries == std::vector<unsigned>({3, 2, 1}));
+}
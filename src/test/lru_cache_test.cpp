@@ -0,0 +1,55 @@
+/*
+ * Test para lru_cache.h: capacidad, orden de expulsion y estadisticas.
+ */
+#include "catch_amalgamated.hpp"
+#include "../lru_cache.h"
+#include <string>
+
+TEST_CASE("lru_cache - buscar e insertar", "[lru_cache]") {
+    lru_cache<int, std::string> c(4);
+    REQUIRE(c.size() == 0);
+    REQUIRE_FALSE(c.find(1));
+    auto v = c.insert(1, std::string("uno"));
+    REQUIRE(*v == "uno");
+    REQUIRE(*c.find(1) == "uno");
+    // inserting an existing key keeps the old value
+    REQUIRE(*c.insert(1, std::string("otro")) == "uno");
+    REQUIRE(c.size() == 1);
+    REQUIRE(c.get_statistics().hits == 1);
+    REQUIRE(c.get_statistics().misses == 1);
+}
+
+TEST_CASE("lru_cache - expulsa el menos usado", "[lru_cache]") {
+    lru_cache<int, int> c(3);
+    c.insert(1, 10);
+    c.insert(2, 20);
+    c.insert(3, 30);
+    // use 1, so 2 is least recently used now
+    REQUIRE(*c.find(1) == 10);
+    auto kept = c.find(2);
+    c.find(3);
+    c.find(1);
+    c.insert(4, 40);
+    REQUIRE(c.size() == 3);
+    REQUIRE_FALSE(c.find(2));
+    REQUIRE(c.find(1));
+    REQUIRE(c.find(3));
+    REQUIRE(c.find(4));
+    REQUIRE(c.get_statistics().evictions == 1);
+    // a value that was found stays valid after eviction
+    REQUIRE(*kept == 20);
+}
+
+TEST_CASE("lru_cache - vaciar y tasa de aciertos", "[lru_cache]") {
+    lru_cache<int, int> c(0);
+    REQUIRE(c.get_capacity() == 1);
+    c.insert(1, 1);
+    c.insert(2, 2);
+    REQUIRE(c.size() == 1);
+    c.find(2);
+    c.find(1);
+    REQUIRE(c.get_statistics().get_hit_rate() == Catch::Approx(0.5));
+    c.clear();
+    REQUIRE(c.size() == 0);
+    REQUIRE_FALSE(c.find(2));
+}
@@ -0,0 +1,115 @@
+/*
+ * Test para memory_pool.h: listas libres por tamano, contadores y uso con
+ * operator new/delete de una jerarquia de clases.
+ */
+#include "catch_amalgamated.hpp"
+#include "../memory_pool.h"
+#include <cstring>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+memory_pool test_pool("test", 8);
+
+struct pooled {
+    double value;
+    pooled(double v) : value(v) {}
+    virtual ~pooled() {}
+    static void *operator new(std::size_t size) { return test_pool.allocate(size); }
+    static void operator delete(void *p, std::size_t size) { test_pool.deallocate(p, size); }
+};
+
+struct pooled_big : public pooled {
+    char payload[200];
+    pooled_big(double v) : pooled(v) { std::memset(payload, 0x5a, sizeof(payload)); }
+};
+} // namespace
+
+TEST_CASE("memory_pool - reutiliza bloques liberados", "[memory_pool]") {
+    memory_pool mp("a", 4);
+    void *p = mp.allocate(40);
+    auto st = mp.get_statistics();
+    REQUIRE(st.misses == 1);
+    REQUIRE(st.hits == 0);
+    REQUIRE(st.in_use == 1);
+    mp.deallocate(p, 40);
+    // same size class gives the same block back
+    void *q = mp.allocate(33);
+    REQUIRE(q == p);
+    st = mp.get_statistics();
+    REQUIRE(st.hits == 1);
+    REQUIRE(st.in_use == 1);
+    REQUIRE(st.high_water_mark == 1);
+    mp.deallocate(q, 33);
+}
+
+TEST_CASE("memory_pool - losas y marca de maximo", "[memory_pool]") {
+    memory_pool mp("b", 4);
+    std::vector<void *> blocks;
+    for (unsigned i = 0; i < 10; ++i)
+        blocks.push_back(mp.allocate(24));
+    std::set<void *> distinct(blocks.begin(), blocks.end());
+    REQUIRE(distinct.size() == 10);
+    auto st = mp.get_statistics();
+    // three slabs of four blocks each
+    REQUIRE(st.misses == 3);
+    REQUIRE(st.hits == 7);
+    REQUIRE(st.high_water_mark == 10);
+    for (void *p : blocks)
+        mp.deallocate(p, 24);
+    st = mp.get_statistics();
+    REQUIRE(st.in_use == 0);
+    REQUIRE(st.high_water_mark == 10);
+}
+
+TEST_CASE("memory_pool - bloques grandes van al heap", "[memory_pool]") {
+    memory_pool mp("c");
+    void *p = mp.allocate(memory_pool::max_block_size + 1);
+    REQUIRE(p != nullptr);
+    REQUIRE(mp.get_statistics().misses == 1);
+    mp.deallocate(p, memory_pool::max_block_size + 1);
+    REQUIRE(mp.get_statistics().in_use == 0);
+}
+
+TEST_CASE("memory_pool - operator new de clases derivadas", "[memory_pool]") {
+    auto before = test_pool.get_statistics();
+    {
+        std::vector<std::unique_ptr<pooled>> objs;
+        for (unsigned i = 0; i < 20; ++i) {
+            if (i & 1)
+                objs.push_back(std::make_unique<pooled_big>(i));
+            else
+                objs.push_back(std::make_unique<pooled>(i));
+        }
+        REQUIRE(test_pool.get_statistics().in_use == before.in_use + 20);
+        for (unsigned i = 0; i < 20; ++i)
+            REQUIRE(objs[i]->value == double(i));
+    }
+    // deleting through base pointer gives the blocks back to their size class
+    REQUIRE(test_pool.get_statistics().in_use == before.in_use);
+    auto p = std::make_unique<pooled_big>(1.0);
+    REQUIRE(test_pool.get_statistics().hits > before.hits);
+}
+
+TEST_CASE("memory_pool - varios hilos", "[memory_pool]") {
+    memory_pool mp("d", 16);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; ++t) {
+        threads.emplace_back([&mp] {
+            for (unsigned k = 0; k < 1000; ++k) {
+                void *a = mp.allocate(48);
+                void *b = mp.allocate(100);
+                mp.deallocate(a, 48);
+                mp.deallocate(b, 100);
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    auto st = mp.get_statistics();
+    REQUIRE(st.in_use == 0);
+    REQUIRE(st.hits + st.misses == 8000);
+    REQUIRE(st.high_water_mark <= 8);
+}
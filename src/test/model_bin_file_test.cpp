@@ -0,0 +1,95 @@
+/*
+ * Test para model_bin_file.h: escribir y leer secciones, archivos obsoletos
+ * (otra clave), corruptos y que faltan.
+ */
+#include "catch_amalgamated.hpp"
+#include "../error.h"
+#include "../model_bin_file.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+const char *model_filename = "model_bin_file_test.ddxml";
+const char *bin_filename = "model_bin_file_test.ddbin";
+
+void write_model_file(const char *contents) {
+    std::ofstream out(model_filename, std::ios::binary | std::ios::trunc);
+    out << contents;
+}
+
+void write_bin_file(uint64_t key) {
+    model_bin_file::writer w(bin_filename, key);
+    w.write(std::vector<uint32_t>(1, 2));
+    w.write(std::vector<float>({1.0f, 2.0f, 3.0f}));
+    w.write(std::vector<uint8_t>());
+    w.write(std::vector<uint16_t>({7, 8, 9}));
+    w.finish();
+}
+} // namespace
+
+TEST_CASE("model_bin_file - nombre de archivo", "[model_bin_file]") {
+    REQUIRE(model_bin_file::get_filename("data/models/ship.ddxml") == "data/models/ship.ddbin");
+    REQUIRE(model_bin_file::get_filename("data/models.v2/ship") == "data/models.v2/ship.ddbin");
+}
+
+TEST_CASE("model_bin_file - escribir y leer", "[model_bin_file]") {
+    write_model_file("<dftd-model version=\"1.2\"/>");
+    uint64_t key = model_bin_file::compute_key(model_filename);
+    write_bin_file(key);
+    model_bin_file::reader r(bin_filename, key);
+    REQUIRE(r.get_nr_of_sections() == 4);
+    std::vector<uint32_t> info;
+    std::vector<float> f;
+    std::vector<uint8_t> empty(5);
+    std::vector<uint16_t> s;
+    r.read(info);
+    r.read(f);
+    r.read(empty);
+    r.read(s);
+    r.finish();
+    REQUIRE(info == std::vector<uint32_t>(1, 2));
+    REQUIRE(f == std::vector<float>({1.0f, 2.0f, 3.0f}));
+    REQUIRE(empty.empty());
+    REQUIRE(s == std::vector<uint16_t>({7, 8, 9}));
+    std::remove(bin_filename);
+    std::remove(model_filename);
+}
+
+TEST_CASE("model_bin_file - contenido inesperado", "[model_bin_file]") {
+    write_bin_file(1);
+    model_bin_file::reader r(bin_filename, 1);
+    std::vector<uint32_t> info;
+    r.read(info);
+    // not all sections read
+    REQUIRE_THROWS_AS(r.finish(), error);
+    // 12 bytes are no multiple of 8
+    std::vector<double> d;
+    REQUIRE_THROWS_AS(r.read(d), error);
+    std::remove(bin_filename);
+}
+
+TEST_CASE("model_bin_file - obsoleto, corrupto o inexistente", "[model_bin_file]") {
+    std::remove(bin_filename);
+    REQUIRE_THROWS_AS(model_bin_file::reader(bin_filename, 1), file_read_error);
+
+    // key changes with every change of the model file
+    write_model_file("<dftd-model version=\"1.2\"/>");
+    uint64_t key = model_bin_file::compute_key(model_filename);
+    write_model_file("<dftd-model version=\"1.21\"/>");
+    REQUIRE(model_bin_file::compute_key(model_filename) != key);
+    write_bin_file(key);
+    REQUIRE_THROWS_AS(model_bin_file::reader(bin_filename, model_bin_file::compute_key(model_filename)), error);
+
+    // damaged data is detected by checksum
+    {
+        std::fstream f(bin_filename, std::ios::in | std::ios::out | std::ios::binary);
+        // first byte of second section, sections are aligned to 16 bytes after the 48 bytes header
+        f.seekp(64);
+        f.put('x');
+    }
+    REQUIRE_THROWS_AS(model_bin_file::reader(bin_filename, key), error);
+    std::remove(bin_filename);
+    std::remove(model_filename);
+}
@@ -0,0 +1,136 @@
+/*
+ * Test para noise_field.h: la escucha con la tabla de fuentes de ruido da los
+ * mismos valores que el calculo anterior por llamada en game::sonar_listen_ships.
+ * Ejecutar benchmark con: noise_field_test "[.benchmark]"
+ */
+#include "catch_amalgamated.hpp"
+#include "../noise_field.h"
+#include "../random_generator.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+struct source {
+    vector2 pos;
+    noise_signature sig;
+    double speed;
+    bool cavitation;
+};
+
+// random sources around the origin, noise signatures of the ship classes
+std::vector<source> make_sources(unsigned n, unsigned seed) {
+    random_generator rg(seed);
+    std::vector<source> result(n);
+    for (unsigned i = 0; i < n; ++i) {
+        source &s = result[i];
+        s.pos = vector2((rg.rndf() - 0.5) * 60000.0, (rg.rndf() - 0.5) * 60000.0);
+        const unsigned cls = i % NR_OF_SHIP_CLASSES;
+        for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
+            s.sig.band_data[b].basic_noise_level = noise_signature::typical_noise_signature[cls][b];
+            s.sig.band_data[b].speed_factor = 0.541;
+        }
+        s.speed = rg.rndf() * 15.0;
+        s.cavitation = (i % 3) == 0;
+    }
+    return result;
+}
+
+noise_field make_field(const std::vector<source> &sources) {
+    noise_field nf;
+    for (const auto &s : sources)
+        nf.add_source(&s, s.pos, s.sig.compute_source_level(s.speed, s.cavitation));
+    return nf;
+}
+
+// the computation game::sonar_listen_ships did for every call before
+std::pair<double, noise> listen_reference(const std::vector<source> &sources, const source &listener, angle hdg,
+                                          angle rel_listening_dir) {
+    noise n;
+    n += noise::compute_ambient_noise_strength(0.2);
+    n += listener.sig.compute_signal_strength(50, listener.speed, false);
+    bool listen_to_starboard = (rel_listening_dir.value_pm180() >= 0);
+    for (const auto &s : sources) {
+        if (&s == &listener)
+            continue;
+        vector2 relpos = s.pos - listener.pos;
+        double distance = relpos.length();
+        angle rel_dir_to_noise = angle(relpos) - hdg;
+        if (listen_to_starboard == (rel_dir_to_noise.value_pm180() >= 0)) {
+            noise nsig = s.sig.compute_signal_strength(distance, s.speed, s.cavitation);
+            for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b)
+                nsig.frequencies[b] *=
+                    compute_signal_strength_GHG(rel_dir_to_noise, noise::typical_frequency[b], rel_listening_dir);
+            n += nsig;
+        }
+    }
+    double abs_strength = floor(std::max(n.compute_total_noise_strength_dB() + 3, 0.0)) - 3;
+    return std::make_pair(abs_strength, n.to_dB());
+}
+} // namespace
+
+TEST_CASE("noise_field - compute_signal_strength igual que nivel y propagacion", "[noise_field]") {
+    auto sources = make_sources(20, 1);
+    for (const auto &s : sources) {
+        for (double d : {0.5, 10.0, 1000.0, 25000.0, 90000.0}) {
+            noise a = s.sig.compute_signal_strength(d, s.speed, s.cavitation);
+            noise b = noise_signature::compute_received_strength(s.sig.compute_source_level(s.speed, s.cavitation), d);
+            for (unsigned k = 0; k < noise::NR_OF_FREQUENCY_BANDS; ++k)
+                REQUIRE(a.frequencies[k] == b.frequencies[k]);
+        }
+    }
+}
+
+TEST_CASE("noise_field - escucha igual que calculo por llamada", "[noise_field]") {
+    auto sources = make_sources(60, 2);
+    noise_field nf = make_field(sources);
+    REQUIRE(nf.size() == 60);
+    const source &listener = sources[7];
+    const angle hdg(37.0);
+    auto r = nf.get_reception(&listener, listener.pos, hdg, listener.sig.compute_source_level(listener.speed, false));
+    REQUIRE(r->size() == 59);
+    // same listener gets the same shared reception
+    REQUIRE(nf.get_reception(&listener, listener.pos, hdg, noise()) == r);
+    for (unsigned a = 0; a < 720; ++a) {
+        angle dir(a * 0.5);
+        auto got = r->listen(dir);
+        auto ref = listen_reference(sources, listener, hdg, dir);
+        // integral powers and the cosine of the angle difference differ in the last bits only
+        REQUIRE(std::fabs(got.first - ref.first) <= 1.0);
+        for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b)
+            REQUIRE(got.second.frequencies[b] == Catch::Approx(ref.second.frequencies[b]).epsilon(1e-9));
+    }
+}
+
+TEST_CASE("noise_field - fuentes lejanas tambien se oyen", "[noise_field]") {
+    // like the computation per call before, there is no range limit
+    noise_field nf;
+    noise level;
+    for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b)
+        level.frequencies[b] = 200.0;
+    int owners[2] = {};
+    nf.add_source(&owners[0], vector2(0, 50000), level);
+    nf.add_source(&owners[1], vector2(0, 150000), level);
+    noise_field::reception r(nf, nullptr, vector2(0, 0), angle(0), noise());
+    REQUIRE(r.size() == 2);
+}
+
+TEST_CASE("noise_field - benchmark barrido de escucha", "[.benchmark][noise_field]") {
+    // a full sweep of the sonar operator or the map display, 360 directions
+    auto sources = make_sources(200, 3);
+    const source &listener = sources[0];
+    BENCHMARK("calculo por llamada") {
+        double sum = 0;
+        for (unsigned a = 0; a < 360; ++a)
+            sum += listen_reference(sources, listener, angle(10), angle(a)).first;
+        return sum;
+    };
+    BENCHMARK("tabla de ruido") {
+        noise_field nf = make_field(sources);
+        auto r = nf.get_reception(&listener, listener.pos, angle(10),
+                                  listener.sig.compute_source_level(listener.speed, false));
+        double sum = 0;
+        for (unsigned a = 0; a < 360; ++a)
+            sum += r->listen(angle(a)).first;
+        return sum;
+    };
+}
@@ -1,7 +1,43 @@
-/* Test ocean_wave_generator.h: compilación de tipos. */
+/* Test ocean_wave_generator.h: espectro para otro viento y mezcla de espectros. */
 #include "catch_amalgamated.hpp"
 #include "../ocean_wave_generator.h"
 
 TEST_CASE("ocean_wave_generator - compilación", "[ocean_wave_generator]") {
     REQUIRE(true);
 }
+
+TEST_CASE("ocean_wave_generator - espectro con el mismo viento", "[ocean_wave_generator]") {
+    ocean_wave_generator<float> owg(16, vector2f(1, 1), 12.0f, 1e-6f, 256.0f, 10.0f);
+    std::vector<std::complex<float>> s;
+    owg.compute_spectrum(vector2f(1, 1), 12.0f, s);
+    REQUIRE(s.size() == owg.get_spectrum().size());
+    for (unsigned i = 0; i < s.size(); ++i) {
+        REQUIRE(s[i].real() == Catch::Approx(owg.get_spectrum()[i].real()).margin(1e-12));
+        REQUIRE(s[i].imag() == Catch::Approx(owg.get_spectrum()[i].imag()).margin(1e-12));
+    }
+}
+
+TEST_CASE("ocean_wave_generator - mezcla de espectros", "[ocean_wave_generator]") {
+    ocean_wave_generator<float> owg(16, vector2f(1, 1), 12.0f, 1e-6f, 256.0f, 10.0f);
+    std::vector<std::complex<float>> calm, storm;
+    owg.compute_spectrum(vector2f(1, 0), 4.0f, calm);
+    owg.compute_spectrum(vector2f(1, 0), 20.0f, storm);
+    // stronger wind gives higher waves
+    float e_calm = 0, e_storm = 0;
+    for (unsigned i = 0; i < calm.size(); ++i) {
+        e_calm += std::norm(calm[i]);
+        e_storm += std::norm(storm[i]);
+    }
+    REQUIRE(e_storm > e_calm);
+
+    owg.blend_spectrum(calm, storm, 0.0f);
+    REQUIRE(owg.get_spectrum() == calm);
+    owg.blend_spectrum(calm, storm, 1.0f);
+    REQUIRE(owg.get_spectrum() == storm);
+    owg.blend_spectrum(calm, storm, 0.5f);
+    for (unsigned i = 0; i < calm.size(); ++i)
+        REQUIRE(owg.get_spectrum()[i].real() == Catch::Approx(0.5f * (calm[i].real() + storm[i].real())));
+
+    std::vector<std::complex<float>> wrong(3);
+    REQUIRE_THROWS(owg.blend_spectrum(calm, wrong, 0.5f));
+}
@@ -0,0 +1,168 @@
+/*
+ * Test para ocean_wave_kernels.h: las variantes SIMD dan los mismos valores
+ * que la variante escalar, con la tolerancia de su seno/coseno polinomico.
+ * Normales: por lote como water::get_normals igual que por punto como water::get_normal.
+ */
+#include "catch_amalgamated.hpp"
+#include "../ocean_wave_kernels.h"
+#include "../ocean_wave_generator.h"
+#include "../random_generator.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+struct arrays {
+    std::vector<float> h0_re, h0_im, hm_re, hm_im, omega, kx, ky;
+    arrays(unsigned n, unsigned seed) {
+        random_generator rg(seed);
+        for (unsigned i = 0; i < n; ++i) {
+            h0_re.push_back(rg.rndf() - 0.5f);
+            h0_im.push_back(rg.rndf() - 0.5f);
+            hm_re.push_back(rg.rndf() - 0.5f);
+            hm_im.push_back(rg.rndf() - 0.5f);
+            omega.push_back(rg.rndf() * 6.0f);
+            kx.push_back((rg.rndf() - 0.5f) * 4.0f);
+            ky.push_back((rg.rndf() - 0.5f) * 4.0f);
+        }
+    }
+};
+} // namespace
+
+TEST_CASE("ocean_wave_kernels - escalar siempre disponible", "[ocean_wave_kernels]") {
+    REQUIRE(ocean_wave_kernels::is_supported(ocean_wave_kernels::scalar));
+    REQUIRE(ocean_wave_kernels::is_supported(ocean_wave_kernels::get_best_path()));
+    REQUIRE(std::string(ocean_wave_kernels::get_name(ocean_wave_kernels::avx2)) == "avx2");
+}
+
+TEST_CASE("ocean_wave_kernels - evolucion igual que escalar", "[ocean_wave_kernels]") {
+    // odd size so the scalar tail of the SIMD loops is used too
+    const unsigned n = 1003;
+    arrays a(n, 7);
+    std::vector<float> ref_re(n), ref_im(n), re(n), im(n);
+    for (float t : {0.0f, 1.5f, 37.25f, 600.0f}) {
+        ocean_wave_kernels::evolve(ocean_wave_kernels::scalar, n, a.h0_re.data(), a.h0_im.data(), a.hm_re.data(),
+                                   a.hm_im.data(), a.omega.data(), t, ref_re.data(), ref_im.data());
+        for (unsigned p = 1; p < ocean_wave_kernels::nr_of_paths; ++p) {
+            auto path = ocean_wave_kernels::path(p);
+            if (!ocean_wave_kernels::is_supported(path))
+                continue;
+            ocean_wave_kernels::evolve(path, n, a.h0_re.data(), a.h0_im.data(), a.hm_re.data(),
+                                       a.hm_im.data(), a.omega.data(), t, re.data(), im.data());
+            for (unsigned i = 0; i < n; ++i) {
+                REQUIRE(re[i] == Catch::Approx(ref_re[i]).margin(1e-4));
+                REQUIRE(im[i] == Catch::Approx(ref_im[i]).margin(1e-4));
+            }
+        }
+    }
+}
+
+TEST_CASE("ocean_wave_kernels - multiplicacion por i*k exacta", "[ocean_wave_kernels]") {
+    const unsigned n = 517;
+    arrays a(n, 9);
+    std::vector<float> ref[4], out[4];
+    for (auto &v : ref)
+        v.resize(n);
+    for (auto &v : out)
+        v.resize(n);
+    ocean_wave_kernels::multiply_ik(ocean_wave_kernels::scalar, n, a.h0_re.data(), a.h0_im.data(), a.kx.data(), a.ky.data(),
+                                    ref[0].data(), ref[1].data(), ref[2].data(), ref[3].data());
+    REQUIRE(ref[0][5] == -a.h0_im[5] * a.kx[5]);
+    REQUIRE(ref[3][5] == a.h0_re[5] * a.ky[5]);
+    for (unsigned p = 1; p < ocean_wave_kernels::nr_of_paths; ++p) {
+        auto path = ocean_wave_kernels::path(p);
+        if (!ocean_wave_kernels::is_supported(path))
+            continue;
+        ocean_wave_kernels::multiply_ik(path, n, a.h0_re.data(), a.h0_im.data(), a.kx.data(), a.ky.data(),
+                                        out[0].data(), out[1].data(), out[2].data(), out[3].data());
+        for (unsigned k = 0; k < 4; ++k)
+            REQUIRE(out[k] == ref[k]);
+    }
+}
+
+TEST_CASE("ocean_wave_kernels - alturas del generador con todas las variantes", "[ocean_wave_kernels]") {
+    ocean_wave_generator<float> owg(32, vector2f(1, 1), 12.0f, 1e-6f, 256.0f, 10.0f, 3);
+    owg.set_kernel_path(ocean_wave_kernels::scalar);
+    owg.set_time(12.5f);
+    std::vector<float> ref, h;
+    owg.compute_heights(ref);
+    for (unsigned p = 1; p < ocean_wave_kernels::nr_of_paths; ++p) {
+        auto path = ocean_wave_kernels::path(p);
+        if (!ocean_wave_kernels::is_supported(path))
+            continue;
+        owg.set_kernel_path(path);
+        owg.set_time(12.5f);
+        owg.compute_heights(h);
+        REQUIRE(h.size() == ref.size());
+        for (unsigned i = 0; i < h.size(); ++i)
+            REQUIRE(h[i] == Catch::Approx(ref[i]).margin(1e-4));
+    }
+}
+
+TEST_CASE("ocean_wave_kernels - alturas interpoladas", "[ocean_wave_kernels]") {
+    // tile of 16x16 samples stored like water's wave data, height is every third float
+    const unsigned shift = 4, res = 1 << shift;
+    random_generator rg(11);
+    std::vector<float> data(res * res * 3);
+    for (auto &d : data)
+        d = rg.rndf() * 2.0f - 1.0f;
+    const unsigned n = 101;
+    std::vector<float> x(n), y(n), ref(n), h(n);
+    for (unsigned i = 0; i < n; ++i) {
+        // also outside of the tile and negative, that must wrap around
+        x[i] = (rg.rndf() - 0.5f) * 4.0f * res;
+        y[i] = (rg.rndf() - 0.5f) * 4.0f * res;
+    }
+    x[0] = 3.0f;
+    y[0] = 5.0f;
+    x[1] = 3.0f - res;
+    y[1] = 5.0f + 2 * res;
+    x[2] = 3.5f;
+    y[2] = 5.0f;
+    ocean_wave_kernels::sample_heights(ocean_wave_kernels::scalar, n, x.data(), y.data(), data.data() + 2, 3, shift, ref.data());
+    // exact on sample points and in the middle between two
+    REQUIRE(ref[0] == data[(5 * res + 3) * 3 + 2]);
+    REQUIRE(ref[1] == ref[0]);
+    REQUIRE(ref[2] == Catch::Approx(0.5f * (data[(5 * res + 3) * 3 + 2] + data[(5 * res + 4) * 3 + 2])));
+    for (unsigned p = 1; p < ocean_wave_kernels::nr_of_paths; ++p) {
+        auto path = ocean_wave_kernels::path(p);
+        if (!ocean_wave_kernels::is_supported(path))
+            continue;
+        ocean_wave_kernels::sample_heights(path, n, x.data(), y.data(), data.data() + 2, 3, shift, h.data());
+        REQUIRE(h == ref);
+    }
+}
+
+TEST_CASE("ocean_wave_kernels - normales por lote igual que por punto", "[ocean_wave_kernels]") {
+    const unsigned shift = 5, res = 1 << shift;
+    random_generator rg(23);
+    std::vector<float> data(res * res * 3);
+    for (auto &d : data)
+        d = rg.rndf() * 2.0f - 1.0f;
+    const float *heights = data.data() + 2;
+    // flat tile gives the up vector
+    std::vector<float> flat(res * res * 3, 0.5f);
+    float n[3];
+    ocean_wave_kernels::sample_normal(7.3f, -2.6f, flat.data() + 2, 3, shift, 1.0, n);
+    REQUIRE(n[0] == 0.0f);
+    REQUIRE(n[1] == 0.0f);
+    REQUIRE(n[2] == 1.0f);
+
+    // sample coordinates like water: wrap world position in double precision, then scale
+    const double tile_length = 256.0;
+    const float ffac = res / float(tile_length);
+    auto wrap = [&](double p) { return float(p - std::floor(p / tile_length) * tile_length) * ffac; };
+    const double ox = -123456.75, oy = 98765.25;
+    const double rollfac = 2.0;
+    for (unsigned i = 0; i < 200; ++i) {
+        // offsets like parts of a ship, also across the tile border
+        const float dx = (rg.rndf() - 0.5f) * 300.0f, dy = (rg.rndf() - 0.5f) * 300.0f;
+        // batched: wrap origin once and add scaled offsets, see water::get_normals
+        float batched[3], single[3];
+        ocean_wave_kernels::sample_normal(wrap(ox) + dx * ffac, wrap(oy) + dy * ffac, heights, 3, shift, rollfac, batched);
+        // per point: wrap every position, see water::get_normal
+        ocean_wave_kernels::sample_normal(wrap(ox + dx), wrap(oy + dy), heights, 3, shift, rollfac, single);
+        for (unsigned k = 0; k < 3; ++k)
+            REQUIRE(batched[k] == Catch::Approx(single[k]).margin(1e-4));
+        REQUIRE(single[0] * single[0] + single[1] * single[1] + single[2] * single[2] == Catch::Approx(1.0f));
+    }
+}
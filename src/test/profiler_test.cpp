@@ -0,0 +1,141 @@
+/*
+ * Test para profiler.h: etapas con nombre, medias por fotograma, salida
+ * como CSV y como traza de Chrome, limite de la grabacion y fallos al escribir.
+ */
+#include "catch_amalgamated.hpp"
+#include "../profiler.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+const profiler::clock::duration ms(std::chrono::milliseconds(1));
+
+void measured_work() {
+    profile_scope("test work");
+}
+} // namespace
+
+TEST_CASE("profiler - etapas por nombre", "[profiler]") {
+    profiler &p = profiler::instance();
+    unsigned a = p.get_stage("test a");
+    unsigned b = p.get_stage("test b");
+    REQUIRE(a != b);
+    REQUIRE(p.get_stage("test a") == a);
+    REQUIRE(p.get_stage_name(b) == "test b");
+}
+
+TEST_CASE("profiler - media de fotogramas", "[profiler]") {
+    profiler &p = profiler::instance();
+    unsigned s = p.get_stage("test average");
+    auto t0 = profiler::clock::now();
+    for (unsigned f = 0; f < 4; ++f) {
+        // two calls per frame are summed up
+        p.add_sample(s, t0, t0 + ms);
+        p.add_sample(s, t0, t0 + ms * f);
+        p.end_frame();
+    }
+    // frames had 1, 2, 3 and 4 ms, other frames in history are older
+    REQUIRE(p.get_max_ms(s) == Catch::Approx(4.0));
+    REQUIRE(p.get_overlay_text().find("test average") != std::string::npos);
+}
+
+TEST_CASE("profiler - desactivado no mide", "[profiler]") {
+    profiler &p = profiler::instance();
+    p.end_frame();
+    p.set_enabled(false);
+    measured_work();
+    unsigned s = p.get_stage("test work");
+    p.end_frame();
+    REQUIRE(p.get_max_ms(s) == 0.0);
+    p.set_enabled(true);
+    measured_work();
+    p.set_enabled(false);
+}
+
+TEST_CASE("profiler - grabacion CSV y traza", "[profiler]") {
+    profiler &p = profiler::instance();
+    unsigned s = p.get_stage("test record");
+    p.start_recording();
+    REQUIRE(p.is_recording());
+    auto t0 = profiler::clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; ++t)
+        threads.emplace_back([&p, s, t0] { p.add_sample(s, t0, t0 + ms * 2); });
+    for (auto &t : threads)
+        t.join();
+    p.end_frame();
+    p.add_sample(s, t0, t0 + ms);
+    p.end_frame();
+    p.stop_recording();
+    p.add_sample(s, t0, t0 + ms);
+    p.end_frame();
+
+    std::ostringstream csv;
+    p.write_csv(csv);
+    std::istringstream lines(csv.str());
+    std::string header, f0, f1, rest;
+    std::getline(lines, header);
+    std::getline(lines, f0);
+    std::getline(lines, f1);
+    REQUIRE(header.substr(0, 5) == "frame");
+    REQUIRE(header.find("test record") != std::string::npos);
+    REQUIRE(f0.substr(0, 2) == "0,");
+    REQUIRE(f1.substr(0, 2) == "1,");
+    // only two frames were recorded
+    REQUIRE_FALSE(std::getline(lines, rest));
+
+    std::ostringstream trace;
+    p.write_chrome_trace(trace);
+    const std::string js = trace.str();
+    REQUIRE(js.find("{\"traceEvents\":[") == 0);
+    unsigned nr_events = 0;
+    for (std::size_t pos = js.find("\"test record\""); pos != std::string::npos; pos = js.find("\"test record\"", pos + 1))
+        ++nr_events;
+    REQUIRE(nr_events == 5);
+    REQUIRE(js.find("\"dur\":2000.000") != std::string::npos);
+}
+
+TEST_CASE("profiler - grabacion limitada y escrita al parar", "[profiler]") {
+    profiler &p = profiler::instance();
+    unsigned s = p.get_stage("test limit");
+    const std::string filename = "/tmp/dftd_profiler_test_recording.csv";
+    p.start_recording(filename);
+    auto t0 = profiler::clock::now();
+    for (unsigned f = 0; f < profiler::max_recorded_frames + 10; ++f) {
+        p.add_sample(s, t0, t0 + ms);
+        p.end_frame();
+    }
+    // stopped at the limit and written to the file
+    REQUIRE_FALSE(p.is_recording());
+    std::ifstream in(filename.c_str());
+    REQUIRE(in.good());
+    unsigned nr_lines = 0;
+    for (std::string line; std::getline(in, line);)
+        ++nr_lines;
+    REQUIRE(nr_lines == profiler::max_recorded_frames + 1);
+    in.close();
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("profiler - fallo al escribir no lanza error", "[profiler]") {
+    profiler &p = profiler::instance();
+    unsigned s = p.get_stage("test write error");
+    p.start_recording("/nonexistent_dftd_dir/recording.csv");
+    auto t0 = profiler::clock::now();
+    // reaching the limit stops and writes at the end of the frame
+    for (unsigned f = 0; f < profiler::max_recorded_frames - 1; ++f) {
+        p.add_sample(s, t0, t0 + ms);
+        p.end_frame();
+    }
+    REQUIRE(p.is_recording());
+    REQUIRE_NOTHROW(p.end_frame());
+    REQUIRE_FALSE(p.is_recording());
+    // also when stopped explicitly
+    p.start_recording("/nonexistent_dftd_dir/recording.json");
+    p.end_frame();
+    REQUIRE_NOTHROW(p.stop_recording());
+    REQUIRE_FALSE(p.is_recording());
+}
@@ -1,9 +1,13 @@
 /*
  * Test para rnd() y seed_global_rnd() (generador global, std::mt19937).
- * Cubre: rango [0,1), reproducibilidad con semilla, rnd(unsigned) en [0,b-1].
+ * Cubre: rango [0,1), reproducibilidad con semilla, rnd(unsigned) en [0,b-1],
+ * llamadas desde varios hilos, rnd_stream por tarea.
  */
 #include "catch_amalgamated.hpp"
 #include "../rnd.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
 
 TEST_CASE("rnd() - valores en [0, 1)", "[rnd]") {
     seed_global_rnd(42u);
@@ -47,3 +51,89 @@ TEST_CASE("rnd(unsigned) - rango [0, b-1] para varios b", "[rnd]") {
         }
     }
 }
+
+TEST_CASE("rnd(unsigned) - varios hilos dan la misma secuencia repartida", "[rnd]") {
+    // parallel simulation tasks share the generator, no number may be lost or doubled
+    seed_global_rnd(4242u);
+    std::vector<unsigned> serial(4000);
+    for (auto &v : serial)
+        v = rnd(1000000u);
+
+    seed_global_rnd(4242u);
+    std::vector<std::vector<unsigned>> drawn(4);
+    std::vector<std::thread> threads;
+    for (auto &d : drawn)
+        threads.emplace_back([&d]() {
+            for (unsigned i = 0; i < 1000; ++i)
+                d.push_back(rnd(1000000u));
+        });
+    for (auto &t : threads)
+        t.join();
+    std::vector<unsigned> all;
+    for (auto &d : drawn)
+        all.insert(all.end(), d.begin(), d.end());
+    std::sort(all.begin(), all.end());
+    std::sort(serial.begin(), serial.end());
+    REQUIRE(all == serial);
+}
+
+TEST_CASE("rnd_stream - misma secuencia para paso y tarea en cualquier hilo", "[rnd]") {
+    // simulation tasks draw from their own stream, so the thread running them doesn't matter
+    const unsigned nr_tasks = 8;
+    std::vector<std::vector<unsigned>> serial(nr_tasks);
+    for (unsigned t = 0; t < nr_tasks; ++t) {
+        rnd_stream rs(17ull, t);
+        for (unsigned i = 0; i < 500; ++i)
+            serial[t].push_back(rnd(1000000u));
+    }
+    std::vector<std::vector<unsigned>> threaded(nr_tasks);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < nr_tasks; ++t)
+        threads.emplace_back([&threaded, t]() {
+            rnd_stream rs(17ull, t);
+            for (unsigned i = 0; i < 500; ++i)
+                threaded[t].push_back(rnd(1000000u));
+        });
+    for (auto &t : threads)
+        t.join();
+    REQUIRE(threaded == serial);
+    REQUIRE(serial[0] != serial[1]);
+}
+
+TEST_CASE("rnd_stream - pasos distintos dan secuencias distintas", "[rnd]") {
+    std::vector<double> a, b;
+    {
+        rnd_stream rs(1ull, 0u);
+        for (int i = 0; i < 10; ++i)
+            a.push_back(rnd());
+    }
+    {
+        rnd_stream rs(1ull << 32, 0u);
+        for (int i = 0; i < 10; ++i)
+            b.push_back(rnd());
+    }
+    REQUIRE(a != b);
+}
+
+TEST_CASE("rnd_stream - al destruirse vuelve el generador global", "[rnd]") {
+    seed_global_rnd(555u);
+    const double first = rnd();
+    const double second = rnd();
+
+    seed_global_rnd(555u);
+    REQUIRE(rnd_stream::current() == nullptr);
+    REQUIRE(rnd() == first);
+    {
+        rnd_stream outer(3ull, 1u);
+        REQUIRE(rnd_stream::current() == &outer);
+        {
+            rnd_stream inner(3ull, 2u);
+            REQUIRE(rnd_stream::current() == &inner);
+            rnd();
+        }
+        REQUIRE(rnd_stream::current() == &outer);
+        rnd();
+    }
+    REQUIRE(rnd_stream::current() == nullptr);
+    REQUIRE(rnd() == second);
+}
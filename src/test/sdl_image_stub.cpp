@@ -0,0 +1,16 @@
+/*
+ * Stub mínimo para sdl_image (solo para testing), sin decodificar imágenes
+ */
+#include "../error.h"
+#include "../texture.h"
+
+sdl_image::sdl_image(const std::string &filename) {
+    throw error(std::string("sdl_image stub can't load ") + filename);
+}
+
+std::vector<uint8_t> sdl_image::get_plain_data(unsigned &, unsigned &, unsigned &) {
+    throw error("sdl_image stub has no data");
+}
+
+texture::~texture() {
+}
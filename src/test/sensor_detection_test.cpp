@@ -0,0 +1,278 @@
+/*
+ * Test para sensor_detection.h: las formulas por objetivo que usan
+ * sensor::is_detected (por pares) y sensor::detect (por lotes), con valores
+ * calculados a mano, y los lotes con el mismo orden de rnd() que por pares.
+ * Ejecutar benchmark con: sensor_detection_test "[.benchmark]"
+ */
+#include "catch_amalgamated.hpp"
+#include "../random_generator.h"
+#include "../rnd.h"
+#include "../sensor_detection.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+using Catch::Approx;
+
+namespace {
+sensor_detection::sensor_params make_params(double range, double bearing, double cone) {
+    sensor_detection::sensor_params sp;
+    sp.range = range;
+    sp.bearing = angle(bearing);
+    sp.detection_cone = cone;
+    return sp;
+}
+
+// a record as ship::get_sensor_target gives it, heading north
+sensor_target make_ship(double x, double y, const std::vector<float> *cs, double noise_factor = 0.0) {
+    sensor_target t;
+    t.pos = vector3(x, y, 0);
+    t.noise_source = vector2(x, y);
+    t.noise_factor = noise_factor;
+    t.cross_sections = cs;
+    return t;
+}
+
+// a record as submarine::get_sensor_target gives it
+sensor_target make_submarine(double x, double y, double depth, const std::vector<float> *cs) {
+    sensor_target t = make_ship(x, y, cs);
+    t.pos.z = -depth;
+    t.is_submarine = true;
+    t.submerged = depth > 0.0;
+    t.surface_scale = (depth < 10.0) ? 0.1 * (10.0 - depth) : 0.0;
+    t.sonar_scale = (depth > 10.0) ? 1.0 : 0.0;
+    return t;
+}
+
+unsigned count(const sensor_detection::mask &m, unsigned n) {
+    unsigned c = 0;
+    for (unsigned i = 0; i < n; ++i)
+        c += sensor_detection::test(m, i) ? 1 : 0;
+    return c;
+}
+
+// a convoy with submarines at various depths around the origin
+struct scene {
+    std::vector<float> cross_sections;
+    std::vector<sensor_target> targets;
+    scene(unsigned n, unsigned seed) {
+        random_generator rg(seed);
+        for (unsigned i = 0; i < 36; ++i)
+            cross_sections.push_back(200.0f + 800.0f * std::fabs(std::sin(i * 10.0f * 3.14159f / 180.0f)));
+        for (unsigned i = 0; i < n; ++i) {
+            double x = (rg.rndf() - 0.5) * 20000.0;
+            double y = (rg.rndf() - 0.5) * 20000.0;
+            sensor_target t;
+            if (i % 4 == 0) {
+                double depth = (i % 8 == 0) ? rg.rndf() * 100.0 : rg.rndf() * 3.0;
+                t = make_submarine(x, y, depth, &cross_sections);
+                t.noise_factor = 0.007 * rg.rndf();
+            } else {
+                t = make_ship(x, y, &cross_sections, rg.rndf());
+            }
+            t.heading = angle(rg.rndf() * 360.0);
+            t.noise_source = t.pos.xy() - t.heading.direction() * 24.0;
+            t.depth_factor = 1.0 - 0.5 * t.pos.z / 400.0;
+            targets.push_back(t);
+        }
+    }
+};
+} // namespace
+
+TEST_CASE("sensor_detection - mascara de bits", "[sensor_detection]") {
+    sensor_detection::mask m;
+    sensor_detection::reset(m, 130);
+    REQUIRE(m.size() == 3);
+    sensor_detection::set(m, 0);
+    sensor_detection::set(m, 63);
+    sensor_detection::set(m, 64);
+    sensor_detection::set(m, 129);
+    REQUIRE(sensor_detection::test(m, 0));
+    REQUIRE(sensor_detection::test(m, 63));
+    REQUIRE(sensor_detection::test(m, 64));
+    REQUIRE(sensor_detection::test(m, 129));
+    REQUIRE_FALSE(sensor_detection::test(m, 1));
+    REQUIRE_FALSE(sensor_detection::test(m, 128));
+    REQUIRE(count(m, 130) == 4);
+}
+
+TEST_CASE("sensor_detection - sin modelo no hay seccion", "[sensor_detection]") {
+    sensor_target t;
+    REQUIRE(t.get_cross_section(vector2(100, 0)) == 0.0);
+    REQUIRE(t.surface_visibility(vector2(100, 0)) == 0.0f);
+}
+
+TEST_CASE("sensor_detection - seccion interpolada por angulo", "[sensor_detection]") {
+    const std::vector<float> cs = {100.0f, 200.0f, 300.0f, 400.0f};
+    REQUIRE(sensor_target::interpolate_cross_section(cs, 0.0f) == Approx(100.0f));
+    REQUIRE(sensor_target::interpolate_cross_section(cs, 90.0f) == Approx(200.0f));
+    REQUIRE(sensor_target::interpolate_cross_section(cs, 45.0f) == Approx(150.0f));
+    // wraps from the last entry to the first
+    REQUIRE(sensor_target::interpolate_cross_section(cs, 315.0f) == Approx(250.0f));
+    REQUIRE(sensor_target::interpolate_cross_section(std::vector<float>(), 45.0f) == 0.0f);
+    // target heading north, watcher to the east: angle of target relative to watcher is 270 degrees
+    sensor_target t = make_ship(0, 0, &cs);
+    REQUIRE(t.get_cross_section(vector2(1000, 0)) == Approx(400.0));
+    REQUIRE(t.get_cross_section(vector2(0, -1000)) == Approx(100.0));
+}
+
+TEST_CASE("sensor_detection - vigia", "[sensor_detection]") {
+    const std::vector<float> cs(36, 1000.0f);
+    sensor_target d = make_ship(0, 0, &cs);
+    // visibility / distance must reach 0.05, so 1000 square meters are seen up to 20km
+    REQUIRE(sensor_detection::lookout_detects(d, 30000, make_ship(19000, 0, &cs)));
+    REQUIRE_FALSE(sensor_detection::lookout_detects(d, 30000, make_ship(21000, 0, &cs)));
+    // never beyond the view distance
+    REQUIRE(sensor_detection::lookout_detects(d, 15000, make_ship(14000, 0, &cs)));
+    REQUIRE_FALSE(sensor_detection::lookout_detects(d, 10000, make_ship(10000, 0, &cs)));
+    // objects nearer than a meter are always seen, even without cross section
+    REQUIRE(sensor_detection::lookout_detects(d, 30000, make_ship(0.5, 0, nullptr)));
+    // a submarine at 5m shows half of its cross section, a deep one nothing
+    REQUIRE(sensor_detection::lookout_detects(d, 30000, make_submarine(9000, 0, 5, &cs)));
+    REQUIRE_FALSE(sensor_detection::lookout_detects(d, 30000, make_submarine(11000, 0, 5, &cs)));
+    REQUIRE_FALSE(sensor_detection::lookout_detects(d, 30000, make_submarine(100, 0, 20, &cs)));
+    // a periscope is seen by the offset only
+    sensor_target scope = make_submarine(90, 0, 12, &cs);
+    scope.surface_offset = 5.0;
+    REQUIRE(scope.surface_visibility(vector2(0, 0)) == Approx(5.0f));
+    REQUIRE(sensor_detection::lookout_detects(d, 30000, scope));
+}
+
+TEST_CASE("sensor_detection - sonar pasivo", "[sensor_detection]") {
+    const std::vector<float> cs(36, 1000.0f);
+    const auto sp = make_params(1000, 0, 20);
+    sensor_target d = make_ship(0, 0, &cs, 0.5);
+    double level = -1.0;
+    // level is (1 - detector noise) * target noise * (range / distance)^2, threshold is at most 0.19
+    seed_global_rnd(3);
+    REQUIRE(sensor_detection::passive_sonar_detects(sp, d, make_ship(0, 500, &cs, 0.5), level));
+    REQUIRE(level == Approx(0.5 * 0.5 * 4.0));
+    REQUIRE_FALSE(sensor_detection::passive_sonar_detects(sp, d, make_ship(0, 1000, &cs, 0.1), level));
+    REQUIRE(level == Approx(0.05));
+    // out of range or outside the cone there is no sound at all
+    REQUIRE_FALSE(sensor_detection::passive_sonar_detects(sp, d, make_ship(0, 1500, &cs, 1.0), level));
+    REQUIRE(level == 0.0);
+    REQUIRE_FALSE(sensor_detection::passive_sonar_detects(sp, d, make_ship(500, 0, &cs, 1.0), level));
+    REQUIRE(level == 0.0);
+    // surfaced submarines hear nothing
+    sensor_target sub = make_submarine(0, 0, 0, &cs);
+    REQUIRE_FALSE(sensor_detection::passive_sonar_detects(sp, sub, make_ship(0, 500, &cs, 1.0), level));
+    sub = make_submarine(0, 0, 50, &cs);
+    REQUIRE(sensor_detection::passive_sonar_detects(sp, sub, make_ship(0, 500, &cs, 1.0), level));
+}
+
+TEST_CASE("sensor_detection - radar", "[sensor_detection]") {
+    const std::vector<float> cs(36, 1.0f);
+    const auto sp = make_params(1000, 0, 360);
+    // signal is (range / distance)^4 * surface visibility
+    seed_global_rnd(4);
+    sensor_target d = make_ship(0, 0, &cs);
+    REQUIRE(sensor_detection::radar_detects(sp, d, make_ship(0, 500, &cs)));
+    REQUIRE(sensor_detection::radar_detects(sp, d, make_ship(0, 1000, &cs)));
+    REQUIRE_FALSE(sensor_detection::radar_detects(sp, d, make_ship(0, 1001, &cs)));
+    // deep submarines give no echo
+    REQUIRE_FALSE(sensor_detection::radar_detects(sp, d, make_submarine(0, 500, 20, &cs)));
+    // submerged submarines can't use radar
+    REQUIRE_FALSE(sensor_detection::radar_detects(sp, make_submarine(0, 0, 20, &cs), make_ship(0, 500, &cs)));
+    REQUIRE(sensor_detection::radar_detects(sp, make_submarine(0, 0, 0, &cs), make_ship(0, 500, &cs)));
+}
+
+TEST_CASE("sensor_detection - ASDIC", "[sensor_detection]") {
+    const std::vector<float> cs(36, 700.0f);
+    const auto sp = make_params(1000, 0, 15);
+    sensor_target d = make_ship(0, 0, &cs);
+    // product is (range / distance)^4 * sonar visibility * (1 - detector noise) * depth factor
+    seed_global_rnd(5);
+    sensor_target sub = make_submarine(0, 1000, 50, &cs);
+    REQUIRE(sub.sonar_visibility(vector2(0, 0)) == Approx(1.0f));
+    REQUIRE(sensor_detection::active_sonar_detects(sp, d, sub));
+    sub.depth_factor = 0.05;
+    REQUIRE_FALSE(sensor_detection::active_sonar_detects(sp, d, sub));
+    // only submerged submarines, only in the cone
+    REQUIRE_FALSE(sensor_detection::active_sonar_detects(sp, d, make_ship(0, 500, &cs)));
+    REQUIRE_FALSE(sensor_detection::active_sonar_detects(sp, d, make_submarine(0, 500, 0, &cs)));
+    REQUIRE_FALSE(sensor_detection::active_sonar_detects(sp, d, make_submarine(500, 0, 50, &cs)));
+    // surfaced submarines can't use ASDIC
+    REQUIRE_FALSE(sensor_detection::active_sonar_detects(sp, make_submarine(0, 0, 0, &cs),
+                                                         make_submarine(0, 500, 50, &cs)));
+}
+
+TEST_CASE("sensor_detection - lotes igual que por pares", "[sensor_detection]") {
+    scene sc(300, 1);
+    const unsigned n = unsigned(sc.targets.size());
+    // detecting units: a surface ship, a surfaced and a submerged submarine
+    for (unsigned di : {1u, 4u, 8u}) {
+        const sensor_target &d = sc.targets[di];
+        sensor_detection::mask batch, ref;
+
+        sensor_detection::reset(ref, n);
+        for (unsigned i = 0; i < n; ++i)
+            if (sensor_detection::lookout_detects(d, 20000, sc.targets[i]))
+                sensor_detection::set(ref, i);
+        sensor_detection::lookout(d, 20000, sc.targets, batch);
+        REQUIRE(batch == ref);
+
+        const auto pp = make_params(9500, 0, 360);
+        seed_global_rnd(7);
+        sensor_detection::reset(ref, n);
+        std::vector<double> ref_levels(n);
+        for (unsigned i = 0; i < n; ++i)
+            if (sensor_detection::passive_sonar_detects(pp, d, sc.targets[i], ref_levels[i]))
+                sensor_detection::set(ref, i);
+        seed_global_rnd(7);
+        std::vector<double> sound_levels;
+        sensor_detection::passive_sonar(pp, d, sc.targets, batch, &sound_levels);
+        REQUIRE(batch == ref);
+        REQUIRE(sound_levels == ref_levels);
+
+        const auto pr = make_params(7000, 0, 60);
+        seed_global_rnd(8);
+        sensor_detection::reset(ref, n);
+        for (unsigned i = 0; i < n; ++i)
+            if (sensor_detection::radar_detects(pr, d, sc.targets[i]))
+                sensor_detection::set(ref, i);
+        seed_global_rnd(8);
+        sensor_detection::radar(pr, d, sc.targets, batch);
+        REQUIRE(batch == ref);
+
+        const auto pa = make_params(1500, 0, 15);
+        seed_global_rnd(9);
+        sensor_detection::reset(ref, n);
+        for (unsigned i = 0; i < n; ++i)
+            if (sensor_detection::active_sonar_detects(pa, d, sc.targets[i]))
+                sensor_detection::set(ref, i);
+        seed_global_rnd(9);
+        sensor_detection::active_sonar(pa, d, sc.targets, batch);
+        REQUIRE(batch == ref);
+    }
+    // make sure the lookouts see something but not everything
+    sensor_detection::mask batch;
+    sensor_detection::lookout(sc.targets[1], 20000, sc.targets, batch);
+    REQUIRE(count(batch, n) > 0);
+    REQUIRE(count(batch, n) < n);
+}
+
+TEST_CASE("sensor_detection - benchmark lotes", "[.benchmark][sensor_detection]") {
+    const auto pp = make_params(9500, 0, 360);
+    const auto pa = make_params(1500, 0, 15);
+    for (unsigned n : {50u, 200u, 1000u}) {
+        scene sc(n, 2);
+        const sensor_target &d = sc.targets[1];
+        const std::string sz = std::to_string(n);
+        BENCHMARK("vigia lote " + sz) {
+            sensor_detection::mask m;
+            sensor_detection::lookout(d, 20000, sc.targets, m);
+            return m;
+        };
+        BENCHMARK("sonar pasivo lote " + sz) {
+            sensor_detection::mask m;
+            sensor_detection::passive_sonar(pp, d, sc.targets, m);
+            return m;
+        };
+        BENCHMARK("ASDIC lote " + sz) {
+            sensor_detection::mask m;
+            sensor_detection::active_sonar(pa, d, sc.targets, m);
+            return m;
+        };
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * Test para spatial_index.h: consultas por radio y por sector sobre una rejilla.
+ */
+#include "catch_amalgamated.hpp"
+#include "../spatial_index.h"
+#include "../random_generator.h"
+#include <cmath>
+#include <vector>
+
+static std::vector<vector2> random_positions(unsigned n, double extent, unsigned seed) {
+    random_generator rg(seed);
+    std::vector<vector2> result(n);
+    for (auto &p : result)
+        p = vector2((rg.rndf() - 0.5) * extent, (rg.rndf() - 0.5) * extent);
+    return result;
+}
+
+static std::vector<unsigned> brute_force(const std::vector<vector2> &pos, const vector2 &c, double r) {
+    std::vector<unsigned> result;
+    for (unsigned i = 0; i < pos.size(); ++i)
+        if (pos[i].square_distance(c) <= r * r)
+            result.push_back(i);
+    return result;
+}
+
+TEST_CASE("spatial_index - indice vacio no devuelve nada", "[spatial_index]") {
+    spatial_index idx;
+    std::vector<unsigned> result(3, 7);
+    idx.query(vector2(0, 0), 1000.0, result);
+    REQUIRE(result.empty());
+    REQUIRE(idx.get_nr_of_objects() == 0);
+}
+
+TEST_CASE("spatial_index - tamano de celda invalido lanza error", "[spatial_index]") {
+    REQUIRE_THROWS(spatial_index(0.0));
+}
+
+TEST_CASE("spatial_index - consulta por radio igual a fuerza bruta", "[spatial_index]") {
+    auto pos = random_positions(2000, 200000.0, 42);
+    spatial_index idx(1500.0);
+    idx.build(pos);
+    REQUIRE(idx.get_nr_of_objects() == 2000);
+    random_generator rg(7);
+    std::vector<unsigned> result;
+    for (unsigned q = 0; q < 100; ++q) {
+        vector2 c((rg.rndf() - 0.5) * 220000.0, (rg.rndf() - 0.5) * 220000.0);
+        double r = rg.rndf() * 30000.0;
+        idx.query(c, r, result);
+        REQUIRE(result == brute_force(pos, c, r));
+    }
+}
+
+TEST_CASE("spatial_index - coordenadas negativas y bordes de celda", "[spatial_index]") {
+    std::vector<vector2> pos = {vector2(-1000, -1000), vector2(0, 0), vector2(999.9, 0), vector2(1000, 0)};
+    spatial_index idx(1000.0);
+    idx.build(pos);
+    std::vector<unsigned> result;
+    idx.query(vector2(0, 0), 1000.0, result);
+    REQUIRE(result == std::vector<unsigned>({1, 2, 3}));
+    idx.query(vector2(-1000, -1000), 1.0, result);
+    REQUIRE(result == std::vector<unsigned>({0}));
+}
+
+TEST_CASE("spatial_index - consulta por sector", "[spatial_index]") {
+    // objects north, east, south and west of center, 1000m away
+    std::vector<vector2> pos = {vector2(0, 1000), vector2(1000, 0), vector2(0, -1000), vector2(-1000, 0)};
+    spatial_index idx;
+    idx.build(pos);
+    std::vector<unsigned> result;
+    idx.query_sector(vector2(0, 0), 1500.0, angle(0), 15.0, 0.0, result);
+    REQUIRE(result == std::vector<unsigned>({0}));
+    idx.query_sector(vector2(0, 0), 1500.0, angle(90), 15.0, 0.0, result);
+    REQUIRE(result == std::vector<unsigned>({1}));
+    idx.query_sector(vector2(0, 0), 1500.0, angle(225), 50.0, 0.0, result);
+    REQUIRE(result == std::vector<unsigned>({2, 3}));
+    idx.query_sector(vector2(0, 0), 1500.0, angle(0), 180.0, 0.0, result);
+    REQUIRE(result == std::vector<unsigned>({0, 1, 2, 3}));
+    // out of range
+    idx.query_sector(vector2(0, 0), 900.0, angle(0), 15.0, 0.0, result);
+    REQUIRE(result.empty());
+}
+
+TEST_CASE("spatial_index - sector con tolerancia es conservador", "[spatial_index]") {
+    auto pos = random_positions(1000, 10000.0, 3);
+    spatial_index idx(500.0);
+    idx.build(pos);
+    const double tolerance = 100.0;
+    random_generator rg(11);
+    std::vector<unsigned> result;
+    for (unsigned q = 0; q < 50; ++q) {
+        vector2 c((rg.rndf() - 0.5) * 10000.0, (rg.rndf() - 0.5) * 10000.0);
+        angle dir(rg.rndf() * 360.0);
+        double half = rg.rndf() * 60.0;
+        idx.query_sector(c, 3000.0, dir, half, tolerance, result);
+        for (unsigned i = 0; i < pos.size(); ++i) {
+            // every object exactly within the sector must be found
+            vector2 d = pos[i] - c;
+            bool inside = d.length() <= 3000.0 && std::fabs((angle(d) - dir).value_pm180()) <= half;
+            if (inside)
+                REQUIRE(std::binary_search(result.begin(), result.end(), i));
+        }
+        // and everything found is within tolerance of the sector
+        for (unsigned i : result)
+            REQUIRE(pos[i].distance(c) <= 3000.0 + tolerance);
+    }
+}
@@ -128,3 +128,25 @@ TEST_CASE("spheref - compute_bound con esferas distantes", "[sphere]") {
     REQUIRE(bound.is_inside(s2.center));
     REQUIRE(bound.radius >= 100.0f);
 }
+
+TEST_CASE("sphere - intersects_swept con segmento", "[sphere]") {
+    sphere s(vector3(0, 0, 0), 5.0);
+
+    // segment passes through the sphere although both end points are outside
+    REQUIRE(s.intersects_swept(vector3(-10, 1, 0), vector3(10, 1, 0), 0.0));
+    // segment ends before the sphere
+    REQUIRE_FALSE(s.intersects_swept(vector3(-20, 0, 0), vector3(-10, 0, 0), 0.0));
+    // segment passes by, but the moving sphere's radius touches
+    REQUIRE_FALSE(s.intersects_swept(vector3(-10, 7, 0), vector3(10, 7, 0), 1.0));
+    REQUIRE(s.intersects_swept(vector3(-10, 7, 0), vector3(10, 7, 0), 2.5));
+    // start point inside
+    REQUIRE(s.intersects_swept(vector3(1, 1, 1), vector3(100, 100, 100), 0.0));
+}
+
+TEST_CASE("sphere - intersects_swept estatico igual que intersects", "[sphere]") {
+    sphere s(vector3(3, -2, 1), 4.0);
+    for (int i = -12; i <= 12; ++i) {
+        vector3 p(i, 0.5 * i, -0.25 * i);
+        REQUIRE(s.intersects_swept(p, p, 1.5) == s.intersects(sphere(p, 1.5)));
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Test para sweep_and_prune.h: fase amplia de colisiones con esferas.
+ */
+#include "catch_amalgamated.hpp"
+#include "../sweep_and_prune.h"
+#include "../random_generator.h"
+#include <utility>
+#include <vector>
+
+typedef std::vector<std::pair<unsigned, unsigned>> pair_list;
+
+static pair_list brute_force(const std::vector<sphere> &spheres) {
+    pair_list result;
+    for (unsigned i = 0; i < spheres.size(); ++i)
+        for (unsigned j = i + 1; j < spheres.size(); ++j)
+            if (spheres[i].intersects(spheres[j]))
+                result.push_back(std::make_pair(i, j));
+    return result;
+}
+
+TEST_CASE("sweep_and_prune - sin esferas no hay pares", "[sweep_and_prune]") {
+    std::vector<sphere> spheres;
+    pair_list pairs;
+    REQUIRE(sweep_and_prune(spheres, pairs) == 0);
+    REQUIRE(pairs.empty());
+}
+
+TEST_CASE("sweep_and_prune - esferas separadas en x no se comparan", "[sweep_and_prune]") {
+    std::vector<sphere> spheres;
+    for (unsigned i = 0; i < 10; ++i)
+        spheres.push_back(sphere(vector3(i * 100.0, 0, 0), 10.0));
+    pair_list pairs;
+    REQUIRE(sweep_and_prune(spheres, pairs) == 0);
+    REQUIRE(pairs.empty());
+}
+
+TEST_CASE("sweep_and_prune - pares ordenados con i < j", "[sweep_and_prune]") {
+    std::vector<sphere> spheres;
+    spheres.push_back(sphere(vector3(50, 0, 0), 10.0));
+    spheres.push_back(sphere(vector3(0, 0, 0), 10.0));
+    spheres.push_back(sphere(vector3(15, 0, 0), 10.0));
+    pair_list pairs;
+    sweep_and_prune(spheres, pairs);
+    REQUIRE(pairs == pair_list({std::make_pair(1u, 2u)}));
+}
+
+TEST_CASE("sweep_and_prune - mismo resultado que fuerza bruta", "[sweep_and_prune]") {
+    random_generator rg(4711);
+    std::vector<sphere> spheres;
+    for (unsigned i = 0; i < 300; ++i)
+        spheres.push_back(sphere(vector3(rg.rndf() * 5000.0, rg.rndf() * 5000.0, rg.rndf() * 20.0 - 10.0),
+                                 20.0 + rg.rndf() * 100.0));
+    pair_list pairs;
+    unsigned long tested = sweep_and_prune(spheres, pairs);
+    REQUIRE(pairs == brute_force(spheres));
+    REQUIRE(tested < 300ul * 299ul / 2);
+}
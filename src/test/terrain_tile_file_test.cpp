@@ -0,0 +1,81 @@
+/*
+ * Test para terrain_tile_file.h: escribir y leer archivos de tiles con y sin
+ * compresion, tiles que faltan y archivos corruptos.
+ */
+#include "catch_amalgamated.hpp"
+#include "../error.h"
+#include "../terrain_tile_file.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+const unsigned tile_size = 16;
+
+std::vector<int16_t> make_tile(const vector2i &idx) {
+    std::vector<int16_t> t(tile_size * tile_size);
+    for (unsigned i = 0; i < t.size(); ++i)
+        t[i] = int16_t(idx.x * 1000 + idx.y * 100 + int(i / 7));
+    return t;
+}
+
+void write_file(const char *filename, terrain_tile_file::codec_type codec) {
+    // 40x20 samples are 3x2 tiles, tile (1,1) is missing
+    terrain_tile_file::writer w(filename, vector2i(40, 20), tile_size, sizeof(int16_t), codec);
+    for (int y = 0; y < 2; ++y)
+        for (int x = 0; x < 3; ++x)
+            if (x != 1 || y != 1)
+                w.add_tile(vector2i(x, y), make_tile(vector2i(x, y)).data());
+    w.finish();
+}
+} // namespace
+
+TEST_CASE("terrain_tile_file - escribir y leer", "[terrain_tile_file]") {
+    const char *filename = "terrain_tile_file_test.ddtile";
+    for (auto codec : {terrain_tile_file::codec_raw, terrain_tile_file::codec_block}) {
+        write_file(filename, codec);
+        terrain_tile_file f(filename);
+        REQUIRE(f.get_codec() == codec);
+        REQUIRE(f.get_image_size() == vector2i(40, 20));
+        REQUIRE(f.get_nr_of_tiles() == vector2i(3, 2));
+        REQUIRE(f.get_tile_size() == tile_size);
+        REQUIRE(f.get_element_size() == sizeof(int16_t));
+        std::vector<int16_t> t(tile_size * tile_size, -200);
+        REQUIRE(f.read_tile(vector2i(2, 1), t.data()));
+        REQUIRE(t == make_tile(vector2i(2, 1)));
+        REQUIRE(f.read_tile(vector2i(0, 0), t.data()));
+        REQUIRE(t == make_tile(vector2i(0, 0)));
+        // missing tile leaves data unchanged
+        REQUIRE_FALSE(f.read_tile(vector2i(1, 1), t.data()));
+        REQUIRE(t == make_tile(vector2i(0, 0)));
+        REQUIRE_THROWS_AS(f.read_tile(vector2i(3, 0), t.data()), error);
+    }
+    std::remove(filename);
+}
+
+TEST_CASE("terrain_tile_file - archivo que falta o corrupto", "[terrain_tile_file]") {
+    const char *filename = "terrain_tile_file_test_bad.ddtile";
+    std::remove(filename);
+    REQUIRE_THROWS_AS(terrain_tile_file(filename), file_read_error);
+    write_file(filename, terrain_tile_file::codec_block);
+    {
+        // truncate file, table is lost
+        std::ifstream in(filename, std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), std::streamsize(data.size() - 16));
+    }
+    REQUIRE_THROWS_AS(terrain_tile_file(filename), error);
+    std::remove(filename);
+}
+
+TEST_CASE("terrain_tile_file - tile anadido dos veces", "[terrain_tile_file]") {
+    const char *filename = "terrain_tile_file_test_twice.ddtile";
+    terrain_tile_file::writer w(filename, vector2i(16, 16), tile_size, sizeof(int16_t), terrain_tile_file::codec_raw);
+    w.add_tile(vector2i(0, 0), make_tile(vector2i(0, 0)).data());
+    REQUIRE_THROWS_AS(w.add_tile(vector2i(0, 0), make_tile(vector2i(0, 0)).data()), error);
+    REQUIRE_THROWS_AS(w.add_tile(vector2i(1, 0), make_tile(vector2i(0, 0)).data()), error);
+    // not finished, so no file is left behind
+}
@@ -0,0 +1,75 @@
+/*
+ * Test para thread_pool.h/cpp: ejecución de lotes de tareas con work stealing.
+ */
+#include "catch_amalgamated.hpp"
+#include "../thread_pool.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("thread_pool - cada tarea se ejecuta exactamente una vez", "[thread_pool]") {
+    thread_pool tp(4, "tptest");
+    REQUIRE(tp.get_nr_of_threads() == 4);
+    std::vector<std::atomic<int>> counts(1000);
+    for (auto &c : counts)
+        c = 0;
+    std::atomic<bool> thr_ok(true);
+    tp.run(unsigned(counts.size()), [&](unsigned task, unsigned thr) {
+        if (thr >= 4)
+            thr_ok = false;
+        ++counts[task];
+    });
+    REQUIRE(thr_ok.load());
+    for (auto &c : counts)
+        REQUIRE(c.load() == 1);
+}
+
+TEST_CASE("thread_pool - lotes repetidos y lote vacío", "[thread_pool]") {
+    thread_pool tp(3, "tptest");
+    std::atomic<unsigned> sum(0);
+    for (unsigned r = 0; r < 50; ++r)
+        tp.run(r, [&](unsigned task, unsigned) { sum += task; });
+    // sum over r of r*(r-1)/2
+    unsigned expected = 0;
+    for (unsigned r = 0; r < 50; ++r)
+        expected += r * (r - 1) / 2;
+    REQUIRE(sum.load() == expected);
+}
+
+TEST_CASE("thread_pool - un solo thread ejecuta en el llamador", "[thread_pool]") {
+    thread_pool tp(1, "tptest");
+    std::vector<unsigned> order, threads;
+    tp.run(5, [&](unsigned task, unsigned thr) {
+        order.push_back(task);
+        threads.push_back(thr);
+    });
+    REQUIRE(threads == std::vector<unsigned>(5, 0));
+    REQUIRE(order == std::vector<unsigned>({0, 1, 2, 3, 4}));
+}
+
+TEST_CASE("thread_pool - tareas desbalanceadas provocan robo", "[thread_pool]") {
+    thread_pool tp(2, "tptest");
+    std::atomic<unsigned> done(0);
+    // thread 0 gets the expensive first half, thread 1 must steal from it
+    tp.run(64, [&](unsigned task, unsigned) {
+        if (task < 32)
+            thread::sleep(1);
+        ++done;
+    });
+    REQUIRE(done.load() == 64);
+}
+
+TEST_CASE("thread_pool - excepciones se propagan al llamador", "[thread_pool]") {
+    thread_pool tp(2, "tptest");
+    std::atomic<unsigned> done(0);
+    REQUIRE_THROWS_AS(tp.run(10, [&](unsigned task, unsigned) {
+                          ++done;
+                          if (task == 7)
+                              throw std::runtime_error("fail");
+                      }),
+                      std::runtime_error);
+    REQUIRE(done.load() == 10);
+    // pool must still be usable afterwards
+    tp.run(3, [&](unsigned, unsigned) { ++done; });
+    REQUIRE(done.load() == 13);
+}
@@ -0,0 +1,72 @@
+/*
+ * Test para wave_foam.h: la espuma calculada con pool de hilos es exactamente
+ * igual que la calculada en serie, por fase y por ciclo completo.
+ */
+#include "catch_amalgamated.hpp"
+#include "../wave_foam.h"
+#include "../random_generator.h"
+#include "../thread_pool.h"
+#include <vector>
+
+namespace {
+const unsigned res = 64, phases = 8;
+const float tile_length = 256.0f;
+
+// displacements large enough that the tile folds over in many places
+std::vector<std::vector<vector3f>> make_displacements(unsigned seed) {
+    random_generator rg(seed);
+    std::vector<std::vector<vector3f>> wd(phases, std::vector<vector3f>(res * res));
+    for (auto &p : wd)
+        for (auto &v : p)
+            v = vector3f((rg.rndf() - 0.5f) * 12.0f, (rg.rndf() - 0.5f) * 12.0f, rg.rndf());
+    return wd;
+}
+
+wave_foam make_foam() {
+    random_generator rg(5);
+    float rndtab[wave_foam::nr_of_random_values];
+    for (auto &r : rndtab)
+        r = rg.rndf();
+    return wave_foam(res, tile_length, phases, rndtab);
+}
+} // namespace
+
+TEST_CASE("wave_foam - una fase en paralelo igual que en serie", "[wave_foam]") {
+    const auto wd = make_displacements(17);
+    const wave_foam wf = make_foam();
+    thread_pool pool(4);
+    std::vector<float> serial(res * res, 0.0f), pooled(res * res, 0.0f);
+    // several phases, so foam of former phases decays
+    for (unsigned k = 0; k < phases; ++k) {
+        wf.spawn_and_decay(wd[k], serial, nullptr);
+        wf.spawn_and_decay(wd[k], pooled, &pool);
+        REQUIRE(pooled == serial);
+    }
+    unsigned nr_foam = 0;
+    for (float a : serial) {
+        REQUIRE(a >= 0.0f);
+        REQUIRE(a <= 1.0f);
+        nr_foam += (a > 0.0f) ? 1 : 0;
+    }
+    REQUIRE(nr_foam > 0);
+    REQUIRE(nr_foam < res * res);
+}
+
+TEST_CASE("wave_foam - ciclo en paralelo igual que en serie", "[wave_foam]") {
+    const auto wd = make_displacements(29);
+    std::vector<const std::vector<vector3f> *> wdp;
+    for (auto &p : wd)
+        wdp.push_back(&p);
+    const wave_foam wf = make_foam();
+    std::vector<std::vector<float>> serial, pooled;
+    wf.compute_cycle(wdp, serial, nullptr);
+    thread_pool pool(3);
+    wf.compute_cycle(wdp, pooled, &pool);
+    REQUIRE(serial.size() == phases);
+    REQUIRE(pooled == serial);
+    // the second iteration starts with the foam of the last phase
+    std::vector<float> aof(res * res, 0.0f);
+    for (unsigned k = 0; k < 2 * phases; ++k)
+        wf.spawn_and_decay(wd[k % phases], aof, nullptr);
+    REQUIRE(serial.back() == aof);
+}
@@ -0,0 +1,104 @@
+/*
+ * Test para wave_tile_cache.h: escribir y leer secciones, deteccion de
+ * ficheros obsoletos (otra clave) y corruptos.
+ */
+#include "catch_amalgamated.hpp"
+#include "../error.h"
+#include "../wave_tile_cache.h"
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+const char *cache_file = "wave_tile_cache_test.cache";
+
+void write_test_file(uint64_t key) {
+    wave_tile_cache::writer w(cache_file, key);
+    w.write(std::vector<float>({1.5f, -2.0f, 3.25f}));
+    w.write(std::vector<unsigned char>({1, 2, 3, 4, 5}));
+    w.write(std::vector<double>(1000, 0.125));
+    w.finish();
+}
+} // namespace
+
+TEST_CASE("wave_tile_cache - escribir y leer", "[wave_tile_cache]") {
+    write_test_file(42);
+    wave_tile_cache::reader r(cache_file, 42);
+    REQUIRE(r.get_nr_of_sections() == 3);
+    std::vector<float> f;
+    std::vector<unsigned char> b;
+    std::vector<double> d;
+    r.read(f, 3);
+    r.read(b, 5);
+    r.read(d, 1000);
+    r.finish();
+    REQUIRE(f == std::vector<float>({1.5f, -2.0f, 3.25f}));
+    REQUIRE(b == std::vector<unsigned char>({1, 2, 3, 4, 5}));
+    REQUIRE(d == std::vector<double>(1000, 0.125));
+    std::remove(cache_file);
+}
+
+TEST_CASE("wave_tile_cache - fichero inexistente", "[wave_tile_cache]") {
+    std::remove(cache_file);
+    REQUIRE_THROWS_AS(wave_tile_cache::reader(cache_file, 42), file_read_error);
+}
+
+TEST_CASE("wave_tile_cache - clave distinta es obsoleto", "[wave_tile_cache]") {
+    write_test_file(42);
+    REQUIRE_THROWS_AS(wave_tile_cache::reader(cache_file, 43), error);
+    std::remove(cache_file);
+}
+
+TEST_CASE("wave_tile_cache - tamano inesperado", "[wave_tile_cache]") {
+    write_test_file(42);
+    wave_tile_cache::reader r(cache_file, 42);
+    std::vector<float> f;
+    REQUIRE_THROWS_AS(r.read(f, 4), error);
+    std::remove(cache_file);
+}
+
+TEST_CASE("wave_tile_cache - faltan secciones", "[wave_tile_cache]") {
+    write_test_file(42);
+    wave_tile_cache::reader r(cache_file, 42);
+    std::vector<float> f;
+    r.read(f, 3);
+    REQUIRE_THROWS_AS(r.finish(), error);
+    std::remove(cache_file);
+}
+
+TEST_CASE("wave_tile_cache - datos corruptos", "[wave_tile_cache]") {
+    write_test_file(42);
+    {
+        // change one byte of the last section
+        std::fstream fs(cache_file, std::ios::in | std::ios::out | std::ios::binary);
+        fs.seekp(200);
+        fs.put(char(0x55));
+    }
+    wave_tile_cache::reader r(cache_file, 42);
+    std::vector<float> f;
+    std::vector<unsigned char> b;
+    std::vector<double> d;
+    r.read(f, 3);
+    r.read(b, 5);
+    r.read(d, 1000);
+    REQUIRE_THROWS_AS(r.finish(), error);
+    std::remove(cache_file);
+}
+
+TEST_CASE("wave_tile_cache - fichero truncado", "[wave_tile_cache]") {
+    write_test_file(42);
+    {
+        std::ofstream fs(cache_file, std::ios::binary | std::ios::trunc);
+        fs << "DFTDWAVE";
+    }
+    REQUIRE_THROWS_AS(wave_tile_cache::reader(cache_file, 42), error);
+    std::remove(cache_file);
+}
+
+TEST_CASE("wave_tile_cache - hash depende de los datos", "[wave_tile_cache]") {
+    float a = 1.0f, b = 2.0f;
+    uint64_t h0 = wave_tile_cache::hash(nullptr, 0);
+    REQUIRE(wave_tile_cache::hash_value(a, h0) != wave_tile_cache::hash_value(b, h0));
+    REQUIRE(wave_tile_cache::hash_value(b, wave_tile_cache::hash_value(a, h0)) !=
+            wave_tile_cache::hash_value(a, wave_tile_cache::hash_value(b, h0)));
+}
@@ -32,12 +32,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "image_loader.h"
 #include "log.h"
+#include "mutex.h"
 #include "primitives.h"
 #include "texture.h"
 #include "vector3.h"
 #include <SDL.h>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <vector>
 using namespace std;
@@ -97,10 +99,48 @@ static GLuint clampmodes[texture::NR_OF_CLAMPING_MODES] = {
     GL_CLAMP_TO_EDGE};
 // --------------------------------------------------
 
+namespace {
+// images decoded in advance by sdl_image::preload, taken by the sdl_image constructor
+::mutex preloaded_mutex;
+std::map<std::string, std::unique_ptr<image_data>> preloaded_images;
+} // namespace
+
 sdl_image::sdl_image(const std::string &filename) {
+    {
+        mutex_locker ml(preloaded_mutex);
+        auto it = preloaded_images.find(filename);
+        if (it != preloaded_images.end()) {
+            data = std::move(it->second);
+            preloaded_images.erase(it);
+        }
+    }
+    if (!data)
+        data = decode(filename);
+}
+
+bool sdl_image::preload(const std::string &filename) {
+    std::unique_ptr<image_data> img;
+    try {
+        img = decode(filename);
+    } catch (std::exception &) {
+        // the texture constructor will report the error or use a fallback file
+        return false;
+    }
+    mutex_locker ml(preloaded_mutex);
+    preloaded_images[filename] = std::move(img);
+    return true;
+}
+
+void sdl_image::clear_preloaded() {
+    mutex_locker ml(preloaded_mutex);
+    preloaded_images.clear();
+}
+
+std::unique_ptr<image_data> sdl_image::decode(const std::string &filename) {
     string::size_type st = filename.rfind(".");
     string extension = (st != string::npos) ? filename.substr(st) : "";
 
+    std::unique_ptr<image_data> data;
     if (extension != ".jpg|png") {
         image_loader_backend* loader = get_image_loader();
         data = loader->load(filename);
@@ -149,6 +189,7 @@ sdl_image::sdl_image(const std::string &filename) {
             dst += data->pitch;
         }
     }
+    return data;
 }
 
 std::vector<uint8_t> sdl_image::get_plain_data(unsigned &w, unsigned &h, unsigned &byte_per_pixel) {
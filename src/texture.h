@@ -51,9 +51,18 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 class sdl_image {
   public:
     /// create image from file
-    ///@note can combine RGB(jpg) and A(png) into one image
+    ///@note can combine RGB(jpg) and A(png) into one image. Takes the decoded image
+    ///	from the preloaded images if it is there.
     sdl_image(const std::string &filename);
 
+    /// decode image file in advance, so a later sdl_image for it needs no decoding.
+    ///@note thread safe, meant for worker threads while the render thread is busy.
+    ///@returns false if the file could not be decoded
+    static bool preload(const std::string &filename);
+
+    /// drop all preloaded images that were not used
+    static void clear_preloaded();
+
     ~sdl_image() = default;
 
     /// transform values to plain vector
@@ -72,6 +81,9 @@ class sdl_image {
   private:
     std::unique_ptr<image_data> data;
 
+    /// decode image file, throws on error
+    static std::unique_ptr<image_data> decode(const std::string &filename);
+
     sdl_image(); // no copy
     sdl_image &operator=(const sdl_image &other);
     sdl_image(const sdl_image &other);
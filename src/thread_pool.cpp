@@ -0,0 +1,160 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// multithreading primitives: pool of worker threads with work stealing
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "thread_pool.h"
+#include "error.h"
+#include <algorithm>
+#include <thread>
+
+thread_pool::worker::worker(thread_pool &tp, unsigned idx_, const char *name)
+    : thread(name), pool(tp), idx(idx_), generation(0) {
+}
+
+void thread_pool::worker::loop() {
+    {
+        mutex_locker ml(pool.mtx);
+        while (generation == pool.generation && !abort_requested())
+            pool.cond_work.wait(pool.mtx);
+        if (abort_requested())
+            return;
+        generation = pool.generation;
+    }
+    pool.work(idx);
+}
+
+void thread_pool::worker::request_abort() {
+    mutex_locker ml(pool.mtx);
+    thread::request_abort();
+    pool.cond_work.signal();
+}
+
+thread_pool::thread_pool(unsigned nr_of_threads, const char *name)
+    : generation(0), nr_of_tasks_left(0), current_func(nullptr), nr_of_steals(0) {
+    if (nr_of_threads == 0)
+        nr_of_threads = hardware_threads();
+    queues.resize(nr_of_threads);
+    workers.reserve(nr_of_threads - 1);
+    try {
+        for (unsigned i = 1; i < nr_of_threads; ++i) {
+            auto *w = new worker(*this, i, name);
+            workers.push_back(w);
+            w->start();
+        }
+    } catch (...) {
+        for (auto *w : workers)
+            w->destruct();
+        throw;
+    }
+}
+
+thread_pool::~thread_pool() {
+    for (auto *w : workers)
+        w->destruct();
+}
+
+unsigned thread_pool::hardware_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+void thread_pool::run(unsigned nr_of_tasks, const task_function &func) {
+    if (nr_of_tasks == 0)
+        return;
+    if (workers.empty()) {
+        // no extra threads, avoid any locking
+        for (unsigned i = 0; i < nr_of_tasks; ++i)
+            func(i, 0);
+        return;
+    }
+    {
+        mutex_locker ml(mtx);
+        if (current_func)
+            throw error("thread_pool::run called recursively");
+        current_func = &func;
+        first_error = nullptr;
+        nr_of_tasks_left = nr_of_tasks;
+        // distribute tasks in contiguous blocks, so neighbouring tasks are handled
+        // by the same thread as long as nothing is stolen.
+        const unsigned nt = get_nr_of_threads();
+        const unsigned blocksize = (nr_of_tasks + nt - 1) / nt;
+        for (unsigned t = 0; t < nt; ++t) {
+            mutex_locker mlq(queues[t].mtx);
+            for (unsigned i = t * blocksize; i < std::min(nr_of_tasks, (t + 1) * blocksize); ++i)
+                queues[t].tasks.push_back(i);
+        }
+        ++generation;
+        cond_work.signal();
+    }
+    work(0);
+    std::exception_ptr err;
+    {
+        mutex_locker ml(mtx);
+        while (nr_of_tasks_left > 0)
+            cond_done.wait(mtx);
+        current_func = nullptr;
+        err = first_error;
+        first_error = nullptr;
+    }
+    if (err)
+        std::rethrow_exception(err);
+}
+
+bool thread_pool::fetch_task(unsigned idx, unsigned &task) {
+    {
+        task_queue &q = queues[idx];
+        mutex_locker ml(q.mtx);
+        if (!q.tasks.empty()) {
+            task = q.tasks.front();
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+    // own queue is empty, try to steal from the others
+    const unsigned nt = get_nr_of_threads();
+    for (unsigned i = 1; i < nt; ++i) {
+        task_queue &q = queues[(idx + i) % nt];
+        mutex_locker ml(q.mtx);
+        if (!q.tasks.empty()) {
+            task = q.tasks.back();
+            q.tasks.pop_back();
+            ++nr_of_steals;
+            return true;
+        }
+    }
+    return false;
+}
+
+void thread_pool::work(unsigned idx) {
+    unsigned task = 0;
+    while (fetch_task(idx, task)) {
+        try {
+            (*current_func)(task, idx);
+        } catch (...) {
+            mutex_locker ml(mtx);
+            if (!first_error)
+                first_error = std::current_exception();
+        }
+        mutex_locker ml(mtx);
+        if (--nr_of_tasks_left == 0)
+            cond_done.signal();
+    }
+}
@@ -0,0 +1,111 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// multithreading primitives: pool of worker threads with work stealing
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "condvar.h"
+#include "mutex.h"
+#include "thread.h"
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <vector>
+
+/// A pool of worker threads that processes batches of indexed tasks.
+///@note The calling thread takes part in the work, so a pool for N threads
+///	creates N-1 worker threads. Each participant has its own task queue.
+///	Tasks are distributed in contiguous blocks, a participant takes tasks from
+///	the front of its own queue and steals from the back of other queues when
+///	its own queue is empty. That way expensive tasks do not leave threads idle.
+class thread_pool {
+  public:
+    /// function to run per task, gets task index and index of executing thread
+    typedef std::function<void(unsigned task, unsigned thread_idx)> task_function;
+
+    /// create pool
+    ///@param nr_of_threads - number of threads including caller, 0 means number of hardware threads
+    ///@param name - name of worker threads (for logging)
+    thread_pool(unsigned nr_of_threads, const char *name = "poolwork");
+
+    /// destroy pool, aborts and joins all workers
+    ~thread_pool();
+
+    /// get number of threads working on tasks (including caller)
+    unsigned get_nr_of_threads() const { return unsigned(queues.size()); }
+
+    /// run tasks 0...nr_of_tasks-1 and wait until all are finished.
+    ///@note the first exception thrown by any task is rethrown here after all tasks are done.
+    ///@note must not be called recursively from inside a task.
+    void run(unsigned nr_of_tasks, const task_function &func);
+
+    /// get number of tasks taken from other threads' queues since creation
+    unsigned long get_nr_of_steals() const { return nr_of_steals.load(); }
+
+    /// get number of threads that the hardware supports (at least 1)
+    static unsigned hardware_threads();
+
+  protected:
+    class worker : public ::thread {
+        thread_pool &pool;
+        unsigned idx;
+        unsigned generation;
+
+      public:
+        worker(thread_pool &tp, unsigned idx_, const char *name);
+        void loop() override;
+        void request_abort() override;
+    };
+
+    /// per thread task queue
+    struct task_queue {
+        ::mutex mtx;
+        std::deque<unsigned> tasks;
+    };
+
+    std::deque<task_queue> queues;
+    std::vector<worker *> workers;
+
+    // state of current batch, protected by mtx
+    ::mutex mtx;
+    condvar cond_work;
+    condvar cond_done;
+    unsigned generation;
+    unsigned nr_of_tasks_left;
+    const task_function *current_func;
+    std::exception_ptr first_error;
+
+    std::atomic<unsigned long> nr_of_steals;
+
+    /// fetch next task for thread idx, returns false if no task is left anywhere
+    bool fetch_task(unsigned idx, unsigned &task);
+
+    /// process tasks until all queues are empty
+    void work(unsigned idx);
+
+  private:
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+};
+
+#endif
@@ -24,9 +24,11 @@
 #include "log.h"
 #include "morton_bivector.h"
 #include "system.h"
+#include "terrain_tile_file.h"
 #include "time.h"
 #include "vector2.h"
 #include <SDL.h>
+#include <algorithm>
 #include <fstream>
 #include <string>
 
@@ -38,6 +40,8 @@ class tile {
     tile() : data(1), last_access(0) {};
 
     void load(const char *filename, vector2i &_bottom_left, unsigned size);
+    /// load tile from tile file, tiles missing in the file are filled with the default value
+    void load(const terrain_tile_file &file, const vector2i &tile_idx, vector2i &_bottom_left, unsigned size);
     T get_value(vector2i coord);
 
     /* simple getters */
@@ -72,7 +76,9 @@ tile<T>::tile(const char *filename, vector2i &_bottom_left, unsigned size)
 
 template <class T>
 void tile<T>::load(const char *filename, vector2i &_bottom_left, unsigned size) {
+    // tiles are reused by the cache, so resizing is not enough
     data.resize(size, -200);
+    std::fill_n(data.data_ptr(), size * size, T(-200));
     bottom_left = _bottom_left;
     last_access = sys().millisec();
 
@@ -92,6 +98,15 @@ void tile<T>::load(const char *filename, vector2i &_bottom_left, unsigned size)
     }
 }
 
+template <class T>
+void tile<T>::load(const terrain_tile_file &file, const vector2i &tile_idx, vector2i &_bottom_left, unsigned size) {
+    data.resize(size, -200);
+    bottom_left = _bottom_left;
+    last_access = sys().millisec();
+    if (!file.read_tile(tile_idx, data.data_ptr()))
+        std::fill_n(data.data_ptr(), size * size, T(-200));
+}
+
 template <class T>
 tile<T>::tile(const tile<T> &other)
     : data(other.get_data()), bottom_left(other.get_bottom_left()), last_access(other.get_last_access()) {
@@ -20,17 +20,23 @@
 #ifndef TILE_CACHE_H
 #define TILE_CACHE_H
 
+#include "error.h"
 #include "system.h"
+#include "terrain_tile_file.h"
 #include "tile.h"
 #include "vector2.h"
-#include <map>
-#include <sstream>
+#include <deque>
+#include <memory>
 #include <string>
+#include <vector>
 
 /* A simple tile cache.
  *
- * The tiles are stored in a std::map atm. Maybe a std::unsorted_map should be used when TR1 goes
- * into the C++ Standard.
+ * The tiles are read from the tile file (see terrain_tile_file) in the tile folder, or from
+ * single bzip2 compressed files per tile if there is no tile file. Tiles are found with an
+ * open addressing hash table and kept in a list in order of last access, so finding and
+ * evicting the least recently used tile takes constant time. Tiles are ordered by their
+ * access time in that list, so expired tiles are always at its end.
  */
 template <class T>
 class tile_cache {
@@ -45,26 +51,7 @@ class tile_cache {
         unsigned long expire;
     };
 
-    /* The compare function for the std::map */
-    struct coord_compare {
-        bool operator()(const vector2i &lhs, const vector2i &rhs) const {
-            if (lhs.x > rhs.x)
-                return false;
-            if (lhs.x < rhs.x)
-                return true;
-            if (lhs.x == rhs.x) {
-                if (lhs.y < rhs.y)
-                    return true;
-                return false;
-            }
-            return false;
-        }
-    };
-
-    /* Iterator type to iterate through the tile map */
-    typedef typename std::map<vector2i, tile<T>, coord_compare>::iterator tile_list_iterator;
-
-    /* Constructs a tile_cache object and generates the morton lookup tables
+    /* Constructs a tile_cache object and opens the tile file if there is one
      *
      *
      * tile_folder: The absolute path to the folder the tiles reside in. Needs a file separator at the end.
@@ -75,14 +62,7 @@ class tile_cache {
      * expire: number of millisecs after a tile expire when it wasn't accessed. zero means infinite
      */
     tile_cache(const std::string tile_folder, int overall_rows, int overall_cols, int tile_size,
-               unsigned int slots, unsigned long expire) {
-        configuration.tile_folder = tile_folder;
-        configuration.overall_rows = overall_rows;
-        configuration.overall_cols = overall_cols;
-        configuration.tile_size = tile_size;
-        configuration.slots = slots;
-        configuration.expire = expire;
-    };
+               unsigned int slots, unsigned long expire);
     tile_cache() {};
     /* Returns a value from the corresponding tile. If the tile isn't in the cache it's added to it.
      *
@@ -93,23 +73,74 @@ class tile_cache {
     /* Removes all tiles from cache */
     void flush();
 
+    /* Returns number of cached tiles */
+    unsigned get_nr_of_tiles() const { return nr_of_tiles; }
+
   protected:
-    /* a map that holds all cached tiles */
-    std::map<vector2i, tile<T>, coord_compare> tile_list;
+    /* a cached tile, linked into the list of tiles in order of last access */
+    struct slot {
+        tile<T> data;
+        vector2i key;
+        int prev, next;
+    };
+
     /* holds all configuration related variables */
     config_type configuration;
+    /* tile file, if present */
+    std::unique_ptr<terrain_tile_file> tile_file;
+    /* all slots, a deque so tiles are never moved in memory */
+    std::deque<slot> slots;
+    /* slots of evicted tiles, reused before new ones are created */
+    std::vector<int> free_slots;
+    /* hash table of slot numbers with linear probing, -1 marks empty entries, size is a power of two */
+    std::vector<int> index = std::vector<int>(64, -1);
+    unsigned nr_of_tiles = 0;
+    /* most/least recently used tile */
+    int lru_head = -1, lru_tail = -1;
+    /* slot of last access, following accesses mostly go to the same tile */
+    int last_slot = -1;
 
     /* removes the least recently used tile from cache */
     inline void free_slot();
     /* removes all expired tiles from cache */
-    inline void erase_expired();
+    inline void erase_expired(unsigned long time);
     /* computes the bottom left corner of correspondig tile to the given global coordinates */
     inline vector2i coord_to_tile(vector2i &coord);
+    /* loads tile into a slot and inserts it into the cache */
+    int load_tile(const vector2i &tile_coord);
+    /* hash table management */
+    unsigned home_position(const vector2i &tile_coord) const;
+    int find_position(const vector2i &tile_coord) const;
+    void insert_into_index(int slot_nr);
+    void erase_from_index(int pos);
+    void grow_index();
+    /* list management */
+    void unlink(int slot_nr);
+    void link_front(int slot_nr);
 };
 
+template <class T>
+tile_cache<T>::tile_cache(const std::string tile_folder, int overall_rows, int overall_cols, int tile_size,
+                          unsigned int slots, unsigned long expire) {
+    configuration.tile_folder = tile_folder;
+    configuration.overall_rows = overall_rows;
+    configuration.overall_cols = overall_cols;
+    configuration.tile_size = tile_size;
+    configuration.slots = slots;
+    configuration.expire = expire;
+    try {
+        tile_file = std::make_unique<terrain_tile_file>(tile_folder + terrain_tile_file::default_name);
+    } catch (file_read_error &) {
+        log_info("No terrain tile file found, reading single tile files from " << tile_folder);
+        return;
+    }
+    if (tile_file->get_tile_size() != unsigned(tile_size) || tile_file->get_element_size() != sizeof(T) ||
+        !(tile_file->get_image_size() == vector2i(overall_cols, overall_rows)))
+        throw error(std::string("terrain tile file doesn't match terrain in ") + tile_folder);
+}
+
 template <class T>
 T tile_cache<T>::get_value(vector2i coord) {
-    T return_value;
     coord.y = configuration.overall_rows - coord.y;
 
     /* wrap coordinates if needed */
@@ -124,63 +155,161 @@ T tile_cache<T>::get_value(vector2i coord) {
 
     vector2i tile_coord = coord_to_tile(coord);
 
-    tile_list_iterator it = tile_list.find(tile_coord);
+    int s = last_slot;
+    if (s < 0 || !(slots[s].key == tile_coord)) {
+        int pos = find_position(tile_coord);
+        s = (index[pos] >= 0) ? index[pos] : load_tile(tile_coord);
+        last_slot = s;
+    }
+    if (s != lru_head) {
+        unlink(s);
+        link_front(s);
+    }
+    tile<T> &t = slots[s].data;
+    T return_value = t.get_value(coord - tile_coord);
+    erase_expired(t.get_last_access());
 
-    if (it != tile_list.end())
-        return_value = it->second.get_value(coord - tile_coord);
-    else {
-        if (configuration.slots > 0 && tile_list.size() >= configuration.slots)
-            free_slot();
+    return return_value;
+}
 
-        std::stringstream filename;
-        filename << configuration.tile_folder;
-        filename << tile_coord.y;
-        filename << "_";
-        filename << tile_coord.x;
-        filename << ".bz2";
+template <class T>
+int tile_cache<T>::load_tile(const vector2i &tile_coord) {
+    if (configuration.slots > 0 && nr_of_tiles >= configuration.slots)
+        free_slot();
 
-        std::pair<tile_list_iterator, bool> p = tile_list.insert(std::pair<vector2i, tile<T>>(tile_coord, tile<T>()));
-        p.first->second.load(filename.str().c_str(), tile_coord, configuration.tile_size);
-        return_value = p.first->second.get_value(coord - tile_coord);
+    int s;
+    if (free_slots.empty()) {
+        s = int(slots.size());
+        slots.emplace_back();
+    } else {
+        s = free_slots.back();
+        free_slots.pop_back();
     }
-    erase_expired();
-
-    return return_value;
+    slot &sl = slots[s];
+    sl.key = tile_coord;
+    vector2i bottom_left = tile_coord;
+    if (tile_file) {
+        sl.data.load(*tile_file, vector2i(tile_coord.x / configuration.tile_size, tile_coord.y / configuration.tile_size),
+                     bottom_left, configuration.tile_size);
+    } else {
+        std::string filename = configuration.tile_folder + std::to_string(tile_coord.y) + "_" + std::to_string(tile_coord.x) + ".bz2";
+        sl.data.load(filename.c_str(), bottom_left, configuration.tile_size);
+    }
+    insert_into_index(s);
+    link_front(s);
+    ++nr_of_tiles;
+    return s;
 }
 
 template <class T>
 inline void tile_cache<T>::free_slot() {
-    unsigned long min = sys().millisec();
-    vector2i min_key;
-    for (tile_list_iterator it = tile_list.begin(); it != tile_list.end(); it++) {
-        if (it->second.get_last_access() <= min) {
-            min = it->second.get_last_access();
-            min_key = it->first;
-        }
-    }
-    tile_list.erase(min_key);
+    int s = lru_tail;
+    if (s < 0)
+        return;
+    erase_from_index(find_position(slots[s].key));
+    unlink(s);
+    free_slots.push_back(s);
+    --nr_of_tiles;
+    if (last_slot == s)
+        last_slot = -1;
 }
 
 template <class T>
-inline void tile_cache<T>::erase_expired() {
+inline void tile_cache<T>::erase_expired(unsigned long time) {
     if (configuration.expire > 0) {
-        long time = sys().millisec();
-        for (tile_list_iterator it = tile_list.begin(); it != tile_list.end();)
-            if (time - it->second.get_last_access() >= configuration.expire) {
-                tile_list.erase(it++);
-            } else {
-                ++it;
-            }
+        while (lru_tail >= 0 && time - slots[lru_tail].data.get_last_access() >= configuration.expire)
+            free_slot();
     }
 }
 
 template <class T>
 void tile_cache<T>::flush() {
-    tile_list.clear();
+    slots.clear();
+    free_slots.clear();
+    std::fill(index.begin(), index.end(), -1);
+    nr_of_tiles = 0;
+    lru_head = lru_tail = last_slot = -1;
 }
 
 template <class T>
 inline vector2i tile_cache<T>::coord_to_tile(vector2i &coord) {
     return vector2i((coord.x / configuration.tile_size) * configuration.tile_size, (coord.y / configuration.tile_size) * configuration.tile_size);
 }
+
+template <class T>
+unsigned tile_cache<T>::home_position(const vector2i &tile_coord) const {
+    uint32_t h = uint32_t(tile_coord.x) * 73856093U ^ uint32_t(tile_coord.y) * 19349663U;
+    return (h * 2654435761U) & unsigned(index.size() - 1);
+}
+
+template <class T>
+int tile_cache<T>::find_position(const vector2i &tile_coord) const {
+    // the table is never full, so there is always an empty entry to stop at
+    const unsigned mask = unsigned(index.size() - 1);
+    unsigned pos = home_position(tile_coord);
+    while (index[pos] >= 0 && !(slots[index[pos]].key == tile_coord))
+        pos = (pos + 1) & mask;
+    return int(pos);
+}
+
+template <class T>
+void tile_cache<T>::insert_into_index(int slot_nr) {
+    // keep load factor below one half
+    if (2 * (nr_of_tiles + 1) > index.size())
+        grow_index();
+    index[find_position(slots[slot_nr].key)] = slot_nr;
+}
+
+template <class T>
+void tile_cache<T>::erase_from_index(int pos) {
+    // shift following entries back, so no search has to step over holes
+    const unsigned mask = unsigned(index.size() - 1);
+    unsigned hole = unsigned(pos);
+    index[hole] = -1;
+    for (unsigned j = (hole + 1) & mask; index[j] >= 0; j = (j + 1) & mask) {
+        unsigned home = home_position(slots[index[j]].key);
+        // entry stays if its home position is cyclically in (hole, j]
+        bool stays = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (!stays) {
+            index[hole] = index[j];
+            index[j] = -1;
+            hole = j;
+        }
+    }
+}
+
+template <class T>
+void tile_cache<T>::grow_index() {
+    std::vector<int> old_index(index.size() * 2, -1);
+    index.swap(old_index);
+    for (int s : old_index)
+        if (s >= 0)
+            index[find_position(slots[s].key)] = s;
+}
+
+template <class T>
+void tile_cache<T>::unlink(int slot_nr) {
+    slot &s = slots[slot_nr];
+    if (s.prev >= 0)
+        slots[s.prev].next = s.next;
+    else if (lru_head == slot_nr)
+        lru_head = s.next;
+    if (s.next >= 0)
+        slots[s.next].prev = s.prev;
+    else if (lru_tail == slot_nr)
+        lru_tail = s.prev;
+    s.prev = s.next = -1;
+}
+
+template <class T>
+void tile_cache<T>::link_front(int slot_nr) {
+    slot &s = slots[slot_nr];
+    s.prev = -1;
+    s.next = lru_head;
+    if (lru_head >= 0)
+        slots[lru_head].prev = slot_nr;
+    lru_head = slot_nr;
+    if (lru_tail < 0)
+        lru_tail = slot_nr;
+}
 #endif // TILE_CACHE_H
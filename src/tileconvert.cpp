@@ -0,0 +1,121 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+// converts a folder of bzip2 compressed terrain tiles to a terrain tile file
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "bzip.h"
+#include "error.h"
+#include "terrain_tile_file.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+typedef chrono::steady_clock clk;
+
+// FNV-1a, to verify tiles without keeping them all in memory
+static uint64_t tile_hash(const vector<char> &data) {
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : data)
+        h = (h ^ uint8_t(c)) * 1099511628211ULL;
+    return h;
+}
+
+static double seconds_since(clk::time_point t0) {
+    return chrono::duration<double>(clk::now() - t0).count();
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        cout << "usage: tileconvert <tile folder> <columns> <rows> <tile size> [raw]\n"
+             << "columns, rows and tile size are the values of bounds and tile_size in terrain.xml.\n"
+             << "Writes " << terrain_tile_file::default_name << " into the tile folder, compressed with\n"
+             << "the block codec unless raw is given.\n";
+        return 1;
+    }
+    string folder = argv[1];
+    if (!folder.empty() && folder[folder.size() - 1] != '/')
+        folder += '/';
+    vector2i image_size(atoi(argv[2]), atoi(argv[3]));
+    unsigned tile_size = unsigned(atoi(argv[4]));
+    terrain_tile_file::codec_type codec = (argc > 5 && strcmp(argv[5], "raw") == 0)
+                                              ? terrain_tile_file::codec_raw
+                                              : terrain_tile_file::codec_block;
+    // terrain heights are 16bit values
+    const unsigned element_size = sizeof(int16_t);
+    const size_t tile_bytes = size_t(tile_size) * tile_size * element_size;
+    const string filename = folder + terrain_tile_file::default_name;
+
+    try {
+        vector<uint64_t> tile_hashes;
+        vector<vector2i> tile_indices;
+        double bzip_time = 0;
+        {
+            terrain_tile_file::writer w(filename, image_size, tile_size, element_size, codec);
+            vector<char> data(tile_bytes);
+            for (int y = 0; y * int(tile_size) < image_size.y; ++y) {
+                for (int x = 0; x * int(tile_size) < image_size.x; ++x) {
+                    // same naming as in tile_cache, bottom left corner of tile, row first
+                    string tilename = folder + to_string(y * tile_size) + "_" + to_string(x * tile_size) + ".bz2";
+                    ifstream in(tilename.c_str(), ios::in | ios::binary);
+                    if (!in.is_open())
+                        continue;
+                    clk::time_point t0 = clk::now();
+                    bzip_istream bin(&in);
+                    bin.read(data.data(), std::streamsize(tile_bytes));
+                    bin.close();
+                    bzip_time += seconds_since(t0);
+                    w.add_tile(vector2i(x, y), data.data());
+                    tile_hashes.push_back(tile_hash(data));
+                    tile_indices.push_back(vector2i(x, y));
+                }
+            }
+            w.finish();
+        }
+
+        // read back to verify and compare time with bzip2 decompression
+        terrain_tile_file f(filename);
+        vector<char> data(tile_bytes);
+        clk::time_point t0 = clk::now();
+        for (unsigned i = 0; i < tile_indices.size(); ++i)
+            if (!f.read_tile(tile_indices[i], data.data()) || tile_hash(data) != tile_hashes[i])
+                throw error(string("verification of tile file failed: ") + filename);
+        // time without hashing
+        t0 = clk::now();
+        for (unsigned i = 0; i < tile_indices.size(); ++i)
+            f.read_tile(tile_indices[i], data.data());
+        double read_time = seconds_since(t0);
+        ifstream in(filename.c_str(), ios::in | ios::binary | ios::ate);
+        cout << "converted " << tile_indices.size() << " tiles to " << filename << ", " << in.tellg() << " bytes\n";
+        if (!tile_indices.empty())
+            cout << "ms per tile: bzip2 " << bzip_time * 1000 / tile_indices.size() << ", "
+                 << (codec == terrain_tile_file::codec_raw ? "raw " : "block codec ") << read_time * 1000 / tile_indices.size()
+                 << "\n";
+    } catch (std::exception &e) {
+        cerr << "error: " << e.what() << "\n";
+        return 2;
+    }
+    return 0;
+}
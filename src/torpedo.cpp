@@ -293,7 +293,7 @@ void torpedo::save(xml_elem &parent) const {
     rudder.save(ed);
 }
 
-void torpedo::simulate(double delta_time) {
+bool torpedo::simulate(double delta_time) {
     /*
     log_debug("torpedo  " << this << " heading " << heading.value() << " should head to " << head_to.value() << " turn speed " << turn_velocity << "\n"
               << " position " << position << " orientation " << orientation << " run_length " << run_length << "\n"
@@ -301,7 +301,8 @@ void torpedo::simulate(double delta_time) {
               << " delta t "<< delta_time << "linear_mom " << linear_momentum);
     */
     redetect_time = 1.0;
-    ship::simulate(delta_time);
+    if (!ship::simulate(delta_time))
+        return false;
 
     depth_steering_logic();
     dive_planes.simulate(delta_time);
@@ -313,7 +314,7 @@ void torpedo::simulate(double delta_time) {
         // it doesn't sink to sea floor when doing this
         // alive_stat = inactive;
         kill();
-        return;
+        return true;
     }
 
     // Torpedo starts to search for a target when the minimum save
@@ -321,7 +322,7 @@ void torpedo::simulate(double delta_time) {
     if (!sensors.empty() && run_length >= sensor_activation_distance) {
         ship *target = gm.sonar_acoustical_torpedo_target(this);
         if (target) {
-            angle targetang(target->get_engine_noise_source() - get_pos().xy());
+            angle targetang(target->get_step_engine_noise_source() - get_pos().xy());
             bool turnright = get_heading().is_cw_nearer(targetang);
             head_to_course(targetang, !turnright);
         }
@@ -386,6 +387,7 @@ void torpedo::simulate(double delta_time) {
         if (gm.check_torpedo_hit(this, runlengthfailure))
             kill();
     }
+    return true;
 }
 
 void torpedo::compute_force_and_torque(vector3 &F, vector3 &T) const {
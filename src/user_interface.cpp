@@ -408,7 +408,7 @@ void user_interface::toggle_pause() {
 }
 
 bool user_interface::time_scale_up() {
-    if (time_scale < 4096) {
+    if (time_scale < max_time_scale) {
         time_scale *= 2;
         return true;
     }
@@ -200,6 +200,8 @@ class user_interface {
     virtual bool paused() const { return pause; }
     virtual unsigned time_scaling() const { return time_scale; }
     virtual void add_message(const std::string &s);
+    /// maximum time compression factor
+    static const unsigned max_time_scale = 4096;
     virtual bool time_scale_up(); // returns true on success
     virtual bool time_scale_down();
     //	virtual void record_sunk_ship ( const class ship* so );
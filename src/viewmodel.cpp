@@ -718,11 +718,31 @@ void run_gui() {
     ml.load_menu();
 }
 
+// compile models to .ddbin files and compare loading times
+static void compile_models(const list<string> &modelfilenames) {
+    for (list<string>::const_iterator it = modelfilenames.begin(); it != modelfilenames.end(); ++it) {
+        unsigned t0 = sys().millisec();
+        std::unique_ptr<model> mdl = std::make_unique<model>(*it);
+        unsigned t1 = sys().millisec();
+        // the game computes the tree only for the base mesh
+        mdl->get_base_mesh().compute_bv_tree();
+        mdl->write_compiled_file();
+        mdl.reset();
+        unsigned t2 = sys().millisec();
+        mdl = std::make_unique<model>(*it);
+        unsigned t3 = sys().millisec();
+        log_info("compiled " << *it << ", load time before " << t1 - t0 << "ms, with compiled file " << t3 - t2 << "ms");
+        cout << "compiled " << *it << ", load time before " << t1 - t0 << "ms, with compiled file " << t3 - t2 << "ms\n";
+    }
+}
+
 int mymain(list<string> &args) {
     // command line argument parsing
     res_x = 1024;
     bool fullscreen = true;
     bool use_gui = false;
+    bool compile = false;
+    list<string> modelfilenames;
 
     string modelfilename;
     string datafilename;
@@ -738,6 +758,7 @@ int mymain(list<string> &args) {
                  << "--layout layoutname\tuse layout with specific name for skins\n"
                  << "--maxfps x\tset maximum fps to x frames per second (default 60). Use x=0 to disable fps limit.\n"
                  << "--gui starts viewmodel in GUI mode, with model list.\n"
+                 << "--compile\twrite compiled model files (.ddbin) for all given models and quit.\n"
                  << "MODELFILENAME\n";
             return 0;
         } else if (*it == "--nofullscreen") {
@@ -763,6 +784,8 @@ int mymain(list<string> &args) {
                 --it;
         } else if (*it == "--gui") {
             use_gui = true;
+        } else if (*it == "--compile") {
+            compile = true;
         } else if (*it == "--maxfps") {
             list<string>::iterator it2 = it;
             ++it2;
@@ -774,11 +797,12 @@ int mymain(list<string> &args) {
             }
         } else {
             modelfilename = *it;
+            modelfilenames.push_back(*it);
         }
     }
 
     // Sin nombre de modelo: abrir selector en vez de fallar
-    if (modelfilename.empty() && !use_gui) {
+    if (modelfilename.empty() && !use_gui && !compile) {
         use_gui = true;
     }
 
@@ -807,6 +831,9 @@ int mymain(list<string> &args) {
     mycfg.register_option("water_detail", 128);
     mycfg.register_option("wave_fft_res", 128);
     mycfg.register_option("wave_phases", 256);
+    mycfg.register_option("wave_streaming", false); // compute wave phases on the fly
+    mycfg.register_option("wave_seed", 1); // 0 = different waves on every run
+    mycfg.register_option("wave_cache_dir", std::string("")); // directory for precomputed waves, empty = no cache
     mycfg.register_option("wavetile_length", 256.0f);
     mycfg.register_option("wave_tidecycle_time", 10.24f);
     mycfg.register_option("usex86sse", true);
@@ -819,6 +846,12 @@ int mymain(list<string> &args) {
     sys().set_res_2d(1024, 768);
     sys().set_max_fps(maxfps);
 
+    if (compile) {
+        compile_models(modelfilenames);
+        system::destroy_instance();
+        return 0;
+    }
+
     log_info("A simple model viewer for DftD-.mdl files");
     log_info("copyright and written 2003 by Thorsten Jordan");
 
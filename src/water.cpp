@@ -30,6 +30,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "cfg.h"
 #include "datadirs.h"
+#include "filehelper.h"
 #include "frustum.h"
 #include "game.h"
 #include "global_data.h"
@@ -39,7 +40,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "ship.h"
 #include "system.h"
 #include "texture.h"
+#include "thread_pool.h"
 #include "water.h"
+#include "wave_tile_cache.h"
 #include <fstream>
 #include <iomanip>
 #include <sstream>
@@ -125,10 +128,26 @@ static constexpr unsigned FOAMAMOUNTRES = 256;
 
 const unsigned foamtexsize = 256;
 
+// parameters of wave generation
+static const vector2f wave_wind_direction(1, 1);
+static constexpr float wave_wind_speed = 12 /*12*/ /*10*/ /*31*/; // wind speed m/s. fixme make dynamic (weather!)
+static constexpr float wave_height_per_resolution = 1e-8;        // roughly 2e-6 for 128
+static constexpr float wave_choppy_factor = -2.0f;
+
 #ifdef MEASURE_WAVE_HEIGHTS
 static float totalmin = 0, totalmax = 0;
 #endif
 
+// run tasks on pool or serially without pool
+static void run_tasks(thread_pool *pool, unsigned nr_of_tasks, const thread_pool::task_function &func) {
+    if (pool) {
+        pool->run(nr_of_tasks, func);
+    } else {
+        for (unsigned i = 0; i < nr_of_tasks; ++i)
+            func(i, 0);
+    }
+}
+
 // computes valid detail values
 static unsigned cmpdtl(int x) {
     if (x < 4 || x > 512)
@@ -141,17 +160,21 @@ water::water(double tm, cfg &configuration) : mytime(tm),
                           wavetile_length(configuration.getf("wavetile_length")),
                           wavetile_length_rcp(1.0f / wavetile_length),
                           wave_tidecycle_time(configuration.getf("wave_tidecycle_time")),
+                          wave_seed(unsigned(std::max(configuration.geti("wave_seed"), 0))),
                           last_light_color(-1, -1, -1),
                           wave_resolution(nextgteqpow2(configuration.geti("wave_fft_res"))),
                           wave_resolution_shift(ulog2(wave_resolution)),
-                          wavetile_data(wave_phases),
+                          wavetile_data(configuration.getb("wave_streaming") ? 2 : wave_phases),
                           curr_wtp(0),
+                          wave_streaming(configuration.getb("wave_streaming")),
+                          curr_phase(0),
                           owg(wave_resolution,
-                              vector2f(1, 1),                                      // wind direction
-                              12 /*12*/ /*10*/ /*31*/,                             // wind speed m/s. fixme make dynamic (weather!)
-                              wave_resolution * (1e-8) /* roughly 2e-6 for 128 */, // scale factor for heights. depends on wave resolution, maybe also on tidecycle time
+                              wave_wind_direction,
+                              wave_wind_speed,
+                              wave_resolution * wave_height_per_resolution, // scale factor for heights. depends on wave resolution, maybe also on tidecycle time
                               wavetile_length,
-                              wave_tidecycle_time),
+                              wave_tidecycle_time,
+                              wave_seed),
                           use_hqsfx(false),
                           vattr_aof_index(0),
                           rerender_new_wtp(true),
@@ -334,34 +357,216 @@ water::water(double tm, cfg &configuration) : mytime(tm),
       with the clouds.
     */
 
-    // multithreaded construction of water data (faster).
-    // spawn 1 more thread (or 3 on 4-core cpus, but two threads are already fast enough)
-    thread::auto_ptr<worker> myworker;
-    if (true /* construction multithreaded */) {
-        myworker.reset(std::make_unique<worker>(*this, 1, 2).release());
-        myworker->start();
-        construction_threaded(owg, 0, 2);
-        myworker.reset();
-    } else {
-        construction_threaded(owg, 0, 1);
+    random_generator foam_rg(wave_seed);
+    for (unsigned k = 0; k < wave_foam::nr_of_random_values; ++k)
+        foam_rndtab[k] = wave_seed ? foam_rg.rndf() : float(rnd());
+
+    if (wave_streaming) {
+        // compute only the current phase, the following phases are computed
+        // in background while the current one is displayed.
+        log_info("water phases are computed on the fly");
+        stream_aof.resize(wave_resolution * wave_resolution);
+        curr_phase = unsigned(wave_phases * myfrac(mytime / wave_tidecycle_time)) % wave_phases;
+        generate_streamed_phase(owg, curr_phase, mytime, wavetile_data[0]);
+        curr_wtp = &wavetile_data[0];
+        stream_aof = curr_wtp->mipmaps[0].amount_of_foam;
+        generate_subdetail_texture();
+        mystreamer.reset(new streamer(*this));
+        mystreamer->start();
+        mystreamer->request((curr_phase + 1) % wave_phases, mytime + wave_tidecycle_time / wave_phases, wavetile_data[1]);
+        add_loading_screen("water created");
+        return;
     }
-    add_loading_screen("water height data computed");
 
-    // set up curr_wtp and subdetail
+    // with fixed waves the computed data is stored on disk and reused on next start
+    std::string cache_filename;
+    uint64_t cache_key = 0;
+    if (wave_seed != 0 && !configuration.gets("wave_cache_dir").empty()) {
+        cache_filename = configuration.gets("wave_cache_dir") + "wavetiles.cache";
+        cache_key = get_wave_cache_key();
+    }
     curr_wtp = 0;
+    if (!cache_filename.empty() && load_wave_cache(cache_filename, cache_key)) {
+        add_loading_screen("water height data loaded");
+    } else {
+        // multithreaded construction of water data, use all cores, the pool exists only
+        // while constructing. Results do not depend on the number of threads.
+        thread_pool pool(thread_pool::hardware_threads(), "waterwrk");
+        log_info("computing water phases with " << pool.get_nr_of_threads() << " threads");
+        construct_phases(pool);
+
 #ifdef MEASURE_WAVE_HEIGHTS
-    cout << "total minh " << totalmin << " maxh " << totalmax << "\n";
+        cout << "total minh " << totalmin << " maxh " << totalmax << "\n";
 #endif
-    compute_amount_of_foam();
+        compute_amount_of_foam(&pool);
+        if (!cache_filename.empty())
+            save_wave_cache(cache_filename, cache_key);
+    }
 
     add_loading_screen("water created");
     set_time(mytime);
 }
 
-void water::construction_threaded(ocean_wave_generator<float> &myowg, unsigned phase_start, unsigned phase_add) {
-    for (unsigned i = phase_start; i < wave_phases; i += phase_add) {
-        generate_wavetile(myowg, wave_tidecycle_time * i / wave_phases, wavetile_data[i]);
+void water::construct_phases(thread_pool &pool) {
+    // fftw plans are created here, as creating them is not thread safe
+    std::vector<std::unique_ptr<ocean_wave_generator<float>>> generators(pool.get_nr_of_threads());
+    for (unsigned i = 1; i < generators.size(); ++i)
+        generators[i] = std::make_unique<ocean_wave_generator<float>>(owg);
+    // compute in parts to report progress
+    const unsigned nr_of_parts = 4;
+    for (unsigned part = 0; part < nr_of_parts; ++part) {
+        unsigned first = wave_phases * part / nr_of_parts;
+        unsigned last = wave_phases * (part + 1) / nr_of_parts;
+        pool.run(last - first, [&](unsigned task, unsigned thread_idx) {
+            unsigned i = first + task;
+            ocean_wave_generator<float> &myowg = thread_idx ? *generators[thread_idx] : owg;
+            generate_wavetile(myowg, wave_tidecycle_time * i / wave_phases, wavetile_data[i]);
+        });
+        add_loading_screen("water height data computed (" + str(last) + "/" + str(wave_phases) + ")");
+    }
+}
+
+uint64_t water::get_wave_cache_key() const {
+    uint64_t h = wave_tile_cache::hash(nullptr, 0);
+    h = wave_tile_cache::hash_value(wave_resolution, h);
+    h = wave_tile_cache::hash_value(wave_phases, h);
+    h = wave_tile_cache::hash_value(wavetile_length, h);
+    h = wave_tile_cache::hash_value(wave_tidecycle_time, h);
+    h = wave_tile_cache::hash_value(wave_seed, h);
+    h = wave_tile_cache::hash_value(wave_wind_direction.x, h);
+    h = wave_tile_cache::hash_value(wave_wind_direction.y, h);
+    h = wave_tile_cache::hash_value(wave_wind_speed, h);
+    h = wave_tile_cache::hash_value(wave_height_per_resolution, h);
+    h = wave_tile_cache::hash_value(wave_choppy_factor, h);
+    return h;
+}
+
+bool water::load_wave_cache(const std::string &filename, uint64_t key) {
+    try {
+        wave_tile_cache::reader r(filename, key);
+        const double L = wavetile_length / wave_resolution;
+        std::vector<float> minmaxh;
+        for (auto &wtp : wavetile_data) {
+            r.read(minmaxh, 2);
+            wtp.minh = minmaxh[0];
+            wtp.maxh = minmaxh[1];
+            wtp.mipmaps.clear();
+            wtp.mipmaps.reserve(wave_resolution_shift);
+            for (unsigned i = 0; i < wave_resolution_shift; ++i) {
+                wtp.mipmaps.push_back(wavetile_phase::mipmap_level(wave_resolution_shift - i, L * (1 << i)));
+                wavetile_phase::mipmap_level &mml = wtp.mipmaps.back();
+                unsigned samples = mml.resolution * mml.resolution;
+                r.read(mml.wavedata, samples);
+                r.read(mml.normals, samples);
+                r.read(mml.amount_of_foam, samples);
+                r.read(mml.normals_tex, samples * 3);
+            }
+        }
+        r.finish();
+        return true;
+    } catch (file_read_error &) {
+        log_info("no water cache yet, computing water");
+    } catch (std::exception &e) {
+        log_warning("can't use water cache, computing water again: " << e.what());
     }
+    for (auto &wtp : wavetile_data)
+        wtp.mipmaps.clear();
+    return false;
+}
+
+void water::save_wave_cache(const std::string &filename, uint64_t key) const {
+    // not being able to write the cache is no error, the data is computed on next start again
+    try {
+        std::string dir = filename.substr(0, filename.rfind('/') + 1);
+        if (!dir.empty() && !is_directory(dir))
+            make_dir(dir);
+        wave_tile_cache::writer w(filename, key);
+        for (const auto &wtp : wavetile_data) {
+            w.write(std::vector<float>({wtp.minh, wtp.maxh}));
+            for (const auto &mml : wtp.mipmaps) {
+                w.write(mml.wavedata);
+                w.write(mml.normals);
+                w.write(mml.amount_of_foam);
+                w.write(mml.normals_tex);
+            }
+        }
+        w.finish();
+        log_info("stored water data in cache " << filename);
+    } catch (std::exception &e) {
+        log_warning("can't store water cache: " << e.what());
+    }
+}
+
+water::streamer::streamer(water &w)
+    : ::thread("waterstr"), wa(w), owg(w.owg), target(nullptr), phase(0), time(0), ready_phase(0) {
+}
+
+void water::streamer::loop() {
+    wavetile_phase *wtp;
+    unsigned ph;
+    double tm;
+    {
+        mutex_locker ml(mtx);
+        while (!target && !abort_requested())
+            cond.wait(mtx);
+        if (abort_requested())
+            return;
+        wtp = target;
+        ph = phase;
+        tm = time;
+    }
+    // compute without lock, the main thread doesn't touch the target until wait() returns
+    unsigned result = ph;
+    try {
+        wa.generate_streamed_phase(owg, ph, tm, *wtp);
+    } catch (std::exception &e) {
+        // let the main thread compute the phase again, so it gets the error
+        log_warning("computing water phase failed: " << e.what());
+        result = wa.wave_phases;
+    }
+    mutex_locker ml(mtx);
+    ready_phase = result;
+    target = nullptr;
+    cond.signal();
+}
+
+void water::streamer::request_abort() {
+    mutex_locker ml(mtx);
+    thread::request_abort();
+    cond.signal();
+}
+
+void water::streamer::request(unsigned phase_, double tm, wavetile_phase &wtp) {
+    mutex_locker ml(mtx);
+    target = &wtp;
+    phase = phase_;
+    time = tm;
+    cond.signal();
+}
+
+unsigned water::streamer::wait() {
+    mutex_locker ml(mtx);
+    while (target)
+        cond.wait(mtx);
+    return ready_phase;
+}
+
+float water::spectrum_blend::get_factor(double tm) const {
+    if (duration <= 0.0)
+        return 1.0f;
+    return float(myclamp((tm - start_time) / duration, 0.0, 1.0));
+}
+
+void water::generate_streamed_phase(ocean_wave_generator<float> &myowg, unsigned phase, double tm, wavetile_phase &wtp) {
+    if (wave_blend.active())
+        myowg.blend_spectrum(wave_blend.from, wave_blend.to, wave_blend.get_factor(tm));
+    wtp.mipmaps.clear();
+    generate_wavetile(myowg, wave_tidecycle_time * phase / wave_phases, wtp);
+    // foam is carried on from the phase in use, so it is not cyclic. stream_aof is only
+    // changed when a phase is used, so a phase computed for nothing spawns no foam.
+    std::vector<float> aof = stream_aof;
+    spawn_and_decay_foam(wtp.mipmaps[0].wavedata, aof, nullptr);
+    store_amount_of_foam(aof, wtp);
 }
 
 void water::setup_textures(const matrix4 &reflection_projmvmat, const vector2f &transl,
@@ -926,60 +1131,62 @@ void water::display(const vector3 &viewpos, double max_view_dist, bool under_wat
     cleanup_textures();
 }
 
-float water::get_height(const vector2 &pos) const {
+vector2f water::get_sample_coordinates(const vector2 &pos) const {
+    // wrap in double precision, world coordinates are too large for float
     float ffac = wave_resolution * wavetile_length_rcp;
-    float x = float(myfmod(pos.x, double(wavetile_length))) * ffac;
-    float y = float(myfmod(pos.y, double(wavetile_length))) * ffac;
-    int ix = int(floor(x));
-    int iy = int(floor(y));
-    int ix2 = (ix + 1) & (wave_resolution - 1);
-    int iy2 = (iy + 1) & (wave_resolution - 1);
-    float fracx = x - ix;
-    float fracy = y - iy;
-    ix &= (wave_resolution - 1); // avoid rare cases of wrap-around, when x is == wave_resolution because of float round errors
-    iy &= (wave_resolution - 1);
-    float a = curr_wtp->get_height(ix + (iy << wave_resolution_shift));
-    float b = curr_wtp->get_height(ix2 + (iy << wave_resolution_shift));
-    float c = curr_wtp->get_height(ix + (iy2 << wave_resolution_shift));
-    float d = curr_wtp->get_height(ix2 + (iy2 << wave_resolution_shift));
-    float e = a * (1.0f - fracx) + b * fracx;
-    float f = c * (1.0f - fracx) + d * fracx;
-    return (1.0f - fracy) * e + fracy * f;
+    return vector2f(float(myfmod(pos.x, double(wavetile_length))) * ffac,
+                    float(myfmod(pos.y, double(wavetile_length))) * ffac);
 }
 
-vector3f water::get_wave_normal_at(unsigned x, unsigned y) const {
-    unsigned x1 = (x + wave_resolution - 1) & (wave_resolution - 1);
-    unsigned x2 = (x + 1) & (wave_resolution - 1);
-    unsigned y1 = (y + wave_resolution - 1) & (wave_resolution - 1);
-    unsigned y2 = (y + 1) & (wave_resolution - 1);
-    float hdx = curr_wtp->get_height(x2 + (y << wave_resolution_shift)) - curr_wtp->get_height(x1 + (y << wave_resolution_shift));
-    float hdy = curr_wtp->get_height(x + (y2 << wave_resolution_shift)) - curr_wtp->get_height(x + (y1 << wave_resolution_shift));
-    return vector3f(-hdx, -hdy, 1).normal();
+float water::get_height(const vector2 &pos) const {
+    vector2f s = get_sample_coordinates(pos);
+    float h;
+    ocean_wave_kernels::sample_heights(ocean_wave_kernels::scalar, 1, &s.x, &s.y, &curr_wtp->mipmaps.front().wavedata[0].z,
+                                       3, wave_resolution_shift, &h);
+    return h;
+}
+
+void water::get_heights(const vector2 &origin, const std::vector<vector2f> &offsets, std::vector<float> &heights) const {
+    heights.resize(offsets.size());
+    if (offsets.empty())
+        return;
+    const float ffac = wave_resolution * wavetile_length_rcp;
+    const vector2f o = get_sample_coordinates(origin);
+    const float *data = &curr_wtp->mipmaps.front().wavedata[0].z;
+    const ocean_wave_kernels::path p = ocean_wave_kernels::get_best_path();
+    // convert to sample coordinates in blocks on the stack, the kernel wraps them
+    const unsigned block = 256;
+    float x[block], y[block];
+    for (unsigned i = 0; i < unsigned(offsets.size()); i += block) {
+        const unsigned n = std::min(block, unsigned(offsets.size()) - i);
+        for (unsigned k = 0; k < n; ++k) {
+            x[k] = o.x + offsets[i + k].x * ffac;
+            y[k] = o.y + offsets[i + k].y * ffac;
+        }
+        ocean_wave_kernels::sample_heights(p, n, x, y, data, 3, wave_resolution_shift, &heights[i]);
+    }
 }
 
-// fixme: the correctness of the result of this function and the one above is not fully tested.
 // with a realistic buoyancy model we don't need that function any longer!
 vector3f water::get_normal(const vector2 &pos, double rollfac) const {
-    float ffac = wave_resolution * wavetile_length_rcp;
-    float x = float(myfmod(pos.x, double(wavetile_length))) * ffac;
-    float y = float(myfmod(pos.y, double(wavetile_length))) * ffac;
-    int ix = int(floor(x));
-    int iy = int(floor(y));
-    int ix2 = (ix + 1) & (wave_resolution - 1);
-    int iy2 = (iy + 1) & (wave_resolution - 1);
-    float fracx = x - ix;
-    float fracy = y - iy;
-    // compute the four normals at the corner points and interpolate between them according to
-    // fracx/y
-    vector3f a = get_wave_normal_at(ix, iy);
-    vector3f b = get_wave_normal_at(ix2, iy);
-    vector3f c = get_wave_normal_at(ix, iy2);
-    vector3f d = get_wave_normal_at(ix2, iy2);
-    vector3f e = a * (1.0f - fracx) + b * fracx;
-    vector3f f = c * (1.0f - fracx) + d * fracx;
-    vector3f g = e * (1.0f - fracy) + f * fracy;
-    g.z *= (1.0f / rollfac);
-    return g.normal();
+    vector2f s = get_sample_coordinates(pos);
+    return get_normal_at_sample(s.x, s.y, rollfac);
+}
+
+void water::get_normals(const vector2 &origin, const std::vector<vector2f> &offsets, std::vector<vector3f> &normals,
+                        double rollfac) const {
+    normals.resize(offsets.size());
+    const float ffac = wave_resolution * wavetile_length_rcp;
+    const vector2f o = get_sample_coordinates(origin);
+    for (unsigned i = 0; i < unsigned(offsets.size()); ++i)
+        normals[i] = get_normal_at_sample(o.x + offsets[i].x * ffac, o.y + offsets[i].y * ffac, rollfac);
+}
+
+vector3f water::get_normal_at_sample(float x, float y, double rollfac) const {
+    vector3f n;
+    ocean_wave_kernels::sample_normal(x, y, &curr_wtp->mipmaps.front().wavedata[0].z, 3, wave_resolution_shift,
+                                      rollfac, &n.x);
+    return n;
 }
 
 void water::generate_wavetile(ocean_wave_generator<float> &myowg, double tiletime, wavetile_phase &wtp) {
@@ -1016,7 +1223,7 @@ void water::generate_wavetile(ocean_wave_generator<float> &myowg, double tiletim
     // fixme 5.0 default? - it seems that choppy waves don't look right. bug? fixme, with negative values it seems right. check this!
     // -2.0f also looks nice, -5.0f is too much. -1.0f should be ok
     vector<vector2f> displacements;
-    myowg.compute_displacements(-2.0f, displacements);
+    myowg.compute_displacements(wave_choppy_factor, displacements);
 
 #if 0
 	// compute where foam is generated...
@@ -1095,97 +1302,47 @@ void water::generate_wavetile(ocean_wave_generator<float> &myowg, double tiletim
     */
 }
 
-void water::compute_amount_of_foam() {
+void water::compute_amount_of_foam(thread_pool *pool) {
     // compute amount of foam per vertex sample
-    vector<float> aof(wave_resolution * wave_resolution);
-
-    float rndtab[37];
-    for (unsigned k = 0; k < 37; ++k)
-        rndtab[k] = rnd();
-
-    // factor to build derivatives correctly
-    const double deriv_fac = wavetile_length_rcp * wave_resolution;
-    const double lambda = 1.0; // lambda has already been multiplied with x/y displacements...
-    const double decay = 4.0 / wave_phases;
-    const double decay_rnd = 0.25 / wave_phases;
-    const double foam_spawn_fac = 0.25; // 0.125;
-    for (unsigned k = 0; k < wave_phases * 2; ++k) {
-        const vector<vector3f> &wd = wavetile_data[k % wave_phases].mipmaps[0].wavedata;
-        // compute for each sample how much foam is added (spawned)
-        for (unsigned y = 0; y < wave_resolution; ++y) {
-            unsigned ym1 = (y + wave_resolution - 1) & (wave_resolution - 1);
-            unsigned yp1 = (y + 1) & (wave_resolution - 1);
-            for (unsigned x = 0; x < wave_resolution; ++x) {
-                unsigned xm1 = (x + wave_resolution - 1) & (wave_resolution - 1);
-                unsigned xp1 = (x + 1) & (wave_resolution - 1);
-                double dispx_dx = (wd[y * wave_resolution + xp1].x - wd[y * wave_resolution + xm1].x) * deriv_fac;
-                double dispx_dy = (wd[yp1 * wave_resolution + x].x - wd[ym1 * wave_resolution + x].x) * deriv_fac;
-                double dispy_dx = (wd[y * wave_resolution + xp1].y - wd[y * wave_resolution + xm1].y) * deriv_fac;
-                double dispy_dy = (wd[yp1 * wave_resolution + x].y - wd[ym1 * wave_resolution + x].y) * deriv_fac;
-                double Jxx = 1.0 + lambda * dispx_dx;
-                double Jyy = 1.0 + lambda * dispy_dy;
-                double Jxy = lambda * dispy_dx;
-                double Jyx = lambda * dispx_dy;
-                double J = Jxx * Jyy - Jxy * Jyx;
-                // printf("x,y=%u,%u, Jxx,yy=%f,%f Jxy,yx=%f,%f J=%f\n",
-                //        x,y, Jxx,Jyy, Jxy,Jyx, J);
-                // double foam_add = (J < 0.3) ? ((J < -1.0) ? 1.0 : (J - 0.3)/-1.3) : 0.0;
-                double foam_add = (J < 0.0) ? ((J < -1.0) ? 1.0 : -J) : 0.0;
-                aof[y * wave_resolution + x] += foam_add * foam_spawn_fac;
-                // spawn foam also on neighbouring fields
-                aof[ym1 * wave_resolution + x] += foam_add * foam_spawn_fac * 0.5;
-                aof[yp1 * wave_resolution + x] += foam_add * foam_spawn_fac * 0.5;
-                aof[y * wave_resolution + xm1] += foam_add * foam_spawn_fac * 0.5;
-                aof[y * wave_resolution + xp1] += foam_add * foam_spawn_fac * 0.5;
-            }
-        }
+    vector<const vector<vector3f> *> wd(wave_phases);
+    for (unsigned k = 0; k < wave_phases; ++k)
+        wd[k] = &wavetile_data[k].mipmaps[0].wavedata;
+    vector<vector<float>> aof;
+    wave_foam(wave_resolution, wavetile_length, wave_phases, foam_rndtab).compute_cycle(wd, aof, pool);
+    for (unsigned k = 0; k < wave_phases; ++k)
+        wavetile_data[k].mipmaps[0].amount_of_foam = std::move(aof[k]);
+
+    // coarser mipmap levels of the phases are independent
+    run_tasks(pool, wave_phases, [&](unsigned task, unsigned) {
+        downsample_amount_of_foam(wavetile_data[task]);
+    });
+}
 
-        // compute decay, depends on time with some randomness
-        unsigned ptr = 0;
-        for (unsigned y = 0; y < wave_resolution; ++y) {
-            for (unsigned x = 0; x < wave_resolution; ++x) {
-                aof[ptr] = std::max(std::min(aof[ptr], 1.0f) - (decay + decay_rnd * rndtab[(3 * x + 5 * y) % 37]), 0.0);
-                ++ptr;
-            }
-        }
+void water::spawn_and_decay_foam(const vector<vector3f> &wd, vector<float> &aof, thread_pool *pool) const {
+    wave_foam(wave_resolution, wavetile_length, wave_phases, foam_rndtab).spawn_and_decay(wd, aof, pool);
+}
 
-        // store amount of foam data when in second iteration
-        if (k >= wave_phases) {
-            wavetile_phase::mipmap_level &mm0 = wavetile_data[k - wave_phases].mipmaps[0];
-            mm0.amount_of_foam = aof;
-            for (unsigned j = 1; j < wavetile_data[k - wave_phases].mipmaps.size(); ++j) {
-                unsigned res = wave_resolution >> j;
-                const wavetile_phase::mipmap_level &mm1 = wavetile_data[k - wave_phases].mipmaps[j - 1];
-                wavetile_phase::mipmap_level &mm2 = wavetile_data[k - wave_phases].mipmaps[j];
-                mm2.amount_of_foam.reserve(res * res);
-                unsigned ptr = 0;
-                for (unsigned y = 0; y < res; ++y) {
-                    for (unsigned x = 0; x < res; ++x) {
-                        float sum = mm1.amount_of_foam[ptr] + mm1.amount_of_foam[ptr + 1] + mm1.amount_of_foam[ptr + 2 * res] + mm1.amount_of_foam[ptr + 1 + 2 * res];
-                        // fixme: maybe let foam vanish on upper mipmap levels
-                        mm2.amount_of_foam.push_back(sum * 0.25f);
-                        ptr += 2;
-                    }
-                    ptr += 2 * res;
-                }
+void water::store_amount_of_foam(const vector<float> &aof, wavetile_phase &wtp) const {
+    wtp.mipmaps[0].amount_of_foam = aof;
+    downsample_amount_of_foam(wtp);
+}
+
+void water::downsample_amount_of_foam(wavetile_phase &wtp) const {
+    for (unsigned j = 1; j < wtp.mipmaps.size(); ++j) {
+        unsigned res = wave_resolution >> j;
+        const wavetile_phase::mipmap_level &mm1 = wtp.mipmaps[j - 1];
+        wavetile_phase::mipmap_level &mm2 = wtp.mipmaps[j];
+        mm2.amount_of_foam.reserve(res * res);
+        unsigned ptr = 0;
+        for (unsigned y = 0; y < res; ++y) {
+            for (unsigned x = 0; x < res; ++x) {
+                float sum = mm1.amount_of_foam[ptr] + mm1.amount_of_foam[ptr + 1] + mm1.amount_of_foam[ptr + 2 * res] + mm1.amount_of_foam[ptr + 1 + 2 * res];
+                // fixme: maybe let foam vanish on upper mipmap levels
+                mm2.amount_of_foam.push_back(sum * 0.25f);
+                ptr += 2;
             }
+            ptr += 2 * res;
         }
-
-#if 0
-		// test: write amount of foam as grey value image
-		ostringstream osfn;
-		osfn << "aof" << setw(4) << setfill('0') << k << ".pgm";
-		ofstream ofs(osfn.str().c_str());
-		ofs << "P5\n";
-		ofs <<wave_resolution<<" "<<wave_resolution<<"\n255\n";
-		ptr = 0;
-		for (unsigned y = 0; y < wave_resolution; ++y) {
-			for (unsigned x = 0; x < wave_resolution; ++x) {
-				Uint8 x = Uint8(std::min(std::max(aof[ptr++], 0.0f), 1.0f) * 255.9);
-				ofs.write((const char*)&x, 1);
-			}
-		}
-#endif
     }
 }
 
@@ -1213,6 +1370,28 @@ void water::set_time(double tm) {
     mytime = tm;
 
     unsigned pn = unsigned(wave_phases * myfrac(tm / wave_tidecycle_time)) % wave_phases;
+    if (wave_streaming) {
+        if (pn == curr_phase) {
+            rerender_new_wtp = false;
+            return;
+        }
+        // use phase computed in background, compute it here if time has advanced differently
+        unsigned ready_phase = mystreamer->wait();
+        unsigned next = (curr_wtp == &wavetile_data[0]) ? 1 : 0;
+        if (ready_phase != pn)
+            generate_streamed_phase(owg, pn, tm, wavetile_data[next]);
+        // guess next phase from the phases skipped in this step
+        unsigned step = (pn + wave_phases - curr_phase) % wave_phases;
+        curr_wtp = &wavetile_data[next];
+        curr_phase = pn;
+        // foam of the phase in use is carried on to the next one
+        stream_aof = curr_wtp->mipmaps[0].amount_of_foam;
+        rerender_new_wtp = true;
+        generate_subdetail_texture();
+        mystreamer->request((pn + step) % wave_phases, tm + step * wave_tidecycle_time / wave_phases,
+                            wavetile_data[1 - next]);
+        return;
+    }
     if (curr_wtp == &wavetile_data[pn]) {
         rerender_new_wtp = false;
     } else {
@@ -1222,6 +1401,24 @@ void water::set_time(double tm) {
     }
 }
 
+void water::set_wind(const vector2f &winddir, float windspeed, double transition_time) {
+    if (!wave_streaming) {
+        log_warning("water: wind can only be changed when phases are computed on the fly");
+        return;
+    }
+    // the background thread must not use the blend data while it is changed
+    mystreamer->wait();
+    // start from the current spectrum, even if a former change is not finished yet
+    if (wave_blend.active())
+        owg.blend_spectrum(wave_blend.from, wave_blend.to, wave_blend.get_factor(mytime));
+    spectrum_blend nb;
+    nb.from = owg.get_spectrum();
+    owg.compute_spectrum(winddir, windspeed, nb.to);
+    nb.start_time = mytime;
+    nb.duration = transition_time;
+    wave_blend = std::move(nb);
+}
+
 float water::exact_fresnel(float x) {
     // the real formula (recheck it!)
     /*
@@ -1335,6 +1532,12 @@ water::wavetile_phase::mipmap_level::mipmap_level(const std::vector<vector3f> &w
     debug_dump();
 }
 
+water::wavetile_phase::mipmap_level::mipmap_level(unsigned res_shift, double sampledist_)
+    : resolution(1 << res_shift),
+      resolution_shift(res_shift),
+      sampledist(sampledist_) {
+}
+
 water::wavetile_phase::mipmap_level::mipmap_level(const std::vector<vector2f> &displacements,
                                                   const std::vector<float> &heights,
                                                   unsigned res_shift,
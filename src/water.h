@@ -38,11 +38,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "thread.h"
 #include "vector3.h"
 #include "vertexbufferobject.h"
+#include "wave_foam.h"
 #include <memory>
 #include <vector>
 
 class ship;
 class game;
+class thread_pool;
 
 ///\brief Rendering of ocean water surfaces.
 class water {
@@ -53,6 +55,7 @@ class water {
     const float wavetile_length;      // >= 512m makes wave look MUCH more realistic
     const float wavetile_length_rcp;  // reciprocal of former value
     const double wave_tidecycle_time; // depends on fps. with 25fps and 256 phases, use ~10seconds.
+    const unsigned wave_seed;         // seed for wave generation, 0 for different waves on every run
 
     std::unique_ptr<texture> reflectiontex;
     std::unique_ptr<texture> foamtex;
@@ -85,6 +88,8 @@ class water {
             ///> generate data from downsampled version of wd
             mipmap_level(const std::vector<vector3f> &wd, unsigned res_shift,
                          double sampledist);
+            ///> create empty level, data is filled in later (from cache)
+            mipmap_level(unsigned res_shift, double sampledist);
             ///> create data from displacements and heights (mostly for level 0)
             mipmap_level(const std::vector<vector2f> &displacements,
                          const std::vector<float> &heights,
@@ -108,10 +113,28 @@ class water {
         wavetile_phase() : minh(0), maxh(0) {}
     };
 
-    // wave tile data
+    // wave tile data, all phases or two in streaming mode
     std::vector<wavetile_phase> wavetile_data;
     const wavetile_phase *curr_wtp; // pointer to current phase
 
+    // streaming mode: only the current and the next phase are stored,
+    // the next phase is computed by a background thread.
+    const bool wave_streaming;
+    unsigned curr_phase;           // number of phase in curr_wtp (streaming mode)
+    std::vector<float> stream_aof; // amount of foam carried from phase to phase (streaming mode)
+    float foam_rndtab[wave_foam::nr_of_random_values]; // randomness of foam decay
+
+    /// blending of wave spectra for weather changes (streaming mode)
+    struct spectrum_blend {
+        std::vector<std::complex<float>> from, to;
+        double start_time;
+        double duration;
+        spectrum_blend() : start_time(0), duration(0) {}
+        bool active() const { return !to.empty(); }
+        float get_factor(double tm) const;
+    };
+    spectrum_blend wave_blend;
+
     // test
     ocean_wave_generator<float> owg;
 
@@ -160,10 +183,17 @@ class water {
                         bool under_water) const;
     void cleanup_textures() const;
 
-    vector3f get_wave_normal_at(unsigned x, unsigned y) const;
+    /// interpolated normal at position in units of wave samples, may be outside the tile
+    vector3f get_normal_at_sample(float x, float y, double rollfac) const;
+    /// wave sample coordinates of origin, offsets can be added after scaling with sample factor
+    vector2f get_sample_coordinates(const vector2 &pos) const;
 
-    void compute_amount_of_foam();
+    void compute_amount_of_foam(thread_pool *pool);
+    void spawn_and_decay_foam(const std::vector<vector3f> &wd, std::vector<float> &aof, thread_pool *pool) const;
+    void store_amount_of_foam(const std::vector<float> &aof, wavetile_phase &wtp) const;
+    void downsample_amount_of_foam(wavetile_phase &wtp) const;
     void generate_wavetile(ocean_wave_generator<float> &myowg, double tiletime, wavetile_phase &wtp);
+    void generate_streamed_phase(ocean_wave_generator<float> &myowg, unsigned phase, double tm, wavetile_phase &wtp);
     void generate_subdetail_texture();
 
     // --------------- geoclipmap stuff
@@ -196,20 +226,37 @@ class water {
     ptrvector<geoclipmap_patch> patches;
     mutable vertexbufferobject vertices;
 
-    class worker : public ::thread {
+    /// compute all phases in precompute mode, one wave generator per thread of pool
+    void construct_phases(thread_pool &pool);
+
+    /// key of cache file, depends on all parameters of wave generation
+    uint64_t get_wave_cache_key() const;
+    /// load all phases from cache file, returns false if it is missing, stale or corrupt
+    bool load_wave_cache(const std::string &filename, uint64_t key);
+    /// store all phases in cache file
+    void save_wave_cache(const std::string &filename, uint64_t key) const;
+
+    /// computes the next phase in background in streaming mode
+    class streamer : public ::thread {
         water &wa;
         ocean_wave_generator<float> owg;
-        unsigned ps, pa;
+        ::mutex mtx;
+        condvar cond;
+        wavetile_phase *target; // phase to compute, nullptr when idle
+        unsigned phase;
+        double time;
+        unsigned ready_phase;
 
       public:
-        worker(water &w, unsigned s, unsigned a) : ::thread("waterwrk"), wa(w), owg(w.owg), ps(s), pa(a) {}
-        void loop() {
-            wa.construction_threaded(owg, ps, pa);
-            request_abort();
-        }
+        streamer(water &w);
+        void loop() override;
+        void request_abort() override;
+        /// request computation of a phase for time tm into wtp
+        void request(unsigned phase, double tm, wavetile_phase &wtp);
+        /// wait until the last request is done, returns the number of the phase computed
+        unsigned wait();
     };
-
-    void construction_threaded(ocean_wave_generator<float> &myowg, unsigned phase_start, unsigned phase_add);
+    thread::auto_ptr<streamer> mystreamer;
 
   public:
     water(double tm, cfg &configuration); // give day time in seconds and configuration
@@ -219,6 +266,13 @@ class water {
 
     void set_time(double tm);
 
+    /// change wind over transition_time seconds by blending the wave spectra.
+    ///@note only possible in streaming mode, precomputed phases are not changed.
+    void set_wind(const vector2f &winddir, float windspeed, double transition_time);
+
+    /// is water computed on the fly?
+    bool is_streaming() const { return wave_streaming; }
+
     void draw_foam_for_ship(const game &gm, const ship *shp, const vector3 &viewpos) const;
     void compute_amount_of_foam_texture(const game &gm, const vector3 &viewpos,
                                         const std::vector<ship *> &allships) const;
@@ -228,6 +282,12 @@ class water {
     float get_height(const vector2 &pos) const;
     // give f as multiplier for difference to (0,0,1)
     vector3f get_normal(const vector2 &pos, double f = 1.0) const;
+    /// compute heights at positions origin + offsets[i] with one call. Much faster than
+    /// calling get_height for every position, offsets should be small (e.g. parts of a ship).
+    void get_heights(const vector2 &origin, const std::vector<vector2f> &offsets, std::vector<float> &heights) const;
+    /// compute normals at positions origin + offsets[i] with one call, see get_normal
+    void get_normals(const vector2 &origin, const std::vector<vector2f> &offsets, std::vector<vector3f> &normals,
+                     double f = 1.0) const;
     static float exact_fresnel(float x);
     void set_refraction_color(const colorf &light_color);
 
@@ -25,6 +25,19 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "global_data.h"
 #include "texture.h"
 
+memory_pool &water_splash::get_pool() {
+    static memory_pool pool("water_splash");
+    return pool;
+}
+
+void *water_splash::operator new(std::size_t size) {
+    return get_pool().allocate(size);
+}
+
+void water_splash::operator delete(void *p, std::size_t size) {
+    get_pool().deallocate(p, size);
+}
+
 void water_splash::render_cylinder(double radius_bottom, double radius_top, double height,
                                    double alpha, const texture &tex,
                                    double u_scal, unsigned nr_segs) {
@@ -77,12 +90,14 @@ water_splash::water_splash(game &gm_, const vector3 &pos, double risetime_, doub
     balpha = std::make_unique<bspline>(3, p);
 }
 
-void water_splash::simulate(double delta_time) {
-    sea_object::simulate(delta_time);
+bool water_splash::simulate(double delta_time) {
+    if (!sea_object::simulate(delta_time))
+        return false;
 
     resttime -= delta_time;
     if (resttime <= -0.5)
         kill();
+    return true;
 }
 
 void water_splash::display(const texture *caustic_map) const {
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define WATER_SPLASH_H
 
 #include "bspline.h"
+#include "memory_pool.h"
 #include "sea_object.h"
 #include <vector>
 
@@ -49,10 +50,15 @@ class water_splash : public sea_object {
 
   public:
     water_splash(game &gm, const vector3 &pos, double risetime = 0.4, double riseheight = 25.0);
-    void simulate(double delta_time);
+    bool simulate(double delta_time);
     void display(const texture *caustic_map = NULL) const;
     void display_mirror_clip() const;
     void compute_force_and_torque(vector3 &F, vector3 &T) const {} // static object, no acceleration
+
+    /// objects are allocated from a memory_pool, they are created and deleted often
+    static void *operator new(std::size_t size);
+    static void operator delete(void *p, std::size_t size);
+    static memory_pool &get_pool();
 };
 
 class torpedo_water_splash : public water_splash {
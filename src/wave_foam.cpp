@@ -0,0 +1,111 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// amount of foam on the ocean wave tile
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "wave_foam.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+// run tasks on pool or serially without pool
+static void run_tasks(thread_pool *pool, unsigned nr_of_tasks, const thread_pool::task_function &func) {
+    if (pool) {
+        pool->run(nr_of_tasks, func);
+    } else {
+        for (unsigned i = 0; i < nr_of_tasks; ++i)
+            func(i, 0);
+    }
+}
+
+wave_foam::wave_foam(unsigned res_, float tile_length, unsigned phases_, const float *rndtab_)
+    : res(res_), deriv_fac(1.0f / tile_length * res_), phases(phases_) {
+    std::copy(rndtab_, rndtab_ + nr_of_random_values, rndtab);
+}
+
+void wave_foam::spawn_and_decay(const std::vector<vector3f> &wd, std::vector<float> &aof, thread_pool *pool) const {
+    const double lambda = 1.0; // lambda has already been multiplied with x/y displacements...
+    const double decay = 4.0 / phases;
+    const double decay_rnd = 0.25 / phases;
+    const double foam_spawn_fac = 0.25; // 0.125;
+    // compute for each sample how much foam is added (spawned)
+    std::vector<double> foam_add(res * res);
+    run_tasks(pool, res, [&](unsigned y, unsigned) {
+        unsigned ym1 = (y + res - 1) & (res - 1);
+        unsigned yp1 = (y + 1) & (res - 1);
+        for (unsigned x = 0; x < res; ++x) {
+            unsigned xm1 = (x + res - 1) & (res - 1);
+            unsigned xp1 = (x + 1) & (res - 1);
+            double dispx_dx = (wd[y * res + xp1].x - wd[y * res + xm1].x) * deriv_fac;
+            double dispx_dy = (wd[yp1 * res + x].x - wd[ym1 * res + x].x) * deriv_fac;
+            double dispy_dx = (wd[y * res + xp1].y - wd[y * res + xm1].y) * deriv_fac;
+            double dispy_dy = (wd[yp1 * res + x].y - wd[ym1 * res + x].y) * deriv_fac;
+            double Jxx = 1.0 + lambda * dispx_dx;
+            double Jyy = 1.0 + lambda * dispy_dy;
+            double Jxy = lambda * dispy_dx;
+            double Jyx = lambda * dispx_dy;
+            double J = Jxx * Jyy - Jxy * Jyx;
+            // printf("x,y=%u,%u, Jxx,yy=%f,%f Jxy,yx=%f,%f J=%f\n",
+            //        x,y, Jxx,Jyy, Jxy,Jyx, J);
+            // double foam_add = (J < 0.3) ? ((J < -1.0) ? 1.0 : (J - 0.3)/-1.3) : 0.0;
+            foam_add[y * res + x] = (J < 0.0) ? ((J < -1.0) ? 1.0 : -J) : 0.0;
+        }
+    });
+
+    // Foam is spawned on the sample and half of it on the neighbouring samples.
+    // Each sample gathers the foam of its neighbours in the order of the sample
+    // indices, that is the order in which it was spread over the samples before,
+    // so rounding and thus the result is the same as with a serial computation.
+    // After that the decay is computed, it depends on time with some randomness.
+    run_tasks(pool, res, [&](unsigned y, unsigned) {
+        unsigned ym1 = (y + res - 1) & (res - 1);
+        unsigned yp1 = (y + 1) & (res - 1);
+        for (unsigned x = 0; x < res; ++x) {
+            unsigned xm1 = (x + res - 1) & (res - 1);
+            unsigned xp1 = (x + 1) & (res - 1);
+            unsigned src[5] = {ym1 * res + x, y * res + xm1, y * res + x, y * res + xp1, yp1 * res + x};
+            // only at the borders wrap-around changes the order
+            if (y == 0 || y == res - 1 || x == 0 || x == res - 1) {
+                for (unsigned i = 1; i < 5; ++i)
+                    for (unsigned j = i; j > 0 && src[j - 1] > src[j]; --j)
+                        std::swap(src[j - 1], src[j]);
+            }
+            unsigned ptr = y * res + x;
+            float a = aof[ptr];
+            for (unsigned s : src) {
+                double f = foam_add[s] * foam_spawn_fac;
+                a += (s == ptr) ? f : f * 0.5;
+            }
+            aof[ptr] = std::max(std::min(a, 1.0f) - (decay + decay_rnd * rndtab[(3 * x + 5 * y) % nr_of_random_values]), 0.0);
+        }
+    });
+}
+
+void wave_foam::compute_cycle(const std::vector<const std::vector<vector3f> *> &wd,
+                              std::vector<std::vector<float>> &aof, thread_pool *pool) const {
+    std::vector<float> a(res * res);
+    aof.resize(wd.size());
+    // phases depend on each other, so only the samples of a phase are computed in parallel
+    for (unsigned k = 0; k < wd.size() * 2; ++k) {
+        spawn_and_decay(*wd[k % wd.size()], a, pool);
+        // store amount of foam data when in second iteration
+        if (k >= wd.size())
+            aof[k - wd.size()] = a;
+    }
+}
@@ -0,0 +1,63 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// amount of foam on the ocean wave tile
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef WAVE_FOAM_H
+#define WAVE_FOAM_H
+
+#include "vector3.h"
+#include <vector>
+
+class thread_pool;
+
+/// Computes the amount of foam per sample of the wave tile over the phases of a cycle.
+///@note Foam is spawned where the displaced tile folds over and decays from phase to
+///	phase with some randomness. The samples of a phase can be computed on a thread
+///	pool, the result is exactly the same as without pool.
+class wave_foam {
+  public:
+    /// number of random values used for the decay
+    static const unsigned nr_of_random_values = 37;
+
+    ///@param res - resolution of the wave tile, power of two
+    ///@param tile_length - length of the wave tile in meters
+    ///@param phases - number of phases per cycle
+    ///@param rndtab - nr_of_random_values values in [0,1) for the decay
+    wave_foam(unsigned res, float tile_length, unsigned phases, const float *rndtab);
+
+    /// spawn foam of a phase with displacements wd onto aof and let the foam decay
+    void spawn_and_decay(const std::vector<vector3f> &wd, std::vector<float> &aof, thread_pool *pool) const;
+
+    /// compute amount of foam of all phases of a cycle.
+    ///@note The cycle is computed twice, so the foam of the last phases is carried over to the first ones.
+    ///@param wd - displacements of every phase
+    ///@param aof - amount of foam of every phase, resized
+    void compute_cycle(const std::vector<const std::vector<vector3f> *> &wd, std::vector<std::vector<float>> &aof,
+                       thread_pool *pool) const;
+
+  protected:
+    unsigned res;
+    double deriv_fac; ///< factor to build derivatives of displacements
+    unsigned phases;
+    float rndtab[nr_of_random_values];
+};
+
+#endif
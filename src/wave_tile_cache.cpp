@@ -0,0 +1,46 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Cache file for precomputed water wave tiles
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "wave_tile_cache.h"
+#include <cstring>
+
+const binary_container::format wave_tile_cache::file_format = {"DFTDWAVE", wave_tile_cache::version, "wave tile cache"};
+
+wave_tile_cache::reader::reader(const std::string &filename, uint64_t key)
+    : binary_container::reader(filename, file_format, key, false), checksum(hash(nullptr, 0)) {
+    // checksum is computed while reading, so the data is read only once
+}
+
+void wave_tile_cache::reader::read(void *data, size_t size) {
+    size_t section_size;
+    const unsigned char *p = next_section(section_size);
+    if (section_size != size)
+        throw_unexpected();
+    memcpy(data, p, size);
+    checksum = hash(data, size, checksum);
+}
+
+void wave_tile_cache::reader::finish() {
+    binary_container::reader::finish();
+    if (checksum != get_checksum())
+        throw_corrupt();
+}
@@ -0,0 +1,69 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2006  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Cache file for precomputed water wave tiles
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#ifndef WAVE_TILE_CACHE_H
+#define WAVE_TILE_CACHE_H
+
+#include "binary_container.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// A file of raw arrays (sections) for precomputed water data, identified by a key.
+///@note The file is a binary_container. Readers detect files of other versions or
+///	keys (stale) and damaged files (corrupt) and report them as errors, the caller
+///	then computes the data again and writes a new file.
+class wave_tile_cache : public binary_container {
+  public:
+    /// version of file format, increase on every change of format or contents
+    static const uint32_t version = 2;
+    /// magic, version and name of file kind
+    static const format file_format;
+
+    /// writes a cache file section by section
+    class writer : public binary_container::writer {
+      public:
+        /// open temporary file for writing, throws error on failure
+        writer(const std::string &filename, uint64_t key) : binary_container::writer(filename, file_format, key) {}
+    };
+
+    /// reads a cache file section by section
+    class reader : public binary_container::reader {
+      public:
+        /// open file and check header, throws error if file is missing, stale or corrupt
+        reader(const std::string &filename, uint64_t key);
+        /// read next section, throws error if it has not the expected number of elements
+        template <class T>
+        void read(std::vector<T> &data, size_t nr_of_elements) {
+            data.resize(nr_of_elements);
+            read(data.data(), nr_of_elements * sizeof(T));
+        }
+        void read(void *data, size_t size);
+        /// check that all sections have been read and checksum is valid, throws error otherwise
+        void finish();
+
+      protected:
+        uint64_t checksum; ///< of sections read so far
+    };
+};
+
+#endif
@@ -29,9 +29,29 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "convoy.h"
 #include "sensors.h"
 #include "sonar.h"
+#include "sphere.h"
+#include "error.h"
 #include "game.h"
 #include <algorithm>
 
+template <class T>
+static void gather_kinematics(kinematic_store& store, const std::vector<std::unique_ptr<T>>& container) {
+    store.resize(unsigned(container.size()));
+    for (unsigned i = 0; i < container.size(); ++i)
+        container[i]->set_kinematic_entry(&store, i);
+}
+
+// append entry for a spawned object, which is appended to the container afterwards
+template <class T>
+static void add_kinematic_entry(kinematic_store& store, const std::vector<std::unique_ptr<T>>& container, sea_object& obj) {
+    // objects added to the container directly, e.g. by loading, get their entries first
+    if (store.size() != container.size())
+        gather_kinematics(store, container);
+    const unsigned idx = store.size();
+    store.resize(idx + 1);
+    obj.set_kinematic_entry(&store, idx);
+}
+
 world::world() {
 }
 
@@ -39,26 +59,32 @@ world::~world() {
 }
 
 void world::spawn_ship(std::unique_ptr<ship> s) {
+    add_kinematic_entry(kinematics[kinematic_ships], ships, *s);
     ships.push_back(std::move(s));
 }
 
 void world::spawn_submarine(std::unique_ptr<submarine> u) {
+    add_kinematic_entry(kinematics[kinematic_submarines], submarines, *u);
     submarines.push_back(std::move(u));
 }
 
 void world::spawn_airplane(std::unique_ptr<airplane> a) {
+    add_kinematic_entry(kinematics[kinematic_airplanes], airplanes, *a);
     airplanes.push_back(std::move(a));
 }
 
 void world::spawn_torpedo(std::unique_ptr<torpedo> t) {
+    add_kinematic_entry(kinematics[kinematic_torpedoes], torpedoes, *t);
     torpedoes.push_back(std::move(t));
 }
 
 void world::spawn_gun_shell(std::unique_ptr<gun_shell> s) {
+    add_kinematic_entry(kinematics[kinematic_gun_shells], gun_shells, *s);
     gun_shells.push_back(std::move(s));
 }
 
 void world::spawn_depth_charge(std::unique_ptr<depth_charge> dc) {
+    add_kinematic_entry(kinematics[kinematic_depth_charges], depth_charges, *dc);
     depth_charges.push_back(std::move(dc));
 }
 
@@ -93,11 +119,260 @@ void world::cleanup_defunct_entities() {
     cleanup_container(gun_shells);
     cleanup_container(water_splashes);
     cleanup_container(particles);
+    update_kinematics();
+    update_spatial_indices();
+}
+
+void world::log_memory_pools() const {
+    gun_shell::get_pool().log_statistics();
+    depth_charge::get_pool().log_statistics();
+    water_splash::get_pool().log_statistics();
+    particle::get_pool().log_statistics();
+}
+
+void world::publish_kinematics() {
+    for (auto& k : kinematics)
+        k.publish();
+}
+
+void world::update_kinematics() {
+    gather_kinematics(kinematics[kinematic_ships], ships);
+    gather_kinematics(kinematics[kinematic_submarines], submarines);
+    gather_kinematics(kinematics[kinematic_airplanes], airplanes);
+    gather_kinematics(kinematics[kinematic_torpedoes], torpedoes);
+    gather_kinematics(kinematics[kinematic_depth_charges], depth_charges);
+    gather_kinematics(kinematics[kinematic_gun_shells], gun_shells);
+}
+
+const double world::spatial_query_margin = 250.0;
+
+template <class T>
+static void build_index(spatial_index& idx, const std::vector<std::unique_ptr<T>>& container) {
+    std::vector<vector2> positions(container.size());
+    for (unsigned i = 0; i < container.size(); ++i)
+        positions[i] = container[i]->get_pos().xy();
+    idx.build(positions);
+}
+
+// read positions from packed state if it matches the container
+template <class T>
+static void build_index(spatial_index& idx, const kinematic_store& store, const std::vector<std::unique_ptr<T>>& container) {
+    if (store.size() != container.size()) {
+        build_index(idx, container);
+        return;
+    }
+    std::vector<vector2> positions;
+    store.get_positions_2d(positions);
+    idx.build(positions);
+}
+
+template <class T>
+static double compute_max_collision_radius(const std::vector<std::unique_ptr<T>>& container) {
+    double r = 0.0;
+    for (auto& s : container)
+        r = std::max(r, s->get_collision_radius());
+    return r;
+}
+
+// extract records once, so sensors can test many targets without virtual calls per pair
+template <class T>
+static void extract_sensor_targets(std::vector<sensor_target>& targets, const std::vector<std::unique_ptr<T>>& container) {
+    targets.resize(container.size());
+    for (unsigned i = 0; i < container.size(); ++i)
+        container[i]->get_sensor_target(targets[i]);
+}
+
+template <class T>
+static void gather_sensor_targets(const std::vector<sensor_target>& extracted,
+                                  const std::vector<std::unique_ptr<T>>& container,
+                                  const std::vector<unsigned>& objects, std::vector<sensor_target>& result) {
+    // like the index, the records can't be used when objects were removed without rebuilding
+    const unsigned nr_valid = (extracted.size() <= container.size()) ? unsigned(extracted.size()) : 0;
+    result.resize(objects.size());
+    for (unsigned j = 0; j < objects.size(); ++j) {
+        const unsigned i = objects[j];
+        if (i < nr_valid)
+            result[j] = extracted[i];
+        else
+            container[i]->get_sensor_target(result[j]);
+    }
+}
+
+void world::update_spatial_indices() {
+    build_index(indices[indexed_ships], kinematics[kinematic_ships], ships);
+    build_index(indices[indexed_submarines], kinematics[kinematic_submarines], submarines);
+    max_collision_radius[indexed_ships] = compute_max_collision_radius(ships);
+    max_collision_radius[indexed_submarines] = compute_max_collision_radius(submarines);
+    extract_sensor_targets(sensor_targets[indexed_ships], ships);
+    extract_sensor_targets(sensor_targets[indexed_submarines], submarines);
+    extract_sensor_targets(sensor_targets[indexed_airplanes], airplanes);
+    extract_sensor_targets(sensor_targets[indexed_depth_charges], depth_charges);
+    extract_sensor_targets(sensor_targets[indexed_gun_shells], gun_shells);
+    build_index(indices[indexed_airplanes], kinematics[kinematic_airplanes], airplanes);
+    build_index(indices[indexed_depth_charges], kinematics[kinematic_depth_charges], depth_charges);
+    build_index(indices[indexed_gun_shells], kinematics[kinematic_gun_shells], gun_shells);
+    build_index(indices[indexed_particles], particles);
+    particle_records.resize(particles.size());
+    for (unsigned i = 0; i < particles.size(); ++i)
+        particle_records[i] = {particles[i]->get_pos().xy(), particles[i]->get_width() * particles[i]->get_height()};
+}
+
+unsigned world::get_nr_of_objects(indexed_type t) const {
+    switch (t) {
+    case indexed_ships:
+        return unsigned(ships.size());
+    case indexed_submarines:
+        return unsigned(submarines.size());
+    case indexed_airplanes:
+        return unsigned(airplanes.size());
+    case indexed_depth_charges:
+        return unsigned(depth_charges.size());
+    case indexed_gun_shells:
+        return unsigned(gun_shells.size());
+    case indexed_particles:
+        return unsigned(particles.size());
+    default:
+        throw error("world: invalid indexed type");
+    }
+}
+
+void world::add_unindexed_objects(indexed_type t, std::vector<unsigned>& result) const {
+    const unsigned n = get_nr_of_objects(t);
+    const unsigned nidx = indices[t].get_nr_of_objects();
+    if (n < nidx) {
+        // objects were removed without rebuilding the index, so it can't be used
+        result.resize(n);
+        for (unsigned i = 0; i < n; ++i)
+            result[i] = i;
+        return;
+    }
+    // objects spawned after the last rebuild are appended, so their indices are higher
+    for (unsigned i = nidx; i < n; ++i)
+        result.push_back(i);
+}
+
+void world::query_range(indexed_type t, const vector2& center, double radius, std::vector<unsigned>& result) const {
+    indices[t].query(center, radius + spatial_query_margin, result);
+    add_unindexed_objects(t, result);
+}
+
+void world::query_sector(indexed_type t, const vector2& center, double radius, angle direction, double half_angle,
+                         std::vector<unsigned>& result) const {
+    indices[t].query_sector(center, radius, direction, half_angle, spatial_query_margin, result);
+    add_unindexed_objects(t, result);
+}
+
+// keep only candidates whose collision sphere is touched by the swept sphere
+template <class T>
+static void filter_swept_sphere(const std::vector<std::unique_ptr<T>>& container, const vector3& p0,
+                                const vector3& p1, double radius, std::vector<unsigned>& result) {
+    unsigned j = 0;
+    for (unsigned i = 0; i < result.size(); ++i) {
+        const T* s = container[result[i]].get();
+        if (sphere(s->get_step_pos(), s->get_collision_radius()).intersects_swept(p0, p1, radius))
+            result[j++] = result[i];
+    }
+    result.resize(j);
+}
+
+void world::query_swept_sphere(indexed_type t, const vector3& p0, const vector3& p1, double radius,
+                               std::vector<unsigned>& result) const {
+    // the circle around the segment's center must contain every sphere that can be touched
+    vector2 center = (p0.xy() + p1.xy()) * 0.5;
+    double range = p0.xy().distance(p1.xy()) * 0.5 + radius + max_collision_radius[t];
+    query_range(t, center, range, result);
+    switch (t) {
+    case indexed_ships:
+        filter_swept_sphere(ships, p0, p1, radius, result);
+        break;
+    case indexed_submarines:
+        filter_swept_sphere(submarines, p0, p1, radius, result);
+        break;
+    default:
+        throw error("world: swept sphere query only for ships and submarines");
+    }
+}
+
+void world::get_sensor_targets(indexed_type t, const std::vector<unsigned>& objects,
+                               std::vector<sensor_target>& result) const {
+    switch (t) {
+    case indexed_ships:
+        gather_sensor_targets(sensor_targets[t], ships, objects, result);
+        break;
+    case indexed_submarines:
+        gather_sensor_targets(sensor_targets[t], submarines, objects, result);
+        break;
+    case indexed_airplanes:
+        gather_sensor_targets(sensor_targets[t], airplanes, objects, result);
+        break;
+    case indexed_depth_charges:
+        gather_sensor_targets(sensor_targets[t], depth_charges, objects, result);
+        break;
+    case indexed_gun_shells:
+        gather_sensor_targets(sensor_targets[t], gun_shells, objects, result);
+        break;
+    default:
+        throw error("world: no sensor records for indexed type");
+    }
+}
+
+void world::detect(const game* gm, const sensor* s, const sea_object* o, indexed_type t,
+                   std::vector<unsigned>& objects) const {
+    std::vector<sensor_target> targets;
+    get_sensor_targets(t, objects, targets);
+    sensor_target d;
+    o->get_sensor_target(d);
+    sensor_detection::mask detected;
+    s->detect(gm, d, targets, detected);
+    unsigned j = 0;
+    for (unsigned i = 0; i < objects.size(); ++i)
+        if (sensor_detection::test(detected, i))
+            objects[j++] = objects[i];
+    objects.resize(j);
+}
+
+void world::detect(const game* gm, const passive_sonar_sensor* s, const sea_object* o, indexed_type t,
+                   std::vector<unsigned>& objects, std::vector<double>& sound_levels) const {
+    std::vector<sensor_target> targets;
+    get_sensor_targets(t, objects, targets);
+    sensor_target d;
+    o->get_sensor_target(d);
+    sensor_detection::mask detected;
+    std::vector<double> levels;
+    s->detect(gm, d, targets, detected, levels);
+    unsigned j = 0;
+    sound_levels.clear();
+    for (unsigned i = 0; i < objects.size(); ++i) {
+        if (sensor_detection::test(detected, i)) {
+            objects[j++] = objects[i];
+            sound_levels.push_back(levels[i]);
+        }
+    }
+    objects.resize(j);
+}
+
+// keep objects that can be referenced at step start except self, reads the packed state if it matches the container
+template <class T>
+static void filter_step_reference_ok(const kinematic_store& store, const std::vector<std::unique_ptr<T>>& container,
+                                     const sea_object* self, std::vector<unsigned>& objects) {
+    if (store.size() == container.size()) {
+        unsigned skip = (self && self->get_kinematic_store() == &store) ? self->get_kinematic_index()
+                                                                          : kinematic_store::no_entry;
+        store.filter_state(objects, uint8_t(sea_object::inactive), skip);
+        return;
+    }
+    objects.erase(std::remove_if(objects.begin(), objects.end(),
+                                 [&](unsigned i) {
+                                     return !container[i] || !container[i]->is_step_reference_ok() ||
+                                            container[i].get() == self;
+                                 }),
+                  objects.end());
 }
 
 // Helper template for visibility detection
 template <class T>
-static std::vector<T*> visible_obj(const game* gm, const std::vector<std::unique_ptr<T>>& v, const sea_object* o) {
+static std::vector<T*> visible_obj(const game* gm, const world& w, world::indexed_type t, const kinematic_store& store,
+                                   const std::vector<std::unique_ptr<T>>& v, const sea_object* o) {
     std::vector<T*> result;
     const sensor* s = o->get_sensor(o->lookout_system);
     if (!s)
@@ -105,32 +380,42 @@ static std::vector<T*> visible_obj(const game* gm, const std::vector<std::unique
     const lookout_sensor* ls = dynamic_cast<const lookout_sensor*>(s);
     if (!ls)
         return result;
-    result.reserve(v.size());
-    for (unsigned i = 0; i < v.size(); ++i) {
-        if (v[i] && v[i]->is_reference_ok()) {
-            if (ls->is_detected(gm, o, v[i].get()))
-                result.push_back(v[i].get());
-        }
-    }
+    // lookouts can't see farther than max view distance
+    std::vector<unsigned> candidates;
+    w.query_range(t, o->get_pos().xy(), gm->get_max_view_distance(), candidates);
+    filter_step_reference_ok(store, v, nullptr, candidates);
+    w.detect(gm, ls, o, t, candidates);
+    result.reserve(candidates.size());
+    for (unsigned i : candidates)
+        result.push_back(v[i].get());
     return result;
 }
 
 std::vector<ship*> world::visible_ships(const game* gm, const sea_object* o) const {
-    return visible_obj<ship>(gm, ships, o);
+    return visible_obj<ship>(gm, *this, indexed_ships, kinematics[kinematic_ships], ships, o);
 }
 
 std::vector<submarine*> world::visible_submarines(const game* gm, const sea_object* o) const {
-    return visible_obj<submarine>(gm, submarines, o);
+    return visible_obj<submarine>(gm, *this, indexed_submarines, kinematics[kinematic_submarines], submarines, o);
 }
 
 std::vector<airplane*> world::visible_airplanes(const game* gm, const sea_object* o) const {
-    return visible_obj<airplane>(gm, airplanes, o);
+    return visible_obj<airplane>(gm, *this, indexed_airplanes, kinematics[kinematic_airplanes], airplanes, o);
 }
 
 std::vector<torpedo*> world::visible_torpedoes(const game* gm, const sea_object* o) const {
     std::vector<torpedo*> result;
+    const kinematic_store& store = kinematics[kinematic_torpedoes];
+    if (store.size() == torpedoes.size()) {
+        std::vector<unsigned> found;
+        store.find_state(uint8_t(sea_object::inactive), found);
+        result.reserve(found.size());
+        for (unsigned k : found)
+            result.push_back(torpedoes[k].get());
+        return result;
+    }
     for (unsigned k = 0; k < torpedoes.size(); ++k) {
-        if (torpedoes[k] && torpedoes[k]->is_reference_ok()) {
+        if (torpedoes[k] && torpedoes[k]->is_step_reference_ok()) {
             result.push_back(torpedoes[k].get());
         }
     }
@@ -138,11 +423,12 @@ std::vector<torpedo*> world::visible_torpedoes(const game* gm, const sea_object*
 }
 
 std::vector<depth_charge*> world::visible_depth_charges(const game* gm, const sea_object* o) const {
-    return visible_obj<depth_charge>(gm, depth_charges, o);
+    return visible_obj<depth_charge>(gm, *this, indexed_depth_charges, kinematics[kinematic_depth_charges],
+                                     depth_charges, o);
 }
 
 std::vector<gun_shell*> world::visible_gun_shells(const game* gm, const sea_object* o) const {
-    return visible_obj<gun_shell>(gm, gun_shells, o);
+    return visible_obj<gun_shell>(gm, *this, indexed_gun_shells, kinematics[kinematic_gun_shells], gun_shells, o);
 }
 
 std::vector<water_splash*> world::visible_water_splashes(const game* gm, const sea_object* o) const {
@@ -160,11 +446,24 @@ std::vector<particle*> world::visible_particles(const game* gm, const sea_object
     const lookout_sensor* ls = dynamic_cast<const lookout_sensor*>(s);
     if (!ls)
         return result;
-    result.reserve(particles.size());
-    for (unsigned i = 0; i < particles.size(); ++i) {
+    std::vector<unsigned> candidates;
+    const vector2 viewer = o->get_pos().xy();
+    const double max_view_dist = gm->get_max_view_distance();
+    query_range(indexed_particles, viewer, max_view_dist, candidates);
+    // particles are simulated in parallel, so test their state at step start. Like the index,
+    // the records can't be used when particles were removed without rebuilding.
+    const unsigned nr_valid = (particle_records.size() <= particles.size()) ? unsigned(particle_records.size()) : 0;
+    result.reserve(candidates.size());
+    for (unsigned i : candidates) {
         if (particles[i] == 0)
             throw error("particles[i] is 0!");
-        if (ls->is_detected(gm, o, particles[i].get()))
+        bool detected;
+        if (i < nr_valid)
+            detected = lookout_sensor::particle_detected(max_view_dist, viewer, particle_records[i].pos,
+                                                         particle_records[i].area);
+        else
+            detected = ls->is_detected(gm, o, particles[i].get());
+        if (detected)
             result.push_back(particles[i].get());
     }
     return result;
@@ -210,15 +509,13 @@ std::vector<sonar_contact> world::sonar_ships(const game* gm, const sea_object*
     if (!pss)
         return result;
 
-    result.reserve(ships.size());
-    for (unsigned k = 0; k < ships.size(); ++k) {
-        if (!ships[k]->is_reference_ok())
-            continue;
-        if (o == ships[k].get())
-            continue;
-        if (pss->is_detected(gm, o, ships[k].get()))
-            result.push_back(sonar_contact(ships[k]->get_pos().xy(), ships[k]->get_class()));
-    }
+    std::vector<unsigned> candidates;
+    query_range(indexed_ships, o->get_pos().xy(), pss->get_range(), candidates);
+    filter_step_reference_ok(kinematics[kinematic_ships], ships, o, candidates);
+    detect(gm, pss, o, indexed_ships, candidates);
+    result.reserve(candidates.size());
+    for (unsigned k : candidates)
+        result.push_back(sonar_contact(ships[k]->get_step_pos().xy(), ships[k]->get_class()));
     return result;
 }
 
@@ -231,14 +528,12 @@ std::vector<sonar_contact> world::sonar_submarines(const game* gm, const sea_obj
     if (!pss)
         return result;
 
-    for (unsigned k = 0; k < submarines.size(); ++k) {
-        if (!submarines[k]->is_reference_ok())
-            continue;
-        if (o == submarines[k].get())
-            continue;
-        if (pss->is_detected(gm, o, submarines[k].get()))
-            result.push_back(sonar_contact(submarines[k]->get_pos().xy(), submarines[k]->get_class()));
-    }
+    std::vector<unsigned> candidates;
+    query_range(indexed_submarines, o->get_pos().xy(), pss->get_range(), candidates);
+    filter_step_reference_ok(kinematics[kinematic_submarines], submarines, o, candidates);
+    detect(gm, pss, o, indexed_submarines, candidates);
+    for (unsigned k : candidates)
+        result.push_back(sonar_contact(submarines[k]->get_step_pos().xy(), submarines[k]->get_class()));
     return result;
 }
 
@@ -261,23 +556,23 @@ ship* world::sonar_acoustical_torpedo_target(const game* gm, const torpedo* o) c
         pss = dynamic_cast<const passive_sonar_sensor*>(s);
 
     if (pss) {
-        for (unsigned k = 0; k < ships.size(); ++k) {
-            double sf = 0.0f;
-            if (pss->is_detected(sf, gm, o, ships[k].get())) {
-                if (sf > loudest_object_sf) {
-                    loudest_object_sf = sf;
-                    loudest_object = ships[k].get();
-                }
+        std::vector<unsigned> candidates;
+        std::vector<double> sound_levels;
+        query_range(indexed_ships, o->get_pos().xy(), pss->get_range(), candidates);
+        detect(gm, pss, o, indexed_ships, candidates, sound_levels);
+        for (unsigned j = 0; j < candidates.size(); ++j) {
+            if (sound_levels[j] > loudest_object_sf) {
+                loudest_object_sf = sound_levels[j];
+                loudest_object = ships[candidates[j]].get();
             }
         }
 
-        for (unsigned k = 0; k < submarines.size(); ++k) {
-            double sf = 0.0f;
-            if (pss->is_detected(sf, gm, o, submarines[k].get())) {
-                if (sf > loudest_object_sf) {
-                    loudest_object_sf = sf;
-                    loudest_object = submarines[k].get();
-                }
+        query_range(indexed_submarines, o->get_pos().xy(), pss->get_range(), candidates);
+        detect(gm, pss, o, indexed_submarines, candidates, sound_levels);
+        for (unsigned j = 0; j < candidates.size(); ++j) {
+            if (sound_levels[j] > loudest_object_sf) {
+                loudest_object_sf = sound_levels[j];
+                loudest_object = submarines[candidates[j]].get();
             }
         }
     }
@@ -292,11 +587,12 @@ std::vector<submarine*> world::radar_submarines(const game* gm, const sea_object
     const lookout_sensor* ls = dynamic_cast<const lookout_sensor*>(s);
     if (!ls)
         return result;
-    result.reserve(submarines.size());
-    for (unsigned k = 0; k < submarines.size(); ++k) {
-        if (ls->is_detected(gm, o, submarines[k].get()))
-            result.push_back(submarines[k].get());
-    }
+    std::vector<unsigned> candidates;
+    query_range(indexed_submarines, o->get_pos().xy(), gm->get_max_view_distance(), candidates);
+    detect(gm, ls, o, indexed_submarines, candidates);
+    result.reserve(candidates.size());
+    for (unsigned k : candidates)
+        result.push_back(submarines[k].get());
     return result;
 }
 
@@ -308,11 +604,12 @@ std::vector<ship*> world::radar_ships(const game* gm, const sea_object* o) const
     const lookout_sensor* ls = dynamic_cast<const lookout_sensor*>(s);
     if (!ls)
         return result;
-    result.reserve(ships.size());
-    for (unsigned k = 0; k < ships.size(); ++k) {
-        if (ls->is_detected(gm, o, ships[k].get()))
-            result.push_back(ships[k].get());
-    }
+    std::vector<unsigned> candidates;
+    query_range(indexed_ships, o->get_pos().xy(), gm->get_max_view_distance(), candidates);
+    detect(gm, ls, o, indexed_ships, candidates);
+    result.reserve(candidates.size());
+    for (unsigned k : candidates)
+        result.push_back(ships[k].get());
     return result;
 }
 
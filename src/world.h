@@ -23,6 +23,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #ifndef WORLD_H
 #define WORLD_H
 
+#include "angle.h"
+#include "kinematic_store.h"
+#include "sensor_detection.h"
+#include "spatial_index.h"
+#include "vector2.h"
+#include "vector3.h"
 #include <list>
 #include <memory>
 #include <vector>
@@ -39,6 +45,8 @@ class particle;
 class convoy;
 class sea_object;
 class game;
+class sensor;
+class passive_sonar_sensor;
 struct sonar_contact;
 
 ///\brief Container for all game world entities and their interactions
@@ -80,9 +88,82 @@ class world {
     void spawn_convoy(std::unique_ptr<convoy> cv);
     void spawn_particle(std::unique_ptr<particle> pt);
 
-    // Cleanup defunct entities
+    // Cleanup defunct entities, rebuilds the kinematic stores and spatial indices afterwards
     void cleanup_defunct_entities();
 
+    /// object types that have a packed kinematic state
+    enum kinematic_type {
+        kinematic_ships,
+        kinematic_submarines,
+        kinematic_airplanes,
+        kinematic_torpedoes,
+        kinematic_depth_charges,
+        kinematic_gun_shells,
+        nr_of_kinematic_types
+    };
+
+    /// gather kinematic state of all objects again and assign their entries.
+    ///@note entry i belongs to object i of the container. Entries are only written
+    ///	here, when objects are spawned or manipulated, so they are the state at
+    ///	the start of the simulation step.
+    void update_kinematics();
+
+    /// make the kinematic state objects stored in simulate visible, see kinematic_store::publish
+    void publish_kinematics();
+
+    /// get packed kinematic state of an object type
+    const kinematic_store& get_kinematics(kinematic_type t) const { return kinematics[t]; }
+
+    /// write usage of memory pools of short lived objects to log
+    void log_memory_pools() const;
+
+    /// object types that have a spatial index
+    enum indexed_type {
+        indexed_ships,
+        indexed_submarines,
+        indexed_airplanes,
+        indexed_depth_charges,
+        indexed_gun_shells,
+        indexed_particles,
+        nr_of_indexed_types
+    };
+
+    /// objects move while the index is in use, so queries are enlarged by this distance (meters).
+    /// It also covers the offset of noise sources or other sensor points from the object center.
+    static const double spatial_query_margin;
+
+    /// rebuild spatial indices from current object positions
+    void update_spatial_indices();
+
+    /// get spatial index of an object type
+    const spatial_index& get_spatial_index(indexed_type t) const { return indices[t]; }
+
+    /// collect indices of objects that may be within radius around center.
+    ///@note the result contains all objects within radius and maybe some more,
+    ///	objects spawned since the last rebuild are always contained. Sorted ascending.
+    void query_range(indexed_type t, const vector2& center, double radius, std::vector<unsigned>& result) const;
+
+    /// collect indices of objects that may be within a circle sector, like query_range
+    ///@param direction - direction of sector center line
+    ///@param half_angle - half opening angle in degrees
+    void query_sector(indexed_type t, const vector2& center, double radius, angle direction, double half_angle,
+                      std::vector<unsigned>& result) const;
+
+    /// collect indices of ships or submarines whose collision sphere is touched by a sphere
+    /// moving from p0 to p1 (swept sphere). Unlike query_range the result is exact.
+    ///@note use p0 == p1 for a static sphere. Sorted ascending.
+    void query_swept_sphere(indexed_type t, const vector3& p0, const vector3& p1, double radius,
+                            std::vector<unsigned>& result) const;
+
+    /// keep only objects of a type that sensor s of object o detects, batch version of
+    /// sensor::is_detected. Not for particles. The order of objects is kept.
+    ///@param objects - indices of objects to test
+    void detect(const game* gm, const sensor* s, const sea_object* o, indexed_type t,
+                std::vector<unsigned>& objects) const;
+    /// like detect for passive sonars, also give the sound level of every object kept
+    void detect(const game* gm, const passive_sonar_sensor* s, const sea_object* o, indexed_type t,
+                std::vector<unsigned>& objects, std::vector<double>& sound_levels) const;
+
     // Get count of entities
     size_t get_ship_count() const { return ships.size(); }
     size_t get_submarine_count() const { return submarines.size(); }
@@ -124,6 +205,30 @@ class world {
     std::vector<std::unique_ptr<convoy>> convoys;
     std::vector<std::unique_ptr<particle>> particles;
 
+    // Packed kinematic state, rebuilt after cleanup
+    kinematic_store kinematics[nr_of_kinematic_types];
+
+    // Spatial indices, rebuilt after cleanup
+    spatial_index indices[nr_of_indexed_types];
+
+    // largest collision radius of indexed ships and submarines, updated with the indices
+    double max_collision_radius[nr_of_indexed_types] = {};
+
+    // sensor records of sea objects, extracted with the indices
+    std::vector<sensor_target> sensor_targets[nr_of_indexed_types];
+
+    // position and visible area of particles, extracted with the indices
+    struct particle_record {
+        vector2 pos;
+        double area;
+    };
+    std::vector<particle_record> particle_records;
+
+    unsigned get_nr_of_objects(indexed_type t) const;
+    void add_unindexed_objects(indexed_type t, std::vector<unsigned>& result) const;
+    void get_sensor_targets(indexed_type t, const std::vector<unsigned>& objects,
+                            std::vector<sensor_target>& result) const;
+
   private:
     world(const world&) = delete;
     world& operator=(const world&) = delete;